@@ -0,0 +1,369 @@
+/**
+ * Automatic baudrate detection: reopen scan versus ser_autobaud().
+ *
+ * A device emulated on the other side of the link runs at a fixed baudrate,
+ * and answers a probe with "OK" only if the port runs at the same baudrate
+ * (read back from the port settings). Otherwise it answers with noise, as the
+ * garbled probe would make it. The baudrate is detected using:
+ *
+ * - reopen: for each candidate, ser_open() at that baudrate, probe, wait for
+ *   the answer (or the listening time), ser_close().
+ * - autobaud: ser_autobaud() with the same probe and expected answer.
+ *
+ * Both try the same candidates (built-in table order), and the detection time
+ * is reported for several device baudrates. Pseudo-terminals do not produce
+ * framing or parity errors, so wrong baudrates are rejected on the answer
+ * contents only (real ports also reject them on errors).
+ */
+
+#include "bench.h"
+
+#include <poll.h>
+
+/** Probe. */
+#define PROBE "AT\r"
+
+/** Expected answer. */
+#define ANSWER "OK\r\n"
+
+/** Listening time at each baudrate (ms). */
+#define LISTEN 20U
+
+/** Candidate baudrates (as in the library built-in table). */
+static const uint32_t rates[] = {
+    115200U, 9600U, 57600U, 19200U, 38400U, 230400U, 460800U, 921600U,
+    4800U, 2400U, 1000000U, 500000U, 250000U, 2000000U, 3000000U, 4000000U,
+    1500000U, 1200U, 600U, 300U
+};
+
+/** Emulated device. */
+typedef struct
+{
+    /** Master side file descriptor */
+    int fd;
+    /** Slave side file descriptor (port settings readback) */
+    int sfd;
+    /** Device baudrate */
+    speed_t speed;
+    /** Stop requested */
+    volatile int stop;
+} device_t;
+
+/**
+ * Map a baudrate to a termios speed.
+ *
+ * @param [in] baudrate
+ *      Baudrate.
+ *
+ * @return
+ *      Speed (B0 if not a standard one).
+ */
+static speed_t to_speed(uint32_t baudrate)
+{
+    switch (baudrate)
+    {
+        case 1200U:
+            return B1200;
+        case 9600U:
+            return B9600;
+        case 38400U:
+            return B38400;
+        case 115200U:
+            return B115200;
+        case 921600U:
+            return B921600;
+        default:
+            return B0;
+    }
+}
+
+/**
+ * Device thread: answer probes.
+ *
+ * @param [in] args
+ *      Emulated device (device_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *device(void *args)
+{
+    device_t *dev = args;
+    unsigned seed = 1U;
+
+    while (!dev->stop)
+    {
+        struct pollfd pfd;
+        struct termios tios;
+        uint8_t buf[64];
+        ssize_t n;
+
+        pfd.fd = dev->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if (poll(&pfd, 1U, 10) <= 0)
+        {
+            continue;
+        }
+
+        n = read(dev->fd, buf, sizeof(buf));
+        if ((n <= 0) || (buf[n - 1] != '\r'))
+        {
+            continue;
+        }
+
+        if ((tcgetattr(dev->sfd, &tios) == 0) &&
+            (cfgetospeed(&tios) == dev->speed))
+        {
+            (void)write(dev->fd, ANSWER, sizeof(ANSWER) - 1U);
+        }
+        else
+        {
+            size_t i;
+
+            for (i = 0U; i < 8U; i++)
+            {
+                buf[i] = (uint8_t)(rand_r(&seed) & 0xFF);
+            }
+
+            (void)write(dev->fd, buf, 8U);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Detect by reopening the port at each candidate baudrate.
+ *
+ * @param [in] ser
+ *      Library instance (closed).
+ * @param [in] port
+ *      Port name.
+ * @param [out] baudrate
+ *      Detected baudrate.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t reopen_scan(ser_t *ser, const char *port, uint32_t *baudrate)
+{
+    size_t i;
+
+    for (i = 0U; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        int32_t r;
+
+        ser_opts_t opts = SER_OPTS_INIT;
+        ser_deadline_t deadline;
+        char buf[64];
+        size_t got = 0U;
+        int found = 0;
+
+        opts.port = port;
+        opts.baudrate = rates[i];
+        opts.timeouts.wr = 1000;
+
+        r = ser_open(ser, &opts);
+        if (r < 0)
+        {
+            return r;
+        }
+
+        deadline = ser_deadline_in((int32_t)LISTEN);
+
+        r = ser_write_until(ser, PROBE, sizeof(PROBE) - 1U, NULL, &deadline);
+
+        while ((r == 0) && !found && (got < sizeof(buf) - 1U))
+        {
+            size_t recvd = 0U;
+
+            r = ser_read_wait_until(ser, &deadline);
+            if (r == 0)
+            {
+                r = ser_try_read(ser, &buf[got], sizeof(buf) - 1U - got,
+                                 &recvd);
+                if (r == SER_EEMPTY)
+                {
+                    r = 0;
+                }
+            }
+
+            got += recvd;
+            buf[got] = '\0';
+            found = (memmem(buf, got, ANSWER, sizeof(ANSWER) - 1U) != NULL);
+        }
+
+        ser_close(ser);
+
+        if (found)
+        {
+            *baudrate = rates[i];
+            return 0;
+        }
+
+        if ((r < 0) && (r != SER_ETIMEDOUT))
+        {
+            return r;
+        }
+    }
+
+    return SER_EFAIL;
+}
+
+static int32_t run(uint32_t dev_rate, unsigned trials, int autobaud,
+                   double *ms)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    char port[64];
+    device_t dev;
+    pthread_t td;
+    int64_t total = 0;
+    unsigned i;
+
+    memset(&dev, 0, sizeof(dev));
+    dev.speed = to_speed(dev_rate);
+
+    dev.fd = bench_pty_open(port, sizeof(port));
+    if (dev.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    dev.sfd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (dev.sfd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal slave\n");
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_slave;
+    }
+
+    if (pthread_create(&td, NULL, device, &dev) != 0)
+    {
+        fprintf(stderr, "Could not start device\n");
+        r = -1;
+        goto cleanup_ser;
+    }
+
+    for (i = 0U; (i < trials) && (r == 0); i++)
+    {
+        uint32_t detected = 0U;
+        int64_t start;
+
+        if (autobaud)
+        {
+            ser_opts_t opts = SER_OPTS_INIT;
+            ser_autobaud_opts_t aopts = SER_AUTOBAUD_OPTS_INIT;
+
+            opts.port = port;
+            opts.baudrate = rates[0];
+            opts.timeouts.wr = 1000;
+
+            r = ser_open(ser, &opts);
+            if (r < 0)
+            {
+                break;
+            }
+
+            aopts.probe = PROBE;
+            aopts.probe_sz = sizeof(PROBE) - 1U;
+            aopts.expect = ANSWER;
+            aopts.expect_sz = sizeof(ANSWER) - 1U;
+            aopts.listen = LISTEN;
+
+            start = bench_now();
+            r = ser_autobaud(ser, &aopts, &detected);
+            total += bench_now() - start;
+
+            ser_close(ser);
+        }
+        else
+        {
+            start = bench_now();
+            r = reopen_scan(ser, port, &detected);
+            total += bench_now() - start;
+        }
+
+        if ((r == 0) && (detected != dev_rate))
+        {
+            fprintf(stderr, "Wrong baudrate detected: %u\n",
+                    (unsigned)detected);
+            r = -1;
+        }
+    }
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Detection failed: %s\n", sererr_last());
+    }
+    else
+    {
+        *ms = (double)total / 1e6 / (double)trials;
+    }
+
+    dev.stop = 1;
+    (void)pthread_join(td, NULL);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_slave:
+    close(dev.sfd);
+
+cleanup_pty:
+    close(dev.fd);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t dev_rates[] = { 115200U, 9600U, 38400U, 921600U,
+                                          1200U };
+
+    unsigned trials = 10U;
+    size_t i;
+
+    if (argc > 1)
+    {
+        trials = (unsigned)strtoul(argv[1], NULL, 0);
+    }
+
+    if (trials == 0U)
+    {
+        return 1;
+    }
+
+    printf("detection time (%u trials, %u ms listening per baudrate)\n",
+           trials, LISTEN);
+
+    for (i = 0U; i < sizeof(dev_rates) / sizeof(dev_rates[0]); i++)
+    {
+        double reopen = 0.0;
+        double autobaud = 0.0;
+
+        if ((run(dev_rates[i], trials, 0, &reopen) < 0) ||
+            (run(dev_rates[i], trials, 1, &autobaud) < 0))
+        {
+            return 1;
+        }
+
+        printf("device %7u bauds  reopen: %8.2f ms  autobaud: %8.2f ms\n",
+               (unsigned)dev_rates[i], reopen, autobaud);
+    }
+
+    return 0;
+}
@@ -0,0 +1,315 @@
+/**
+ * Benchmark helpers.
+ *
+ * Benchmarks run on a pseudo-terminal pair, so that no hardware is required:
+ * the library opens the slave side as a serial port, and the benchmark drives
+ * the master side (e.g. using a feeder thread that emulates a remote device
+ * streaming data at a given pace).
+ */
+
+#ifndef BENCH_BENCH_H_
+#define BENCH_BENCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <termios.h>
+#include <time.h>
+
+#include <sercomm/sercomm.h>
+
+/** Stream feeder (emulates a remote device). */
+typedef struct
+{
+    /** Master side file descriptor */
+    int fd;
+    /** Total number of bytes to send */
+    size_t total;
+    /** Bytes per chunk */
+    size_t chunk;
+    /** Interval between chunks (us) */
+    unsigned interval;
+} bench_feeder_t;
+
+/** Echo responder (emulates a remote device answering requests). */
+typedef struct
+{
+    /** Master side file descriptor */
+    int fd;
+    /** Number of requests to answer */
+    unsigned long count;
+    /** Request/response size (bytes, up to 256) */
+    size_t msg_sz;
+    /** Processing time before answering (us) */
+    unsigned delay;
+} bench_responder_t;
+
+/**
+ * Open a pseudo-terminal pair (raw mode).
+ *
+ * @param [out] name
+ *      Slave side name (port name).
+ * @param [in] name_sz
+ *      Name buffer size.
+ *
+ * @return
+ *      Master side file descriptor, -1 on failure.
+ */
+static inline int bench_pty_open(char *name, size_t name_sz)
+{
+    int fd;
+    struct termios tios;
+
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if ((grantpt(fd) < 0) || (unlockpt(fd) < 0) ||
+        (ptsname_r(fd, name, name_sz) != 0) || (tcgetattr(fd, &tios) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    cfmakeraw(&tios);
+    (void)tcsetattr(fd, TCSANOW, &tios);
+
+    return fd;
+}
+
+/**
+ * Obtain current monotonic time.
+ *
+ * @return
+ *      Time (ns).
+ */
+static inline int64_t bench_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((int64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/**
+ * Obtain the CPU time consumed by the calling thread.
+ *
+ * @return
+ *      CPU time (ns).
+ */
+static inline int64_t bench_thread_cpu(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return ((int64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/**
+ * Compare two samples (qsort).
+ *
+ * @param [in] a
+ *      First sample (int64_t).
+ * @param [in] b
+ *      Second sample (int64_t).
+ *
+ * @return
+ *      Comparison result.
+ */
+static inline int bench_cmp_i64(const void *a, const void *b)
+{
+    int64_t sa = *(const int64_t *)a;
+    int64_t sb = *(const int64_t *)b;
+
+    return (sa > sb) - (sa < sb);
+}
+
+/**
+ * Obtain the number of read system calls issued by the process so far.
+ *
+ * @note
+ *      Linux only (/proc/self/io), the read used to obtain the value itself is
+ *      not accounted.
+ *
+ * @return
+ *      Number of read system calls, -1 if not available.
+ */
+static inline long bench_syscr(void)
+{
+    FILE *f;
+    char line[64];
+    long syscr = -1;
+
+    f = fopen("/proc/self/io", "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (sscanf(line, "syscr: %ld", &syscr) == 1)
+        {
+            break;
+        }
+    }
+
+    fclose(f);
+
+    return syscr;
+}
+
+/**
+ * Obtain the number of read system calls issued by the calling thread.
+ *
+ * @note
+ *      Linux only (/proc/thread-self/io, falls back to the whole process), the
+ *      read used to obtain the value itself is not accounted.
+ *
+ * @return
+ *      Number of read system calls, -1 if not available.
+ */
+static inline long bench_thread_syscr(void)
+{
+    FILE *f;
+    char line[64];
+    long syscr = -1;
+
+    f = fopen("/proc/thread-self/io", "r");
+    if (f == NULL)
+    {
+        return bench_syscr();
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (sscanf(line, "syscr: %ld", &syscr) == 1)
+        {
+            break;
+        }
+    }
+
+    fclose(f);
+
+    return syscr;
+}
+
+/**
+ * Feeder thread: send a byte stream in chunks at a fixed pace.
+ *
+ * @param [in] args
+ *      Feeder (bench_feeder_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static inline void *bench_feeder(void *args)
+{
+    bench_feeder_t *feeder = args;
+    uint8_t buf[4096];
+    size_t sent = 0U;
+
+    while (sent < feeder->total)
+    {
+        size_t n;
+        size_t i;
+        ssize_t w;
+
+        n = feeder->total - sent;
+        if (n > feeder->chunk)
+        {
+            n = feeder->chunk;
+        }
+
+        if (n > sizeof(buf))
+        {
+            n = sizeof(buf);
+        }
+
+        for (i = 0U; i < n; i++)
+        {
+            buf[i] = (uint8_t)(sent + i);
+        }
+
+        w = write(feeder->fd, buf, n);
+        if (w > 0)
+        {
+            sent += (size_t)w;
+        }
+        else if ((w < 0) && (errno != EAGAIN) && (errno != EINTR))
+        {
+            break;
+        }
+
+        if (feeder->interval > 0U)
+        {
+            (void)usleep(feeder->interval);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Responder thread: echo back each request.
+ *
+ * @param [in] args
+ *      Responder (bench_responder_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static inline void *bench_responder(void *args)
+{
+    bench_responder_t *resp = args;
+    uint8_t buf[256];
+    unsigned long i;
+
+    if (resp->msg_sz > sizeof(buf))
+    {
+        return NULL;
+    }
+
+    for (i = 0U; i < resp->count; i++)
+    {
+        size_t recvd = 0U;
+
+        while (recvd < resp->msg_sz)
+        {
+            ssize_t n;
+
+            n = read(resp->fd, &buf[recvd], resp->msg_sz - recvd);
+            if (n > 0)
+            {
+                recvd += (size_t)n;
+            }
+            else if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+            {
+                return NULL;
+            }
+        }
+
+        if (resp->delay > 0U)
+        {
+            (void)usleep(resp->delay);
+        }
+
+        if (write(resp->fd, buf, resp->msg_sz) != (ssize_t)resp->msg_sz)
+        {
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+#endif
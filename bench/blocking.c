@@ -0,0 +1,204 @@
+/**
+ * Kernel-side blocking reads (VMIN/VTIME) versus the default wait + read path.
+ *
+ * A feeder thread emulates a device streaming small chunks at a fixed pace,
+ * and the whole stream is received using:
+ *
+ * - default mode: ser_read_wait() (ppoll) + ser_read() (read) on each wakeup.
+ * - blocking mode: ser_read() only, the kernel batches bytes (VMIN/VTIME).
+ *
+ * The number of system calls per mode is reported (read calls are measured
+ * using /proc/self/io, when available).
+ */
+
+#include "bench.h"
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Total number of bytes */
+    size_t total;
+    /** Feeder chunk size (bytes) */
+    size_t chunk;
+    /** Feeder interval (us) */
+    unsigned interval;
+    /** VMIN (blocking mode) */
+    uint8_t vmin;
+    /** VTIME (blocking mode) */
+    uint8_t vtime;
+} params_t;
+
+static int32_t run(const params_t *params, int blocking)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    bench_feeder_t feeder;
+    pthread_t td;
+    uint8_t buf[4096];
+    size_t recvd = 0U;
+    unsigned long reads = 0U;
+    unsigned long waits = 0U;
+    long syscr_start;
+    long syscr_end;
+    int64_t start;
+    int64_t elapsed;
+
+    feeder.fd = bench_pty_open(port, sizeof(port));
+    if (feeder.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    feeder.total = params->total;
+    feeder.chunk = params->chunk;
+    feeder.interval = params->interval;
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.rd = 1000;
+    opts.blocking.enabled = (uint8_t)blocking;
+    opts.blocking.vmin = params->vmin;
+    opts.blocking.vtime = params->vtime;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    if (pthread_create(&td, NULL, bench_feeder, &feeder) != 0)
+    {
+        fprintf(stderr, "Could not start feeder\n");
+        r = -1;
+        goto cleanup_close;
+    }
+
+    start = bench_now();
+    syscr_start = bench_syscr();
+
+    while (recvd < params->total)
+    {
+        size_t n;
+
+        r = ser_read(ser, buf, sizeof(buf), &n);
+        reads++;
+
+        if (r == 0)
+        {
+            recvd += n;
+        }
+        else if (r == SER_EEMPTY)
+        {
+            /* blocking mode: VTIME expired, just read again */
+            if (blocking)
+            {
+                continue;
+            }
+
+            r = ser_read_wait(ser);
+            waits++;
+            if (r < 0)
+            {
+                fprintf(stderr, "Error while waiting: %s\n", sererr_last());
+                break;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Could not read: %s\n", sererr_last());
+            break;
+        }
+    }
+
+    syscr_end = bench_syscr();
+    elapsed = bench_now() - start;
+
+    (void)pthread_join(td, NULL);
+
+    if (r == 0)
+    {
+        printf("%-9s  bytes: %zu  reads: %lu  waits: %lu  syscalls: %lu  "
+               "bytes/read: %.1f  time: %.1f ms\n",
+               blocking ? "blocking" : "default", recvd, reads, waits,
+               reads + waits, (double)recvd / (double)reads,
+               (double)elapsed / 1e6);
+
+        if ((syscr_start >= 0) && (syscr_end >= 0))
+        {
+            printf("%-9s  read syscalls measured: %ld\n", "",
+                   syscr_end - syscr_start - 1);
+        }
+    }
+
+cleanup_close:
+    ser_close(ser);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(feeder.fd);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.total = 1024U * 1024U;
+    params.chunk = 16U;
+    params.interval = 50U;
+    params.vmin = 255U;
+    params.vtime = 1U;
+
+    if (argc > 1)
+    {
+        params.total = (size_t)strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.chunk = (size_t)strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3)
+    {
+        params.interval = (unsigned)strtoul(argv[3], NULL, 0);
+    }
+
+    if (argc > 4)
+    {
+        params.vmin = (uint8_t)strtoul(argv[4], NULL, 0);
+    }
+
+    if (argc > 5)
+    {
+        params.vtime = (uint8_t)strtoul(argv[5], NULL, 0);
+    }
+
+    printf("stream: %zu bytes, %zu bytes every %u us (VMIN=%u, VTIME=%u)\n",
+           params.total, params.chunk, params.interval, params.vmin,
+           params.vtime);
+
+    if ((run(&params, 0) < 0) || (run(&params, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,421 @@
+/**
+ * Cyclic exchanges: user loop with usleep() versus the cyclic executor.
+ *
+ * Two ports run 8-byte setpoint/feedback exchanges with an echoing responder
+ * at a fixed rate. The same number of cycles is run from a user loop (both
+ * exchanges, then usleep() for the period) and from a cyclic executor shared
+ * by both ports (second port half a period out of phase). The achieved rate
+ * and the cycle start error (against the ideal schedule) are reported, as well
+ * as the executor jitter histogram.
+ */
+
+#include "bench.h"
+
+/** Request/response size (bytes). */
+#define MSG_SZ 8U
+
+/** Number of ports. */
+#define PORTS 2U
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of cycles */
+    unsigned long count;
+    /** Period (us) */
+    uint32_t period_us;
+} params_t;
+
+/** Port under test. */
+typedef struct
+{
+    /** Library instance */
+    ser_t *ser;
+    /** Responder */
+    bench_responder_t resp;
+    /** Responder thread */
+    pthread_t td;
+    /** Cycle start times (ns) */
+    int64_t *starts;
+    /** Cycle numbers */
+    uint64_t *ids;
+    /** Number of cycles run */
+    unsigned long cycles;
+    /** Number of cycles to run */
+    unsigned long count;
+    /** Failed exchanges */
+    unsigned long failed;
+} port_t;
+
+/**
+ * Request fill hook: record the cycle start and send the cycle number.
+ *
+ * @param [in] ctx
+ *      Port.
+ * @param [in] cycle
+ *      Cycle number.
+ * @param [out] buf
+ *      Request buffer.
+ * @param [in] cap
+ *      Request buffer size.
+ * @param [out] sz
+ *      Request size.
+ *
+ * @return
+ *      Always 0.
+ */
+static int32_t fill(void *ctx, uint64_t cycle, uint8_t *buf, size_t cap,
+                    size_t *sz)
+{
+    port_t *port = ctx;
+
+    (void)cap;
+
+    if (port->cycles == port->count)
+    {
+        *sz = 0U;
+        return 0;
+    }
+
+    port->ids[port->cycles] = cycle;
+    port->starts[port->cycles++] = bench_now();
+
+    memset(buf, 0, MSG_SZ);
+    memcpy(buf, &cycle, sizeof(cycle));
+    *sz = MSG_SZ;
+
+    return 0;
+}
+
+/**
+ * Response consume hook.
+ *
+ * @param [in] ctx
+ *      Port.
+ * @param [in] cycle
+ *      Cycle number.
+ * @param [in] r
+ *      Result.
+ * @param [in] rsp
+ *      Response.
+ * @param [in] rsp_sz
+ *      Response size.
+ */
+static void consume(void *ctx, uint64_t cycle, int32_t r, const uint8_t *rsp,
+                    size_t rsp_sz)
+{
+    port_t *port = ctx;
+
+    (void)cycle;
+    (void)rsp;
+    (void)rsp_sz;
+
+    if (r < 0)
+    {
+        port->failed++;
+    }
+}
+
+/**
+ * Report achieved rate and cycle start error.
+ *
+ * @param [in] name
+ *      Label.
+ * @param [in] params
+ *      Parameters.
+ * @param [in] port
+ *      Port.
+ */
+static void report(const char *name, const params_t *params,
+                   const port_t *port)
+{
+    int64_t period = (int64_t)params->period_us * 1000;
+    int64_t err_sum = 0;
+    int64_t err_max = 0;
+    unsigned long i;
+
+    /* start error: against the ideal schedule from the first cycle */
+    for (i = 1U; i < port->cycles; i++)
+    {
+        int64_t err = port->starts[i] - port->starts[0] -
+                      ((int64_t)(port->ids[i] - port->ids[0]) * period);
+
+        if (err < 0)
+        {
+            err = -err;
+        }
+
+        err_sum += err;
+        if (err > err_max)
+        {
+            err_max = err;
+        }
+    }
+
+    printf("%-9s  rate: %7.1f Hz  start error avg: %8.1f us  max: %8.1f us  "
+           "failed: %lu\n", name,
+           (double)(port->cycles - 1U) * 1e9 /
+           (double)(port->starts[port->cycles - 1U] - port->starts[0]),
+           (double)err_sum / 1e3 / (double)(port->cycles - 1U),
+           (double)err_max / 1e3, port->failed);
+}
+
+static int32_t run(const params_t *params, int executor)
+{
+    int32_t r = 0;
+
+    port_t ports[PORTS];
+    ser_transact_opts_t topts = SER_TRANSACT_OPTS_INIT;
+    ser_cyclic_t *cy = NULL;
+    size_t opened = 0U;
+    size_t started = 0U;
+    unsigned long i;
+    size_t p;
+
+    memset(ports, 0, sizeof(ports));
+    topts.rsp_sz = MSG_SZ;
+
+    for (p = 0U; p < PORTS; p++)
+    {
+        port_t *port = &ports[p];
+        ser_opts_t opts = SER_OPTS_INIT;
+        char name[64];
+
+        port->count = params->count;
+        port->starts = calloc(params->count, sizeof(*port->starts));
+        port->ids = calloc(params->count, sizeof(*port->ids));
+        if ((port->starts == NULL) || (port->ids == NULL))
+        {
+            fprintf(stderr, "Could not allocate cycle times\n");
+            free(port->starts);
+            free(port->ids);
+            r = -1;
+            goto cleanup;
+        }
+
+        port->resp.fd = bench_pty_open(name, sizeof(name));
+        if (port->resp.fd < 0)
+        {
+            fprintf(stderr, "Could not open pseudo-terminal\n");
+            free(port->starts);
+            free(port->ids);
+            r = -1;
+            goto cleanup;
+        }
+
+        port->resp.count = params->count;
+        port->resp.msg_sz = MSG_SZ;
+        port->resp.delay = 0U;
+
+        port->ser = ser_create();
+        if (port->ser == NULL)
+        {
+            fprintf(stderr, "Could not create library instance: %s\n",
+                    sererr_last());
+            free(port->starts);
+            free(port->ids);
+            close(port->resp.fd);
+            r = -1;
+            goto cleanup;
+        }
+
+        opts.port = name;
+        opts.baudrate = 115200;
+        opts.timeouts.rd = 100;
+        opts.timeouts.wr = 100;
+
+        r = ser_open(port->ser, &opts);
+        if (r < 0)
+        {
+            fprintf(stderr, "Could not open port: %s\n", sererr_last());
+            ser_destroy(port->ser);
+            free(port->starts);
+            free(port->ids);
+            close(port->resp.fd);
+            goto cleanup;
+        }
+
+        opened++;
+    }
+
+    for (p = 0U; p < PORTS; p++)
+    {
+        if (pthread_create(&ports[p].td, NULL, bench_responder,
+                           &ports[p].resp) != 0)
+        {
+            fprintf(stderr, "Could not start responder\n");
+            r = -1;
+            goto cleanup;
+        }
+
+        started++;
+    }
+
+    if (executor)
+    {
+        cy = ser_cyclic_create(NULL);
+        if (cy == NULL)
+        {
+            fprintf(stderr, "Could not create executor: %s\n", sererr_last());
+            r = -1;
+            goto cleanup;
+        }
+
+        for (p = 0U; (p < PORTS) && (r == 0); p++)
+        {
+            ser_cyclic_opts_t copts = SER_CYCLIC_OPTS_INIT;
+
+            copts.period_us = params->period_us;
+            copts.phase_us = (uint32_t)((params->period_us * p) / PORTS);
+            copts.transact = topts;
+            copts.fill = fill;
+            copts.consume = consume;
+            copts.ctx = &ports[p];
+
+            r = ser_cyclic_add(cy, ports[p].ser, &copts);
+        }
+
+        if (r == 0)
+        {
+            r = ser_cyclic_start(cy);
+        }
+
+        if (r < 0)
+        {
+            fprintf(stderr, "Could not start executor: %s\n", sererr_last());
+            goto cleanup;
+        }
+
+        /* run until all cycles are done */
+        while ((ports[0].cycles < params->count) ||
+               (ports[PORTS - 1U].cycles < params->count))
+        {
+            (void)usleep(10000);
+        }
+
+        ser_cyclic_stop(cy);
+    }
+    else
+    {
+        for (i = 0U; (i < params->count) && (r == 0); i++)
+        {
+            for (p = 0U; (p < PORTS) && (r == 0); p++)
+            {
+                uint8_t req[MSG_SZ];
+                uint8_t rsp[MSG_SZ];
+                size_t sz;
+                ser_deadline_t deadline;
+
+                (void)fill(&ports[p], i, req, sizeof(req), &sz);
+
+                r = ser_write(ports[p].ser, req, sz, NULL);
+                if (r == 0)
+                {
+                    deadline = ser_deadline_in(100);
+                    r = ser_read_exact(ports[p].ser, rsp, sizeof(rsp), NULL,
+                                       &deadline);
+                }
+            }
+
+            (void)usleep(params->period_us);
+        }
+    }
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Exchange failed: %s\n", sererr_last());
+        goto cleanup;
+    }
+
+    for (p = 0U; p < PORTS; p++)
+    {
+        char name[32];
+
+        (void)snprintf(name, sizeof(name), "%s %zu",
+                       executor ? "executor" : "loop", p);
+        report(name, params, &ports[p]);
+    }
+
+    if (executor)
+    {
+        ser_cyclic_stats_t stats;
+
+        if (ser_cyclic_stats(cy, ports[0].ser, &stats) == 0)
+        {
+            printf("%-9s  cycles: %llu  overruns: %llu  skipped: %llu  "
+                   "jitter avg: %.1f us  max: %.1f us\n", "",
+                   (unsigned long long)stats.cycles,
+                   (unsigned long long)stats.overruns,
+                   (unsigned long long)stats.skipped,
+                   (double)stats.jitter_sum_ns / 1e3 / (double)stats.cycles,
+                   (double)stats.jitter_max_ns / 1e3);
+            printf("%-9s  jitter histogram (us):", "");
+            for (p = 0U; p < SER_CYCLIC_HIST_SZ; p++)
+            {
+                if (stats.hist[p] > 0U)
+                {
+                    printf(" <%u: %llu", 1U << p,
+                           (unsigned long long)stats.hist[p]);
+                }
+            }
+
+            printf("\n");
+        }
+    }
+
+cleanup:
+    if (cy != NULL)
+    {
+        ser_cyclic_destroy(cy);
+    }
+
+    for (p = 0U; p < opened; p++)
+    {
+        ser_close(ports[p].ser);
+
+        if ((r == 0) && (p < started))
+        {
+            (void)pthread_join(ports[p].td, NULL);
+        }
+
+        ser_destroy(ports[p].ser);
+        close(ports[p].resp.fd);
+        free(ports[p].starts);
+        free(ports[p].ids);
+    }
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.count = 2000U;
+    params.period_us = 1000U;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+        if (params.count < 2U)
+        {
+            fprintf(stderr, "At least 2 cycles are required\n");
+            return 1;
+        }
+    }
+
+    if (argc > 2)
+    {
+        params.period_us = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+
+    printf("cycles: %lu, period: %u us, ports: %u\n", params.count,
+           params.period_us, PORTS);
+
+    if ((run(&params, 0) < 0) || (run(&params, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+/**
+ * Output drain: turnaround after a transmitted frame.
+ *
+ * Frames are written and then waited for until their last character left the
+ * line (as a half-duplex master does before turning the line around), using:
+ *
+ * - tcdrain: tcdrain() on the port descriptor (no deadline).
+ * - drain: ser_drain() with a deadline.
+ *
+ * The turnaround delay (wait completion minus the ideal end of transmission,
+ * i.e. write time plus the frame characters time) is reported (average, 99th
+ * percentile and worst case), together with the CPU time of the calling
+ * thread. A real port (and its baudrate) can be given; pseudo-terminals have
+ * no transmitter, so the ideal end is the write time on them (the delay is
+ * the call overhead, plus one character time for ser_drain()).
+ */
+
+#include "bench.h"
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of frames */
+    unsigned long count;
+    /** Frame size (bytes) */
+    size_t frame_sz;
+    /** Baudrate */
+    uint32_t baudrate;
+    /** Port (NULL to use a pseudo-terminal) */
+    const char *port;
+} params_t;
+
+static int32_t run(const params_t *params, int drain)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    ser_fd_t sfd;
+    char port[64];
+    int fd = -1;
+    uint8_t *frame;
+    uint8_t buf[256];
+    int64_t *delays;
+    int64_t frame_ns;
+    int64_t sum = 0;
+    int64_t cpu;
+    int64_t busy = 0;
+    unsigned long i;
+
+    /* 8N1: 10 bits per character (no transmitter on pseudo-terminals) */
+    frame_ns = 0;
+    if (params->port != NULL)
+    {
+        frame_ns = ((int64_t)params->frame_sz * 10 * 1000000000) /
+                   (int64_t)params->baudrate;
+    }
+
+    delays = malloc(params->count * sizeof(*delays));
+    frame = calloc(1U, params->frame_sz);
+    if ((delays == NULL) || (frame == NULL))
+    {
+        fprintf(stderr, "Could not allocate buffers\n");
+        r = -1;
+        goto cleanup_bufs;
+    }
+
+    if (params->port == NULL)
+    {
+        fd = bench_pty_open(port, sizeof(port));
+        if (fd < 0)
+        {
+            fprintf(stderr, "Could not open pseudo-terminal\n");
+            r = -1;
+            goto cleanup_bufs;
+        }
+
+        (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = (params->port != NULL) ? params->port : port;
+    opts.baudrate = params->baudrate;
+    opts.timeouts.wr = 1000;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    (void)ser_get_fd(ser, &sfd);
+
+    cpu = bench_thread_cpu();
+
+    for (i = 0U; (i < params->count) && (r == 0); i++)
+    {
+        int64_t start;
+        int64_t done;
+
+        frame[0] = (uint8_t)i;
+
+        start = bench_now();
+
+        r = ser_write(ser, frame, params->frame_sz, NULL);
+        if (r < 0)
+        {
+            break;
+        }
+
+        if (drain)
+        {
+            ser_deadline_t deadline;
+
+            deadline = ser_deadline_in(1000);
+            r = ser_drain(ser, &deadline);
+        }
+        else if (tcdrain((int)sfd) < 0)
+        {
+            fprintf(stderr, "tcdrain failed: %s\n", strerror(errno));
+            r = -1;
+        }
+
+        done = bench_now();
+        busy += done - start;
+
+        delays[i] = done - (start + frame_ns);
+        sum += delays[i];
+
+        /* drain the other side */
+        if (fd >= 0)
+        {
+            while (read(fd, buf, sizeof(buf)) > 0)
+            {
+            }
+        }
+    }
+
+    cpu = bench_thread_cpu() - cpu;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Write failed: %s\n", sererr_last());
+    }
+    else
+    {
+        qsort(delays, params->count, sizeof(*delays), bench_cmp_i64);
+
+        printf("%-8s  turnaround avg: %8.1f us  p99: %8.1f us  max: %8.1f us  "
+               "cpu: %.0f%%\n", drain ? "drain" : "tcdrain",
+               (double)sum / 1e3 / (double)params->count,
+               (double)delays[(params->count * 99U) / 100U] / 1e3,
+               (double)delays[params->count - 1U] / 1e3,
+               100.0 * (double)cpu / (double)busy);
+    }
+
+    ser_close(ser);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+cleanup_bufs:
+    free(frame);
+    free(delays);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.count = 200U;
+    params.frame_sz = 32U;
+    params.baudrate = 115200U;
+    params.port = NULL;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.frame_sz = (size_t)strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3)
+    {
+        params.baudrate = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+
+    if (argc > 4)
+    {
+        params.port = argv[4];
+    }
+
+    if ((params.count == 0U) || (params.frame_sz == 0U) ||
+        (params.baudrate == 0U))
+    {
+        return 1;
+    }
+
+    printf("frames: %lu of %zu bytes at %u bauds (8N1, %s)\n", params.count,
+           params.frame_sz, (unsigned)params.baudrate,
+           (params.port != NULL) ? params.port :
+           "pseudo-terminal: no transmitter");
+
+    if ((run(&params, 0) < 0) || (run(&params, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+/**
+ * Small request/response exchanges: classic read sequence versus
+ * ser_read_available().
+ *
+ * A responder thread emulates a device echoing each request, and the same
+ * number of transactions is run using:
+ *
+ * - classic: ser_write() + ser_available() (ioctl), ser_read_wait() (ppoll)
+ *   when nothing is pending, ser_read() (read).
+ * - fast: ser_write() + ser_read_available(), which waits for the response
+ *   of a just written request, then reads it.
+ *
+ * Both modes benefit from the optimistic write path (write is attempted
+ * before waiting). The system calls the library issues from the client
+ * thread are measured (the libc entry points used are interposed by the
+ * benchmark, which requires a shared library build) and reported per
+ * transaction, along with the read system calls accounted by the kernel
+ * (Linux, /proc/thread-self) as a cross-check.
+ */
+
+#include <dlfcn.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+
+#include "bench.h"
+
+/** Request/response size (bytes). */
+#define MSG_SZ 8U
+
+/** System calls issued by the client thread while counting. */
+static __thread unsigned long syscalls;
+/** Count system calls issued by this thread. */
+static __thread int counting;
+
+/** Resolve the next (libc) definition of an interposed function. */
+#define NEXT(fn, next)                                                        \
+    do                                                                        \
+    {                                                                         \
+        void *sym_ = dlsym(RTLD_NEXT, #fn);                                   \
+        memcpy(&(next), &sym_, sizeof(next));                                 \
+    } while (0)
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    static __typeof__(&read) next;
+
+    if (next == NULL)
+    {
+        NEXT(read, next);
+    }
+
+    syscalls += (counting != 0);
+    return next(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    static __typeof__(&write) next;
+
+    if (next == NULL)
+    {
+        NEXT(write, next);
+    }
+
+    syscalls += (counting != 0);
+    return next(fd, buf, count);
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    static __typeof__(&writev) next;
+
+    if (next == NULL)
+    {
+        NEXT(writev, next);
+    }
+
+    syscalls += (counting != 0);
+    return next(fd, iov, iovcnt);
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    static __typeof__(&ioctl) next;
+    va_list ap;
+    void *arg;
+
+    if (next == NULL)
+    {
+        NEXT(ioctl, next);
+    }
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    syscalls += (counting != 0);
+    return next(fd, request, arg);
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    static __typeof__(&poll) next;
+
+    if (next == NULL)
+    {
+        NEXT(poll, next);
+    }
+
+    syscalls += (counting != 0);
+    return next(fds, nfds, timeout);
+}
+
+int ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *tmo,
+          const sigset_t *sigmask)
+{
+    static __typeof__(&ppoll) next;
+
+    if (next == NULL)
+    {
+        NEXT(ppoll, next);
+    }
+
+    syscalls += (counting != 0);
+    return next(fds, nfds, tmo, sigmask);
+}
+
+static int32_t run(unsigned long count, int fast)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    bench_responder_t resp;
+    pthread_t td;
+    uint8_t req[MSG_SZ] = { 0 };
+    uint8_t buf[MSG_SZ];
+    unsigned long i;
+    long syscr_start;
+    long syscr_end;
+    int64_t start;
+    int64_t elapsed;
+
+    resp.fd = bench_pty_open(port, sizeof(port));
+    if (resp.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    resp.count = count;
+    resp.msg_sz = MSG_SZ;
+    resp.delay = 0U;
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.rd = 1000;
+    opts.timeouts.wr = 1000;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    if (pthread_create(&td, NULL, bench_responder, &resp) != 0)
+    {
+        fprintf(stderr, "Could not start responder\n");
+        r = -1;
+        goto cleanup_close;
+    }
+
+    start = bench_now();
+    syscr_start = bench_thread_syscr();
+    syscalls = 0U;
+    counting = 1;
+
+    for (i = 0U; (i < count) && (r == 0); i++)
+    {
+        size_t recvd = 0U;
+
+        req[0] = (uint8_t)i;
+
+        r = ser_write(ser, req, sizeof(req), NULL);
+
+        while ((r == 0) && (recvd < MSG_SZ))
+        {
+            size_t n = 0U;
+
+            if (fast)
+            {
+                r = ser_read_available(ser, &buf[recvd], MSG_SZ - recvd, &n);
+            }
+            else
+            {
+                size_t available;
+
+                r = ser_available(ser, &available);
+                if ((r == 0) && (available == 0U))
+                {
+                    r = ser_read_wait(ser);
+                }
+
+                if (r == 0)
+                {
+                    r = ser_read(ser, &buf[recvd], MSG_SZ - recvd, &n);
+                }
+            }
+
+            recvd += n;
+        }
+    }
+
+    counting = 0;
+    syscr_end = bench_thread_syscr();
+    elapsed = bench_now() - start;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Transaction failed: %s\n", sererr_last());
+    }
+
+cleanup_close:
+    ser_close(ser);
+
+    if (r == 0)
+    {
+        (void)pthread_join(td, NULL);
+
+        printf("%-8s  transactions: %lu  syscalls/transaction: %.2f  "
+               "time/transaction: %.1f us\n",
+               fast ? "fast" : "classic", count,
+               (double)syscalls / (double)count,
+               (double)elapsed / 1e3 / (double)count);
+
+        if ((syscr_start >= 0) && (syscr_end >= 0))
+        {
+            printf("%-8s  read syscalls/transaction (kernel): %.2f\n", "",
+                   (double)(syscr_end - syscr_start - 1) / (double)count);
+        }
+    }
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(resp.fd);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count = 20000U;
+
+    if (argc > 1)
+    {
+        count = strtoul(argv[1], NULL, 0);
+    }
+
+    printf("request/response: %lu transactions of %u bytes\n", count, MSG_SZ);
+
+    if ((run(count, 0) < 0) || (run(count, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,302 @@
+/**
+ * Hedged requests over redundant links.
+ *
+ * Two responder threads emulate a device reachable through two links: a fast
+ * link with a heavy latency tail (e.g. a loaded USB adapter) and a slower but
+ * steady one (e.g. RS-485). The same number of transactions is run on the
+ * fast link alone, then hedged over both links (after the adaptive threshold,
+ * and on both links at once). Latency percentiles and the requests sent on
+ * each link (the cost of hedging) are reported.
+ */
+
+#include "bench.h"
+
+/** Request/response size (bytes). */
+#define MSG_SZ 8U
+
+/** Number of links. */
+#define LINKS 2U
+
+/** Link emulation. */
+typedef struct
+{
+    /** Master side file descriptor */
+    int fd;
+    /** Processing time (us) */
+    unsigned delay;
+    /** Tail processing time (us) */
+    unsigned tail_delay;
+    /** Tail probability (%) */
+    unsigned tail_pct;
+} link_emu_t;
+
+/** Benchmark modes. */
+typedef enum
+{
+    /** Fast link only */
+    MODE_SINGLE,
+    /** Hedged after the threshold */
+    MODE_DELAYED,
+    /** Hedged right away */
+    MODE_ALWAYS
+} mode_t_;
+
+/**
+ * Link responder thread: echo each request after the processing time (until
+ * the port is closed).
+ *
+ * @param [in] args
+ *      Link emulation (link_emu_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *link_responder(void *args)
+{
+    link_emu_t *emu = args;
+    unsigned seed = (unsigned)emu->fd;
+    uint8_t buf[MSG_SZ];
+
+    for (;;)
+    {
+        size_t recvd = 0U;
+        unsigned delay = emu->delay;
+
+        while (recvd < MSG_SZ)
+        {
+            ssize_t n;
+
+            n = read(emu->fd, &buf[recvd], MSG_SZ - recvd);
+            if (n > 0)
+            {
+                recvd += (size_t)n;
+            }
+            else if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+            {
+                return NULL;
+            }
+        }
+
+        if ((unsigned)(rand_r(&seed) % 100) < emu->tail_pct)
+        {
+            delay = emu->tail_delay;
+        }
+
+        (void)usleep(delay);
+
+        if (write(emu->fd, buf, MSG_SZ) != (ssize_t)MSG_SZ)
+        {
+            return NULL;
+        }
+    }
+}
+
+static int32_t run(unsigned long count, mode_t_ mode, int64_t *lat)
+{
+    static const char *const names[] = { "single", "delayed", "always" };
+
+    int32_t r = 0;
+
+    link_emu_t emus[LINKS] = {
+        { -1, 200U, 5000U, 2U },
+        { -1, 800U, 800U, 0U }
+    };
+    ser_t *sers[LINKS] = { NULL, NULL };
+    pthread_t tds[LINKS];
+    ser_hedge_opts_t hopts = SER_HEDGE_OPTS_INIT;
+    ser_transact_opts_t topts = SER_TRANSACT_OPTS_INIT;
+    ser_hedge_t *hg = NULL;
+    size_t opened = 0U;
+    size_t started = 0U;
+    unsigned long i;
+    size_t l;
+
+    topts.rsp_sz = MSG_SZ;
+
+    for (l = 0U; l < LINKS; l++)
+    {
+        ser_opts_t opts = SER_OPTS_INIT;
+        char port[64];
+
+        emus[l].fd = bench_pty_open(port, sizeof(port));
+        if (emus[l].fd < 0)
+        {
+            fprintf(stderr, "Could not open pseudo-terminal\n");
+            r = -1;
+            goto cleanup;
+        }
+
+        sers[l] = ser_create();
+        if (sers[l] == NULL)
+        {
+            fprintf(stderr, "Could not create library instance: %s\n",
+                    sererr_last());
+            close(emus[l].fd);
+            r = -1;
+            goto cleanup;
+        }
+
+        opts.port = port;
+        opts.baudrate = 115200;
+
+        r = ser_open(sers[l], &opts);
+        if (r < 0)
+        {
+            fprintf(stderr, "Could not open port: %s\n", sererr_last());
+            ser_destroy(sers[l]);
+            close(emus[l].fd);
+            goto cleanup;
+        }
+
+        opened++;
+    }
+
+    hopts.mode = (mode == MODE_ALWAYS) ? SER_HEDGE_ALWAYS : SER_HEDGE_DELAYED;
+    hopts.rsp_max = MSG_SZ;
+
+    hg = ser_hedge_create(sers, LINKS, &hopts);
+    if (hg == NULL)
+    {
+        fprintf(stderr, "Could not create group: %s\n", sererr_last());
+        r = -1;
+        goto cleanup;
+    }
+
+    for (l = 0U; l < LINKS; l++)
+    {
+        if (pthread_create(&tds[l], NULL, link_responder, &emus[l]) != 0)
+        {
+            fprintf(stderr, "Could not start responder\n");
+            r = -1;
+            goto cleanup;
+        }
+
+        started++;
+    }
+
+    for (i = 0U; (i < count) && (r == 0); i++)
+    {
+        uint8_t req[MSG_SZ] = { 0 };
+        uint8_t rsp[MSG_SZ];
+        ser_deadline_t deadline;
+        int64_t start;
+
+        memcpy(req, &i, sizeof(req) < sizeof(i) ? sizeof(req) : sizeof(i));
+
+        start = bench_now();
+        deadline = ser_deadline_in(1000);
+
+        if (mode == MODE_SINGLE)
+        {
+            r = ser_transact(sers[0], req, sizeof(req), rsp, sizeof(rsp),
+                             &topts, NULL, &deadline);
+        }
+        else
+        {
+            r = ser_hedge_transact(hg, req, sizeof(req), rsp, sizeof(rsp),
+                                   &topts, NULL, NULL, &deadline);
+        }
+
+        lat[i] = bench_now() - start;
+    }
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Transaction failed: %s\n", sererr_last());
+    }
+    else
+    {
+        qsort(lat, count, sizeof(*lat), bench_cmp_i64);
+
+        printf("%-8s  latency avg/p50/p99/max: ", names[mode]);
+        {
+            int64_t sum = 0;
+
+            for (i = 0U; i < count; i++)
+            {
+                sum += lat[i];
+            }
+
+            printf("%.0f/%.0f/%.0f/%.0f us\n", (double)sum / 1e3 / (double)count,
+                   (double)lat[count / 2U] / 1e3,
+                   (double)lat[(count * 99U) / 100U] / 1e3,
+                   (double)lat[count - 1U] / 1e3);
+        }
+
+        for (l = 0U; (l < LINKS) && (mode != MODE_SINGLE); l++)
+        {
+            ser_hedge_link_stats_t stats;
+
+            if (ser_hedge_stats(hg, l, &stats) == 0)
+            {
+                printf("%-8s  link %zu: requests: %llu  hedges: %llu  "
+                       "wins: %llu  late: %llu  p50/p95: %u/%u us%s\n", "", l,
+                       (unsigned long long)stats.requests,
+                       (unsigned long long)stats.hedges,
+                       (unsigned long long)stats.wins,
+                       (unsigned long long)stats.late, stats.median_us,
+                       stats.latency_us,
+                       stats.primary ? " (primary)" : "");
+            }
+        }
+    }
+
+cleanup:
+    if (hg != NULL)
+    {
+        ser_hedge_destroy(hg);
+    }
+
+    for (l = 0U; l < opened; l++)
+    {
+        ser_close(sers[l]);
+
+        if (l < started)
+        {
+            (void)pthread_join(tds[l], NULL);
+        }
+
+        ser_destroy(sers[l]);
+        close(emus[l].fd);
+    }
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count = 2000U;
+    int64_t *lat;
+    int ret = 0;
+
+    if (argc > 1)
+    {
+        count = strtoul(argv[1], NULL, 0);
+        if (count == 0U)
+        {
+            fprintf(stderr, "Invalid number of transactions\n");
+            return 1;
+        }
+    }
+
+    lat = malloc(count * sizeof(*lat));
+    if (lat == NULL)
+    {
+        fprintf(stderr, "Could not allocate latencies\n");
+        return 1;
+    }
+
+    printf("transactions: %lu, link 0: 200 us (2%% at 5000 us), "
+           "link 1: 800 us\n", count);
+
+    if ((run(count, MODE_SINGLE, lat) < 0) ||
+        (run(count, MODE_DELAYED, lat) < 0) ||
+        (run(count, MODE_ALWAYS, lat) < 0))
+    {
+        ret = 1;
+    }
+
+    free(lat);
+
+    return ret;
+}
@@ -0,0 +1,236 @@
+/**
+ * Polling many ports: sequential ser_transact() versus ser_transact_many().
+ *
+ * Each port is served by a responder thread emulating a device that answers
+ * after a processing time, which grows with the port index (from the base
+ * delay up to twice as much). The same number of cycles (one transaction on
+ * every port) is run sequentially and concurrently, and the time per cycle is
+ * reported together with the sum and maximum of the per-port latencies
+ * measured by ser_transact_many().
+ */
+
+#include "bench.h"
+
+/** Request/response size (bytes). */
+#define MSG_SZ 8U
+
+/** Maximum number of ports. */
+#define PORTS_MAX 128U
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of cycles */
+    unsigned long count;
+    /** Number of ports */
+    size_t ports;
+    /** Base responder processing time (us) */
+    unsigned delay;
+} params_t;
+
+/** Port under test. */
+typedef struct
+{
+    /** Library instance */
+    ser_t *ser;
+    /** Responder */
+    bench_responder_t resp;
+    /** Responder thread */
+    pthread_t td;
+    /** Request */
+    uint8_t req[MSG_SZ];
+    /** Response */
+    uint8_t rsp[MSG_SZ];
+} port_t;
+
+static port_t ports[PORTS_MAX];
+
+static int32_t run(const params_t *params, int many)
+{
+    int32_t r = 0;
+
+    ser_transact_opts_t topts = SER_TRANSACT_OPTS_INIT;
+    ser_transact_item_t items[PORTS_MAX];
+    size_t opened = 0U;
+    size_t started = 0U;
+    unsigned long i;
+    size_t p;
+    int64_t lat_sum = 0;
+    int64_t lat_max = 0;
+    int64_t start;
+    int64_t elapsed;
+
+    topts.rsp_sz = MSG_SZ;
+
+    for (p = 0U; p < params->ports; p++)
+    {
+        port_t *port = &ports[p];
+        ser_opts_t opts = SER_OPTS_INIT;
+        char name[64];
+
+        port->resp.fd = bench_pty_open(name, sizeof(name));
+        if (port->resp.fd < 0)
+        {
+            fprintf(stderr, "Could not open pseudo-terminal\n");
+            r = -1;
+            goto cleanup;
+        }
+
+        port->resp.count = params->count;
+        port->resp.msg_sz = MSG_SZ;
+        port->resp.delay = params->delay +
+                           (unsigned)((params->delay * p) / params->ports);
+
+        port->ser = ser_create();
+        if (port->ser == NULL)
+        {
+            fprintf(stderr, "Could not create library instance: %s\n",
+                    sererr_last());
+            close(port->resp.fd);
+            r = -1;
+            goto cleanup;
+        }
+
+        opts.port = name;
+        opts.baudrate = 115200;
+
+        r = ser_open(port->ser, &opts);
+        if (r < 0)
+        {
+            fprintf(stderr, "Could not open port: %s\n", sererr_last());
+            ser_destroy(port->ser);
+            close(port->resp.fd);
+            goto cleanup;
+        }
+
+        opened++;
+
+        items[p].ser = port->ser;
+        items[p].req = port->req;
+        items[p].req_sz = MSG_SZ;
+        items[p].rsp = port->rsp;
+        items[p].rsp_cap = MSG_SZ;
+        items[p].opts = &topts;
+    }
+
+    for (p = 0U; p < params->ports; p++)
+    {
+        if (pthread_create(&ports[p].td, NULL, bench_responder,
+                           &ports[p].resp) != 0)
+        {
+            fprintf(stderr, "Could not start responder\n");
+            r = -1;
+            goto cleanup;
+        }
+
+        started++;
+    }
+
+    start = bench_now();
+
+    for (i = 0U; (i < params->count) && (r == 0); i++)
+    {
+        ser_deadline_t deadline;
+
+        deadline = ser_deadline_in(1000);
+
+        if (many)
+        {
+            r = ser_transact_many(items, params->ports, &deadline);
+
+            for (p = 0U; (r == 0) && (p < params->ports); p++)
+            {
+                lat_sum += items[p].elapsed_ns;
+                if (items[p].elapsed_ns > lat_max)
+                {
+                    lat_max = items[p].elapsed_ns;
+                }
+            }
+        }
+        else
+        {
+            for (p = 0U; (p < params->ports) && (r == 0); p++)
+            {
+                r = ser_transact(ports[p].ser, ports[p].req, MSG_SZ,
+                                 ports[p].rsp, MSG_SZ, &topts, NULL,
+                                 &deadline);
+            }
+        }
+    }
+
+    elapsed = bench_now() - start;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Transaction failed: %s\n", sererr_last());
+    }
+    else
+    {
+        printf("%-10s  time/cycle: %8.1f us", many ? "many" : "sequential",
+               (double)elapsed / 1e3 / (double)params->count);
+
+        if (many)
+        {
+            printf("  port latency sum: %8.1f us  max: %8.1f us",
+                   (double)lat_sum / 1e3 / (double)params->count,
+                   (double)lat_max / 1e3);
+        }
+
+        printf("\n");
+    }
+
+cleanup:
+    for (p = 0U; p < opened; p++)
+    {
+        ser_close(ports[p].ser);
+
+        if ((r == 0) && (p < started))
+        {
+            (void)pthread_join(ports[p].td, NULL);
+        }
+
+        ser_destroy(ports[p].ser);
+        close(ports[p].resp.fd);
+    }
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.count = 200U;
+    params.ports = 16U;
+    params.delay = 500U;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.ports = (size_t)strtoul(argv[2], NULL, 0);
+        if ((params.ports == 0U) || (params.ports > PORTS_MAX))
+        {
+            fprintf(stderr, "Number of ports must be 1..%u\n", PORTS_MAX);
+            return 1;
+        }
+    }
+
+    if (argc > 3)
+    {
+        params.delay = (unsigned)strtoul(argv[3], NULL, 0);
+    }
+
+    printf("cycles: %lu, ports: %zu, device processing time: %u..%u us\n",
+           params.count, params.ports, params.delay, 2U * params.delay);
+
+    if ((run(&params, 0) < 0) || (run(&params, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
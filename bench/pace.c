@@ -0,0 +1,318 @@
+/**
+ * Transmit pacing: bursts to a device without flow control.
+ *
+ * The other side of the link emulates a device with a small receive FIFO,
+ * drained at a lower rate than the line rate, and no flow control: bytes
+ * arriving while the FIFO is full are lost. Bytes are modelled as arriving at
+ * the line rate once read from the pseudo-terminal. Blocks are written with
+ * ser_write(), and the same transfer is run:
+ *
+ * - unpaced: bytes are handed to the port as fast as it accepts them.
+ * - paced: token bucket slightly below the device rate, half FIFO bursts.
+ * - paced async: as paced, through the asynchronous transmission thread.
+ *
+ * The bytes lost to overruns, the intact blocks, the goodput (intact blocks
+ * over the transfer time) and the pacing delays are reported.
+ */
+
+#include "bench.h"
+
+#include <poll.h>
+
+/** Pacing styles. */
+typedef enum
+{
+    /** No pacing */
+    STYLE_UNPACED,
+    /** Pacing in the calling thread */
+    STYLE_PACED,
+    /** Pacing in the asynchronous transmission thread */
+    STYLE_PACED_ASYNC
+} style_t;
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of blocks */
+    unsigned long blocks;
+    /** Block size (bytes) */
+    unsigned long block_sz;
+    /** Line rate (bytes/s) */
+    unsigned long line;
+    /** Device rate (bytes/s) */
+    unsigned long device;
+    /** Device FIFO size (bytes) */
+    unsigned long fifo;
+} params_t;
+
+/** Emulated device. */
+typedef struct
+{
+    /** Master side file descriptor */
+    int fd;
+    /** Parameters */
+    const params_t *params;
+    /** Bytes received (including lost ones) */
+    unsigned long bytes;
+    /** Bytes lost to overruns */
+    unsigned long lost;
+    /** Blocks with lost bytes */
+    unsigned long damaged;
+    /** Arrival time of the last byte (ns) */
+    int64_t last;
+} device_t;
+
+/**
+ * Device thread: model the FIFO as bytes arrive.
+ *
+ * @param [in] args
+ *      Emulated device (device_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *device(void *args)
+{
+    device_t *dev = args;
+    const params_t *params = dev->params;
+    unsigned long total = params->blocks * params->block_sz;
+    int64_t byte_ns = 1000000000 / (int64_t)params->line;
+    double level = 0.0;
+    int64_t drained = 0;
+    long damaged_block = -1;
+
+    while (dev->bytes < total)
+    {
+        struct pollfd pfd;
+        uint8_t buf[4096];
+        int64_t now;
+        ssize_t n;
+        ssize_t i;
+
+        pfd.fd = dev->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if (poll(&pfd, 1U, 2000) <= 0)
+        {
+            break;
+        }
+
+        n = read(dev->fd, buf, sizeof(buf));
+        if (n <= 0)
+        {
+            break;
+        }
+
+        now = bench_now();
+
+        for (i = 0; i < n; i++)
+        {
+            int64_t arrival;
+            long block;
+
+            /* line rate: bytes arrive back to back at most */
+            arrival = (dev->last + byte_ns > now) ? dev->last + byte_ns : now;
+            if (drained == 0)
+            {
+                drained = arrival;
+            }
+
+            level -= (double)(arrival - drained) * (double)params->device /
+                     1e9;
+            if (level < 0.0)
+            {
+                level = 0.0;
+            }
+
+            drained = arrival;
+            dev->last = arrival;
+
+            block = (long)(dev->bytes / params->block_sz);
+            if (level + 1.0 > (double)params->fifo)
+            {
+                dev->lost++;
+                if (block != damaged_block)
+                {
+                    dev->damaged++;
+                    damaged_block = block;
+                }
+            }
+            else
+            {
+                level += 1.0;
+            }
+
+            dev->bytes++;
+        }
+    }
+
+    return NULL;
+}
+
+static int32_t run(const params_t *params, style_t style)
+{
+    static const char *const names[] = { "unpaced", "paced", "async" };
+
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    device_t dev;
+    pthread_t td;
+    uint8_t *block;
+    unsigned long i;
+    int64_t start;
+
+    block = calloc(1U, params->block_sz);
+    if (block == NULL)
+    {
+        fprintf(stderr, "Could not allocate block\n");
+        return -1;
+    }
+
+    memset(&dev, 0, sizeof(dev));
+    dev.params = params;
+
+    dev.fd = bench_pty_open(port, sizeof(port));
+    if (dev.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        r = -1;
+        goto cleanup_block;
+    }
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.wr = 10000;
+
+    if (style != STYLE_UNPACED)
+    {
+        opts.pacing.rate = (uint32_t)((params->device * 95U) / 100U);
+        opts.pacing.burst = (uint32_t)(params->fifo / 2U);
+    }
+
+    if (style == STYLE_PACED_ASYNC)
+    {
+        opts.tx.ring_sz = params->block_sz;
+    }
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    if (pthread_create(&td, NULL, device, &dev) != 0)
+    {
+        fprintf(stderr, "Could not start device\n");
+        r = -1;
+        goto cleanup_close;
+    }
+
+    start = bench_now();
+
+    for (i = 0U; (i < params->blocks) && (r == 0); i++)
+    {
+        r = ser_write(ser, block, params->block_sz, NULL);
+    }
+
+    (void)pthread_join(td, NULL);
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Write failed: %s\n", sererr_last());
+    }
+    else
+    {
+        double elapsed = (double)(dev.last - start) / 1e9;
+
+        printf("%-8s  lost: %6lu bytes  intact blocks: %3lu/%lu  "
+               "goodput: %6.0f bytes/s\n", names[style], dev.lost,
+               params->blocks - dev.damaged, params->blocks,
+               (double)((params->blocks - dev.damaged) * params->block_sz) /
+               elapsed);
+
+        if (style != STYLE_UNPACED)
+        {
+            ser_pace_stats_t stats;
+
+            if (ser_pace_stats(ser, &stats) == 0)
+            {
+                printf("%-8s  paced: %llu bytes  delays: %llu  "
+                       "delayed: %.1f ms\n", "",
+                       (unsigned long long)stats.bytes,
+                       (unsigned long long)stats.delays,
+                       (double)stats.delay_ns / 1e6);
+            }
+        }
+    }
+
+cleanup_close:
+    ser_close(ser);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(dev.fd);
+
+cleanup_block:
+    free(block);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.blocks = 4U;
+    params.block_sz = 4096U;
+    params.line = 11520U;
+    params.device = 5000U;
+    params.fifo = 16U;
+
+    if (argc > 1)
+    {
+        params.blocks = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.device = strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3)
+    {
+        params.fifo = strtoul(argv[3], NULL, 0);
+    }
+
+    if ((params.blocks == 0U) || (params.device == 0U) || (params.fifo < 2U))
+    {
+        return 1;
+    }
+
+    printf("blocks: %lu of %lu bytes (line: %lu bytes/s, device: %lu "
+           "bytes/s, FIFO: %lu bytes)\n", params.blocks, params.block_sz,
+           params.line, params.device, params.fifo);
+
+    if ((run(&params, STYLE_UNPACED) < 0) || (run(&params, STYLE_PACED) < 0) ||
+        (run(&params, STYLE_PACED_ASYNC) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,356 @@
+/**
+ * Pipelined transactions on a long round-trip link.
+ *
+ * A responder thread emulates a device behind a link with a fixed round-trip
+ * latency (e.g. a USB adapter): each request is answered once the latency
+ * elapsed, independently of other requests in flight. The same number of
+ * transactions is run with increasing pipeline windows, and the throughput is
+ * reported relative to the window of 1 (serialized requests), together with
+ * the window utilization (throughput relative to the ideal window / round
+ * trip).
+ */
+
+#include "bench.h"
+
+#include <poll.h>
+
+/** Request/response size (bytes): identifier (4) + payload (4). */
+#define MSG_SZ 8U
+
+/** Maximum number of requests queued in the responder. */
+#define QUEUE_SZ 256U
+
+/** Delay line responder. */
+typedef struct
+{
+    /** Master side file descriptor */
+    int fd;
+    /** Number of requests to answer */
+    unsigned long count;
+    /** Round-trip latency (us) */
+    unsigned latency;
+} delay_line_t;
+
+/** Queued response. */
+typedef struct
+{
+    /** Due time (ns) */
+    int64_t due;
+    /** Response */
+    uint8_t msg[MSG_SZ];
+} queued_t;
+
+/**
+ * Delay line responder thread: echo each request after the latency.
+ *
+ * @param [in] args
+ *      Responder (delay_line_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *delay_line(void *args)
+{
+    delay_line_t *dl = args;
+    static queued_t queue[QUEUE_SZ];
+    unsigned long head = 0U;
+    unsigned long tail = 0U;
+    uint8_t buf[MSG_SZ];
+    size_t recvd = 0U;
+
+    (void)fcntl(dl->fd, F_SETFL, fcntl(dl->fd, F_GETFL) | O_NONBLOCK);
+
+    while (head < dl->count)
+    {
+        struct pollfd pfd;
+        struct timespec ts;
+        int64_t now;
+        int64_t wait = 100000000;
+        ssize_t n;
+
+        now = bench_now();
+
+        /* answer due requests */
+        while ((head < tail) && (queue[head % QUEUE_SZ].due <= now))
+        {
+            if (write(dl->fd, queue[head % QUEUE_SZ].msg, MSG_SZ) !=
+                (ssize_t)MSG_SZ)
+            {
+                return NULL;
+            }
+
+            head++;
+        }
+
+        if (head < tail)
+        {
+            wait = queue[head % QUEUE_SZ].due - now;
+        }
+
+        pfd.fd = dl->fd;
+        pfd.events = (tail - head < QUEUE_SZ) ? POLLIN : 0;
+        pfd.revents = 0;
+
+        ts.tv_sec = (time_t)(wait / 1000000000);
+        ts.tv_nsec = (long)(wait % 1000000000);
+
+        if (ppoll(&pfd, 1U, &ts, NULL) <= 0)
+        {
+            continue;
+        }
+
+        /* queue new requests */
+        n = read(dl->fd, &buf[recvd], MSG_SZ - recvd);
+        if (n > 0)
+        {
+            recvd += (size_t)n;
+            if (recvd == MSG_SZ)
+            {
+                queued_t *q = &queue[tail % QUEUE_SZ];
+
+                q->due = bench_now() + ((int64_t)dl->latency * 1000);
+                memcpy(q->msg, buf, MSG_SZ);
+                tail++;
+                recvd = 0U;
+            }
+        }
+        else if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+        {
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Response matcher: identifier in the first 4 bytes.
+ *
+ * @param [in] ctx
+ *      Unused.
+ * @param [in] buf
+ *      Received bytes.
+ * @param [in] sz
+ *      Number of received bytes.
+ * @param [out] id
+ *      Request identifier.
+ *
+ * @return
+ *      Response size once complete, 0 otherwise.
+ */
+static int32_t match(void *ctx, const uint8_t *buf, size_t sz, uint32_t *id)
+{
+    (void)ctx;
+
+    if (sz < MSG_SZ)
+    {
+        return 0;
+    }
+
+    memcpy(id, buf, sizeof(*id));
+
+    return (int32_t)MSG_SZ;
+}
+
+/** Completion state. */
+typedef struct
+{
+    /** Completed requests */
+    unsigned long done;
+    /** Failed requests */
+    unsigned long failed;
+} state_t;
+
+/**
+ * Request completion callback.
+ *
+ * @param [in] ctx
+ *      Completion state.
+ * @param [in] id
+ *      Request identifier.
+ * @param [in] r
+ *      Result.
+ * @param [in] rsp
+ *      Response.
+ * @param [in] rsp_sz
+ *      Response size.
+ */
+static void on_done(void *ctx, uint32_t id, int32_t r, const uint8_t *rsp,
+                    size_t rsp_sz)
+{
+    state_t *state = ctx;
+
+    (void)id;
+    (void)rsp;
+    (void)rsp_sz;
+
+    state->done++;
+    if (r < 0)
+    {
+        state->failed++;
+    }
+}
+
+static int32_t run(unsigned long count, unsigned latency, size_t window,
+                   double *tps)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    ser_pipeline_opts_t popts = SER_PIPELINE_OPTS_INIT;
+    ser_pipeline_t *pl;
+    char port[64];
+    delay_line_t dl;
+    pthread_t td;
+    state_t state = { 0U, 0U };
+    unsigned long i;
+    int64_t start;
+    int64_t elapsed;
+
+    dl.fd = bench_pty_open(port, sizeof(port));
+    if (dl.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    dl.count = count;
+    dl.latency = latency;
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    popts.window = window;
+    popts.rsp_max = MSG_SZ;
+    popts.match = match;
+
+    pl = ser_pipeline_create(ser, &popts);
+    if (pl == NULL)
+    {
+        fprintf(stderr, "Could not create pipeline: %s\n", sererr_last());
+        r = -1;
+        goto cleanup_close;
+    }
+
+    if (pthread_create(&td, NULL, delay_line, &dl) != 0)
+    {
+        fprintf(stderr, "Could not start responder\n");
+        r = -1;
+        goto cleanup_pl;
+    }
+
+    start = bench_now();
+
+    for (i = 0U; (i < count) && (r == 0); i++)
+    {
+        uint8_t req[MSG_SZ] = { 0 };
+        uint32_t id = (uint32_t)i;
+        ser_deadline_t timeout;
+        ser_deadline_t deadline;
+
+        memcpy(req, &id, sizeof(id));
+
+        timeout = ser_deadline_in(1000);
+        deadline = ser_deadline_in(1000);
+
+        r = ser_pipeline_submit(pl, id, req, sizeof(req), &timeout, on_done,
+                                &state, &deadline);
+    }
+
+    while ((r == 0) && (ser_pipeline_inflight(pl) > 0U))
+    {
+        ser_deadline_t deadline;
+
+        deadline = ser_deadline_in(1000);
+        r = ser_pipeline_poll(pl, &deadline);
+    }
+
+    elapsed = bench_now() - start;
+
+    if ((r < 0) || (state.failed > 0U))
+    {
+        fprintf(stderr, "Transactions failed: %s\n", sererr_last());
+        r = -1;
+    }
+    else
+    {
+        *tps = (double)count / ((double)elapsed / 1e9);
+    }
+
+    (void)pthread_join(td, NULL);
+
+cleanup_pl:
+    ser_pipeline_destroy(pl);
+
+cleanup_close:
+    ser_close(ser);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(dl.fd);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    static const size_t windows[] = { 1U, 2U, 4U, 8U, 16U, 32U };
+
+    unsigned long count = 2000U;
+    unsigned latency = 1000U;
+    double base = 0.0;
+    size_t i;
+
+    if (argc > 1)
+    {
+        count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        latency = (unsigned)strtoul(argv[2], NULL, 0);
+    }
+
+    printf("transactions: %lu, round trip: %u us (serialized limit: %.0f/s)\n",
+           count, latency, 1e6 / (double)latency);
+
+    for (i = 0U; i < sizeof(windows) / sizeof(windows[0]); i++)
+    {
+        double tps = 0.0;
+
+        if (run(count, latency, windows[i], &tps) < 0)
+        {
+            return 1;
+        }
+
+        if (i == 0U)
+        {
+            base = tps;
+        }
+
+        printf("window %2zu  transactions/s: %9.0f  speedup: %5.2f  "
+               "utilization: %5.1f%%\n", windows[i], tps, tps / base,
+               100.0 * tps * (double)latency / 1e6 / (double)windows[i]);
+    }
+
+    return 0;
+}
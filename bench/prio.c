@@ -0,0 +1,403 @@
+/**
+ * Priority transmission: urgent frames behind a bulk transfer.
+ *
+ * A bulk transfer keeps the asynchronous transmit queue full while urgent
+ * frames are queued periodically. The other side of the link drains bytes at
+ * a fixed rate (emulating the wire), and timestamps the urgent frames on
+ * arrival. The same traffic is run with:
+ *
+ * - fifo: a single class (urgent frames wait behind the queued bulk frames).
+ * - prio: urgent frames in a strict higher class.
+ * - prio+ttl: as prio, bulk frames also expire if not written in time.
+ *
+ * Each style runs with frames dividing the pseudo-terminal write size, and with
+ * frames that do not (so that writes end mid-frame).
+ *
+ * The urgent frame latency (scheduled to received), the bulk throughput and the
+ * expired bulk frames are reported. Bytes already handed to the driver (the
+ * pseudo-terminal buffer) are not subject to priorities, so they set a floor
+ * on the latency.
+ */
+
+#include "bench.h"
+
+/** Maximum frame size (bytes). Frames hold a marker (1), padding (7), a
+ * timestamp (8) and more padding up to their size. */
+#define FRAME_MAX 128U
+
+/** Frame sizes (bytes), the second one does not divide the write size. */
+static const size_t frame_szs[] = { 16U, 100U };
+
+/** Urgent frame marker. */
+#define URGENT 0xA5U
+
+/** Traffic styles. */
+typedef enum
+{
+    /** Single class */
+    STYLE_FIFO,
+    /** Urgent frames in a higher class */
+    STYLE_PRIO,
+    /** Urgent frames in a higher class, bulk frames expire */
+    STYLE_PRIO_TTL
+} style_t;
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of urgent frames */
+    unsigned long count;
+    /** Urgent frames period (us) */
+    unsigned period;
+    /** Wire rate (bytes/s) */
+    unsigned long rate;
+    /** Bulk frames time to live (us) */
+    unsigned ttl;
+    /** Frame size (bytes) */
+    size_t frame_sz;
+} params_t;
+
+/** Wire emulation (other side of the link). */
+typedef struct
+{
+    /** Master side file descriptor */
+    int fd;
+    /** Wire rate (bytes/s) */
+    unsigned long rate;
+    /** Frame size (bytes) */
+    size_t frame_sz;
+    /** Stop requested */
+    volatile int stop;
+    /** Urgent frame latencies (ns) */
+    int64_t *lat;
+    /** Number of urgent frames received */
+    unsigned long urgent;
+    /** Maximum number of urgent frames */
+    unsigned long urgent_max;
+    /** Bulk frames received */
+    unsigned long bulk;
+} wire_t;
+
+/**
+ * Wire thread: drain bytes at a fixed rate, timestamp urgent frames.
+ *
+ * @param [in] args
+ *      Wire emulation (wire_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *wire(void *args)
+{
+    wire_t *w = args;
+    uint8_t frame[FRAME_MAX];
+    size_t got = 0U;
+    int64_t start;
+    uint64_t drained = 0U;
+
+    (void)fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) | O_NONBLOCK);
+
+    start = bench_now();
+
+    while (!w->stop)
+    {
+        struct timespec ts = { 0, 100000 };
+        uint64_t allowed;
+
+        (void)nanosleep(&ts, NULL);
+
+        allowed = (uint64_t)((double)(bench_now() - start) / 1e9 *
+                             (double)w->rate);
+
+        while (drained < allowed)
+        {
+            size_t want = w->frame_sz - got;
+            ssize_t n;
+
+            if ((uint64_t)want > (allowed - drained))
+            {
+                want = (size_t)(allowed - drained);
+            }
+
+            n = read(w->fd, &frame[got], want);
+            if (n <= 0)
+            {
+                /* idle wire does not save up bandwidth */
+                drained = allowed;
+                break;
+            }
+
+            drained += (uint64_t)n;
+            got += (size_t)n;
+
+            if (got == w->frame_sz)
+            {
+                if (frame[0] == URGENT)
+                {
+                    int64_t sent;
+
+                    memcpy(&sent, &frame[8], sizeof(sent));
+                    if (w->urgent < w->urgent_max)
+                    {
+                        w->lat[w->urgent] = bench_now() - sent;
+                    }
+
+                    w->urgent++;
+                }
+                else
+                {
+                    w->bulk++;
+                }
+
+                got = 0U;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int32_t run(const params_t *params, style_t style)
+{
+    static const char *const names[] = { "fifo", "prio", "prio+ttl" };
+
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    ser_tx_stats_t stats;
+    char port[64];
+    wire_t w;
+    pthread_t td;
+    uint8_t frame[FRAME_MAX] = { 0 };
+    unsigned long queued = 0U;
+    int64_t next;
+    int64_t start;
+    int64_t elapsed;
+    int64_t sum = 0;
+    unsigned long i;
+    int started = 0;
+
+    memset(&w, 0, sizeof(w));
+
+    w.lat = malloc(params->count * sizeof(*w.lat));
+    if (w.lat == NULL)
+    {
+        fprintf(stderr, "Could not allocate samples\n");
+        return -1;
+    }
+
+    w.urgent_max = params->count;
+    w.rate = params->rate;
+    w.frame_sz = params->frame_sz;
+
+    w.fd = bench_pty_open(port, sizeof(port));
+    if (w.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        r = -1;
+        goto cleanup_lat;
+    }
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.wr = 1000;
+    opts.tx.ring_sz = 65536U;
+    opts.tx.classes = (style == STYLE_FIFO) ? 1U : 2U;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    if (pthread_create(&td, NULL, wire, &w) != 0)
+    {
+        fprintf(stderr, "Could not start wire\n");
+        r = -1;
+        goto cleanup_close;
+    }
+
+    started = 1;
+    start = bench_now();
+    next = start + ((int64_t)params->period * 1000);
+
+    for (i = 0U; (i < params->count) && (r == 0);)
+    {
+        struct timespec ts = { 0, 200000 };
+        ser_deadline_t expires;
+        int64_t now;
+
+        now = bench_now();
+
+        if (now >= next)
+        {
+            /* latency accounted from the scheduled time (waits for room
+             * included) */
+            frame[0] = URGENT;
+            memcpy(&frame[8], &next, sizeof(next));
+
+            r = ser_write_async_prio(ser, frame, params->frame_sz,
+                                     (style == STYLE_FIFO) ? 0U : 1U, NULL,
+                                     NULL, NULL, NULL);
+            if (r == 0)
+            {
+                next += (int64_t)params->period * 1000;
+                i++;
+            }
+            else if (r == SER_EBUSY)
+            {
+                /* retried on the next round */
+                r = 0;
+            }
+        }
+
+        /* keep the bulk transfer going */
+        frame[0] = 0U;
+        expires = (style == STYLE_PRIO_TTL) ?
+                  ser_deadline_in_ns((int64_t)params->ttl * 1000) :
+                  ser_deadline_in_ns(-1);
+
+        while (r == 0)
+        {
+            r = ser_write_async_prio(ser, frame, params->frame_sz, 0U,
+                                     &expires, NULL, NULL, NULL);
+            if (r == 0)
+            {
+                queued++;
+            }
+        }
+
+        if (r == SER_EBUSY)
+        {
+            r = 0;
+        }
+
+        (void)nanosleep(&ts, NULL);
+    }
+
+    /* let the last urgent frame reach the wire */
+    while ((r == 0) && (w.urgent < params->count) &&
+           ((bench_now() - next) < 2000000000))
+    {
+        struct timespec ts = { 0, 1000000 };
+
+        (void)nanosleep(&ts, NULL);
+    }
+
+    elapsed = bench_now() - start;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Write failed: %s\n", sererr_last());
+    }
+    else if (w.urgent < params->count)
+    {
+        fprintf(stderr, "Urgent frames lost\n");
+        r = -1;
+    }
+    else
+    {
+        (void)ser_tx_stats(ser, &stats);
+
+        for (i = 0U; i < params->count; i++)
+        {
+            sum += w.lat[i];
+        }
+
+        qsort(w.lat, params->count, sizeof(*w.lat), bench_cmp_i64);
+
+        printf("%-8s  %3u B  urgent avg: %7.2f ms  p99: %7.2f ms  "
+               "max: %7.2f ms\n", names[style], (unsigned)params->frame_sz,
+               (double)sum / 1e6 / (double)params->count,
+               (double)w.lat[(params->count * 99U) / 100U] / 1e6,
+               (double)w.lat[params->count - 1U] / 1e6);
+        printf("%-8s         bulk: %.0f frames/s  expired: %llu of %lu\n", "",
+               (double)w.bulk / ((double)elapsed / 1e9),
+               (unsigned long long)stats.classes[0].dropped, queued);
+    }
+
+cleanup_close:
+    /* queued frames are written on close, so the wire must still run */
+    ser_close(ser);
+
+    if (started)
+    {
+        w.stop = 1;
+        (void)pthread_join(td, NULL);
+    }
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(w.fd);
+
+cleanup_lat:
+    free(w.lat);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+    size_t i;
+
+    params.count = 200U;
+    params.period = 5000U;
+    params.rate = 1000000U;
+    params.ttl = 5000U;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.period = (unsigned)strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3)
+    {
+        params.rate = strtoul(argv[3], NULL, 0);
+    }
+
+    if (argc > 4)
+    {
+        params.ttl = (unsigned)strtoul(argv[4], NULL, 0);
+    }
+
+    if (params.count == 0U)
+    {
+        return 1;
+    }
+
+    printf("urgent frames: %lu every %u us behind a bulk transfer "
+           "(wire: %lu bytes/s, bulk ttl: %u us)\n", params.count,
+           params.period, params.rate, params.ttl);
+
+    for (i = 0U; i < sizeof(frame_szs) / sizeof(frame_szs[0]); i++)
+    {
+        params.frame_sz = frame_szs[i];
+
+        if ((run(&params, STYLE_FIFO) < 0) || (run(&params, STYLE_PRIO) < 0) ||
+            (run(&params, STYLE_PRIO_TTL) < 0))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ * Live reconfiguration: baudrate switch with close/open versus
+ * ser_reconfigure().
+ *
+ * A handshake is emulated: the port alternates between two baudrates, and the
+ * device answers with a burst right as the switch starts (the bytes are
+ * already queued on the port while it is being switched). The switch is done
+ * using:
+ *
+ * - reopen: ser_close() + ser_open() with the new baudrate.
+ * - reconf: ser_reconfigure() with the new baudrate (applied right away).
+ *
+ * The switch time (average, 99th percentile and worst case) and the burst
+ * bytes lost in the switch are reported.
+ *
+ * A regression check is run first: switching from a custom baudrate to 38400
+ * (the placeholder speed custom baudrates are stored with) must be applied.
+ */
+
+#include "bench.h"
+
+/** Device burst size (bytes). */
+#define BURST_SZ 64U
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of switches */
+    unsigned long count;
+    /** Low baudrate */
+    uint32_t low;
+    /** High baudrate */
+    uint32_t high;
+} params_t;
+
+/**
+ * Check a switch from a custom baudrate to 38400.
+ *
+ * @return
+ *      0 if the switch is applied, -1 otherwise.
+ */
+static int32_t check_custom(void)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    int fd;
+    ser_fd_t sfd;
+    uint32_t baudrate = 0U;
+    struct termios tios;
+
+    fd = bench_pty_open(port, sizeof(port));
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 250000U;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    opts.baudrate = 38400U;
+
+    r = ser_reconfigure(ser, &opts, SER_RECONF_NOW);
+    if (r < 0)
+    {
+        fprintf(stderr, "Switch failed: %s\n", sererr_last());
+        goto cleanup_close;
+    }
+
+    (void)ser_get_baudrate(ser, &baudrate);
+
+    if ((ser_get_fd(ser, &sfd) < 0) || (tcgetattr(sfd, &tios) < 0) ||
+        (cfgetospeed(&tios) != B38400) || (baudrate != 38400U))
+    {
+        r = -1;
+    }
+
+    printf("custom -> 38400 switch: %s\n", (r == 0) ? "ok" : "FAILED");
+
+cleanup_close:
+    ser_close(ser);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(fd);
+
+    return r;
+}
+
+static int32_t run(const params_t *params, int reconf)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    int fd;
+    uint8_t burst[BURST_SZ] = { 0 };
+    uint8_t buf[BURST_SZ];
+    int64_t *times;
+    int64_t sum = 0;
+    unsigned long lost = 0U;
+    unsigned long i;
+
+    times = malloc(params->count * sizeof(*times));
+    if (times == NULL)
+    {
+        fprintf(stderr, "Could not allocate samples\n");
+        return -1;
+    }
+
+    fd = bench_pty_open(port, sizeof(port));
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        r = -1;
+        goto cleanup_times;
+    }
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = params->low;
+    opts.timeouts.rd = 100;
+    opts.timeouts.wr = 1000;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    for (i = 0U; (i < params->count) && (r == 0); i++)
+    {
+        ser_deadline_t deadline;
+        size_t recvd = 0U;
+        int64_t start;
+
+        opts.baudrate = (opts.baudrate == params->low) ? params->high :
+                        params->low;
+
+        /* device answers as the switch starts */
+        if (write(fd, burst, sizeof(burst)) != (ssize_t)sizeof(burst))
+        {
+            fprintf(stderr, "Could not write burst\n");
+            r = -1;
+            break;
+        }
+
+        start = bench_now();
+
+        if (reconf)
+        {
+            r = ser_reconfigure(ser, &opts, SER_RECONF_NOW);
+        }
+        else
+        {
+            ser_close(ser);
+            r = ser_open(ser, &opts);
+        }
+
+        times[i] = bench_now() - start;
+        sum += times[i];
+
+        if (r < 0)
+        {
+            fprintf(stderr, "Switch failed: %s\n", sererr_last());
+            if (!reconf)
+            {
+                goto cleanup_ser;
+            }
+
+            break;
+        }
+
+        /* collect the burst */
+        deadline = ser_deadline_in(20);
+        (void)ser_read_exact(ser, buf, sizeof(buf), &recvd, &deadline);
+        lost += BURST_SZ - recvd;
+    }
+
+    if (r == 0)
+    {
+        qsort(times, params->count, sizeof(*times), bench_cmp_i64);
+
+        printf("%-6s  switch avg: %7.1f us  p99: %7.1f us  max: %7.1f us  "
+               "lost: %lu of %lu bytes\n", reconf ? "reconf" : "reopen",
+               (double)sum / 1e3 / (double)params->count,
+               (double)times[(params->count * 99U) / 100U] / 1e3,
+               (double)times[params->count - 1U] / 1e3, lost,
+               params->count * BURST_SZ);
+    }
+
+    ser_close(ser);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(fd);
+
+cleanup_times:
+    free(times);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.count = 200U;
+    params.low = 115200U;
+    params.high = 4000000U;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.high = (uint32_t)strtoul(argv[2], NULL, 0);
+    }
+
+    if (params.count == 0U)
+    {
+        return 1;
+    }
+
+    printf("baudrate switches: %lu (%u <-> %u bauds, %u bytes burst)\n",
+           params.count, (unsigned)params.low, (unsigned)params.high,
+           BURST_SZ);
+
+    if ((check_custom() < 0) || (run(&params, 0) < 0) ||
+        (run(&params, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+/**
+ * Real-time configuration self-test.
+ *
+ * Request/response cycles are run through the background reception and
+ * asynchronous transmission threads, with and without the real-time
+ * configuration (thread priority, CPU affinity, locked buffers). After a
+ * warm-up, the page faults and context switches per cycle are reported for the
+ * calling thread and for the whole process (library threads included).
+ *
+ * A non-zero priority requires real-time scheduling privileges (e.g.
+ * CAP_SYS_NICE or an rtprio limit), and locking buffers requires a large enough
+ * RLIMIT_MEMLOCK.
+ */
+
+#include "bench.h"
+
+#include <sys/resource.h>
+
+/** Request/response size (bytes). */
+#define MSG_SZ 8U
+
+/** Number of warm-up cycles (not measured). */
+#define WARMUP  100U
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of measured cycles */
+    unsigned long count;
+    /** Real-time configuration */
+    ser_rt_t rt;
+} params_t;
+
+/** Resource usage sample. */
+typedef struct
+{
+    /** Minor page faults */
+    long minflt;
+    /** Major page faults */
+    long majflt;
+    /** Voluntary context switches */
+    long nvcsw;
+    /** Involuntary context switches */
+    long nivcsw;
+} usage_t;
+
+/**
+ * Sample resource usage.
+ *
+ * @param [in] who
+ *      RUSAGE_THREAD or RUSAGE_SELF.
+ * @param [out] usage
+ *      Usage sample.
+ */
+static void usage_get(int who, usage_t *usage)
+{
+    struct rusage ru;
+
+    memset(&ru, 0, sizeof(ru));
+    (void)getrusage(who, &ru);
+
+    usage->minflt = ru.ru_minflt;
+    usage->majflt = ru.ru_majflt;
+    usage->nvcsw = ru.ru_nvcsw;
+    usage->nivcsw = ru.ru_nivcsw;
+}
+
+/**
+ * Print resource usage per cycle.
+ *
+ * @param [in] who
+ *      Label.
+ * @param [in] start
+ *      Usage at start.
+ * @param [in] end
+ *      Usage at end.
+ * @param [in] count
+ *      Number of cycles.
+ */
+static void usage_print(const char *who, const usage_t *start,
+                        const usage_t *end, unsigned long count)
+{
+    printf("          %-8s page faults/cycle: %.3f (major: %.3f)  "
+           "context switches/cycle: %.2f (involuntary: %.2f)\n", who,
+           (double)(end->minflt - start->minflt) / (double)count,
+           (double)(end->majflt - start->majflt) / (double)count,
+           (double)(end->nvcsw - start->nvcsw) / (double)count,
+           (double)(end->nivcsw - start->nivcsw) / (double)count);
+}
+
+static int32_t run(const params_t *params, int rt)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    bench_responder_t resp;
+    pthread_t td;
+    uint8_t req[MSG_SZ] = { 0 };
+    uint8_t buf[MSG_SZ];
+    unsigned long i;
+    usage_t thread_start;
+    usage_t thread_end;
+    usage_t proc_start;
+    usage_t proc_end;
+    int64_t start = 0;
+    int64_t elapsed;
+
+    resp.fd = bench_pty_open(port, sizeof(port));
+    if (resp.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    resp.count = WARMUP + params->count;
+    resp.msg_sz = MSG_SZ;
+    resp.delay = 0U;
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.rd = 1000;
+    opts.timeouts.wr = 1000;
+    opts.rx.ring_sz = 4096U;
+    opts.tx.ring_sz = 4096U;
+    if (rt)
+    {
+        opts.rt = params->rt;
+    }
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    if (pthread_create(&td, NULL, bench_responder, &resp) != 0)
+    {
+        fprintf(stderr, "Could not start responder\n");
+        r = -1;
+        goto cleanup_close;
+    }
+
+    for (i = 0U; (i < WARMUP + params->count) && (r == 0); i++)
+    {
+        ser_deadline_t deadline;
+
+        if (i == WARMUP)
+        {
+            usage_get(RUSAGE_THREAD, &thread_start);
+            usage_get(RUSAGE_SELF, &proc_start);
+            start = bench_now();
+        }
+
+        req[0] = (uint8_t)i;
+
+        r = ser_write(ser, req, sizeof(req), NULL);
+        if (r == 0)
+        {
+            deadline = ser_deadline_in(1000);
+            r = ser_read_exact(ser, buf, sizeof(buf), NULL, &deadline);
+        }
+    }
+
+    usage_get(RUSAGE_THREAD, &thread_end);
+    usage_get(RUSAGE_SELF, &proc_end);
+    elapsed = bench_now() - start;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Cycle failed: %s\n", sererr_last());
+    }
+    else
+    {
+        printf("%-8s  cycles: %lu  time/cycle: %.1f us\n",
+               rt ? "rt" : "default", params->count,
+               (double)elapsed / 1e3 / (double)params->count);
+        usage_print("thread", &thread_start, &thread_end, params->count);
+        usage_print("process", &proc_start, &proc_end, params->count);
+    }
+
+cleanup_close:
+    ser_close(ser);
+
+    if (r == 0)
+    {
+        (void)pthread_join(td, NULL);
+    }
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(resp.fd);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.count = 10000U;
+    params.rt.priority = 0;
+    params.rt.cpus = 0U;
+    params.rt.lock_memory = 1U;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.rt.priority = (int32_t)strtol(argv[2], NULL, 0);
+    }
+
+    if (argc > 3)
+    {
+        params.rt.cpus = (uint64_t)strtoull(argv[3], NULL, 0);
+    }
+
+    if (argc > 4)
+    {
+        params.rt.lock_memory = (uint8_t)strtoul(argv[4], NULL, 0);
+    }
+
+    printf("cycles: %lu (priority: %d, cpus: 0x%llx, locked buffers: %u)\n",
+           params.count, (int)params.rt.priority,
+           (unsigned long long)params.rt.cpus, params.rt.lock_memory);
+
+    if ((run(&params, 0) < 0) || (run(&params, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
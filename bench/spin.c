@@ -0,0 +1,199 @@
+/**
+ * Read wait strategies: blocking versus spinning waits on short
+ * request/response exchanges.
+ *
+ * A responder thread emulates a device answering each request after a given
+ * processing time, and the same number of transactions is run with each wait
+ * strategy (block, spin, adaptive). The round-trip time (average and worst
+ * case), the CPU time of the client thread and the wait statistics are
+ * reported, so that the CPU burned can be weighed against the latency saved.
+ *
+ * Spinning only pays off if the client has a core of its own: on a single
+ * core, it delays the responder (and the kernel work delivering its reply).
+ */
+
+#include "bench.h"
+
+/** Request/response size (bytes). */
+#define MSG_SZ 8U
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of transactions */
+    unsigned long count;
+    /** Responder processing time (us) */
+    unsigned delay;
+    /** Maximum spin time (us) */
+    uint32_t spin_us;
+} params_t;
+
+static int32_t run(const params_t *params, ser_wait_mode_t mode)
+{
+    static const char *const names[] = { "block", "spin", "adaptive" };
+
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    bench_responder_t resp;
+    pthread_t td;
+    uint8_t req[MSG_SZ] = { 0 };
+    uint8_t buf[MSG_SZ];
+    unsigned long i;
+    int64_t rtt_max = 0;
+    int64_t start;
+    int64_t elapsed;
+    int64_t cpu;
+
+    resp.fd = bench_pty_open(port, sizeof(port));
+    if (resp.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    resp.count = params->count;
+    resp.msg_sz = MSG_SZ;
+    resp.delay = params->delay;
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.rd = 1000;
+    opts.timeouts.wr = 1000;
+    opts.wait.mode = mode;
+    opts.wait.spin_us = params->spin_us;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    if (pthread_create(&td, NULL, bench_responder, &resp) != 0)
+    {
+        fprintf(stderr, "Could not start responder\n");
+        r = -1;
+        goto cleanup_close;
+    }
+
+    start = bench_now();
+    cpu = bench_thread_cpu();
+
+    for (i = 0U; (i < params->count) && (r == 0); i++)
+    {
+        size_t recvd = 0U;
+        int64_t rtt;
+
+        req[0] = (uint8_t)i;
+        rtt = bench_now();
+
+        r = ser_write(ser, req, sizeof(req), NULL);
+
+        while ((r == 0) && (recvd < MSG_SZ))
+        {
+            size_t n = 0U;
+
+            r = ser_read_available(ser, &buf[recvd], MSG_SZ - recvd, &n);
+            recvd += n;
+        }
+
+        rtt = bench_now() - rtt;
+        if (rtt > rtt_max)
+        {
+            rtt_max = rtt;
+        }
+    }
+
+    cpu = bench_thread_cpu() - cpu;
+    elapsed = bench_now() - start;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Transaction failed: %s\n", sererr_last());
+    }
+
+    if (r == 0)
+    {
+        ser_wait_stats_t stats;
+
+        printf("%-8s  rtt avg: %.1f us  rtt max: %.1f us  cpu: %.0f%%\n",
+               names[mode], (double)elapsed / 1e3 / (double)params->count,
+               (double)rtt_max / 1e3, 100.0 * (double)cpu / (double)elapsed);
+
+        if (ser_wait_stats(ser, &stats) == 0)
+        {
+            printf("%-8s  waits: %llu  spin hits: %llu  spin misses: %llu  "
+                   "spin: %.1f ms  blocked: %.1f ms  budget: %u us\n", "",
+                   (unsigned long long)stats.waits,
+                   (unsigned long long)stats.spin_hits,
+                   (unsigned long long)stats.spin_misses,
+                   (double)stats.spin_ns / 1e6, (double)stats.block_ns / 1e6,
+                   stats.budget_us);
+        }
+    }
+
+cleanup_close:
+    ser_close(ser);
+
+    if (r == 0)
+    {
+        (void)pthread_join(td, NULL);
+    }
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(resp.fd);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.count = 20000U;
+    params.delay = 0U;
+    params.spin_us = 200U;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.delay = (unsigned)strtoul(argv[2], NULL, 0);
+    }
+
+    if (argc > 3)
+    {
+        params.spin_us = (uint32_t)strtoul(argv[3], NULL, 0);
+    }
+
+    printf("request/response: %lu transactions, reply after %u us "
+           "(spin up to %u us)\n", params.count, params.delay,
+           params.spin_us);
+
+    if ((run(&params, SER_WAIT_BLOCK) < 0) ||
+        (run(&params, SER_WAIT_SPIN) < 0) ||
+        (run(&params, SER_WAIT_ADAPTIVE) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+/**
+ * Request/response transactions: hand-rolled loop versus ser_transact().
+ *
+ * A responder thread emulates a device echoing each request, and the same
+ * number of transactions is run using:
+ *
+ * - loop: ser_write() + ser_read_wait() / ser_read() until the response is
+ *   complete (each call with its own timeout).
+ * - transact: ser_transact() with the response size (one deadline).
+ * - framed: ser_transact() with a response framer.
+ *
+ * The time per transaction and the read system calls of the client are
+ * reported (Linux, /proc/thread-self).
+ */
+
+#include "bench.h"
+
+/** Request/response size (bytes). */
+#define MSG_SZ 8U
+
+/** Transaction styles. */
+typedef enum
+{
+    /** Hand-rolled loop */
+    STYLE_LOOP,
+    /** ser_transact() with response size */
+    STYLE_TRANSACT,
+    /** ser_transact() with framer */
+    STYLE_FRAMED
+} style_t;
+
+/**
+ * Fixed size framer (emulates a protocol with a length field).
+ *
+ * @param [in] ctx
+ *      Unused.
+ * @param [in] buf
+ *      Bytes received so far.
+ * @param [in] sz
+ *      Number of bytes received so far.
+ *
+ * @return
+ *      Response size once complete, 0 otherwise.
+ */
+static int32_t framer(void *ctx, const uint8_t *buf, size_t sz)
+{
+    (void)ctx;
+    (void)buf;
+
+    return (sz >= MSG_SZ) ? (int32_t)MSG_SZ : 0;
+}
+
+static int32_t run(unsigned long count, style_t style)
+{
+    static const char *const names[] = { "loop", "transact", "framed" };
+
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    ser_transact_opts_t topts = SER_TRANSACT_OPTS_INIT;
+    char port[64];
+    bench_responder_t resp;
+    pthread_t td;
+    uint8_t req[MSG_SZ] = { 0 };
+    uint8_t buf[64];
+    unsigned long i;
+    long syscr_start;
+    long syscr_end;
+    int64_t start;
+    int64_t elapsed;
+
+    resp.fd = bench_pty_open(port, sizeof(port));
+    if (resp.fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        return -1;
+    }
+
+    resp.count = count;
+    resp.msg_sz = MSG_SZ;
+    resp.delay = 0U;
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.rd = 1000;
+    opts.timeouts.wr = 1000;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    if (style == STYLE_FRAMED)
+    {
+        topts.framer = framer;
+    }
+    else
+    {
+        topts.rsp_sz = MSG_SZ;
+    }
+
+    if (pthread_create(&td, NULL, bench_responder, &resp) != 0)
+    {
+        fprintf(stderr, "Could not start responder\n");
+        r = -1;
+        goto cleanup_close;
+    }
+
+    start = bench_now();
+    syscr_start = bench_thread_syscr();
+
+    for (i = 0U; (i < count) && (r == 0); i++)
+    {
+        req[0] = (uint8_t)i;
+
+        if (style == STYLE_LOOP)
+        {
+            size_t recvd = 0U;
+
+            r = ser_write(ser, req, sizeof(req), NULL);
+
+            while ((r == 0) && (recvd < MSG_SZ))
+            {
+                size_t n = 0U;
+
+                r = ser_read_wait(ser);
+                if (r == 0)
+                {
+                    r = ser_read(ser, &buf[recvd], MSG_SZ - recvd, &n);
+                }
+
+                recvd += n;
+            }
+        }
+        else
+        {
+            ser_deadline_t deadline;
+
+            deadline = ser_deadline_in(1000);
+            r = ser_transact(ser, req, sizeof(req), buf, sizeof(buf), &topts,
+                             NULL, &deadline);
+        }
+    }
+
+    syscr_end = bench_thread_syscr();
+    elapsed = bench_now() - start;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Transaction failed: %s\n", sererr_last());
+    }
+    else
+    {
+        printf("%-8s  transactions: %lu  time/transaction: %.1f us\n",
+               names[style], count, (double)elapsed / 1e3 / (double)count);
+
+        if ((syscr_start >= 0) && (syscr_end >= 0))
+        {
+            printf("%-8s  read syscalls/transaction measured: %.2f\n", "",
+                   (double)(syscr_end - syscr_start - 1) / (double)count);
+        }
+    }
+
+cleanup_close:
+    ser_close(ser);
+
+    if (r == 0)
+    {
+        (void)pthread_join(td, NULL);
+    }
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(resp.fd);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long count = 20000U;
+
+    if (argc > 1)
+    {
+        count = strtoul(argv[1], NULL, 0);
+    }
+
+    printf("request/response: %lu transactions of %u bytes\n", count, MSG_SZ);
+
+    if ((run(count, STYLE_LOOP) < 0) || (run(count, STYLE_TRANSACT) < 0) ||
+        (run(count, STYLE_FRAMED) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
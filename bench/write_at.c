@@ -0,0 +1,194 @@
+/**
+ * Time-scheduled transmission: sleep then write versus ser_write_at().
+ *
+ * Writes are scheduled at a fixed period, and issued using:
+ *
+ * - sleep: clock_nanosleep() until the scheduled time, then ser_write().
+ * - write_at: ser_write_at() (sleep until shortly before, busy-wait the rest).
+ *
+ * The dispatch error (time the write was issued at minus the scheduled time)
+ * is reported (average, 99th percentile and worst case), together with the CPU
+ * time of the calling thread. Accuracy depends on the thread getting a core on
+ * time: results on a loaded or shared core will show the scheduler latency.
+ */
+
+#include "bench.h"
+
+/** Message size (bytes). */
+#define MSG_SZ 8U
+
+/** Benchmark parameters. */
+typedef struct
+{
+    /** Number of writes */
+    unsigned long count;
+    /** Period (us) */
+    unsigned period;
+} params_t;
+
+static int32_t run(const params_t *params, int at)
+{
+    int32_t r = 0;
+
+    ser_t *ser;
+    ser_opts_t opts = SER_OPTS_INIT;
+    char port[64];
+    int fd;
+    uint8_t msg[MSG_SZ] = { 0 };
+    uint8_t buf[256];
+    int64_t *errs;
+    int64_t sum = 0;
+    int64_t next;
+    int64_t cpu;
+    int64_t elapsed;
+    unsigned long i;
+
+    errs = malloc(params->count * sizeof(*errs));
+    if (errs == NULL)
+    {
+        fprintf(stderr, "Could not allocate samples\n");
+        return -1;
+    }
+
+    fd = bench_pty_open(port, sizeof(port));
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not open pseudo-terminal\n");
+        r = -1;
+        goto cleanup_errs;
+    }
+
+    (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    ser = ser_create();
+    if (ser == NULL)
+    {
+        fprintf(stderr, "Could not create library instance: %s\n",
+                sererr_last());
+        r = -1;
+        goto cleanup_pty;
+    }
+
+    opts.port = port;
+    opts.baudrate = 115200;
+    opts.timeouts.wr = 1000;
+
+    r = ser_open(ser, &opts);
+    if (r < 0)
+    {
+        fprintf(stderr, "Could not open port: %s\n", sererr_last());
+        goto cleanup_ser;
+    }
+
+    cpu = bench_thread_cpu();
+    next = bench_now() + ((int64_t)params->period * 1000);
+
+    for (i = 0U; (i < params->count) && (r == 0); i++)
+    {
+        int64_t issued;
+
+        msg[0] = (uint8_t)i;
+
+        if (at)
+        {
+            ser_deadline_t when;
+            ser_deadline_t sent_at;
+
+            when.sec = next / 1000000000;
+            when.nsec = (int32_t)(next % 1000000000);
+
+            r = ser_write_at(ser, msg, sizeof(msg), NULL, &when, &sent_at);
+            issued = (sent_at.sec * 1000000000) + sent_at.nsec;
+        }
+        else
+        {
+            struct timespec ts;
+
+            ts.tv_sec = (time_t)(next / 1000000000);
+            ts.tv_nsec = (long)(next % 1000000000);
+
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+                                   NULL) == EINTR)
+            {
+            }
+
+            issued = bench_now();
+            r = ser_write(ser, msg, sizeof(msg), NULL);
+        }
+
+        errs[i] = issued - next;
+        sum += errs[i];
+
+        /* drain the other side */
+        while (read(fd, buf, sizeof(buf)) > 0)
+        {
+        }
+
+        next += (int64_t)params->period * 1000;
+    }
+
+    elapsed = (int64_t)params->count * params->period * 1000;
+    cpu = bench_thread_cpu() - cpu;
+
+    if (r < 0)
+    {
+        fprintf(stderr, "Write failed: %s\n", sererr_last());
+    }
+    else
+    {
+        qsort(errs, params->count, sizeof(*errs), bench_cmp_i64);
+
+        printf("%-8s  error avg: %6.1f us  p99: %6.1f us  max: %6.1f us  "
+               "cpu: %.0f%%\n", at ? "write_at" : "sleep",
+               (double)sum / 1e3 / (double)params->count,
+               (double)errs[(params->count * 99U) / 100U] / 1e3,
+               (double)errs[params->count - 1U] / 1e3,
+               100.0 * (double)cpu / (double)elapsed);
+    }
+
+    ser_close(ser);
+
+cleanup_ser:
+    ser_destroy(ser);
+
+cleanup_pty:
+    close(fd);
+
+cleanup_errs:
+    free(errs);
+
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    params_t params;
+
+    params.count = 2000U;
+    params.period = 1000U;
+
+    if (argc > 1)
+    {
+        params.count = strtoul(argv[1], NULL, 0);
+    }
+
+    if (argc > 2)
+    {
+        params.period = (unsigned)strtoul(argv[2], NULL, 0);
+    }
+
+    if (params.count == 0U)
+    {
+        return 1;
+    }
+
+    printf("scheduled writes: %lu of %u bytes, every %u us\n", params.count,
+           MSG_SZ, params.period);
+
+    if ((run(&params, 0) < 0) || (run(&params, 1) < 0))
+    {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PUBLIC_SERCOMM_ASIO_HPP_
+#define PUBLIC_SERCOMM_ASIO_HPP_
+
+#include <cerrno>
+#include <unistd.h>
+
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+
+#include "comms.h"
+#include "err.h"
+
+/**
+ * @file sercomm/asio.hpp
+ * @brief Boost.Asio adapter.
+ * @defgroup SER_ASIO Boost.Asio adapter
+ * @ingroup SER
+ *
+ * Header-only helpers to drive serial ports from a Boost.Asio io_context,
+ * without any extra thread. The port is watched with a
+ * boost::asio::posix::stream_descriptor, and serviced with the non-blocking
+ * calls once it is reported ready:
+ *
+ * @code
+ * auto sd = sercomm::asio::make_stream_descriptor(io, ser);
+ *
+ * std::function<void(const boost::system::error_code &)> on_readable;
+ * on_readable = [&](const boost::system::error_code &ec) {
+ *     uint8_t buf[256];
+ *     size_t recvd;
+ *
+ *     if (ec)
+ *         return;
+ *
+ *     while (ser_try_read(ser, buf, sizeof(buf), &recvd) == 0)
+ *         process(buf, recvd);
+ *
+ *     sercomm::asio::async_wait_readable(sd, on_readable);
+ * };
+ *
+ * sercomm::asio::async_wait_readable(sd, on_readable);
+ * @endcode
+ *
+ * @note
+ *      Only available on POSIX systems.
+ * @{
+ */
+
+namespace sercomm {
+namespace asio {
+
+/**
+ * Create a stream descriptor watching a serial port.
+ *
+ * @note
+ *      The descriptor owns a duplicate of the port file descriptor, so that
+ *      destroying it does not close the port. It must be destroyed (or
+ *      closed) before the port is closed.
+ *
+ * @param [in] ctx
+ *      Execution context (io_context).
+ * @param [in] ser
+ *      Opened library instance.
+ *
+ * @return
+ *      Stream descriptor.
+ *
+ * @throws boost::system::system_error
+ *      If the port native handle is not available (see ser_get_fd()), or it
+ *      could not be duplicated.
+ */
+template <typename ExecutionContext>
+inline boost::asio::posix::stream_descriptor
+make_stream_descriptor(ExecutionContext &ctx, ser_t *ser)
+{
+    ser_fd_t fd;
+    int fd_dup;
+
+    if (ser_get_fd(ser, &fd) < 0)
+    {
+        throw boost::system::system_error(
+            boost::system::errc::make_error_code(
+                boost::system::errc::not_supported),
+            sererr_last());
+    }
+
+    fd_dup = ::dup(fd);
+    if (fd_dup < 0)
+    {
+        throw boost::system::system_error(
+            boost::system::error_code(errno,
+                                      boost::system::system_category()),
+            "dup");
+    }
+
+    return boost::asio::posix::stream_descriptor(ctx, fd_dup);
+}
+
+/**
+ * Wait asynchronously until a serial port is readable.
+ *
+ * @param [in] sd
+ *      Stream descriptor (see make_stream_descriptor()).
+ * @param [in] handler
+ *      Completion handler, void(const boost::system::error_code &).
+ */
+template <typename Handler>
+inline void async_wait_readable(boost::asio::posix::stream_descriptor &sd,
+                                Handler &&handler)
+{
+    sd.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                  static_cast<Handler &&>(handler));
+}
+
+/**
+ * Wait asynchronously until a serial port is writable.
+ *
+ * @param [in] sd
+ *      Stream descriptor (see make_stream_descriptor()).
+ * @param [in] handler
+ *      Completion handler, void(const boost::system::error_code &).
+ */
+template <typename Handler>
+inline void async_wait_writable(boost::asio::posix::stream_descriptor &sd,
+                                Handler &&handler)
+{
+    sd.async_wait(boost::asio::posix::stream_descriptor::wait_write,
+                  static_cast<Handler &&>(handler));
+}
+
+} /* namespace asio */
+} /* namespace sercomm */
+
+/** @} */
+
+#endif
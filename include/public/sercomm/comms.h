@@ -41,6 +41,18 @@ SER_BEGIN_DECL
 /** Use for infinite timeout. */
 #define SER_NO_TIMEOUT  0
 
+/** Absolute deadline (monotonic clock). */
+typedef struct
+{
+    /** Seconds */
+    int64_t sec;
+    /** Nanoseconds */
+    int32_t nsec;
+} ser_deadline_t;
+
+/** Initializer for a deadline that never expires. */
+#define SER_DEADLINE_NEVER { INT64_MAX, 0 }
+
 /** Byte sizes. */
 typedef enum
 {
@@ -91,6 +103,111 @@ typedef enum
     SER_QUEUE_ALL
 } ser_queue_t;
 
+/** Reconfiguration timing. */
+typedef enum
+{
+    /** Right away (bytes being transmitted may be garbled) */
+    SER_RECONF_NOW,
+    /** Once queued bytes have been transmitted */
+    SER_RECONF_DRAIN
+} ser_reconf_t;
+
+/** Background reception overflow policies. */
+typedef enum
+{
+    /** Stop draining the port until there is room (bytes stay queued in the
+     * kernel) */
+    SER_RX_OVF_BLOCK = 0,
+    /** Drop the oldest buffered bytes */
+    SER_RX_OVF_DROP_OLDEST,
+    /** Drop the newly received bytes */
+    SER_RX_OVF_DROP_NEWEST
+} ser_rx_ovf_t;
+
+/** Background reception statistics. */
+typedef struct
+{
+    /** Bytes received from the port */
+    uint64_t bytes;
+    /** Bytes dropped because of overflows */
+    uint64_t dropped;
+    /** Number of times the receive ring was found full */
+    uint64_t overflows;
+    /** Maximum number of bytes buffered */
+    uint64_t high_water;
+} ser_rx_stats_t;
+
+/** Maximum number of transmit priority classes. */
+#define SER_TX_CLASSES_MAX 4U
+
+/** Asynchronous transmission statistics. */
+typedef struct
+{
+    /** Per priority class */
+    struct
+    {
+        /** Frames written */
+        uint64_t frames;
+        /** Bytes written */
+        uint64_t bytes;
+        /** Frames dropped because they expired before being written */
+        uint64_t dropped;
+        /** Frames currently queued */
+        uint64_t queued;
+    } classes[SER_TX_CLASSES_MAX];
+} ser_tx_stats_t;
+
+/** Transmit pacing statistics. */
+typedef struct
+{
+    /** Bytes written */
+    uint64_t bytes;
+    /** Number of times a write had to wait for the pacing */
+    uint64_t delays;
+    /** Total time waited (ns) */
+    uint64_t delay_ns;
+} ser_pace_stats_t;
+
+/** Low-latency profile knobs (flags). */
+typedef enum
+{
+    /** Serial driver low-latency mode (ASYNC_LOW_LATENCY) */
+    SER_LOWLAT_ASYNC = (1 << 0),
+    /** USB-serial adapter latency timer set to 1 ms (e.g. FTDI) */
+    SER_LOWLAT_LATENCY_TIMER = (1 << 1),
+    /** USB autosuspend disabled for the port device */
+    SER_LOWLAT_NO_AUTOSUSPEND = (1 << 2)
+} ser_lowlat_knob_t;
+
+/** Read wait strategies. */
+typedef enum
+{
+    /** Block in the kernel until bytes arrive */
+    SER_WAIT_BLOCK = 0,
+    /** Busy-poll the input queue for up to the spin time, then block */
+    SER_WAIT_SPIN,
+    /** Busy-poll for a time learnt from the observed reply times (bounded by
+     * the spin time), then block */
+    SER_WAIT_ADAPTIVE
+} ser_wait_mode_t;
+
+/** Read wait statistics. */
+typedef struct
+{
+    /** Number of waits */
+    uint64_t waits;
+    /** Waits completed while spinning (no scheduler wakeup required) */
+    uint64_t spin_hits;
+    /** Waits that had to block after spinning */
+    uint64_t spin_misses;
+    /** Time spent spinning (CPU burned, ns) */
+    uint64_t spin_ns;
+    /** Time spent blocked after spinning (ns) */
+    uint64_t block_ns;
+    /** Current spin budget (us) */
+    uint32_t budget_us;
+} ser_wait_stats_t;
+
 /** Serial port options. */
 typedef struct
 {
@@ -112,8 +229,116 @@ typedef struct
         /** Write */
         int32_t wr;
     } timeouts;
+    /** Background reception */
+    struct
+    {
+        /** Receive ring size (bytes, rounded up to a power of two). When
+         * non-zero, a dedicated thread drains the port into the ring as soon
+         * as bytes arrive, and reads are served from the ring. */
+        size_t ring_sz;
+        /** Overflow policy */
+        ser_rx_ovf_t overflow;
+    } rx;
+    /** Asynchronous transmission */
+    struct
+    {
+        /** Transmit ring size (bytes, rounded up to a power of two). When
+         * non-zero, a dedicated thread writes the queued bytes, coalescing
+         * queued frames into large writes (see ser_write_async()). */
+        size_t ring_sz;
+        /** Number of priority classes (0 or 1 for a single queue, up to
+         * #SER_TX_CLASSES_MAX). Each class has its own ring of ring_sz
+         * bytes, higher classes being more urgent (see
+         * ser_write_async_prio()). */
+        uint8_t classes;
+        /** Class weights. Classes with a zero weight are served first, in
+         * strict priority order. Classes with a non-zero weight share the
+         * remaining bandwidth in proportion to their weight. Either way,
+         * classes only take turns at frame boundaries. */
+        uint16_t weights[SER_TX_CLASSES_MAX];
+    } tx;
+    /** Transmit pacing (POSIX only, ignored elsewhere). Bytes are handed to
+     * the port no faster than a token bucket allows, for devices with small
+     * receive FIFOs and no flow control. Applies to all writes (and to the
+     * asynchronous transmission thread), except io_uring transfers. An
+     * inter-byte gap g is obtained with a rate of 1/g and a burst of 1, an
+     * inter-chunk gap g between chunks of n bytes with a rate of n/g and a
+     * burst of n. */
+    struct
+    {
+        /** Rate (bytes/s, 0 to disable) */
+        uint32_t rate;
+        /** Burst size (bytes, bytes are released in chunks of this size at
+         * most, 0 for 1) */
+        uint32_t burst;
+    } pacing;
+    /** Kernel-side blocking reads (POSIX only, ignored elsewhere) */
+    struct
+    {
+        /** Enable (non-zero). Reads use a second, blocking descriptor of
+         * the port, so each read is completed by the kernel once vmin bytes
+         * are received or the vtime inter-byte timeout expires (ser_read()
+         * returns SER_EEMPTY if no bytes were received). Writes are not
+         * affected. Intended for bulk streaming: it cannot be combined with
+         * background reception. */
+        uint8_t enabled;
+        /** Minimum number of bytes per read (VMIN) */
+        uint8_t vmin;
+        /** Inter-byte timeout (VTIME, tenths of a second) */
+        uint8_t vtime;
+    } blocking;
+    /** Low-latency profile (Linux only, non-zero to enable). Port and USB
+     * adapter knobs are tuned on open (best-effort, see ser_low_latency())
+     * and restored on close. Some knobs require write access to sysfs. */
+    uint8_t low_latency;
+    /** Read wait strategy (POSIX only, ignored elsewhere). Spinning trades
+     * CPU time for the scheduler wakeup latency of blocking waits, and is
+     * intended for short request/response loops on isolated cores. Not used
+     * with background reception or blocking mode. */
+    struct
+    {
+        /** Mode */
+        ser_wait_mode_t mode;
+        /** Maximum spin time per wait (us) */
+        uint32_t spin_us;
+    } wait;
+    /** Real-time configuration of the background reception and asynchronous
+     * transmission threads and rings (POSIX only, ignored elsewhere) */
+    ser_rt_t rt;
 } ser_opts_t;
 
+/**
+ * Asynchronous write completion callback.
+ *
+ * @note
+ *      Called from the transmission thread. On failure, the error details can
+ *      be obtained with sererr_last() from within the callback.
+ *
+ * @param [in] ctx
+ *      Callback context.
+ * @param [in] seq
+ *      Frame sequence number (as returned by ser_write_async()).
+ * @param [in] r
+ *      0 if the frame was written, error code otherwise.
+ */
+typedef void (*ser_tx_on_done_t)(void *ctx, uint64_t seq, int32_t r);
+
+/** Native port handle (file descriptor on POSIX, HANDLE on Windows). */
+#ifdef _WIN32
+typedef void *ser_fd_t;
+#else
+typedef int ser_fd_t;
+#endif
+
+/** I/O vector (scatter/gather buffer). */
+typedef struct
+{
+    /** Buffer */
+    void *buf;
+    /** Buffer size */
+    size_t sz;
+} ser_iov_t;
+
 /** Initializer for serial port configuration structure. */
 #define SER_OPTS_INIT { NULL, \
                         0, \
@@ -123,9 +348,59 @@ typedef struct
                         { \
                             0, \
                             0, \
-                        } \
+                        }, \
+                        { \
+                            0, \
+                            SER_RX_OVF_BLOCK \
+                        }, \
+                        { \
+                            0, \
+                            0, \
+                            { 0, 0, 0, 0 } \
+                        }, \
+                        { \
+                            0, \
+                            0 \
+                        }, \
+                        { \
+                            0, \
+                            1, \
+                            0 \
+                        }, \
+                        0, \
+                        { \
+                            SER_WAIT_BLOCK, \
+                            0 \
+                        }, \
+                        SER_RT_INIT \
                       }
 
+/**
+ * Obtain a deadline relative to the current time.
+ *
+ * @note
+ *      Negative timeouts are treated as #SER_NO_TIMEOUT (the deadline never
+ *      expires), as port timeouts always were.
+ *
+ * @param [in] timeout
+ *      Timeout (ms) - see #SER_NO_TIMEOUT.
+ *
+ * @return
+ *      Deadline.
+ */
+SER_EXPORT ser_deadline_t ser_deadline_in(int32_t timeout);
+
+/**
+ * Obtain a deadline relative to the current time (nanosecond resolution).
+ *
+ * @param [in] timeout_ns
+ *      Timeout (ns), negative for a deadline that never expires.
+ *
+ * @return
+ *      Deadline.
+ */
+SER_EXPORT ser_deadline_t ser_deadline_in_ns(int64_t timeout_ns);
+
 /**
  * Open serial port.
  *
@@ -153,6 +428,91 @@ SER_EXPORT int32_t ser_open(ser_t *ser, const ser_opts_t *opts);
  */
 SER_EXPORT void ser_close(ser_t *ser);
 
+/**
+ * Reconfigure an opened serial port.
+ *
+ * @note
+ *      Only the line settings (baudrate, byte size, parity and stop bits) and
+ *      the timeouts are taken from the options, other fields are ignored.
+ *      The port is kept open (and its buffers and threads running), and only
+ *      changed settings are applied. Queues are not flushed, so no bytes are
+ *      dropped. When waiting for queued bytes to be transmitted, the write
+ *      timeout applies (SER_ETIMEDOUT is returned if it expires, and nothing
+ *      is changed).
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      New options.
+ * @param [in] when
+ *      When to apply the new settings.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_reconfigure(ser_t *ser, const ser_opts_t *opts,
+                                   ser_reconf_t when);
+
+/** Automatic baudrate detection options. */
+typedef struct
+{
+    /** Candidate baudrates, likeliest first (NULL for a built-in table of
+     * common baudrates). The current baudrate is always tried first. */
+    const uint32_t *rates;
+    /** Number of candidate baudrates */
+    size_t nrates;
+    /** Probe sent after switching to each baudrate (optional) */
+    const void *probe;
+    /** Probe size (bytes) */
+    size_t probe_sz;
+    /** Pattern expected in the received bytes (optional). When given, a
+     * baudrate is only accepted once the pattern is received. */
+    const void *expect;
+    /** Expected pattern size (bytes, up to 64) */
+    size_t expect_sz;
+    /** Listening time at each baudrate (ms, non-zero) */
+    uint32_t listen;
+    /** Error-free bytes needed to accept a baudrate (if no pattern is
+     * expected) */
+    size_t min_bytes;
+} ser_autobaud_opts_t;
+
+/** Initializer for automatic baudrate detection options. */
+#define SER_AUTOBAUD_OPTS_INIT { NULL, 0U, NULL, 0U, NULL, 0U, 20U, 8U }
+
+/**
+ * Detect the baudrate of the device on the other side of the link.
+ *
+ * @note
+ *      Candidate baudrates are tried in order, switching the port in place
+ *      (see ser_reconfigure()): the input queue is flushed, the probe is sent
+ *      (if any), and received bytes are scored until the listening time
+ *      expires (or, if a probe is sent, until the line is idle after the
+ *      answer). Framing and parity errors (and breaks) are marked by the
+ *      driver (PARMRK) and counted, and a baudrate is rejected as soon as
+ *      errors dominate. A baudrate is accepted as soon as the expected
+ *      pattern is received or, without pattern, once enough error-free bytes
+ *      are received. Otherwise, the baudrate with the most received bytes
+ *      over errors (if clearly positive) is chosen. Wrong baudrates can still
+ *      produce error-free bytes (e.g. sub-multiples), so an expected pattern
+ *      is recommended. The port is left at the detected baudrate (at the
+ *      initial one if none is detected), with its input queue flushed. Not
+ *      supported on Windows.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      Detection options.
+ * @param [out] baudrate
+ *      Detected baudrate.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_EFAIL if no baudrate is
+ *      detected).
+ */
+SER_EXPORT int32_t ser_autobaud(ser_t *ser, const ser_autobaud_opts_t *opts,
+                                uint32_t *baudrate);
+
 /**
  * Flush serial port queue/s.
  *
@@ -179,6 +539,111 @@ SER_EXPORT int32_t ser_flush(ser_t *ser, ser_queue_t queue);
  */
 SER_EXPORT int32_t ser_available(ser_t *ser, size_t *available);
 
+/**
+ * Obtain the number of bytes queued for transmission.
+ *
+ * @note
+ *      Includes the bytes in the driver output queue and, if asynchronous
+ *      transmission is enabled, the queued bytes not written to the port yet.
+ *      Bytes in the transmitter itself (shift register, hardware FIFO) are
+ *      not accounted for. Pseudo-terminals always report an empty driver
+ *      queue.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [out] queued
+ *      Where number of queued bytes will be stored.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_outq(ser_t *ser, size_t *queued);
+
+/**
+ * Wait until all queued bytes have been transmitted.
+ *
+ * @note
+ *      Unlike tcdrain(), the wait is bounded by a deadline (and is not
+ *      affected by the read or write timeouts). The calling thread sleeps for
+ *      the estimated transmission time of the queued bytes, then polls the
+ *      transmitter until it is empty (Linux, if the driver reports its
+ *      status) or waits one extra character time otherwise, so that the line
+ *      can be turned around (e.g. half-duplex RS-485) right after it
+ *      returns. Flow control may hold bytes back indefinitely.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired).
+ */
+SER_EXPORT int32_t ser_drain(ser_t *ser, const ser_deadline_t *deadline);
+
+/**
+ * Obtain the baudrate the port actually runs at.
+ *
+ * @note
+ *      Drivers may round the requested baudrate to the closest one they can
+ *      generate. On Linux, the rate reported by the driver is returned (or
+ *      the one obtained from the custom divisor, on drivers that only support
+ *      this legacy method). Elsewhere, the requested baudrate is returned.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [out] baudrate
+ *      Where baudrate will be stored.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_get_baudrate(ser_t *ser, uint32_t *baudrate);
+
+/**
+ * Obtain background reception statistics.
+ *
+ * @param [in] ser
+ *      Opened library instance (with background reception enabled).
+ * @param [out] stats
+ *      Where statistics will be stored.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_rx_stats(ser_t *ser, ser_rx_stats_t *stats);
+
+/**
+ * Obtain the knobs applied by the low-latency profile.
+ *
+ * @param [in] ser
+ *      Opened library instance (with the low-latency profile enabled).
+ * @param [out] applied
+ *      Where the applied knobs will be stored (#ser_lowlat_knob_t flags).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_low_latency(ser_t *ser, uint32_t *applied);
+
+/**
+ * Obtain read wait statistics.
+ *
+ * @note
+ *      The latency saved by spinning is roughly the number of spin hits times
+ *      the scheduler wakeup latency of the system (see bench/spin.c).
+ *
+ * @param [in] ser
+ *      Opened library instance (with a spinning wait strategy).
+ * @param [out] stats
+ *      Where statistics will be stored.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_wait_stats(ser_t *ser, ser_wait_stats_t *stats);
+
 /**
  * Wait until serial port is ready to be read.
  *
@@ -190,6 +655,51 @@ SER_EXPORT int32_t ser_available(ser_t *ser, size_t *available);
  */
 SER_EXPORT int32_t ser_read_wait(ser_t *ser);
 
+/**
+ * Wait until serial port is ready to be read, or a deadline expires.
+ *
+ * @note
+ *      The read timeout of the port is not used.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] deadline
+ *      Deadline (see ser_deadline_in(), #SER_DEADLINE_NEVER).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired).
+ */
+SER_EXPORT int32_t ser_read_wait_until(ser_t *ser,
+                                       const ser_deadline_t *deadline);
+
+/**
+ * Read whatever is available from serial port, waiting only if nothing is.
+ *
+ * @note
+ *      Replaces the ser_available() + ser_read_wait() + ser_read() sequence:
+ *      pending bytes are read directly (a single system call), the port is
+ *      only waited for (up to the read timeout) when nothing is pending. If
+ *      bytes were written since the previous call (a request), the response
+ *      is waited for first rather than looked for with a read that would
+ *      find nothing.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [out] buf
+ *      Output buffer.
+ * @param [in] sz
+ *      Maximum number of bytes to read.
+ * @param [in] recvd
+ *      Number of received bytes (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if nothing arrived
+ *      in time).
+ */
+SER_EXPORT int32_t ser_read_available(ser_t *ser, void *buf, size_t sz,
+                                      size_t *recvd);
+
 /**
  * Read from serial port.
  *
@@ -231,6 +741,406 @@ SER_EXPORT int32_t ser_read(ser_t *ser, void *buf, size_t sz, size_t *recvd);
 SER_EXPORT int32_t ser_write(ser_t *ser, const void *buf, size_t sz,
                              size_t *sent);
 
+/**
+ * Write to serial port, retrying until all bytes are written or a deadline
+ * expires.
+ *
+ * @note
+ *      The write timeout of the port is not used: all retries share the same
+ *      absolute deadline.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] buf
+ *      Buffer with the data to be written.
+ * @param [in] sz
+ *      Number of bytes to write.
+ * @param [in] sent
+ *      Number of actual written bytes (optional, also set on failure).
+ * @param [in] deadline
+ *      Deadline (see ser_deadline_in(), #SER_DEADLINE_NEVER).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired).
+ */
+SER_EXPORT int32_t ser_write_until(ser_t *ser, const void *buf, size_t sz,
+                                   size_t *sent,
+                                   const ser_deadline_t *deadline);
+
+/**
+ * Write to serial port at a given time.
+ *
+ * @note
+ *      The calling thread sleeps until shortly before the given time, then
+ *      busy-waits the rest (the sleep margin adapts to the wake-up latencies
+ *      measured on the port), and writes. Accuracy depends on the thread
+ *      getting a core on time: an idle (or isolated) core and a real-time
+ *      priority are recommended. Bytes reach the wire right away only if the
+ *      output queue is empty. The write timeout of the port applies to the
+ *      write itself. Not available with asynchronous transmission.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] buf
+ *      Buffer with the data to be written.
+ * @param [in] sz
+ *      Number of bytes to write.
+ * @param [in] sent
+ *      Number of actual written bytes (optional, also set on failure).
+ * @param [in] at
+ *      Time to write at (monotonic clock, see ser_deadline_in_ns()). Past
+ *      times write right away.
+ * @param [out] sent_at
+ *      Time the first bytes were handed to the driver, taken right after the
+ *      first successful write (optional, only set once bytes are written).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_write_at(ser_t *ser, const void *buf, size_t sz,
+                                size_t *sent, const ser_deadline_t *at,
+                                ser_deadline_t *sent_at);
+
+/**
+ * Read an exact number of bytes from serial port.
+ *
+ * @note
+ *      Bytes are read as they become available, requesting all the remaining
+ *      ones on each read, until the requested number of bytes is received or
+ *      the deadline expires. The read timeout of the port is not used.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [out] buf
+ *      Output buffer.
+ * @param [in] sz
+ *      Number of bytes to read.
+ * @param [out] recvd
+ *      Number of received bytes, also on failure (optional).
+ * @param [in] deadline
+ *      Deadline for the whole operation.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired before all bytes were received).
+ *
+ * @see
+ *      ser_deadline_in
+ */
+SER_EXPORT int32_t ser_read_exact(ser_t *ser, void *buf, size_t sz,
+                                  size_t *recvd,
+                                  const ser_deadline_t *deadline);
+
+/**
+ * Read from serial port into multiple buffers (scatter).
+ *
+ * @note
+ *      Buffers are filled in order, as if they were a single contiguous
+ *      buffer. Behaves like ser_read() otherwise.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] iov
+ *      Buffers.
+ * @param [in] iovcnt
+ *      Number of buffers.
+ * @param [in] recvd
+ *      Number of received bytes (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_read
+ */
+SER_EXPORT int32_t ser_readv(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                             size_t *recvd);
+
+/**
+ * Write multiple buffers to serial port (gather).
+ *
+ * @note
+ *      Buffers are written in order, as if they were a single contiguous
+ *      buffer, without intermediate copies. Behaves like ser_write()
+ *      otherwise.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] iov
+ *      Buffers.
+ * @param [in] iovcnt
+ *      Number of buffers.
+ * @param [in] sent
+ *      Number of actual written bytes (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_write
+ */
+SER_EXPORT int32_t ser_writev(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                              size_t *sent);
+
+/**
+ * Write multiple buffers to serial port (gather), retrying until all bytes are
+ * written or a deadline expires.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] iov
+ *      Buffers.
+ * @param [in] iovcnt
+ *      Number of buffers.
+ * @param [in] sent
+ *      Number of actual written bytes (optional, also set on failure).
+ * @param [in] deadline
+ *      Deadline (see ser_deadline_in(), #SER_DEADLINE_NEVER).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired).
+ *
+ * @see
+ *      ser_writev, ser_write_until
+ */
+SER_EXPORT int32_t ser_writev_until(ser_t *ser, const ser_iov_t *iov,
+                                    size_t iovcnt, size_t *sent,
+                                    const ser_deadline_t *deadline);
+
+/**
+ * Queue a frame for asynchronous transmission.
+ *
+ * @note
+ *      Requires asynchronous transmission to be enabled (tx.ring_sz option).
+ *      The frame is copied into the transmit ring, so the buffer can be reused
+ *      right after the call. Frames are written in order (queued in class 0
+ *      if priority classes are enabled, see ser_write_async_prio()). Never
+ *      blocks: if there is no room for the frame, SER_EBUSY is returned (wait
+ *      for an earlier frame with ser_tx_wait() and retry).
+ *
+ *      Once enabled, ser_write() and ser_writev() go through the same queue
+ *      (and wait for completion), so that ordering is kept.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] buf
+ *      Input buffer.
+ * @param [in] sz
+ *      Input buffer size (must fit in the transmit ring).
+ * @param [in] on_done
+ *      Completion callback (optional).
+ * @param [in] ctx
+ *      Completion callback context (optional).
+ * @param [out] seq
+ *      Frame sequence number (optional, first frame is 1).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_tx_wait
+ */
+SER_EXPORT int32_t ser_write_async(ser_t *ser, const void *buf, size_t sz,
+                                   ser_tx_on_done_t on_done, void *ctx,
+                                   uint64_t *seq);
+
+/**
+ * Queue a frame for asynchronous transmission in a priority class.
+ *
+ * @note
+ *      Requires asynchronous transmission to be enabled (tx.ring_sz option).
+ *      Frames are written in order within a class, classes being scheduled
+ *      according to the tx.weights option: an urgent frame only waits for
+ *      the frame being written (and for the bytes already handed to the
+ *      driver). Frames still queued once expired are dropped, and completed
+ *      with SER_ETIMEDOUT. Never blocks: if there is no room for the frame,
+ *      SER_EBUSY is returned.
+ *
+ *      ser_write_async(), ser_write() and ser_writev() use class 0.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] buf
+ *      Input buffer.
+ * @param [in] sz
+ *      Input buffer size (must fit in the transmit ring).
+ * @param [in] prio
+ *      Priority class (lower than the tx.classes option).
+ * @param [in] expires
+ *      Time after which the frame must not be written anymore (optional,
+ *      never expires if NULL).
+ * @param [in] on_done
+ *      Completion callback (optional).
+ * @param [in] ctx
+ *      Completion callback context (optional).
+ * @param [out] seq
+ *      Frame sequence number (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_tx_wait, ser_tx_stats
+ */
+SER_EXPORT int32_t ser_write_async_prio(ser_t *ser, const void *buf,
+                                        size_t sz, uint8_t prio,
+                                        const ser_deadline_t *expires,
+                                        ser_tx_on_done_t on_done, void *ctx,
+                                        uint64_t *seq);
+
+/**
+ * Obtain asynchronous transmission statistics.
+ *
+ * @param [in] ser
+ *      Opened library instance (with asynchronous transmission).
+ * @param [out] stats
+ *      Statistics.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_tx_stats(ser_t *ser, ser_tx_stats_t *stats);
+
+/**
+ * Obtain transmit pacing statistics.
+ *
+ * @param [in] ser
+ *      Opened library instance (with transmit pacing).
+ * @param [out] stats
+ *      Statistics.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_pace_stats(ser_t *ser, ser_pace_stats_t *stats);
+
+/**
+ * Obtain the native port handle, so that the port can be watched by an
+ * external event loop (libuv, Boost.Asio, epoll, etc.).
+ *
+ * @note
+ *      The handle is owned by the library: it must not be closed, and it is
+ *      only valid until ser_close() is called. On POSIX, the file descriptor
+ *      is in non-blocking mode; once it is reported readable (or writable)
+ *      use ser_try_read() (or ser_try_write()) to service it. See the
+ *      sercomm/uv.h and sercomm/asio.hpp adapters.
+ *
+ *      The handle is not available while background reception is enabled,
+ *      since the port is then drained by the reception thread.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [out] fd
+ *      Where the native handle will be stored.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_get_fd(ser_t *ser, ser_fd_t *fd);
+
+/**
+ * Read from serial port without blocking.
+ *
+ * @note
+ *      Only the bytes already received are returned: this function never
+ *      waits for the port to be ready.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [out] buf
+ *      Output buffer.
+ * @param [in] sz
+ *      Maximum number of bytes to read.
+ * @param [out] recvd
+ *      Number of received bytes (optional).
+ *
+ * @return
+ *      0 on success, SER_EEMPTY if no bytes are available, error code
+ *      otherwise.
+ */
+SER_EXPORT int32_t ser_try_read(ser_t *ser, void *buf, size_t sz,
+                                size_t *recvd);
+
+/**
+ * Write to serial port without blocking.
+ *
+ * @note
+ *      Only the bytes the port can accept right now are written (a single
+ *      write call, it never waits for the port to be ready), so the number of
+ *      written bytes may be lower than requested (transmit pacing may lower
+ *      it further, SER_EBUSY is returned if it allows no bytes yet). If
+ *      asynchronous transmission is enabled, the whole buffer is queued
+ *      instead.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] buf
+ *      Input buffer.
+ * @param [in] sz
+ *      Number of bytes to write.
+ * @param [out] sent
+ *      Number of written bytes (optional).
+ *
+ * @return
+ *      0 on success, SER_EBUSY if no bytes could be written, error code
+ *      otherwise.
+ */
+SER_EXPORT int32_t ser_try_write(ser_t *ser, const void *buf, size_t sz,
+                                 size_t *sent);
+
+/**
+ * Write to serial port, accepting a partial write.
+ *
+ * @note
+ *      Writes the bytes the port can accept (transmit pacing applies) and
+ *      returns, so that the caller can apply backpressure. Without a
+ *      deadline it never waits, and no accepted bytes is not an error.
+ *      With a deadline, it only waits while the port cannot accept any
+ *      byte. Not available with asynchronous transmission.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] buf
+ *      Input buffer.
+ * @param [in] sz
+ *      Number of bytes to write.
+ * @param [out] sent
+ *      Number of accepted bytes.
+ * @param [in] deadline
+ *      Deadline to wait for room (NULL to never wait).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired before any byte was accepted).
+ */
+SER_EXPORT int32_t ser_write_some(ser_t *ser, const void *buf, size_t sz,
+                                  size_t *sent,
+                                  const ser_deadline_t *deadline);
+
+/**
+ * Wait until a queued frame has been written.
+ *
+ * @note
+ *      Frames of the same priority class queued before it have been written
+ *      (or dropped) too. The outcome of a frame can be obtained until twice
+ *      the capacity of the frames queues has been queued after it.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] seq
+ *      Frame sequence number.
+ * @param [in] deadline
+ *      Deadline (see ser_deadline_in(), #SER_DEADLINE_NEVER).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if deadline
+ *      expired).
+ */
+SER_EXPORT int32_t ser_tx_wait(ser_t *ser, uint64_t seq,
+                               const ser_deadline_t *deadline);
+
 /** @} */
 
 SER_END_DECL
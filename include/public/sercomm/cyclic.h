@@ -0,0 +1,235 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PUBLIC_SERCOMM_CYCLIC_H_
+#define PUBLIC_SERCOMM_CYCLIC_H_
+
+#include "common.h"
+#include "types.h"
+#include "comms.h"
+#include "transact.h"
+
+SER_BEGIN_DECL
+
+/**
+ * @file sercomm/cyclic.h
+ * @brief Cyclic executor.
+ * @defgroup SER_CYCLIC Cyclic executor
+ * @ingroup SER
+ *
+ * The cyclic executor runs fixed-rate exchanges (e.g. setpoint/feedback) on
+ * one or more ports from a single thread. Each port has a period and a phase
+ * offset, and on each release the executor asks the port fill hook for the
+ * request, runs the transaction and hands the response to the consume hook.
+ * Releases are scheduled on absolute times (no drift), and the release jitter
+ * (how late the exchange started) is recorded in a histogram together with
+ * the overruns (exchanges that did not complete before the next release).
+ *
+ * @note
+ *      Exchanges of the ports sharing an executor run one after another:
+ *      phase offsets should leave room for them, otherwise releases are
+ *      delayed (and show up as jitter).
+ * @{
+ */
+
+/** Cyclic executor. */
+typedef struct ser_cyclic ser_cyclic_t;
+
+/** Number of jitter histogram buckets. */
+#define SER_CYCLIC_HIST_SZ      16U
+
+/**
+ * Request fill hook.
+ *
+ * @param [in] ctx
+ *      Hook context.
+ * @param [in] cycle
+ *      Cycle number.
+ * @param [out] buf
+ *      Request buffer.
+ * @param [in] cap
+ *      Request buffer size.
+ * @param [out] sz
+ *      Request size (0 to skip the exchange in this cycle).
+ *
+ * @return
+ *      0 on success, error code otherwise (the exchange is skipped, and the
+ *      error is reported to the consume hook).
+ */
+typedef int32_t (*ser_cyclic_fill_t)(void *ctx, uint64_t cycle, uint8_t *buf,
+                                     size_t cap, size_t *sz);
+
+/**
+ * Response consume hook.
+ *
+ * @param [in] ctx
+ *      Hook context.
+ * @param [in] cycle
+ *      Cycle number.
+ * @param [in] r
+ *      0 if the exchange succeeded, error code otherwise.
+ * @param [in] rsp
+ *      Response (only valid during the call).
+ * @param [in] rsp_sz
+ *      Response size (0 if no response is expected).
+ */
+typedef void (*ser_cyclic_consume_t)(void *ctx, uint64_t cycle, int32_t r,
+                                     const uint8_t *rsp, size_t rsp_sz);
+
+/** Cyclic exchange options. */
+typedef struct
+{
+    /** Period (us) */
+    uint32_t period_us;
+    /** Phase offset within the period (us) */
+    uint32_t phase_us;
+    /** Response timeout from the release (us, 0 for the period) */
+    uint32_t timeout_us;
+    /** Maximum request size (bytes) */
+    size_t req_max;
+    /** Maximum response size (bytes) */
+    size_t rsp_max;
+    /** Response size or framer (no response is read if neither is given) */
+    ser_transact_opts_t transact;
+    /** Request fill hook */
+    ser_cyclic_fill_t fill;
+    /** Response consume hook (optional) */
+    ser_cyclic_consume_t consume;
+    /** Hooks context */
+    void *ctx;
+} ser_cyclic_opts_t;
+
+/** Initializer for cyclic exchange options. */
+#define SER_CYCLIC_OPTS_INIT \
+    { 1000U, 0U, 0U, 64U, 64U, SER_TRANSACT_OPTS_INIT, NULL, NULL, NULL }
+
+/** Cyclic exchange statistics. */
+typedef struct
+{
+    /** Cycles run */
+    uint64_t cycles;
+    /** Exchanges that did not complete before the next release */
+    uint64_t overruns;
+    /** Releases skipped to catch up after overruns */
+    uint64_t skipped;
+    /** Failed exchanges */
+    uint64_t failures;
+    /** Maximum release jitter (ns) */
+    int64_t jitter_max_ns;
+    /** Total release jitter (ns), divide by cycles for the mean */
+    int64_t jitter_sum_ns;
+    /** Release jitter histogram: bucket 0 counts releases less than 1 us
+     * late, bucket i (i > 0) those [2^(i-1), 2^i) us late, the last bucket
+     * also counts anything later */
+    uint64_t hist[SER_CYCLIC_HIST_SZ];
+} ser_cyclic_stats_t;
+
+/**
+ * Create a cyclic executor.
+ *
+ * @param [in] rt
+ *      Real-time configuration of the executor thread (NULL for default
+ *      scheduling).
+ *
+ * @return
+ *      A new executor (NULL if it could not be created).
+ *
+ * @see
+ *      ser_cyclic_destroy
+ */
+SER_EXPORT ser_cyclic_t *ser_cyclic_create(const ser_rt_t *rt);
+
+/**
+ * Destroy a cyclic executor (stopping it if running).
+ *
+ * @param [in] cy
+ *      Executor.
+ */
+SER_EXPORT void ser_cyclic_destroy(ser_cyclic_t *cy);
+
+/**
+ * Add a cyclic exchange.
+ *
+ * @param [in] cy
+ *      Executor (not running).
+ * @param [in] ser
+ *      Opened library instance (must outlive the executor).
+ * @param [in] opts
+ *      Exchange options.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_EBUSY if running).
+ */
+SER_EXPORT int32_t ser_cyclic_add(ser_cyclic_t *cy, ser_t *ser,
+                                  const ser_cyclic_opts_t *opts);
+
+/**
+ * Start the executor thread.
+ *
+ * @note
+ *      The first release of all exchanges is aligned one millisecond after
+ *      the call (plus their phase offset). Statistics are reset.
+ *
+ * @param [in] cy
+ *      Executor.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_cyclic_start(ser_cyclic_t *cy);
+
+/**
+ * Stop the executor thread.
+ *
+ * @note
+ *      The thread stops right away, without waiting for its next release
+ *      (the exchange in progress, if any, is completed first).
+ *
+ * @param [in] cy
+ *      Executor.
+ */
+SER_EXPORT void ser_cyclic_stop(ser_cyclic_t *cy);
+
+/**
+ * Obtain cyclic exchange statistics.
+ *
+ * @param [in] cy
+ *      Executor.
+ * @param [in] ser
+ *      Library instance of the exchange.
+ * @param [out] stats
+ *      Where statistics will be stored.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_EINVAL if the port has no
+ *      exchange).
+ */
+SER_EXPORT int32_t ser_cyclic_stats(ser_cyclic_t *cy, ser_t *ser,
+                                    ser_cyclic_stats_t *stats);
+
+/** @} */
+
+SER_END_DECL
+
+#endif
@@ -127,6 +127,32 @@ SER_EXPORT void ser_dev_list_destroy(ser_dev_list_t *lst);
 SER_EXPORT ser_dev_mon_t *ser_dev_monitor_init(ser_dev_on_event_t on_event,
                                                void *ctx);
 
+/**
+ * Initialize the serial devices monitor (real-time configuration).
+ *
+ * @note
+ *      On Windows, a non-zero priority maps to the time critical thread
+ *      priority and memory locking is not supported.
+ *
+ * @param [in] on_event
+ *      Callback function that will be called when a new serial device is
+ *      connected or disconnected.
+ * @param [in] ctx
+ *      Context that will be passed to the callback function when called
+ *      (optional).
+ * @param [in] rt
+ *      Real-time configuration of the monitor thread (optional).
+ *
+ * @return
+ *      An instance of the device monitor (NULL if it could not be initialized).
+ *
+ * @see
+ *      ser_dev_monitor_stop
+ */
+SER_EXPORT ser_dev_mon_t *ser_dev_monitor_init_ex(ser_dev_on_event_t on_event,
+                                                  void *ctx,
+                                                  const ser_rt_t *rt);
+
 /**
  * Stop the serial devices monitor.
  *
@@ -137,6 +163,6 @@ SER_EXPORT void ser_dev_monitor_stop(ser_dev_mon_t *mon);
 
 /** @} */
 
-SER_BEGIN_DECL
+SER_END_DECL
 
 #endif
@@ -0,0 +1,220 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PUBLIC_SERCOMM_LOOP_H_
+#define PUBLIC_SERCOMM_LOOP_H_
+
+#include "common.h"
+#include "types.h"
+
+SER_BEGIN_DECL
+
+/**
+ * @file sercomm/loop.h
+ * @brief Event loop.
+ * @defgroup SER_LOOP Event loop
+ * @ingroup SER
+ *
+ * The event loop allows a single thread to service many serial ports. Ports
+ * are registered together with the events they are interested in and an
+ * optional inactivity timeout. Each call to ser_loop_run_once() waits until
+ * any of the registered ports is ready (or a timeout expires) and calls the
+ * port callback, so the cost of each wakeup only depends on the number of
+ * ready ports.
+ *
+ * @note
+ *      The event loop is only available on Linux (it is built on top of
+ *      epoll).
+ * @{
+ */
+
+/** Event loop. */
+typedef struct ser_loop ser_loop_t;
+
+/*
+ * Event loop event flags.
+ */
+
+/** Port is ready to be read. */
+#define SER_LOOP_EVT_RD         0x01U
+/** Port is ready to be written. */
+#define SER_LOOP_EVT_WR         0x02U
+/** No requested event occurred within the port timeout. */
+#define SER_LOOP_EVT_TIMEOUT    0x04U
+/** Port error or hang up (e.g. device was disconnected). */
+#define SER_LOOP_EVT_ERR        0x08U
+
+/**
+ * Event callback.
+ *
+ * @note
+ *      Ports (including the one being notified) may be modified or removed
+ *      from within the callback.
+ *
+ * @param [in] ctx
+ *      Context given when the port was added.
+ * @param [in] ser
+ *      Port that triggered the event.
+ * @param [in] events
+ *      Event flags (see SER_LOOP_EVT_*).
+ */
+typedef void (*ser_loop_on_event_t)(void *ctx, ser_t *ser, uint32_t events);
+
+/**
+ * Create an event loop.
+ *
+ * @return
+ *      A new event loop (NULL if it could not be created).
+ *
+ * @see
+ *      ser_loop_destroy
+ */
+SER_EXPORT ser_loop_t *ser_loop_create(void);
+
+/**
+ * Destroy an event loop.
+ *
+ * @note
+ *      Ports still registered are removed, but they are not closed.
+ *
+ * @param [in] loop
+ *      Event loop.
+ *
+ * @see
+ *      ser_loop_create
+ */
+SER_EXPORT void ser_loop_destroy(ser_loop_t *loop);
+
+/**
+ * Add a port to the event loop.
+ *
+ * @note
+ *      A port can only be registered on a single event loop. Ports with
+ *      background reception enabled are not supported (SER_ENOTSUP).
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] events
+ *      Events of interest (SER_LOOP_EVT_RD and/or SER_LOOP_EVT_WR).
+ * @param [in] timeout
+ *      Inactivity timeout (ms). The timeout is restarted every time the
+ *      callback is called - see #SER_NO_TIMEOUT.
+ * @param [in] on_event
+ *      Event callback.
+ * @param [in] ctx
+ *      Context that will be passed to the callback function when called
+ *      (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_loop_del
+ */
+SER_EXPORT int32_t ser_loop_add(ser_loop_t *loop, ser_t *ser, uint32_t events,
+                                int32_t timeout, ser_loop_on_event_t on_event,
+                                void *ctx);
+
+/**
+ * Modify the events of interest and timeout of a registered port.
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] ser
+ *      Registered library instance.
+ * @param [in] events
+ *      Events of interest (SER_LOOP_EVT_RD and/or SER_LOOP_EVT_WR).
+ * @param [in] timeout
+ *      Inactivity timeout (ms) - see #SER_NO_TIMEOUT.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_loop_mod(ser_loop_t *loop, ser_t *ser, uint32_t events,
+                                int32_t timeout);
+
+/**
+ * Remove a port from the event loop.
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] ser
+ *      Registered library instance.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_loop_add
+ */
+SER_EXPORT int32_t ser_loop_del(ser_loop_t *loop, ser_t *ser);
+
+/**
+ * Wait for events and dispatch them.
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] timeout
+ *      Maximum wait time (ms) - see #SER_NO_TIMEOUT.
+ *
+ * @return
+ *      Number of dispatched events (0 if none), error code otherwise.
+ */
+SER_EXPORT int32_t ser_loop_run_once(ser_loop_t *loop, int32_t timeout);
+
+/**
+ * Wait for events and dispatch them until the loop is stopped.
+ *
+ * @param [in] loop
+ *      Event loop.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_loop_stop
+ */
+SER_EXPORT int32_t ser_loop_run(ser_loop_t *loop);
+
+/**
+ * Stop an event loop.
+ *
+ * @note
+ *      This function can be called from any thread or from a callback.
+ *
+ * @param [in] loop
+ *      Event loop.
+ *
+ * @see
+ *      ser_loop_run
+ */
+SER_EXPORT void ser_loop_stop(ser_loop_t *loop);
+
+/** @} */
+
+SER_END_DECL
+
+#endif
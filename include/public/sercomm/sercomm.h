@@ -27,8 +27,15 @@
 
 #include "sercomm/base.h"
 #include "sercomm/comms.h"
+#include "sercomm/cyclic.h"
 #include "sercomm/dev.h"
 #include "sercomm/err.h"
+#include "sercomm/loop.h"
+#include "sercomm/transact.h"
+
+#ifdef SER_WITH_URING
+#include "sercomm/uring.h"
+#endif
 
 /**
  * @file sercomm/sercomm.h
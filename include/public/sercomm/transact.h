@@ -0,0 +1,522 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PUBLIC_SERCOMM_TRANSACT_H_
+#define PUBLIC_SERCOMM_TRANSACT_H_
+
+#include "common.h"
+#include "types.h"
+#include "comms.h"
+
+SER_BEGIN_DECL
+
+/**
+ * @file sercomm/transact.h
+ * @brief Transactions.
+ * @defgroup SER_TRANSACT Transactions
+ * @ingroup SER
+ *
+ * A transaction writes a request and reads its response under a single
+ * deadline, the way most command/reply device protocols are driven. The
+ * response is either of a known size, or delimited by a framer that inspects
+ * the received bytes. Transactions on several ports can be run concurrently
+ * under a shared deadline (see ser_transact_many()), or hedged over redundant
+ * links to the same device (see ser_hedge_transact()).
+ *
+ * Protocols that tag requests with an identifier can keep several requests
+ * in flight using a pipeline: requests are written as long as the window
+ * allows, and responses are matched back to their requests by identifier.
+ * Pipelines are driven by the calling thread (see ser_pipeline_poll()).
+ * @{
+ */
+
+/**
+ * Response framer.
+ *
+ * @param [in] ctx
+ *      Framer context.
+ * @param [in] buf
+ *      Bytes received so far.
+ * @param [in] sz
+ *      Number of bytes received so far.
+ *
+ * @return
+ *      Response size (bytes) once the response is complete, 0 if more bytes
+ *      are needed, error code if the bytes are not a valid response.
+ */
+typedef int32_t (*ser_framer_t)(void *ctx, const uint8_t *buf, size_t sz);
+
+/** Transaction options. */
+typedef struct
+{
+    /** Discard stale input before writing the request (non-zero) */
+    uint8_t flush;
+    /** Response size (bytes), used if no framer is given */
+    size_t rsp_sz;
+    /** Response framer (optional) */
+    ser_framer_t framer;
+    /** Response framer context */
+    void *framer_ctx;
+} ser_transact_opts_t;
+
+/** Initializer for transaction options. */
+#define SER_TRANSACT_OPTS_INIT { 0U, 0U, NULL, NULL }
+
+/**
+ * Write a request and read its response.
+ *
+ * @note
+ *      The request is written right away, and the port is only read once it
+ *      has bytes, so a transaction usually costs one write, one wait and one
+ *      read. When a framer is used, bytes received after the response (in the
+ *      same read) are discarded.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] req
+ *      Request.
+ * @param [in] req_sz
+ *      Request size.
+ * @param [out] rsp
+ *      Response buffer.
+ * @param [in] rsp_cap
+ *      Response buffer size.
+ * @param [in] opts
+ *      Transaction options (response size or framer).
+ * @param [out] rsp_sz
+ *      Response size, or number of bytes received on failure (optional).
+ * @param [in] deadline
+ *      Deadline for the whole transaction (write and read).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired, SER_EINVAL if the response does not fit, or the framer
+ *      error).
+ */
+SER_EXPORT int32_t ser_transact(ser_t *ser, const void *req, size_t req_sz,
+                                void *rsp, size_t rsp_cap,
+                                const ser_transact_opts_t *opts,
+                                size_t *rsp_sz,
+                                const ser_deadline_t *deadline);
+
+/** Transaction on one of several ports (see ser_transact_many()). */
+typedef struct
+{
+    /** Opened library instance */
+    ser_t *ser;
+    /** Request */
+    const void *req;
+    /** Request size */
+    size_t req_sz;
+    /** Response buffer */
+    void *rsp;
+    /** Response buffer size */
+    size_t rsp_cap;
+    /** Transaction options (response size or framer) */
+    const ser_transact_opts_t *opts;
+    /** Result (out): 0 on success, error code otherwise */
+    int32_t r;
+    /** Response size, or number of bytes received on failure (out) */
+    size_t rsp_sz;
+    /** Time from the call until the transaction completed (out, ns) */
+    int64_t elapsed_ns;
+} ser_transact_item_t;
+
+/**
+ * Run transactions on several ports concurrently.
+ *
+ * @note
+ *      All requests are written first, then the responses are collected as
+ *      they arrive, waiting on all ports at once. The time taken is thus that
+ *      of the slowest port instead of the sum of all ports. Each port must
+ *      appear at most once. Wait strategies (see ser_wait_mode_t) do not apply:
+ *      waits always block.
+ *
+ * @param [in, out] items
+ *      Transactions (results are filled).
+ * @param [in] cnt
+ *      Number of transactions.
+ * @param [in] deadline
+ *      Deadline shared by all transactions.
+ *
+ * @return
+ *      0 if all transactions succeeded, result of the first failed transaction
+ *      otherwise (see ser_transact_item_t), SER_ENOTSUP if not supported on
+ *      the platform.
+ */
+SER_EXPORT int32_t ser_transact_many(ser_transact_item_t *items, size_t cnt,
+                                     const ser_deadline_t *deadline);
+
+/** Transaction pipeline. */
+typedef struct ser_pipeline ser_pipeline_t;
+
+/**
+ * Pipeline response matcher.
+ *
+ * @param [in] ctx
+ *      Matcher context.
+ * @param [in] buf
+ *      Received bytes (a response starts at the first byte).
+ * @param [in] sz
+ *      Number of received bytes.
+ * @param [out] id
+ *      Identifier of the request the response belongs to.
+ *
+ * @return
+ *      Response size (bytes) once the response is complete, 0 if more bytes
+ *      are needed, error code if the bytes are not a valid response (the
+ *      first byte is then discarded to resynchronize).
+ */
+typedef int32_t (*ser_pipeline_match_t)(void *ctx, const uint8_t *buf,
+                                        size_t sz, uint32_t *id);
+
+/**
+ * Pipeline request completion callback.
+ *
+ * @note
+ *      Called from ser_pipeline_poll() (or any call driving the pipeline).
+ *      Further requests may be submitted from within the callback.
+ *
+ * @param [in] ctx
+ *      Callback context.
+ * @param [in] id
+ *      Request identifier.
+ * @param [in] r
+ *      0 if the response was received, error code otherwise (SER_ETIMEDOUT
+ *      if it did not arrive in time).
+ * @param [in] rsp
+ *      Response (only valid during the call, NULL on failure).
+ * @param [in] rsp_sz
+ *      Response size.
+ */
+typedef void (*ser_pipeline_on_done_t)(void *ctx, uint32_t id, int32_t r,
+                                       const uint8_t *rsp, size_t rsp_sz);
+
+/** Pipeline options. */
+typedef struct
+{
+    /** Maximum number of requests in flight */
+    size_t window;
+    /** Maximum response size (bytes) */
+    size_t rsp_max;
+    /** Response matcher */
+    ser_pipeline_match_t match;
+    /** Response matcher context */
+    void *match_ctx;
+} ser_pipeline_opts_t;
+
+/** Initializer for pipeline options. */
+#define SER_PIPELINE_OPTS_INIT { 8U, 256U, NULL, NULL }
+
+/** Pipeline statistics. */
+typedef struct
+{
+    /** Completed requests (responses received) */
+    uint64_t completed;
+    /** Requests that timed out */
+    uint64_t timeouts;
+    /** Responses that did not match any request in flight */
+    uint64_t unmatched;
+    /** Bytes discarded to resynchronize */
+    uint64_t discarded;
+} ser_pipeline_stats_t;
+
+/**
+ * Create a transaction pipeline.
+ *
+ * @param [in] ser
+ *      Opened library instance (must outlive the pipeline).
+ * @param [in] opts
+ *      Pipeline options.
+ *
+ * @return
+ *      A new pipeline (NULL if it could not be created).
+ *
+ * @see
+ *      ser_pipeline_destroy
+ */
+SER_EXPORT ser_pipeline_t *ser_pipeline_create(ser_t *ser,
+                                               const ser_pipeline_opts_t *opts);
+
+/**
+ * Destroy a transaction pipeline.
+ *
+ * @note
+ *      Requests still in flight are completed with SER_EFAIL.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ */
+SER_EXPORT void ser_pipeline_destroy(ser_pipeline_t *pl);
+
+/**
+ * Submit a request.
+ *
+ * @note
+ *      If the window is full, the pipeline is driven (responses are
+ *      processed) until a request completes or the deadline expires. The
+ *      request is then written right away.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [in] id
+ *      Request identifier (must be unique among requests in flight).
+ * @param [in] req
+ *      Request.
+ * @param [in] req_sz
+ *      Request size.
+ * @param [in] timeout
+ *      Deadline for the response.
+ * @param [in] on_done
+ *      Completion callback, NULL to collect the response with
+ *      ser_pipeline_wait().
+ * @param [in] ctx
+ *      Completion callback context.
+ * @param [in] deadline
+ *      Deadline for the submission (room in the window and write).
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_EBUSY if the identifier is
+ *      already in flight, SER_ETIMEDOUT if no room was available in time).
+ */
+SER_EXPORT int32_t ser_pipeline_submit(ser_pipeline_t *pl, uint32_t id,
+                                       const void *req, size_t req_sz,
+                                       const ser_deadline_t *timeout,
+                                       ser_pipeline_on_done_t on_done,
+                                       void *ctx,
+                                       const ser_deadline_t *deadline);
+
+/**
+ * Process responses and timeouts.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [in] deadline
+ *      Deadline (returns as soon as at least one request completes).
+ *
+ * @return
+ *      0 if at least one request completed, error code otherwise
+ *      (SER_ETIMEDOUT if none completed in time, SER_EEMPTY if no requests
+ *      are in flight).
+ */
+SER_EXPORT int32_t ser_pipeline_poll(ser_pipeline_t *pl,
+                                     const ser_deadline_t *deadline);
+
+/**
+ * Wait for a request submitted without callback (future) and collect its
+ * response.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [in] id
+ *      Request identifier.
+ * @param [out] rsp
+ *      Response buffer.
+ * @param [in] rsp_cap
+ *      Response buffer size.
+ * @param [out] rsp_sz
+ *      Response size (optional).
+ * @param [in] deadline
+ *      Deadline for the wait (the request stays in flight if it expires).
+ *
+ * @return
+ *      0 on success, error code otherwise (the request result, SER_EINVAL if
+ *      the identifier is unknown or the response does not fit).
+ */
+SER_EXPORT int32_t ser_pipeline_wait(ser_pipeline_t *pl, uint32_t id,
+                                     void *rsp, size_t rsp_cap,
+                                     size_t *rsp_sz,
+                                     const ser_deadline_t *deadline);
+
+/**
+ * Obtain the number of requests in flight (including completed ones not yet
+ * collected).
+ *
+ * @param [in] pl
+ *      Pipeline.
+ *
+ * @return
+ *      Number of requests in flight.
+ */
+SER_EXPORT size_t ser_pipeline_inflight(ser_pipeline_t *pl);
+
+/**
+ * Obtain pipeline statistics.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [out] stats
+ *      Where statistics will be stored.
+ */
+SER_EXPORT void ser_pipeline_stats(ser_pipeline_t *pl,
+                                   ser_pipeline_stats_t *stats);
+
+/** Hedged transaction group (redundant links to the same device). */
+typedef struct ser_hedge ser_hedge_t;
+
+/** Hedging modes. */
+typedef enum
+{
+    /** Send on the primary, hedge on the next link after the threshold */
+    SER_HEDGE_DELAYED,
+    /** Send on all links at once */
+    SER_HEDGE_ALWAYS
+} ser_hedge_mode_t;
+
+/** Hedged transaction group options. */
+typedef struct
+{
+    /** Hedging mode */
+    ser_hedge_mode_t mode;
+    /** Hedging threshold: percentile of the primary latency (1-99) */
+    uint32_t percentile;
+    /** Hedging threshold (us) used until enough latencies are known */
+    uint32_t threshold_us;
+    /** Maximum response size (bytes) */
+    size_t rsp_max;
+} ser_hedge_opts_t;
+
+/** Initializer for hedged transaction group options. */
+#define SER_HEDGE_OPTS_INIT { SER_HEDGE_DELAYED, 95U, 10000U, 256U }
+
+/** Hedged transaction group link statistics. */
+typedef struct
+{
+    /** Requests sent on the link */
+    uint64_t requests;
+    /** Requests sent as a hedge (the primary was late) */
+    uint64_t hedges;
+    /** Responses used (first valid response) */
+    uint64_t wins;
+    /** Requests abandoned (response late or never received) */
+    uint64_t late;
+    /** Failed requests (I/O errors, invalid responses) */
+    uint64_t failures;
+    /** Latency at the hedging percentile (us, 0 if not known yet) */
+    uint32_t latency_us;
+    /** Median latency (us, 0 if not known yet) */
+    uint32_t median_us;
+    /** Link is the primary (non-zero) */
+    uint8_t primary;
+} ser_hedge_link_stats_t;
+
+/**
+ * Create a hedged transaction group.
+ *
+ * @note
+ *      The first link is the initial primary. Afterwards, the link with the
+ *      lowest median latency becomes the primary (hedging takes care of its
+ *      tail), with some hysteresis so that similar links do not alternate.
+ *      Latencies of abandoned requests are sampled once their response is
+ *      drained, and every few transactions a backup link is also used right
+ *      away (probe), so that its latency keeps being known.
+ *
+ * @param [in] links
+ *      Opened library instances, each a link to the same device (must outlive
+ *      the group).
+ * @param [in] cnt
+ *      Number of links (at least 2).
+ * @param [in] opts
+ *      Group options.
+ *
+ * @return
+ *      A new group (NULL if it could not be created).
+ *
+ * @see
+ *      ser_hedge_destroy
+ */
+SER_EXPORT ser_hedge_t *ser_hedge_create(ser_t *const *links, size_t cnt,
+                                         const ser_hedge_opts_t *opts);
+
+/**
+ * Destroy a hedged transaction group.
+ *
+ * @param [in] hg
+ *      Group.
+ */
+SER_EXPORT void ser_hedge_destroy(ser_hedge_t *hg);
+
+/**
+ * Write a request and read its response over redundant links.
+ *
+ * @note
+ *      The request is sent on the primary link, and on the next link each time
+ *      the hedging threshold elapses without a response (or right away on all
+ *      links, see ser_hedge_mode_t, or if a link fails). The first valid
+ *      response is used. Responses arriving late on the other links are
+ *      drained and dropped (the links are not used until then, or until the
+ *      deadline of the request expires), so all links must use the same
+ *      response format.
+ *
+ * @param [in] hg
+ *      Group.
+ * @param [in] req
+ *      Request.
+ * @param [in] req_sz
+ *      Request size.
+ * @param [out] rsp
+ *      Response buffer.
+ * @param [in] rsp_cap
+ *      Response buffer size.
+ * @param [in] opts
+ *      Transaction options (response size or framer).
+ * @param [out] rsp_sz
+ *      Response size (optional).
+ * @param [out] link
+ *      Index of the link that answered (optional).
+ * @param [in] deadline
+ *      Deadline for the whole transaction.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if no link answered
+ *      in time, or the error of the last link that failed).
+ */
+SER_EXPORT int32_t ser_hedge_transact(ser_hedge_t *hg, const void *req,
+                                      size_t req_sz, void *rsp,
+                                      size_t rsp_cap,
+                                      const ser_transact_opts_t *opts,
+                                      size_t *rsp_sz, size_t *link,
+                                      const ser_deadline_t *deadline);
+
+/**
+ * Obtain hedged transaction group link statistics.
+ *
+ * @param [in] hg
+ *      Group.
+ * @param [in] link
+ *      Link index.
+ * @param [out] stats
+ *      Where statistics will be stored.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_hedge_stats(ser_hedge_t *hg, size_t link,
+                                   ser_hedge_link_stats_t *stats);
+
+/** @} */
+
+SER_END_DECL
+
+#endif
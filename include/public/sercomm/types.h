@@ -64,6 +64,21 @@ SER_BEGIN_DECL
 /** Library instance. */
 typedef struct ser ser_t;
 
+/** Real-time configuration (library threads and buffers). */
+typedef struct
+{
+    /** Thread priority (SCHED_FIFO, 1-99), 0 to keep the default
+     * scheduling */
+    int32_t priority;
+    /** Thread CPU affinity (bit n for CPU n), 0 for any CPU */
+    uint64_t cpus;
+    /** Prefault and lock buffers in memory (non-zero) */
+    uint8_t lock_memory;
+} ser_rt_t;
+
+/** Initializer for real-time configuration (disabled). */
+#define SER_RT_INIT { 0, 0U, 0U }
+
 /*
  * Library error codes.
  */
@@ -0,0 +1,230 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PUBLIC_SERCOMM_URING_H_
+#define PUBLIC_SERCOMM_URING_H_
+
+#include "common.h"
+#include "types.h"
+
+SER_BEGIN_DECL
+
+/**
+ * @file sercomm/uring.h
+ * @brief io_uring I/O backend.
+ * @defgroup SER_URING io_uring I/O backend
+ * @ingroup SER
+ *
+ * The io_uring backend allows to batch request/response exchanges
+ * (transactions) and continuous receptions on many ports, so that all of them
+ * are submitted and completed using a single system call. Each transaction is
+ * submitted as a linked write, read and timeout chain operating on registered
+ * buffers, and continuous receptions use multishot reads.
+ *
+ * If the running kernel does not support io_uring, the same API is serviced
+ * using the regular blocking I/O path (see ser_uring_is_native()).
+ *
+ * @note
+ *      The io_uring backend is only available on Linux, and only if the
+ *      library has been built with the WITH_URING option (see
+ *      #SER_WITH_URING).
+ * @{
+ */
+
+/** io_uring backend instance. */
+typedef struct ser_uring ser_uring_t;
+
+/**
+ * Transaction completion callback.
+ *
+ * @param [in] ctx
+ *      Context given when the transaction was queued.
+ * @param [in] ser
+ *      Port.
+ * @param [in] result
+ *      0 on success, error code otherwise (e.g. SER_ETIMEDOUT if the full
+ *      response was not received in time).
+ * @param [in] rsp
+ *      Response (only valid during the callback).
+ * @param [in] rsp_sz
+ *      Response size (may be smaller than expected on errors).
+ */
+typedef void (*ser_uring_on_done_t)(void *ctx, ser_t *ser, int32_t result,
+                                    const void *rsp, size_t rsp_sz);
+
+/**
+ * Reception callback.
+ *
+ * @param [in] ctx
+ *      Context given when the reception was started.
+ * @param [in] ser
+ *      Port.
+ * @param [in] result
+ *      0 on success, error code otherwise (reception is stopped on errors).
+ * @param [in] data
+ *      Received data (only valid during the callback).
+ * @param [in] sz
+ *      Received data size.
+ */
+typedef void (*ser_uring_on_data_t)(void *ctx, ser_t *ser, int32_t result,
+                                    const void *data, size_t sz);
+
+/**
+ * Create an io_uring backend instance.
+ *
+ * @param [in] depth
+ *      Maximum number of in-flight operations (transactions and receptions).
+ * @param [in] buf_sz
+ *      Size of the registered buffer of each operation, it limits the
+ *      maximum request/response size.
+ *
+ * @return
+ *      A new instance (NULL if it could not be created).
+ *
+ * @see
+ *      ser_uring_destroy
+ */
+SER_EXPORT ser_uring_t *ser_uring_create(uint32_t depth, size_t buf_sz);
+
+/**
+ * Destroy an io_uring backend instance.
+ *
+ * @note
+ *      In-flight operations are cancelled without calling their callbacks.
+ *
+ * @param [in] ring
+ *      Instance.
+ *
+ * @see
+ *      ser_uring_create
+ */
+SER_EXPORT void ser_uring_destroy(ser_uring_t *ring);
+
+/**
+ * Check if the instance is using io_uring.
+ *
+ * @param [in] ring
+ *      Instance.
+ *
+ * @return
+ *      1 if io_uring is used, 0 if the regular I/O path is used instead.
+ */
+SER_EXPORT int ser_uring_is_native(ser_uring_t *ring);
+
+/**
+ * Queue a transaction (write request, then read response).
+ *
+ * @note
+ *      The transaction is submitted on the next call to ser_uring_run_once().
+ *      A port can only have a single transaction or reception in-flight.
+ *      Ports with background reception or asynchronous transmission enabled
+ *      are not supported (SER_ENOTSUP).
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] req
+ *      Request.
+ * @param [in] req_sz
+ *      Request size.
+ * @param [in] rsp_sz
+ *      Expected response size.
+ * @param [in] timeout
+ *      Transaction timeout (ms) - see #SER_NO_TIMEOUT.
+ * @param [in] on_done
+ *      Completion callback.
+ * @param [in] ctx
+ *      Context that will be passed to the callback function when called
+ *      (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+SER_EXPORT int32_t ser_uring_transact(ser_uring_t *ring, ser_t *ser,
+                                      const void *req, size_t req_sz,
+                                      size_t rsp_sz, int32_t timeout,
+                                      ser_uring_on_done_t on_done, void *ctx);
+
+/**
+ * Start a continuous reception.
+ *
+ * @note
+ *      Ports with background reception enabled are not supported
+ *      (SER_ENOTSUP).
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] on_data
+ *      Reception callback.
+ * @param [in] ctx
+ *      Context that will be passed to the callback function when called
+ *      (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_uring_recv_stop
+ */
+SER_EXPORT int32_t ser_uring_recv_start(ser_uring_t *ring, ser_t *ser,
+                                        ser_uring_on_data_t on_data,
+                                        void *ctx);
+
+/**
+ * Stop a continuous reception.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] ser
+ *      Port with an active reception.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ *
+ * @see
+ *      ser_uring_recv_start
+ */
+SER_EXPORT int32_t ser_uring_recv_stop(ser_uring_t *ring, ser_t *ser);
+
+/**
+ * Submit queued operations, wait for completions and dispatch them.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] timeout
+ *      Maximum wait time (ms) - see #SER_NO_TIMEOUT.
+ *
+ * @return
+ *      Number of dispatched callbacks (0 if none), error code otherwise.
+ */
+SER_EXPORT int32_t ser_uring_run_once(ser_uring_t *ring, int32_t timeout);
+
+/** @} */
+
+SER_END_DECL
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PUBLIC_SERCOMM_UV_H_
+#define PUBLIC_SERCOMM_UV_H_
+
+#include <uv.h>
+
+#include "common.h"
+#include "types.h"
+#include "comms.h"
+
+#ifdef _WIN32
+#error "sercomm/uv.h is only available on POSIX systems"
+#endif
+
+SER_BEGIN_DECL
+
+/**
+ * @file sercomm/uv.h
+ * @brief libuv adapter.
+ * @defgroup SER_UV libuv adapter
+ * @ingroup SER
+ *
+ * Header-only helpers to drive serial ports from a libuv event loop, without
+ * any extra thread. The port is watched with a uv_poll_t handle, and serviced
+ * with the non-blocking calls from the poll callback:
+ *
+ * @code
+ * static void on_poll(uv_poll_t *handle, int status, int events)
+ * {
+ *     ser_t *ser = handle->data;
+ *     uint8_t buf[256];
+ *     size_t recvd;
+ *
+ *     if ((status == 0) && (events & UV_READABLE))
+ *     {
+ *         while (ser_try_read(ser, buf, sizeof(buf), &recvd) == 0)
+ *         {
+ *             process(buf, recvd);
+ *         }
+ *     }
+ * }
+ *
+ * ser_uv_poll_init(loop, &handle, ser);
+ * handle.data = ser;
+ * uv_poll_start(&handle, UV_READABLE, on_poll);
+ * @endcode
+ *
+ * @note
+ *      The poll handle must be closed (uv_close()) before the port is closed.
+ * @{
+ */
+
+/**
+ * Initialize a libuv poll handle watching a serial port.
+ *
+ * @param [in] loop
+ *      libuv loop.
+ * @param [out] handle
+ *      Poll handle.
+ * @param [in] ser
+ *      Opened library instance.
+ *
+ * @return
+ *      0 on success, libuv error code otherwise (UV_ENOTSUP if the port
+ *      native handle is not available, see ser_get_fd()).
+ */
+static inline int ser_uv_poll_init(uv_loop_t *loop, uv_poll_t *handle,
+                                   ser_t *ser)
+{
+    ser_fd_t fd;
+
+    if (ser_get_fd(ser, &fd) < 0)
+    {
+        return UV_ENOTSUP;
+    }
+
+    return uv_poll_init(loop, handle, fd);
+}
+
+/** @} */
+
+SER_END_DECL
+
+#endif
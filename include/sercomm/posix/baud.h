@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_BAUD_H_
+#define SERCOMM_POSIX_BAUD_H_
+
+#include <stdint.h>
+
+/*
+ * Linux termios2 interface (BOTHER): kept in its own translation unit, since
+ * the kernel termios definitions conflict with the C library ones.
+ */
+
+/**
+ * Set an arbitrary baudrate (input and output).
+ *
+ * @note
+ *      Must be called after the port attributes are applied (tcsetattr()
+ *      would replace the rate).
+ *
+ * @param [in] fd
+ *      Serial port file descriptor.
+ * @param [in] baudrate
+ *      Baudrate.
+ * @param [out] actual
+ *      Baudrate actually set by the driver.
+ *
+ * @return
+ *      0 on success, SER_ENOTSUP if the driver does not support arbitrary
+ *      baudrates, error code otherwise.
+ */
+int32_t baud_set(int fd, uint32_t baudrate, uint32_t *actual);
+
+/**
+ * Obtain the baudrate set by the driver (output).
+ *
+ * @param [in] fd
+ *      Serial port file descriptor.
+ * @param [out] actual
+ *      Baudrate.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t baud_get(int fd, uint32_t *actual);
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_LOWLAT_H_
+#define SERCOMM_POSIX_LOWLAT_H_
+
+#include "public/sercomm/comms.h"
+
+/**
+ * Apply the low-latency profile (if enabled).
+ *
+ * @note
+ *      Knobs are applied on a best-effort basis: those not supported by the
+ *      port (or not permitted) are skipped, see ser_low_latency().
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      Port options.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t lowlat_apply(ser_t *ser, const ser_opts_t *opts);
+
+/**
+ * Obtain the knobs applied by the low-latency profile.
+ *
+ * @param [in] ser
+ *      Library instance with the low-latency profile applied.
+ *
+ * @return
+ *      Applied knobs (SER_LOWLAT_* flags).
+ */
+uint32_t lowlat_applied(ser_t *ser);
+
+/**
+ * Restore the knobs changed by the low-latency profile.
+ *
+ * @param [in] ser
+ *      Library instance with the low-latency profile applied.
+ */
+void lowlat_restore(ser_t *ser);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_NOTIFY_H_
+#define SERCOMM_POSIX_NOTIFY_H_
+
+/** Wake-up notifier (eventfd on Linux, pipe elsewhere). */
+typedef struct
+{
+    /** Read end (pollable) */
+    int rd;
+    /** Write end */
+    int wr;
+} notifier_t;
+
+/**
+ * Open a notifier.
+ *
+ * @param [out] n
+ *      Notifier.
+ *
+ * @return
+ *      0 on success, -1 on failure (errno is set).
+ */
+int notifier_open(notifier_t *n);
+
+/**
+ * Close a notifier.
+ *
+ * @param [in] n
+ *      Notifier.
+ */
+void notifier_close(notifier_t *n);
+
+/**
+ * Signal a notifier (its read end becomes readable).
+ *
+ * @param [in] n
+ *      Notifier.
+ */
+void notifier_signal(notifier_t *n);
+
+/**
+ * Clear a notifier.
+ *
+ * @param [in] n
+ *      Notifier.
+ */
+void notifier_clear(notifier_t *n);
+
+#endif
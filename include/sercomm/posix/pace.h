@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_PACE_H_
+#define SERCOMM_POSIX_PACE_H_
+
+#include <stdint.h>
+
+#include "public/sercomm/comms.h"
+
+/**
+ * Set up transmit pacing.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      Port options.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t pace_start(ser_t *ser, const ser_opts_t *opts);
+
+/**
+ * Tear down transmit pacing.
+ *
+ * @param [in] ser
+ *      Library instance with transmit pacing.
+ */
+void pace_stop(ser_t *ser);
+
+/**
+ * Obtain the number of bytes that can be written now.
+ *
+ * @note
+ *      Bytes are released in chunks: nothing is allowed until a full burst
+ *      (or the whole write, if smaller) can go. Refusals are not accounted
+ *      as delays, callers waiting for the pacing do so (see pace_delayed()).
+ *
+ * @param [in] ser
+ *      Library instance with transmit pacing.
+ * @param [in] sz
+ *      Number of bytes to be written.
+ * @param [out] wait
+ *      Time until the bytes can be written (ns, set if 0 is returned).
+ *
+ * @return
+ *      Number of bytes allowed (0 if the caller has to wait).
+ */
+size_t pace_allow(ser_t *ser, size_t sz, int64_t *wait);
+
+/**
+ * Account written bytes.
+ *
+ * @param [in] ser
+ *      Library instance with transmit pacing.
+ * @param [in] sz
+ *      Number of written bytes (no more than allowed).
+ */
+void pace_consume(ser_t *ser, size_t sz);
+
+/**
+ * Account a wait for the pacing.
+ *
+ * @note
+ *      Waits until the next write (see pace_consume()) are accounted as a
+ *      single delay.
+ *
+ * @param [in] ser
+ *      Library instance with transmit pacing.
+ * @param [in] ns
+ *      Time waited (ns).
+ */
+void pace_delayed(ser_t *ser, int64_t ns);
+
+/**
+ * Obtain transmit pacing statistics.
+ *
+ * @param [in] ser
+ *      Library instance with transmit pacing.
+ * @param [out] stats
+ *      Where statistics will be stored.
+ */
+void pace_stats(ser_t *ser, ser_pace_stats_t *stats);
+
+#endif
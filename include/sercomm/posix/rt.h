@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_RT_H_
+#define SERCOMM_POSIX_RT_H_
+
+#include <pthread.h>
+
+#include "public/sercomm/common.h"
+#include "public/sercomm/types.h"
+
+/**
+ * Create a thread with the given real-time configuration.
+ *
+ * @param [out] td
+ *      Thread.
+ * @param [in] rt
+ *      Real-time configuration (NULL for default scheduling).
+ * @param [in] start
+ *      Thread function.
+ * @param [in] arg
+ *      Thread function argument.
+ *
+ * @return
+ *      0 on success, error number otherwise (e.g. EPERM if real-time
+ *      scheduling is not permitted).
+ */
+int rt_thread_create(pthread_t *td, const ser_rt_t *rt,
+                     void *(*start)(void *), void *arg);
+
+/**
+ * Initialize a mutex (priority inheritance if real-time threads are used).
+ *
+ * @param [out] mtx
+ *      Mutex.
+ * @param [in] rt
+ *      Real-time configuration (NULL for a default mutex).
+ *
+ * @return
+ *      0 on success, error number otherwise.
+ */
+int rt_mutex_init(pthread_mutex_t *mtx, const ser_rt_t *rt);
+
+/**
+ * Allocate a buffer (zeroed), prefaulted and locked in memory if required.
+ *
+ * @param [out] mem
+ *      Buffer.
+ * @param [in] sz
+ *      Buffer size.
+ * @param [in] align
+ *      Buffer alignment (power of two, multiple of sizeof(void *)).
+ * @param [in] rt
+ *      Real-time configuration (NULL for an ordinary buffer).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t rt_mem_alloc(void **mem, size_t sz, size_t align, const ser_rt_t *rt);
+
+/**
+ * Free a buffer allocated with rt_mem_alloc().
+ *
+ * @param [in] mem
+ *      Buffer (may be NULL).
+ * @param [in] sz
+ *      Buffer size.
+ * @param [in] rt
+ *      Real-time configuration the buffer was allocated with.
+ */
+void rt_mem_free(void *mem, size_t sz, const ser_rt_t *rt);
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_RX_H_
+#define SERCOMM_POSIX_RX_H_
+
+#include <stdbool.h>
+#include <poll.h>
+
+#include "public/sercomm/comms.h"
+
+/**
+ * Start background reception.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      Port options.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t rx_start(ser_t *ser, const ser_opts_t *opts);
+
+/**
+ * Stop background reception.
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ */
+void rx_stop(ser_t *ser);
+
+/**
+ * Read from the receive ring (never blocks).
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ * @param [out] buf
+ *      Output buffer.
+ * @param [in] sz
+ *      Maximum number of bytes to read.
+ * @param [out] recvd
+ *      Number of read bytes.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_EEMPTY if ring is empty).
+ */
+int32_t rx_read(ser_t *ser, void *buf, size_t sz, size_t *recvd);
+
+/**
+ * Obtain number of bytes available in the receive ring.
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ *
+ * @return
+ *      Number of available bytes.
+ */
+size_t rx_available(ser_t *ser);
+
+/**
+ * Wait until the receive ring has bytes (or reception failed).
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t rx_wait(ser_t *ser, const ser_deadline_t *deadline);
+
+/**
+ * Arm a wait on the receive ring, so that it can be combined with other
+ * descriptors in a single poll.
+ *
+ * @note
+ *      Unless bytes are already pending, the reception thread signals the
+ *      returned descriptor once bytes arrive. rx_wait_disarm() must be called
+ *      after the poll in both cases.
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ * @param [out] pfd
+ *      Descriptor to poll (negative if bytes are already pending).
+ *
+ * @return
+ *      true if bytes are pending (or reception failed), false otherwise.
+ */
+bool rx_wait_arm(ser_t *ser, struct pollfd *pfd);
+
+/**
+ * Disarm a wait on the receive ring.
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ * @param [in] pfd
+ *      Descriptor filled by rx_wait_arm() (revents filled by the poll).
+ */
+void rx_wait_disarm(ser_t *ser, const struct pollfd *pfd);
+
+/**
+ * Discard all bytes in the receive ring.
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ */
+void rx_flush(ser_t *ser);
+
+/**
+ * Obtain background reception statistics.
+ *
+ * @param [in] ser
+ *      Library instance with background reception.
+ * @param [out] stats
+ *      Statistics.
+ */
+void rx_stats(ser_t *ser, ser_rx_stats_t *stats);
+
+#endif
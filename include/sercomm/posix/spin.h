@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_SPIN_H_
+#define SERCOMM_POSIX_SPIN_H_
+
+#include <stdbool.h>
+
+#include "public/sercomm/comms.h"
+
+/* spin loop hint (lets the sibling hyper-thread run, saves power) */
+#if defined(__x86_64__) || defined(__i386__)
+# define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+# define cpu_relax() __asm__ __volatile__("yield")
+#else
+# define cpu_relax()
+#endif
+
+/**
+ * Set up the read wait strategy.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      Port options.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t spin_start(ser_t *ser, const ser_opts_t *opts);
+
+/**
+ * Tear down the read wait strategy.
+ *
+ * @param [in] ser
+ *      Library instance with a spinning wait strategy.
+ */
+void spin_stop(ser_t *ser);
+
+/**
+ * Busy-poll the input queue until bytes arrive, the spin budget is exhausted
+ * or the deadline expires.
+ *
+ * @param [in] ser
+ *      Library instance with a spinning wait strategy.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      true if bytes arrived, false if the caller has to block.
+ */
+bool spin_poll(ser_t *ser, const ser_deadline_t *deadline);
+
+/**
+ * Account a blocking wait that followed an unsuccessful spin.
+ *
+ * @param [in] ser
+ *      Library instance with a spinning wait strategy.
+ * @param [in] ready
+ *      Bytes arrived (the wait did not time out or fail).
+ */
+void spin_blocked(ser_t *ser, bool ready);
+
+/**
+ * Obtain read wait statistics.
+ *
+ * @param [in] ser
+ *      Library instance with a spinning wait strategy.
+ * @param [out] stats
+ *      Where statistics will be stored.
+ */
+void spin_stats(ser_t *ser, ser_wait_stats_t *stats);
+
+/**
+ * Wait until an absolute time: sleep until shortly before, then busy-wait.
+ *
+ * @note
+ *      The sleep margin is calibrated on the wake-up latencies measured in
+ *      previous timed waits of the port (it does not require a spinning wait
+ *      strategy).
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] t
+ *      Time (ns, monotonic clock).
+ *
+ * @return
+ *      Time at which the wait completed (ns).
+ */
+int64_t spin_until(ser_t *ser, int64_t t);
+
+#endif
@@ -25,8 +25,11 @@
 #ifndef SERCOMM_POSIX_TIME_H_
 #define SERCOMM_POSIX_TIME_H_
 
+#include <stdbool.h>
 #include <time.h>
 
+#include "public/sercomm/comms.h"
+
 #if defined(__MACH__) && defined(__APPLE__)
 #include <AvailabilityMacros.h>
 #endif
@@ -70,4 +73,51 @@ int clock_gettime(clockid_t clk_id, struct timespec *ts);
  */
 struct timespec clock__diff(const struct timespec *a, const struct timespec *b);
 
+/**
+ * Obtain current monotonic time.
+ *
+ * @return
+ *      Time (ns).
+ */
+int64_t clock__now_ns(void);
+
+/**
+ * Convert a deadline to a monotonic time.
+ *
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      Time (ns), INT64_MAX if the deadline never expires.
+ */
+int64_t clock__deadline_ns(const ser_deadline_t *deadline);
+
+/**
+ * Compute remaining time until a deadline.
+ *
+ * @param [in] deadline
+ *      Deadline.
+ * @param [out] remaining
+ *      Remaining time (zero if the deadline already expired).
+ *
+ * @return
+ *      false if the deadline never expires (remaining is not set), true
+ *      otherwise.
+ */
+bool clock__remaining(const ser_deadline_t *deadline,
+                      struct timespec *remaining);
+
+/**
+ * Sleep until an absolute time.
+ *
+ * @note
+ *      clock_nanosleep() is used where available, so that the wake-up time
+ *      does not depend on when the sleep started. Interrupted sleeps are
+ *      restarted.
+ *
+ * @param [in] t
+ *      Time (ns, monotonic clock).
+ */
+void clock__sleep_until(int64_t t);
+
 #endif
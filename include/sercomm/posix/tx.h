@@ -0,0 +1,136 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_TX_H_
+#define SERCOMM_POSIX_TX_H_
+
+#include "public/sercomm/comms.h"
+
+/**
+ * Start asynchronous transmission.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      Port options.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t tx_start(ser_t *ser, const ser_opts_t *opts);
+
+/**
+ * Stop asynchronous transmission.
+ *
+ * @note
+ *      Queued frames are given until the deadline to be written, pending ones
+ *      are completed with an error afterwards.
+ *
+ * @param [in] ser
+ *      Library instance with asynchronous transmission.
+ * @param [in] deadline
+ *      Deadline to write queued frames.
+ */
+void tx_stop(ser_t *ser, const ser_deadline_t *deadline);
+
+/**
+ * Queue a frame for transmission.
+ *
+ * @param [in] ser
+ *      Library instance with asynchronous transmission.
+ * @param [in] iov
+ *      Frame buffers.
+ * @param [in] iovcnt
+ *      Number of frame buffers.
+ * @param [in] prio
+ *      Priority class.
+ * @param [in] expires
+ *      Expiry time (NULL if never).
+ * @param [in] on_done
+ *      Completion callback (optional).
+ * @param [in] ctx
+ *      Completion callback context (optional).
+ * @param [in] deadline
+ *      Deadline to wait for room (NULL to fail immediately with SER_EBUSY).
+ * @param [out] seq
+ *      Frame sequence number (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t tx_enqueue(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                   uint8_t prio, const ser_deadline_t *expires,
+                   ser_tx_on_done_t on_done, void *ctx,
+                   const ser_deadline_t *deadline, uint64_t *seq);
+
+/**
+ * Wait until a frame has been written.
+ *
+ * @param [in] ser
+ *      Library instance with asynchronous transmission.
+ * @param [in] seq
+ *      Frame sequence number.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t tx_wait(ser_t *ser, uint64_t seq, const ser_deadline_t *deadline);
+
+/**
+ * Wait until all queued frames have been written (or dropped).
+ *
+ * @param [in] ser
+ *      Library instance with asynchronous transmission.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t tx_drain(ser_t *ser, const ser_deadline_t *deadline);
+
+/**
+ * Obtain the number of bytes queued and not written yet.
+ *
+ * @param [in] ser
+ *      Library instance with asynchronous transmission.
+ *
+ * @return
+ *      Number of queued bytes.
+ */
+size_t tx_queued(ser_t *ser);
+
+/**
+ * Obtain asynchronous transmission statistics.
+ *
+ * @param [in] ser
+ *      Library instance with asynchronous transmission.
+ * @param [out] stats
+ *      Statistics.
+ */
+void tx_stats(ser_t *ser, ser_tx_stats_t *stats);
+
+#endif
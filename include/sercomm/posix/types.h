@@ -25,15 +25,42 @@
 #ifndef SERCOMM_POSIX_TYPES_H_
 #define SERCOMM_POSIX_TYPES_H_
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <termios.h>
 
+#include "public/sercomm/comms.h"
+
+/** Event loop entry. */
+struct ser_loop_ent;
+
+/** Background reception context. */
+struct ser_rx;
+
+/** Asynchronous transmission context. */
+struct ser_tx;
+
+/** Low-latency profile context. */
+struct ser_lowlat;
+
+/** Spinning wait strategy context. */
+struct ser_spin;
+
+/** Transmit pacing context. */
+struct ser_pace;
+
 /** Library instance (POSIX). */
 struct ser
 {
     /** Previous serial port settings (restored on close) */
     struct termios tios_old;
-    /** Serial port file descriptor */
+    /** Applied serial port settings */
+    struct termios tios;
+    /** Serial port file descriptor (non-blocking) */
     int fd;
+    /** Read file descriptor (blocking mode: a second, blocking descriptor of
+     * the port, fd otherwise) */
+    int rd_fd;
     /** Timeouts */
     struct
     {
@@ -42,6 +69,44 @@ struct ser
         /** Write */
         int wr;
     } timeouts;
+    /** Kernel-side blocking reads (VMIN/VTIME) */
+    bool blocking;
+    /** Bytes written since the last ser_read_available() (a response is
+     * unlikely to be pending yet) */
+    bool wrote;
+    /** Event loop entry (if registered) */
+    struct ser_loop_ent *loop_ent;
+    /** Background reception (NULL if disabled) */
+    struct ser_rx *rx;
+    /** Asynchronous transmission (NULL if disabled) */
+    struct ser_tx *tx;
+    /** Low-latency profile (NULL if disabled) */
+    struct ser_lowlat *lowlat;
+    /** Spinning wait strategy (NULL if waits always block) */
+    struct ser_spin *spin;
+    /** Transmit pacing (NULL if disabled) */
+    struct ser_pace *pace;
+    /** Line settings (besides baudrate) */
+    struct
+    {
+        /** Byte size */
+        ser_bytesz_t bytesz;
+        /** Parity */
+        ser_parity_t parity;
+        /** Stop bits */
+        ser_stopbits_t stopbits;
+    } line;
+    /** Baudrate (as set by the driver, if reported) */
+    uint32_t baudrate;
+    /** Custom baudrate applied (set apart from the attributes, which hold a
+     * placeholder speed) */
+    bool baud_custom;
+    /** Custom baudrate applied through the legacy divisor (Linux) */
+    bool baud_divisor;
+    /** Time to transmit a character (ns, 0 if unknown) */
+    int64_t char_ns;
+    /** Timed writes: sleep margin before busy-waiting (ns, 0 if unknown) */
+    int64_t wake_margin_ns;
 };
 
 #endif
@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_POSIX_WAIT_H_
+#define SERCOMM_POSIX_WAIT_H_
+
+#include <poll.h>
+
+#include "public/sercomm/comms.h"
+
+/**
+ * Wait until any of the given file descriptors is ready, or a deadline
+ * expires.
+ *
+ * @note
+ *      On Linux, ppoll() is used: there is no FD_SETSIZE limit and the wait is
+ *      nanosecond accurate. Elsewhere poll() does not support tty devices (e.g.
+ *      macOS), so it is emulated using select(), refusing descriptors beyond
+ *      FD_SETSIZE. Interrupted waits are restarted with the time left until the
+ *      (absolute) deadline. Negative descriptors are ignored.
+ *
+ * @param [in, out] pfds
+ *      Descriptors and events of interest (revents are filled).
+ * @param [in] nfds
+ *      Number of descriptors.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      Number of ready descriptors, 0 if the deadline expired, -1 on failure
+ *      (errno is set).
+ */
+int pwait_poll(struct pollfd *pfds, nfds_t nfds,
+               const ser_deadline_t *deadline);
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SERCOMM_TRANSACT_H_
+#define SERCOMM_TRANSACT_H_
+
+#include "public/sercomm/transact.h"
+
+/**
+ * Obtain the number of bytes to request for a response.
+ *
+ * @param [in] opts
+ *      Transaction options.
+ * @param [in] rsp_cap
+ *      Response buffer size.
+ * @param [out] want
+ *      Number of bytes (fixed response size, or whole buffer if framed).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+int32_t transact_want(const ser_transact_opts_t *opts, size_t rsp_cap,
+                      size_t *want);
+
+/**
+ * Check whether a response is complete.
+ *
+ * @param [in] opts
+ *      Transaction options.
+ * @param [in] rsp
+ *      Bytes received so far.
+ * @param [in, out] recvd
+ *      Number of bytes received so far (set to the response size if
+ *      complete).
+ * @param [in] want
+ *      Number of bytes requested (see transact_want()).
+ *
+ * @return
+ *      1 if complete, 0 if more bytes are needed, error code otherwise.
+ */
+int32_t transact_check(const ser_transact_opts_t *opts, const uint8_t *rsp,
+                       size_t *recvd, size_t want);
+
+/**
+ * Compare two deadlines.
+ *
+ * @param [in] a
+ *      Deadline.
+ * @param [in] b
+ *      Deadline.
+ *
+ * @return
+ *      Negative if a expires before b, 0 if equal, positive otherwise.
+ */
+int deadline_cmp(const ser_deadline_t *a, const ser_deadline_t *b);
+
+#endif
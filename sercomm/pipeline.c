@@ -0,0 +1,566 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/transact.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sercomm/err.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Request slot states. */
+typedef enum
+{
+    /** Free */
+    SLOT_FREE = 0,
+    /** Request written, waiting for the response */
+    SLOT_INFLIGHT,
+    /** Completed, waiting to be collected (no callback) */
+    SLOT_DONE
+} slot_state_t;
+
+/** Request slot. */
+typedef struct
+{
+    /** State */
+    slot_state_t state;
+    /** Request identifier */
+    uint32_t id;
+    /** Response deadline */
+    ser_deadline_t timeout;
+    /** Completion callback (NULL if collected with ser_pipeline_wait()) */
+    ser_pipeline_on_done_t on_done;
+    /** Completion callback context */
+    void *ctx;
+    /** Result (once completed) */
+    int32_t r;
+    /** Response storage (once completed, no callback) */
+    uint8_t *rsp;
+    /** Response size */
+    size_t rsp_sz;
+} slot_t;
+
+/** Transaction pipeline. */
+struct ser_pipeline
+{
+    /** Library instance */
+    ser_t *ser;
+    /** Response matcher */
+    ser_pipeline_match_t match;
+    /** Response matcher context */
+    void *match_ctx;
+    /** Request slots */
+    slot_t *slots;
+    /** Number of slots (window) */
+    size_t window;
+    /** Slots in use */
+    size_t used;
+    /** Maximum response size */
+    size_t rsp_max;
+    /** Response storage (one per slot) */
+    uint8_t *rsps;
+    /** Receive buffer */
+    uint8_t *rbuf;
+    /** Receive buffer size */
+    size_t rbuf_sz;
+    /** Receive buffer bytes pending to be parsed */
+    size_t rbuf_len;
+    /** Requests completed since last reset (see pipeline_poll) */
+    size_t completions;
+    /** Responses are being dispatched (callbacks running) */
+    bool dispatching;
+    /** Statistics */
+    ser_pipeline_stats_t stats;
+};
+
+/**
+ * Find the slot of a request.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [in] id
+ *      Request identifier.
+ *
+ * @return
+ *      Slot, NULL if not found.
+ */
+static slot_t *slot_find(ser_pipeline_t *pl, uint32_t id)
+{
+    size_t i;
+
+    for (i = 0U; i < pl->window; i++)
+    {
+        if ((pl->slots[i].state != SLOT_FREE) && (pl->slots[i].id == id))
+        {
+            return &pl->slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Complete a request.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [in] slot
+ *      Request slot.
+ * @param [in] r
+ *      Result.
+ * @param [in] rsp
+ *      Response (NULL on failure).
+ * @param [in] rsp_sz
+ *      Response size.
+ */
+static void slot_complete(ser_pipeline_t *pl, slot_t *slot, int32_t r,
+                          const uint8_t *rsp, size_t rsp_sz)
+{
+    pl->completions++;
+
+    /* future: keep the response until collected */
+    if (slot->on_done == NULL)
+    {
+        slot->state = SLOT_DONE;
+        slot->r = r;
+        slot->rsp_sz = rsp_sz;
+        if (rsp != NULL)
+        {
+            memcpy(slot->rsp, rsp, rsp_sz);
+        }
+
+        return;
+    }
+
+    /* free the slot first, so that the callback can submit a request */
+    slot->state = SLOT_FREE;
+    pl->used--;
+
+    slot->on_done(slot->ctx, slot->id, r, rsp, rsp_sz);
+}
+
+/**
+ * Complete the requests whose response deadline expired.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ */
+static void pipeline_expire(ser_pipeline_t *pl)
+{
+    ser_deadline_t now;
+    size_t i;
+
+    now = ser_deadline_in_ns(0);
+
+    for (i = 0U; i < pl->window; i++)
+    {
+        slot_t *slot = &pl->slots[i];
+
+        if ((slot->state == SLOT_INFLIGHT) &&
+            (deadline_cmp(&slot->timeout, &now) <= 0))
+        {
+            pl->stats.timeouts++;
+            sererr_set("Operation timed out");
+            slot_complete(pl, slot, SER_ETIMEDOUT, NULL, 0U);
+        }
+    }
+}
+
+/**
+ * Obtain the earliest response deadline of the requests in flight.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ *
+ * @return
+ *      Earliest deadline, NULL if no requests are in flight.
+ */
+static const ser_deadline_t *pipeline_next_timeout(ser_pipeline_t *pl)
+{
+    const ser_deadline_t *next = NULL;
+    size_t i;
+
+    for (i = 0U; i < pl->window; i++)
+    {
+        slot_t *slot = &pl->slots[i];
+
+        if ((slot->state == SLOT_INFLIGHT) &&
+            ((next == NULL) || (deadline_cmp(&slot->timeout, next) < 0)))
+        {
+            next = &slot->timeout;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * Match the received bytes against the requests in flight.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ */
+static void pipeline_parse(ser_pipeline_t *pl)
+{
+    size_t off = 0U;
+
+    pl->dispatching = true;
+
+    while (off < pl->rbuf_len)
+    {
+        const uint8_t *buf = &pl->rbuf[off];
+        size_t len = pl->rbuf_len - off;
+        int32_t rsp_sz;
+        uint32_t id = 0U;
+        slot_t *slot;
+
+        rsp_sz = pl->match(pl->match_ctx, buf, len, &id);
+
+        /* incomplete: wait for more bytes (unless it can never fit) */
+        if (rsp_sz == 0)
+        {
+            if (len < pl->rsp_max)
+            {
+                break;
+            }
+
+            rsp_sz = -1;
+        }
+
+        /* invalid: skip a byte to resynchronize */
+        if ((rsp_sz < 0) || ((size_t)rsp_sz > len) ||
+            ((size_t)rsp_sz > pl->rsp_max))
+        {
+            pl->stats.discarded++;
+            off++;
+            continue;
+        }
+
+        slot = slot_find(pl, id);
+        if ((slot != NULL) && (slot->state == SLOT_INFLIGHT))
+        {
+            pl->stats.completed++;
+            slot_complete(pl, slot, 0, buf, (size_t)rsp_sz);
+        }
+        else
+        {
+            pl->stats.unmatched++;
+        }
+
+        off += (size_t)rsp_sz;
+    }
+
+    pl->rbuf_len -= off;
+    memmove(pl->rbuf, &pl->rbuf[off], pl->rbuf_len);
+
+    pl->dispatching = false;
+}
+
+/**
+ * Drive the pipeline once: expire requests, then read and match responses
+ * (waiting for them if none are pending).
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [in] deadline
+ *      Deadline for the wait.
+ *
+ * @return
+ *      0 on success, error code otherwise (SER_ETIMEDOUT if the deadline
+ *      expired).
+ */
+static int32_t pipeline_drive(ser_pipeline_t *pl, const ser_deadline_t *deadline)
+{
+    int32_t r;
+    size_t recvd = 0U;
+    const ser_deadline_t *next;
+
+    pipeline_expire(pl);
+
+    /* responses are usually pending when many requests are in flight */
+    r = ser_try_read(pl->ser, &pl->rbuf[pl->rbuf_len],
+                     pl->rbuf_sz - pl->rbuf_len, &recvd);
+    if ((r == 0) && (recvd > 0U))
+    {
+        pl->rbuf_len += recvd;
+        pipeline_parse(pl);
+
+        return 0;
+    }
+    else if ((r < 0) && (r != SER_EEMPTY))
+    {
+        return r;
+    }
+
+    /* nothing pending: wait for bytes, or until a request times out */
+    next = pipeline_next_timeout(pl);
+    if ((next != NULL) && (deadline_cmp(next, deadline) < 0))
+    {
+        r = ser_read_wait_until(pl->ser, next);
+
+        /* expired requests are completed on the next round */
+        return (r == SER_ETIMEDOUT) ? 0 : r;
+    }
+
+    return ser_read_wait_until(pl->ser, deadline);
+}
+
+/**
+ * Drive the pipeline until at least one request completes.
+ *
+ * @param [in] pl
+ *      Pipeline.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t pipeline_poll(ser_pipeline_t *pl, const ser_deadline_t *deadline)
+{
+    int32_t r = 0;
+
+    if (pl->dispatching)
+    {
+        sererr_set("Pipeline cannot be driven from a completion callback");
+        return SER_EBUSY;
+    }
+
+    pl->completions = 0U;
+
+    while (pl->completions == 0U)
+    {
+        ser_deadline_t now;
+
+        if (pipeline_next_timeout(pl) == NULL)
+        {
+            sererr_set("No requests in flight");
+            return SER_EEMPTY;
+        }
+
+        r = pipeline_drive(pl, deadline);
+        if (r < 0)
+        {
+            break;
+        }
+
+        /* bytes may keep arriving without completing any request */
+        now = ser_deadline_in_ns(0);
+        if ((pl->completions == 0U) && (deadline_cmp(deadline, &now) <= 0))
+        {
+            sererr_set("Operation timed out");
+            r = SER_ETIMEDOUT;
+            break;
+        }
+    }
+
+    return r;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+ser_pipeline_t *ser_pipeline_create(ser_t *ser, const ser_pipeline_opts_t *opts)
+{
+    ser_pipeline_t *pl;
+    size_t i;
+
+    if ((opts->window == 0U) || (opts->rsp_max == 0U) ||
+        (opts->rsp_max > (size_t)INT32_MAX) || (opts->match == NULL))
+    {
+        sererr_set("Invalid pipeline options");
+        return NULL;
+    }
+
+    pl = calloc(1U, sizeof(*pl));
+    if (pl == NULL)
+    {
+        sererr_set("Could not allocate pipeline");
+        return NULL;
+    }
+
+    pl->ser = ser;
+    pl->match = opts->match;
+    pl->match_ctx = opts->match_ctx;
+    pl->window = opts->window;
+    pl->rsp_max = opts->rsp_max;
+
+    /* receive buffer: room for a few responses per read */
+    pl->rbuf_sz = pl->rsp_max * ((pl->window < 2U) ? 2U : pl->window);
+
+    pl->slots = calloc(pl->window, sizeof(*pl->slots));
+    pl->rsps = malloc(pl->window * pl->rsp_max);
+    pl->rbuf = malloc(pl->rbuf_sz);
+    if ((pl->slots == NULL) || (pl->rsps == NULL) || (pl->rbuf == NULL))
+    {
+        sererr_set("Could not allocate pipeline");
+        ser_pipeline_destroy(pl);
+        return NULL;
+    }
+
+    for (i = 0U; i < pl->window; i++)
+    {
+        pl->slots[i].rsp = &pl->rsps[i * pl->rsp_max];
+    }
+
+    return pl;
+}
+
+void ser_pipeline_destroy(ser_pipeline_t *pl)
+{
+    size_t i;
+
+    for (i = 0U; (pl->slots != NULL) && (i < pl->window); i++)
+    {
+        slot_t *slot = &pl->slots[i];
+
+        if ((slot->state == SLOT_INFLIGHT) && (slot->on_done != NULL))
+        {
+            sererr_set("Pipeline destroyed");
+            slot->on_done(slot->ctx, slot->id, SER_EFAIL, NULL, 0U);
+        }
+    }
+
+    free(pl->rbuf);
+    free(pl->rsps);
+    free(pl->slots);
+    free(pl);
+}
+
+int32_t ser_pipeline_submit(ser_pipeline_t *pl, uint32_t id, const void *req,
+                            size_t req_sz, const ser_deadline_t *timeout,
+                            ser_pipeline_on_done_t on_done, void *ctx,
+                            const ser_deadline_t *deadline)
+{
+    int32_t r;
+    slot_t *slot;
+    size_t i;
+
+    if (slot_find(pl, id) != NULL)
+    {
+        sererr_set("Request identifier already in flight");
+        return SER_EBUSY;
+    }
+
+    /* window full: process responses until a slot is released */
+    while (pl->used == pl->window)
+    {
+        r = pipeline_poll(pl, deadline);
+        if (r == SER_EEMPTY)
+        {
+            sererr_set("Pipeline window full of uncollected requests");
+            return SER_EBUSY;
+        }
+        else if (r < 0)
+        {
+            return r;
+        }
+    }
+
+    r = ser_write_until(pl->ser, req, req_sz, NULL, deadline);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    for (i = 0U; pl->slots[i].state != SLOT_FREE; i++)
+    {
+    }
+
+    slot = &pl->slots[i];
+    slot->state = SLOT_INFLIGHT;
+    slot->id = id;
+    slot->timeout = *timeout;
+    slot->on_done = on_done;
+    slot->ctx = ctx;
+
+    pl->used++;
+
+    return 0;
+}
+
+int32_t ser_pipeline_poll(ser_pipeline_t *pl, const ser_deadline_t *deadline)
+{
+    return pipeline_poll(pl, deadline);
+}
+
+int32_t ser_pipeline_wait(ser_pipeline_t *pl, uint32_t id, void *rsp,
+                          size_t rsp_cap, size_t *rsp_sz,
+                          const ser_deadline_t *deadline)
+{
+    int32_t r;
+    slot_t *slot;
+
+    slot = slot_find(pl, id);
+    if ((slot == NULL) || (slot->on_done != NULL))
+    {
+        sererr_set("Unknown request identifier");
+        return SER_EINVAL;
+    }
+
+    while (slot->state == SLOT_INFLIGHT)
+    {
+        r = pipeline_poll(pl, deadline);
+        if (r < 0)
+        {
+            return r;
+        }
+    }
+
+    r = slot->r;
+    if ((r == 0) && (slot->rsp_sz > rsp_cap))
+    {
+        sererr_set("Response does not fit in the buffer");
+        r = SER_EINVAL;
+    }
+    else if (r == 0)
+    {
+        memcpy(rsp, slot->rsp, slot->rsp_sz);
+        if (rsp_sz != NULL)
+        {
+            *rsp_sz = slot->rsp_sz;
+        }
+    }
+
+    slot->state = SLOT_FREE;
+    pl->used--;
+
+    return r;
+}
+
+size_t ser_pipeline_inflight(ser_pipeline_t *pl)
+{
+    return pl->used;
+}
+
+void ser_pipeline_stats(ser_pipeline_t *pl, ser_pipeline_stats_t *stats)
+{
+    *stats = pl->stats;
+}
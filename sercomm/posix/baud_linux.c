@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/posix/baud.h"
+#include "public/sercomm/err.h"
+
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t baud_set(int fd, uint32_t baudrate, uint32_t *actual)
+{
+    struct termios2 tios;
+
+    if (ioctl(fd, TCGETS2, &tios) < 0)
+    {
+        return perr_setc(errno);
+    }
+
+    tios.c_cflag &= ~(tcflag_t)(CBAUD | (CBAUD << IBSHIFT));
+    tios.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tios.c_ispeed = (speed_t)baudrate;
+    tios.c_ospeed = (speed_t)baudrate;
+
+    if (ioctl(fd, TCSETS2, &tios) < 0)
+    {
+        if ((errno == ENOTTY) || (errno == EINVAL))
+        {
+            sererr_set("Arbitrary baudrates unsupported");
+            return SER_ENOTSUP;
+        }
+
+        return perr_setc(errno);
+    }
+
+    /* drivers may round to the closest rate they can generate */
+    return baud_get(fd, actual);
+}
+
+int32_t baud_get(int fd, uint32_t *actual)
+{
+    struct termios2 tios;
+
+    if (ioctl(fd, TCGETS2, &tios) < 0)
+    {
+        return perr_setc(errno);
+    }
+
+    *actual = (uint32_t)tios.c_ospeed;
+
+    return 0;
+}
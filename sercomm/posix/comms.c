@@ -31,6 +31,7 @@
 #include <fcntl.h>
 #include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 
 #ifdef __linux__
 # include <linux/serial.h>
@@ -42,8 +43,16 @@
 #endif
 
 #include "sercomm/err.h"
+#include "sercomm/posix/baud.h"
+#include "sercomm/posix/err.h"
+#include "sercomm/posix/lowlat.h"
+#include "sercomm/posix/pace.h"
+#include "sercomm/posix/rx.h"
+#include "sercomm/posix/spin.h"
+#include "sercomm/posix/tx.h"
 #include "sercomm/posix/types.h"
 #include "sercomm/posix/time.h"
+#include "sercomm/posix/wait.h"
 
 /*******************************************************************************
  * Private
@@ -56,6 +65,34 @@
 # endif
 #endif
 
+/** Maximum number of I/O vectors passed on each readv/writev call. */
+#define IOV_BATCH   16
+
+/** Output drain: polling period if the character time is unknown (ns). */
+#define DRAIN_POLL_NS   1000000
+
+/** Automatic baudrate detection: pattern search window (bytes). */
+#define AUTOBAUD_WIN_SZ     256U
+
+/** Automatic baudrate detection: maximum expected pattern size. */
+#define AUTOBAUD_EXPECT_MAX 64U
+
+/** Automatic baudrate detection: weight of an error over a received byte. */
+#define AUTOBAUD_ERR_WEIGHT 8
+
+/** Automatic baudrate detection: idle line ending an answer (characters). */
+#define AUTOBAUD_IDLE_CHARS 4
+
+/** Automatic baudrate detection: minimum idle line ending an answer (ns). */
+#define AUTOBAUD_IDLE_MIN_NS 1000000
+
+/** Automatic baudrate detection: common baudrates, likeliest first. */
+static const uint32_t autobaud_rates[] = {
+    115200U, 9600U, 57600U, 19200U, 38400U, 230400U, 460800U, 921600U,
+    4800U, 2400U, 1000000U, 500000U, 250000U, 2000000U, 3000000U, 4000000U,
+    1500000U, 1200U, 600U, 300U
+};
+
 /** Operation type. */
 typedef enum
 {
@@ -65,80 +102,167 @@ typedef enum
     SER_OP_WR
 } ser_op_t;
 
+/** Automatic baudrate detection: received bytes at a baudrate. */
+typedef struct
+{
+    /** Pattern search window (decoded bytes not searched yet, after the
+     * last expected pattern size - 1 searched ones) */
+    uint8_t win[AUTOBAUD_WIN_SZ];
+    /** Number of bytes in the window */
+    size_t win_sz;
+    /** Number of error-free bytes */
+    size_t sz;
+    /** Number of errors (framing, parity, breaks) */
+    size_t errors;
+    /** Parity marking decoder state (bytes of a mark seen) */
+    int mark;
+    /** Expected pattern received */
+    bool matched;
+} autobaud_score_t;
+
+/** Deadline computed on first use (the clock is not read if I/O completes
+ * right away). */
+typedef struct
+{
+    /** Deadline (once computed) */
+    ser_deadline_t deadline;
+    /** Timeout the deadline is computed from (ms) */
+    int32_t timeout;
+    /** Deadline has been computed */
+    bool valid;
+} deadline_lazy_t;
+
+#ifdef __linux__
 /**
- * Convert errno codes to sercomm errors.
+ * Set a custom baudrate (Linux).
  *
- * @param [in] code
- *      Errno code.
+ * @note
+ *      The exact rate is requested through termios2 (BOTHER). Only if the
+ *      driver does not support it, the legacy custom divisor is used (the
+ *      port must be set to 38400, rounded to the closest divisor).
  *
- * @returns
- *      sercomm error code.
+ * @param [in] ser
+ *      Library instance (port attributes applied).
+ * @param [in] baudrate
+ *      Baudrate.
+ *
+ * @return
+ *      0 on success, error code otherwise.
  */
-static int32_t error_set(int code)
+static int32_t port_baud_custom(ser_t *ser, uint32_t baudrate)
 {
     int32_t r;
 
-    switch (code)
+    struct serial_struct lser;
+
+    /* arbitrary rate (termios2) */
+    r = baud_set(ser->fd, baudrate, &ser->baudrate);
+    if (r != SER_ENOTSUP)
     {
-        case 0:
-            r = 0;
-            break;
-        case ENOENT:
-            sererr_set("No such device");
-            r = SER_ENODEV;
-            break;
-        case EBUSY:
-            sererr_set("Device is busy");
-            r = SER_EBUSY;
-            break;
-        case EIO:
-        case ENXIO:
-            sererr_set("Device was disconnected");
-            r = SER_EDISCONN;
-            break;
-        case EAGAIN:
-            sererr_set("No bytes available");
-            r = SER_EEMPTY;
-            break;
-        default:
-            sererr_set("%s", strerror(errno));
-            r = SER_EFAIL;
-            break;
+        if (r == 0)
+        {
+            ser->baud_divisor = false;
+        }
+
+        return r;
     }
 
-    return r;
+    /* fallback: custom divisor */
+    if (ioctl(ser->fd, TIOCGSERIAL, &lser) < 0)
+    {
+        if ((errno == ENOTTY) || (errno == EINVAL))
+        {
+            sererr_set("Custom baudrates unsupported");
+            return SER_ENOTSUP;
+        }
+
+        return perr_setc(errno);
+    }
+
+    lser.custom_divisor = (lser.baud_base + ((int)baudrate / 2)) /
+                          (int)baudrate;
+    if (lser.custom_divisor == 0)
+    {
+        sererr_set("Baudrate too high for the port clock");
+        return SER_EINVAL;
+    }
+
+    lser.flags &= ~ASYNC_SPD_MASK;
+    lser.flags |= ASYNC_SPD_CUST;
+
+    if (ioctl(ser->fd, TIOCSSERIAL, &lser) < 0)
+    {
+        return perr_setc(errno);
+    }
+
+    ser->baudrate = (uint32_t)(lser.baud_base / lser.custom_divisor);
+    ser->baud_divisor = true;
+
+    return 0;
 }
 
 /**
- * Configure port.
+ * Stop aliasing 38400 to the legacy custom divisor (Linux).
  *
  * @param [in] ser
- *      Closed library instance.
+ *      Library instance (with the custom divisor applied).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_baud_divisor_clear(ser_t *ser)
+{
+    struct serial_struct lser;
+
+    if (ioctl(ser->fd, TIOCGSERIAL, &lser) < 0)
+    {
+        return perr_setc(errno);
+    }
+
+    lser.flags &= ~ASYNC_SPD_MASK;
+
+    if (ioctl(ser->fd, TIOCSSERIAL, &lser) < 0)
+    {
+        return perr_setc(errno);
+    }
+
+    ser->baud_divisor = false;
+
+    return 0;
+}
+#endif
+
+/**
+ * Set the line settings (baudrate, byte size, parity and stop bits) on the
+ * attributes to be applied.
+ *
+ * @note
+ *      The port is not modified (settings are only validated).
+ *
  * @param [in] opts
  *      Port options.
+ * @param [in, out] tios
+ *      Attributes.
+ * @param [out] custom
+ *      Set if the baudrate is custom (to be set once attributes are applied,
+ *      see port_line_applied()).
  *
  * @return
  *      0 on success, error code otherwise.
  */
-static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
+static int32_t port_line(const ser_opts_t *opts, struct termios *tios,
+                         bool *custom)
 {
     int32_t r = 0;
 
-    struct termios tios;
-    bool custom_baudrate = false;
     speed_t speed;
 
-    /* store current attributes */
-    if (tcgetattr(ser->fd, &ser->tios_old) < 0)
-    {
-        r = error_set(errno);
-        goto out;
-    }
-
-    /* configure: common */
-    memset(&tios, 0, sizeof(tios));
+    *custom = false;
 
-    tios.c_cflag = CREAD | CLOCAL;
+    tios->c_cflag &= ~(tcflag_t)(CSIZE | PARENB | PARODD | CSTOPB);
+#ifdef CMSPAR
+    tios->c_cflag &= ~(tcflag_t)CMSPAR;
+#endif
 
     /* configure: baudrate */
     switch (opts->baudrate)
@@ -329,45 +453,22 @@ static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
           break;
 #endif
       default:
-          custom_baudrate = true;
+          *custom = true;
     }
 
-    if (custom_baudrate == false)
+    if (*custom == false)
     {
-        (void)cfsetispeed(&tios, speed);
-        (void)cfsetospeed(&tios, speed);
+        (void)cfsetispeed(tios, speed);
+        (void)cfsetospeed(tios, speed);
     }
     else
     {
-#if defined(__MACH__) && defined(__APPLE__)
-        /* Mac OS X (>= 10.4) */
-        speed = (speed_t)opts->baudrate;
-
-        if (ioctl(ser->fd, IOSSIOSPEED, &speed, 1) < 0)
-        {
-            r = error_set(errno);
-            goto out;
-        }
-#elif defined(__linux__)
-        /* Linux */
-        struct serial_struct lser;
-
-        if (ioctl (ser->fd, TIOCGSERIAL, &lser) < 0)
-        {
-            r = error_set(errno);
-            goto out;
-        }
-
-        /* set custom divisor and update flags */
-        lser.custom_divisor = lser.baud_base / (int)opts->baudrate;
-        lser.flags &= ~ASYNC_SPD_MASK;
-        lser.flags |= ASYNC_SPD_CUST;
-
-        if (ioctl (ser->fd, TIOCSSERIAL, &lser) < 0)
-        {
-            r = error_set(errno);
-            goto out;
-        }
+#if (defined(__MACH__) && defined(__APPLE__)) || defined(__linux__)
+        /* set once attributes are applied (applying them overrides the
+         * speed), 38400 is a placeholder (also aliased by the Linux custom
+         * divisor fallback) */
+        (void)cfsetispeed(tios, B38400);
+        (void)cfsetospeed(tios, B38400);
 #else
         sererr_set("Custom baudrates unsupported");
         r = SER_ENOTSUP;
@@ -379,16 +480,16 @@ static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
     switch (opts->bytesz)
     {
         case SER_BYTESZ_8:
-            tios.c_cflag |= CS8;
+            tios->c_cflag |= CS8;
             break;
         case SER_BYTESZ_7:
-            tios.c_cflag |= CS7;
+            tios->c_cflag |= CS7;
             break;
         case SER_BYTESZ_6:
-            tios.c_cflag |= CS6;
+            tios->c_cflag |= CS6;
             break;
         case SER_BYTESZ_5:
-            tios.c_cflag |= CS5;
+            tios->c_cflag |= CS5;
             break;
         default:
             sererr_set("Invalid byte size");
@@ -402,17 +503,17 @@ static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
         case SER_PAR_NONE:
             break;
         case SER_PAR_ODD:
-            tios.c_cflag |= (PARENB | PARODD);
+            tios->c_cflag |= (PARENB | PARODD);
             break;
         case SER_PAR_EVEN:
-            tios.c_cflag |= (PARENB);
+            tios->c_cflag |= (PARENB);
             break;
 #ifdef CMSPAR
         case SER_PAR_MARK:
-            tios.c_cflag |= (PARENB | CMSPAR | PARODD);
+            tios->c_cflag |= (PARENB | CMSPAR | PARODD);
             break;
         case SER_PAR_SPACE:
-            tios.c_cflag |= (PARENB | CMSPAR);
+            tios->c_cflag |= (PARENB | CMSPAR);
             break;
 #else
         case SER_PAR_MARK:
@@ -437,7 +538,7 @@ static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
             r = SER_ENOTSUP;
             goto out;
         case SER_STOPB_TWO:
-            tios.c_cflag |= CSTOPB;
+            tios->c_cflag |= CSTOPB;
             break;
         default:
             sererr_set("Invalid number of stop bits");
@@ -445,19 +546,182 @@ static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
             goto out;
     }
 
-    /* configure: timeouts (store values for select) */
+out:
+    return r;
+}
+
+/**
+ * Complete the line settings once attributes are applied: custom baudrate,
+ * actual baudrate and character time.
+ *
+ * @param [in] ser
+ *      Library instance.
+ * @param [in] opts
+ *      Port options.
+ * @param [in] custom
+ *      Baudrate is custom (see port_line()).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_line_applied(ser_t *ser, const ser_opts_t *opts,
+                                 bool custom)
+{
+    /* baudrate: actual one (drivers may round it) */
+#if defined(__MACH__) && defined(__APPLE__)
+    if (custom)
+    {
+        speed_t speed = (speed_t)opts->baudrate;
+
+        /* Mac OS X (>= 10.4) */
+        if (ioctl(ser->fd, IOSSIOSPEED, &speed, 1) < 0)
+        {
+            return perr_setc(errno);
+        }
+    }
+
+    ser->baudrate = opts->baudrate;
+#elif defined(__linux__)
+    if (custom)
+    {
+        int32_t r;
+
+        r = port_baud_custom(ser, opts->baudrate);
+        if (r < 0)
+        {
+            return r;
+        }
+    }
+    else
+    {
+        /* leaving the custom divisor: 38400 must be 38400 again */
+        if (ser->baud_divisor)
+        {
+            int32_t r;
+
+            r = port_baud_divisor_clear(ser);
+            if (r < 0)
+            {
+                return r;
+            }
+        }
+
+        ser->baudrate = opts->baudrate;
+        (void)baud_get(ser->fd, &ser->baudrate);
+    }
+#else
+    ser->baudrate = opts->baudrate;
+#endif
+
+    ser->baud_custom = custom;
+
+    ser->line.bytesz = opts->bytesz;
+    ser->line.parity = opts->parity;
+    ser->line.stopbits = opts->stopbits;
+
+    /* character time (start, data, parity and stop bits) */
+    if (ser->baudrate != 0U)
+    {
+        int64_t bits;
+
+        bits = 1 + (8 - (int64_t)opts->bytesz) +
+               ((opts->parity != SER_PAR_NONE) ? 1 : 0) +
+               ((opts->stopbits == SER_STOPB_TWO) ? 2 : 1);
+
+        ser->char_ns = ((bits * 1000000000) + (int64_t)ser->baudrate - 1) /
+                       (int64_t)ser->baudrate;
+    }
+    else
+    {
+        ser->char_ns = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * Configure port.
+ *
+ * @param [in] ser
+ *      Closed library instance.
+ * @param [in] opts
+ *      Port options.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
+{
+    int32_t r = 0;
+
+    struct termios tios;
+    bool custom;
+
+    /* store current attributes */
+    if (tcgetattr(ser->fd, &ser->tios_old) < 0)
+    {
+        r = perr_setc(errno);
+        goto out;
+    }
+
+    ser->baud_custom = false;
+    ser->baud_divisor = false;
+
+    /* configure: common */
+    memset(&tios, 0, sizeof(tios));
+
+    tios.c_cflag = CREAD | CLOCAL;
+
+    /* configure: line */
+    r = port_line(opts, &tios, &custom);
+    if (r < 0)
+    {
+        goto out;
+    }
+
+    /* configure: timeouts (store values for waits) */
     ser->timeouts.rd = (int)opts->timeouts.rd;
-    ser->timeouts.wr = (int)opts->timeouts.rd;
+    ser->timeouts.wr = (int)opts->timeouts.wr;
+
+    /* configure: reads (completed by the kernel in blocking mode) */
+    if (opts->blocking.enabled != 0U)
+    {
+        if (opts->rx.ring_sz != 0U)
+        {
+            sererr_set("Blocking reads cannot be combined with background "
+                       "reception");
+            r = SER_EINVAL;
+            goto out;
+        }
+
+        tios.c_cc[VMIN] = opts->blocking.vmin;
+        tios.c_cc[VTIME] = opts->blocking.vtime;
+    }
+    else
+    {
+        tios.c_cc[VMIN] = 1;
+        tios.c_cc[VTIME] = 0;
+    }
 
-    tios.c_cc[VMIN] = 1;
-    tios.c_cc[VTIME] = 0;
+    ser->blocking = (opts->blocking.enabled != 0U);
+    ser->wrote = false;
 
     /* apply new attributes (after flushing) */
     if (tcsetattr(ser->fd, TCSAFLUSH, &tios) < 0)
     {
-        r = error_set(errno);
+        r = perr_setc(errno);
+        goto out;
+    }
+
+    /* configure: line (once applied) */
+    r = port_line_applied(ser, opts, custom);
+    if (r < 0)
+    {
+        goto out;
     }
 
+    ser->tios = tios;
+
 out:
     return r;
 }
@@ -480,69 +744,38 @@ void port_restore(ser_t *ser)
  *      Opened library instance.
  * @param [in] op
  *      Operation to wait for (read or write).
- * @param [in, out] timeout
- *      Maximum wait time (NOTE: will be updated with remaining time).
+ * @param [in] deadline
+ *      Deadline.
  *
  * @return
  *      0 on success, error code otherwise.
  */
-static int32_t port_wait_ready(ser_t *ser, ser_op_t op, int *timeout)
+static int32_t port_wait_ready(ser_t *ser, ser_op_t op,
+                               const ser_deadline_t *deadline)
 {
     int32_t r;
 
-    fd_set fds;
-    fd_set *rfds = NULL;
-    fd_set *wfds = NULL;
-
+    struct pollfd pfd;
     int s;
 
-    /* setup file descriptor set */
-    FD_ZERO(&fds);
-    FD_SET(ser->fd, &fds);
-
-    if (op == SER_OP_RD)
-    {
-        rfds = &fds;
-    }
-    else
+    /* spinning strategy: busy-poll for bytes before blocking */
+    if ((op == SER_OP_RD) && (ser->spin != NULL) && spin_poll(ser, deadline))
     {
-        wfds = &fds;
+        return 0;
     }
 
-    /* wait until read or write is available */
-    if (*timeout > 0)
-    {
-        struct timeval tv;
-        struct timespec start;
-        struct timespec end;
-        struct timespec diff;
-
-        tv.tv_sec = *timeout / 1000;
-        tv.tv_usec = (*timeout * 1000) % 1000000;
-
-        if (clock_gettime(CLOCK_MONOTONIC, &start) < 0)
-        {
-            r = error_set(errno);
-            goto out;
-        }
-
-        s = select(ser->fd + 1, rfds, wfds, NULL, &tv);
+    pfd.fd = ser->fd;
+    pfd.events = (op == SER_OP_RD) ? POLLIN : POLLOUT;
+    pfd.revents = 0;
 
-        if (clock_gettime(CLOCK_MONOTONIC, &end) < 0)
-        {
-            r = error_set(errno);
-            goto out;
-        }
+    /* wait until read or write is available (or deadline expires) */
+    s = pwait_poll(&pfd, 1U, deadline);
 
-        diff = clock__diff(&end, &start);
-        *timeout = (int32_t)((diff.tv_sec * 1000) + (diff.tv_nsec / 1000000));
-    }
-    else
+    if ((op == SER_OP_RD) && (ser->spin != NULL))
     {
-        s = select(ser->fd + 1, rfds, wfds, NULL, NULL);
+        spin_blocked(ser, s > 0);
     }
 
-    /* check select results */
     if (s > 0)
     {
         r = 0;
@@ -554,193 +787,1955 @@ static int32_t port_wait_ready(ser_t *ser, ser_op_t op, int *timeout)
     }
     else
     {
-        sererr_set("%s", strerror(errno));
-        r = SER_EFAIL;
+        r = perr_setc(errno);
     }
 
-out:
     return r;
 }
 
-/*******************************************************************************
- * Public
- ******************************************************************************/
-
-int32_t ser_open(ser_t *ser, const ser_opts_t *opts)
+/**
+ * Limit a read size to the bytes already queued on the port.
+ *
+ * @note
+ *      Used in blocking mode, so that the read completes immediately.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in, out] sz
+ *      Read size (limited on return).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_read_queued(ser_t *ser, size_t *sz)
 {
-    int32_t r = 0;
+    int cinq = 0;
 
-    /* open port */
-    ser->fd = open(opts->port, O_RDWR | O_NOCTTY | O_NONBLOCK);
-    if (ser->fd < 0)
+    if (ioctl(ser->fd, TIOCINQ, &cinq) < 0)
     {
-        r = error_set(errno);
-        goto out;
+        return perr_setc(errno);
     }
 
-    /* configure port */
-    r = port_configure(ser, opts);
-    if (r < 0)
+    if ((size_t)cinq < *sz)
     {
-        goto cleanup;
+        *sz = (size_t)cinq;
     }
 
-    goto out;
-
-cleanup:
-    close(ser->fd);
-
-out:
-    return r;
+    return 0;
 }
 
-void ser_close(ser_t *ser)
-{
-    /* restore port settings, then close */
-    port_restore(ser);
-    close(ser->fd);
+/**
+ * Wait until bytes are queued on the port (blocking mode).
+ *
+ * @note
+ *      Without VTIME, the port is only reported readable once VMIN bytes are
+ *      queued, so the wait is split in periods of the time the wanted bytes
+ *      take to be received, checking the queued ones after each.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] want
+ *      Number of wanted bytes.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_wait_queued(ser_t *ser, size_t want,
+                                const ser_deadline_t *deadline)
+{
+    int32_t r;
+
+    int64_t end;
+    int64_t period;
+
+    if ((ser->tios.c_cc[VTIME] != 0) || (ser->tios.c_cc[VMIN] <= 1))
+    {
+        return port_wait_ready(ser, SER_OP_RD, deadline);
+    }
+
+    end = clock__deadline_ns(deadline);
+
+    period = (ser->char_ns > 0) ? (int64_t)want * ser->char_ns :
+             DRAIN_POLL_NS;
+
+    for (;;)
+    {
+        ser_deadline_t wake;
+        int64_t wake_ns;
+        size_t queued = 1U;
+
+        r = port_read_queued(ser, &queued);
+        if ((r < 0) || (queued > 0U))
+        {
+            return r;
+        }
+
+        wake_ns = clock__now_ns() + period;
+        if (wake_ns >= end)
+        {
+            return port_wait_ready(ser, SER_OP_RD, deadline);
+        }
+
+        wake.sec = wake_ns / 1000000000;
+        wake.nsec = (int32_t)(wake_ns % 1000000000);
+
+        r = port_wait_ready(ser, SER_OP_RD, &wake);
+        if (r != SER_ETIMEDOUT)
+        {
+            return r;
+        }
+    }
+}
+
+/**
+ * Obtain the errno code matching a failed (non-positive) read.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] n
+ *      Read result.
+ *
+ * @return
+ *      errno code.
+ */
+static int read_errno(const ser_t *ser, ssize_t n)
+{
+    /* no bytes: VTIME expired (blocking mode) or device gone (otherwise) */
+    if (n == 0)
+    {
+        return ser->blocking ? EAGAIN : EIO;
+    }
+
+    return errno;
+}
+
+/**
+ * Fill system I/O vectors starting at the given cursor position.
+ *
+ * @param [out] siov
+ *      System I/O vectors (IOV_BATCH entries).
+ * @param [in] iov
+ *      I/O vectors.
+ * @param [in] iovcnt
+ *      Number of I/O vectors.
+ * @param [in] idx
+ *      Cursor (vector index).
+ * @param [in] off
+ *      Cursor (offset within vector).
+ *
+ * @return
+ *      Number of filled system I/O vectors.
+ */
+static int iov_fill(struct iovec *siov, const ser_iov_t *iov, size_t iovcnt,
+                    size_t idx, size_t off)
+{
+    int n = 0;
+
+    for (; (idx < iovcnt) && (n < IOV_BATCH); idx++)
+    {
+        siov[n].iov_base = (uint8_t *)iov[idx].buf + off;
+        siov[n].iov_len = iov[idx].sz - off;
+        off = 0U;
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * Advance I/O vectors cursor.
+ *
+ * @param [in] iov
+ *      I/O vectors.
+ * @param [in] iovcnt
+ *      Number of I/O vectors.
+ * @param [in, out] idx
+ *      Cursor (vector index).
+ * @param [in, out] off
+ *      Cursor (offset within vector).
+ * @param [in] n
+ *      Number of bytes to advance.
+ */
+static void iov_advance(const ser_iov_t *iov, size_t iovcnt, size_t *idx,
+                        size_t *off, size_t n)
+{
+    /* skip completed (or empty) vectors */
+    while ((*idx < iovcnt) && (n >= (iov[*idx].sz - *off)))
+    {
+        n -= iov[*idx].sz - *off;
+        (*idx)++;
+        *off = 0U;
+    }
+
+    *off += n;
+}
+
+/**
+ * Obtain a lazily computed deadline.
+ *
+ * @param [in] deadline
+ *      Lazy deadline.
+ *
+ * @return
+ *      Deadline.
+ */
+static const ser_deadline_t *deadline_get(deadline_lazy_t *deadline)
+{
+    if (!deadline->valid)
+    {
+        deadline->deadline = ser_deadline_in(deadline->timeout);
+        deadline->valid = true;
+    }
+
+    return &deadline->deadline;
+}
+
+/**
+ * Trim a write to the bytes the transmit pacing allows, waiting if none is
+ * allowed yet.
+ *
+ * @param [in] ser
+ *      Opened library instance (with transmit pacing).
+ * @param [in, out] siov
+ *      System I/O vectors.
+ * @param [in, out] cnt
+ *      Number of system I/O vectors (0 if the caller has to retry).
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_pace(ser_t *ser, struct iovec *siov, int *cnt,
+                         deadline_lazy_t *deadline)
+{
+    size_t total = 0U;
+    size_t allowed;
+    int64_t wait;
+    int i;
+
+    for (i = 0; i < *cnt; i++)
+    {
+        total += siov[i].iov_len;
+    }
+
+    allowed = pace_allow(ser, total, &wait);
+    if (allowed == 0U)
+    {
+        int64_t end = clock__deadline_ns(deadline_get(deadline));
+        int64_t now;
+        int64_t wake;
+
+        now = clock__now_ns();
+        wake = now + wait;
+        if (wake > end)
+        {
+            clock__sleep_until(end);
+            pace_delayed(ser, end - now);
+            sererr_set("Operation timed out");
+            return SER_ETIMEDOUT;
+        }
+
+        clock__sleep_until(wake);
+        pace_delayed(ser, wait);
+        *cnt = 0;
+
+        return 0;
+    }
+
+    for (i = 0; i < *cnt; i++)
+    {
+        if (siov[i].iov_len >= allowed)
+        {
+            siov[i].iov_len = allowed;
+            *cnt = i + 1;
+            break;
+        }
+
+        allowed -= siov[i].iov_len;
+    }
+
+    return 0;
+}
+
+/**
+ * Write multiple buffers to serial port (gather).
+ *
+ * @note
+ *      Writes are attempted first, the port is only waited for (and the clock
+ *      only read) if it cannot accept more bytes. Blocking mode descriptors
+ *      are still waited for first.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] iov
+ *      Buffers.
+ * @param [in] iovcnt
+ *      Number of buffers.
+ * @param [in] sent
+ *      Number of actual written bytes (optional).
+ * @param [in] deadline
+ *      Deadline.
+ * @param [out] first
+ *      Time right after the first successful write (ns, optional, only set
+ *      once bytes are written).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_writev(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                           size_t *sent, deadline_lazy_t *deadline,
+                           int64_t *first)
+{
+    int32_t r = 0;
+
+    struct iovec siov[IOV_BATCH];
+    size_t sent_ = 0U;
+    size_t idx = 0U;
+    size_t off = 0U;
+
+    iov_advance(iov, iovcnt, &idx, &off, 0U);
+
+    /* asynchronous transmission: queue (keeps ordering), then wait */
+    if ((ser->tx != NULL) && (idx < iovcnt))
+    {
+        uint64_t seq;
+
+        r = tx_enqueue(ser, iov, iovcnt, 0U, NULL, NULL, NULL,
+                       deadline_get(deadline), &seq);
+        if (r == 0)
+        {
+            r = tx_wait(ser, seq, deadline_get(deadline));
+        }
+
+        if (r == 0)
+        {
+            for (; idx < iovcnt; idx++)
+            {
+                sent_ += iov[idx].sz;
+            }
+        }
+    }
+
+    while ((idx < iovcnt) && (ser->tx == NULL))
+    {
+        ssize_t sent_now;
+        int cnt;
+
+        /* write remaining bytes (no more than the pacing allows) */
+        cnt = iov_fill(siov, iov, iovcnt, idx, off);
+
+        if (ser->pace != NULL)
+        {
+            r = port_pace(ser, siov, &cnt, deadline);
+            if (r < 0)
+            {
+                break;
+            }
+
+            if (cnt == 0)
+            {
+                continue;
+            }
+        }
+
+        sent_now = writev(ser->fd, siov, cnt);
+
+        if (sent_now > 0)
+        {
+            if ((first != NULL) && (sent_ == 0U))
+            {
+                *first = clock__now_ns();
+            }
+
+            if (ser->pace != NULL)
+            {
+                pace_consume(ser, (size_t)sent_now);
+            }
+
+            sent_ += (size_t)sent_now;
+            iov_advance(iov, iovcnt, &idx, &off, (size_t)sent_now);
+        }
+        else if ((sent_now < 0) && (errno == EAGAIN))
+        {
+            /* port is full: wait until write is available */
+            r = port_wait_ready(ser, SER_OP_WR, deadline_get(deadline));
+            if (r < 0)
+            {
+                break;
+            }
+        }
+        /* no data written: device disconnected */
+        else if ((sent_now == 0) || (errno != EINTR))
+        {
+            r = perr_setc(EIO);
+            break;
+        }
+    }
+
+    if (sent_ > 0U)
+    {
+        ser->wrote = true;
+    }
+
+    /* optionally store sent bytes */
+    if (sent != NULL)
+    {
+        *sent = sent_;
+    }
+
+    return r;
+}
+
+/**
+ * Wait until the transmitter is empty (the last character left the line).
+ *
+ * @note
+ *      Called once the driver output queue is empty. The transmitter status
+ *      is polled every half character time (busy-waiting the end of each
+ *      period for accuracy). If the driver does not report it, one character
+ *      time (shift register) is waited instead.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] end
+ *      Deadline (ns, INT64_MAX if none).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_drain_tx(ser_t *ser, int64_t end)
+{
+    int64_t period;
+    int64_t now;
+
+    period = (ser->char_ns > 0) ? ser->char_ns : DRAIN_POLL_NS;
+    now = clock__now_ns();
+
+#ifdef TIOCSERGETLSR
+    for (;;)
+    {
+        int lsr = 0;
+
+        if (ioctl(ser->fd, TIOCSERGETLSR, &lsr) < 0)
+        {
+            /* transmitter status not reported by the driver */
+            if ((errno == ENOTTY) || (errno == EINVAL) || (errno == EIO))
+            {
+                break;
+            }
+
+            return perr_setc(errno);
+        }
+
+        if ((lsr & TIOCSER_TEMT) != 0)
+        {
+            return 0;
+        }
+
+        if (now >= end)
+        {
+            sererr_set("Operation timed out");
+            return SER_ETIMEDOUT;
+        }
+
+        now = spin_until(ser, (end - now > period / 2) ? now + (period / 2) :
+                         end);
+    }
+#endif
+
+    if (end - now < period)
+    {
+        (void)spin_until(ser, end);
+        sererr_set("Operation timed out");
+        return SER_ETIMEDOUT;
+    }
+
+    (void)spin_until(ser, now + period);
+
+    return 0;
+}
+
+/**
+ * Switch the line settings of an opened port in place.
+ *
+ * @note
+ *      Only changed attributes are applied (queues are not flushed). Custom
+ *      baudrates are set apart from the attributes (see port_line_applied()),
+ *      so they are set again whenever the previous or new one is custom.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] opts
+ *      Port options (line settings).
+ * @param [in] iflag
+ *      Input flags.
+ *
+ * @return
+ *      0 on success, error code otherwise (nothing is changed if the line
+ *      settings are invalid).
+ */
+static int32_t port_switch(ser_t *ser, const ser_opts_t *opts, tcflag_t iflag)
+{
+    int32_t r;
+
+    struct termios tios;
+    bool custom;
+    bool changed;
+
+    /* new line settings over the applied attributes */
+    tios = ser->tios;
+
+    r = port_line(opts, &tios, &custom);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    tios.c_iflag = iflag;
+
+    /* attributes hold a placeholder speed for custom baudrates: leaving one
+     * requires applying them even if they compare equal */
+    changed = (memcmp(&tios, &ser->tios, sizeof(tios)) != 0);
+    if (changed || (ser->baud_custom && !custom))
+    {
+        if (tcsetattr(ser->fd, TCSANOW, &tios) < 0)
+        {
+            return perr_setc(errno);
+        }
+
+        ser->tios = tios;
+        changed = true;
+    }
+
+    /* custom baudrates are always set again */
+    if (changed || custom)
+    {
+        r = port_line_applied(ser, opts, custom);
+    }
+
+    return r;
+}
+
+/**
+ * Look for the expected pattern in the search window, then slide it.
+ *
+ * @note
+ *      Only the last expected pattern size - 1 bytes are kept, so that a
+ *      pattern split across reads is found and bytes are searched once.
+ *
+ * @param [in, out] score
+ *      Score.
+ * @param [in] opts
+ *      Detection options.
+ */
+static void autobaud_match(autobaud_score_t *score,
+                           const ser_autobaud_opts_t *opts)
+{
+    size_t keep = opts->expect_sz - 1U;
+    size_t i;
+
+    for (i = 0U; (i + opts->expect_sz) <= score->win_sz; i++)
+    {
+        if (memcmp(&score->win[i], opts->expect, opts->expect_sz) == 0)
+        {
+            score->matched = true;
+            return;
+        }
+    }
+
+    if (score->win_sz > keep)
+    {
+        memmove(score->win, &score->win[score->win_sz - keep], keep);
+        score->win_sz = keep;
+    }
+}
+
+/**
+ * Score received bytes (parity marked).
+ *
+ * @note
+ *      With PARMRK (and without ISTRIP), a 0xFF byte is received as
+ *      0xFF 0xFF, and a byte with a framing or parity error (or a break) as
+ *      0xFF 0x00 byte.
+ *
+ * @param [in, out] score
+ *      Score.
+ * @param [in] buf
+ *      Received bytes.
+ * @param [in] sz
+ *      Number of received bytes.
+ * @param [in] opts
+ *      Detection options.
+ */
+static void autobaud_feed(autobaud_score_t *score, const uint8_t *buf,
+                          size_t sz, const ser_autobaud_opts_t *opts)
+{
+    size_t i;
+
+    for (i = 0U; i < sz; i++)
+    {
+        if ((score->mark == 0) && (buf[i] == 0xFFU))
+        {
+            score->mark = 1;
+            continue;
+        }
+
+        if ((score->mark == 1) && (buf[i] == 0x00U))
+        {
+            score->mark = 2;
+            continue;
+        }
+
+        if (score->mark == 2)
+        {
+            score->errors++;
+            score->mark = 0;
+            continue;
+        }
+
+        /* error-free byte (0xFF 0xFF is a single 0xFF) */
+        score->mark = 0;
+        score->sz++;
+
+        if ((opts->expect != NULL) && !score->matched)
+        {
+            score->win[score->win_sz++] = buf[i];
+            if (score->win_sz == AUTOBAUD_WIN_SZ)
+            {
+                autobaud_match(score, opts);
+            }
+        }
+    }
+
+    if ((opts->expect != NULL) && !score->matched)
+    {
+        autobaud_match(score, opts);
+    }
+}
+
+/**
+ * Check if a baudrate is accepted right away.
+ *
+ * @param [in] score
+ *      Score.
+ * @param [in] opts
+ *      Detection options.
+ *
+ * @return
+ *      true if accepted, false otherwise.
+ */
+static bool autobaud_accepted(const autobaud_score_t *score,
+                              const ser_autobaud_opts_t *opts)
+{
+    if (opts->expect != NULL)
+    {
+        return score->matched;
+    }
+
+    return (score->errors == 0U) && (score->sz >= opts->min_bytes);
+}
+
+/**
+ * Check if a baudrate is rejected right away (errors dominate).
+ *
+ * @param [in] score
+ *      Score.
+ *
+ * @return
+ *      true if rejected, false otherwise.
+ */
+static bool autobaud_rejected(const autobaud_score_t *score)
+{
+    return (score->errors >= 2U) &&
+           (((int64_t)score->errors * AUTOBAUD_ERR_WEIGHT) >
+            (int64_t)score->sz);
+}
+
+/**
+ * Listen at a candidate baudrate.
+ *
+ * @note
+ *      If a probe is sent, listening ends once the answer is over (the line
+ *      is idle for a few characters time after bytes were received).
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] baudrate
+ *      Candidate baudrate.
+ * @param [in] iflag
+ *      Input flags (parity marking).
+ * @param [in] opts
+ *      Detection options.
+ * @param [out] score
+ *      Score.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t autobaud_listen(ser_t *ser, uint32_t baudrate, tcflag_t iflag,
+                               const ser_autobaud_opts_t *opts,
+                               autobaud_score_t *score)
+{
+    int32_t r;
+
+    ser_opts_t line = SER_OPTS_INIT;
+    ser_deadline_t deadline;
+
+    memset(score, 0, sizeof(*score));
+
+    line.baudrate = baudrate;
+    line.bytesz = ser->line.bytesz;
+    line.parity = ser->line.parity;
+    line.stopbits = ser->line.stopbits;
+
+    r = port_switch(ser, &line, iflag);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    /* bytes received at the previous baudrate are meaningless */
+    r = ser_flush(ser, SER_QUEUE_IN);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    deadline = ser_deadline_in((int32_t)opts->listen);
+
+    if (opts->probe != NULL)
+    {
+        r = ser_write_until(ser, opts->probe, opts->probe_sz, NULL,
+                            &deadline);
+        if (r < 0)
+        {
+            return (r == SER_ETIMEDOUT) ? 0 : r;
+        }
+    }
+
+    while (!autobaud_accepted(score, opts) && !autobaud_rejected(score))
+    {
+        uint8_t buf[64];
+        size_t recvd = 0U;
+        const ser_deadline_t *wait = &deadline;
+        ser_deadline_t idle;
+
+        /* probe answered: the answer is over once the line is idle */
+        if ((opts->probe != NULL) && ((score->sz + score->errors) > 0U))
+        {
+            int64_t idle_ns;
+
+            idle_ns = AUTOBAUD_IDLE_CHARS * ser->char_ns;
+            if (idle_ns < AUTOBAUD_IDLE_MIN_NS)
+            {
+                idle_ns = AUTOBAUD_IDLE_MIN_NS;
+            }
+
+            idle = ser_deadline_in_ns(idle_ns);
+            if ((idle.sec < deadline.sec) ||
+                ((idle.sec == deadline.sec) && (idle.nsec < deadline.nsec)))
+            {
+                wait = &idle;
+            }
+        }
+
+        r = ser_read_wait_until(ser, wait);
+        if (r == SER_ETIMEDOUT)
+        {
+            return 0;
+        }
+
+        if (r < 0)
+        {
+            return r;
+        }
+
+        r = ser_try_read(ser, buf, sizeof(buf), &recvd);
+        if (r == SER_EEMPTY)
+        {
+            continue;
+        }
+
+        if (r < 0)
+        {
+            return r;
+        }
+
+        autobaud_feed(score, buf, recvd, opts);
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+ser_deadline_t ser_deadline_in(int32_t timeout)
+{
+    /* negative timeouts never expire (as #SER_NO_TIMEOUT) */
+    if (timeout <= SER_NO_TIMEOUT)
+    {
+        return ser_deadline_in_ns(-1);
+    }
+
+    return ser_deadline_in_ns((int64_t)timeout * 1000000);
+}
+
+ser_deadline_t ser_deadline_in_ns(int64_t timeout_ns)
+{
+    ser_deadline_t deadline = SER_DEADLINE_NEVER;
+    struct timespec now;
+
+    if ((timeout_ns >= 0) && (clock_gettime(CLOCK_MONOTONIC, &now) == 0))
+    {
+        deadline.sec = (int64_t)now.tv_sec + (timeout_ns / 1000000000);
+        deadline.nsec = (int32_t)(now.tv_nsec + (timeout_ns % 1000000000));
+
+        if (deadline.nsec >= 1000000000)
+        {
+            deadline.sec++;
+            deadline.nsec -= 1000000000;
+        }
+    }
+
+    return deadline;
+}
+
+int32_t ser_open(ser_t *ser, const ser_opts_t *opts)
+{
+    int32_t r = 0;
+
+    /* open port */
+    ser->fd = open(opts->port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (ser->fd < 0)
+    {
+        r = perr_setc(errno);
+        goto out;
+    }
+
+    /* configure port */
+    r = port_configure(ser, opts);
+    if (r < 0)
+    {
+        goto cleanup;
+    }
+
+    /* blocking mode: reads wait in the kernel (VMIN/VTIME) on a second,
+     * blocking descriptor (writes and waits keep the non-blocking one) */
+    ser->rd_fd = ser->fd;
+    if (ser->blocking)
+    {
+        ser->rd_fd = open(opts->port, O_RDONLY | O_NOCTTY);
+        if (ser->rd_fd < 0)
+        {
+            r = perr_setc(errno);
+            goto cleanup_restore;
+        }
+    }
+
+    /* set up read wait strategy */
+    r = spin_start(ser, opts);
+    if (r < 0)
+    {
+        goto cleanup_rd;
+    }
+
+    /* tune port for low latency (if enabled) */
+    r = lowlat_apply(ser, opts);
+    if (r < 0)
+    {
+        goto cleanup_spin;
+    }
+
+    /* set up transmit pacing (if enabled) */
+    r = pace_start(ser, opts);
+    if (r < 0)
+    {
+        goto cleanup_lowlat;
+    }
+
+    /* start background reception (if enabled) */
+    r = rx_start(ser, opts);
+    if (r < 0)
+    {
+        goto cleanup_pace;
+    }
+
+    /* start asynchronous transmission (if enabled) */
+    r = tx_start(ser, opts);
+    if (r < 0)
+    {
+        goto cleanup_rx;
+    }
+
+    goto out;
+
+cleanup_rx:
+    if (ser->rx != NULL)
+    {
+        rx_stop(ser);
+    }
+
+cleanup_pace:
+    if (ser->pace != NULL)
+    {
+        pace_stop(ser);
+    }
+
+cleanup_lowlat:
+    if (ser->lowlat != NULL)
+    {
+        lowlat_restore(ser);
+    }
+
+cleanup_spin:
+    if (ser->spin != NULL)
+    {
+        spin_stop(ser);
+    }
+
+cleanup_rd:
+    if (ser->rd_fd != ser->fd)
+    {
+        close(ser->rd_fd);
+    }
+
+cleanup_restore:
+    port_restore(ser);
+
+cleanup:
+    close(ser->fd);
+
+out:
+    return r;
+}
+
+void ser_close(ser_t *ser)
+{
+    /* write queued frames (bounded by the write timeout), then stop */
+    if (ser->tx != NULL)
+    {
+        ser_deadline_t deadline;
+
+        deadline = ser_deadline_in(ser->timeouts.wr);
+        tx_stop(ser, &deadline);
+    }
+
+    /* stop background reception (it reads from the port) */
+    if (ser->rx != NULL)
+    {
+        rx_stop(ser);
+    }
+
+    /* restore port settings, then close */
+    if (ser->lowlat != NULL)
+    {
+        lowlat_restore(ser);
+    }
+
+    if (ser->spin != NULL)
+    {
+        spin_stop(ser);
+    }
+
+    if (ser->pace != NULL)
+    {
+        pace_stop(ser);
+    }
+
+    if (ser->rd_fd != ser->fd)
+    {
+        close(ser->rd_fd);
+    }
+
+    port_restore(ser);
+    close(ser->fd);
+}
+
+int32_t ser_reconfigure(ser_t *ser, const ser_opts_t *opts,
+                        ser_reconf_t when)
+{
+    int32_t r;
+
+    if ((when != SER_RECONF_NOW) && (when != SER_RECONF_DRAIN))
+    {
+        sererr_set("Invalid reconfiguration timing");
+        return SER_EINVAL;
+    }
+
+    if (when == SER_RECONF_DRAIN)
+    {
+        ser_deadline_t deadline;
+
+        deadline = ser_deadline_in(ser->timeouts.wr);
+
+        r = ser_drain(ser, &deadline);
+        if (r < 0)
+        {
+            return r;
+        }
+    }
+
+    r = port_switch(ser, opts, ser->tios.c_iflag);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    ser->timeouts.rd = (int)opts->timeouts.rd;
+    ser->timeouts.wr = (int)opts->timeouts.wr;
+
+    return 0;
+}
+
+int32_t ser_autobaud(ser_t *ser, const ser_autobaud_opts_t *opts,
+                     uint32_t *baudrate)
+{
+    int32_t r = 0;
+
+    const uint32_t *rates = autobaud_rates;
+    size_t nrates = sizeof(autobaud_rates) / sizeof(autobaud_rates[0]);
+    ser_opts_t line = SER_OPTS_INIT;
+    autobaud_score_t score;
+    tcflag_t iflag;
+    tcflag_t iflag_mark;
+    uint32_t initial;
+    uint32_t best = 0U;
+    int64_t best_score = 0;
+    bool found = false;
+    size_t i;
+
+    if (((opts->expect != NULL) &&
+         ((opts->expect_sz == 0U) || (opts->expect_sz > AUTOBAUD_EXPECT_MAX))) ||
+        ((opts->expect == NULL) && (opts->min_bytes == 0U)) ||
+        (opts->listen == 0U) ||
+        ((opts->rates != NULL) && (opts->nrates == 0U)))
+    {
+        sererr_set("Invalid automatic baudrate detection options");
+        return SER_EINVAL;
+    }
+
+    if (opts->rates != NULL)
+    {
+        rates = opts->rates;
+        nrates = opts->nrates;
+    }
+
+    /* mark framing and parity errors (and breaks) */
+    iflag = ser->tios.c_iflag;
+    iflag_mark = (iflag & ~(tcflag_t)(IGNPAR | IGNBRK | BRKINT | ISTRIP)) |
+                 INPCK | PARMRK;
+
+    initial = ser->baudrate;
+
+    /* current baudrate first, then candidates in order */
+    for (i = 0U; i <= nrates; i++)
+    {
+        uint32_t candidate;
+        int64_t value;
+
+        candidate = (i == 0U) ? initial : rates[i - 1U];
+        if ((i > 0U) && (candidate == initial))
+        {
+            continue;
+        }
+
+        r = autobaud_listen(ser, candidate, iflag_mark, opts, &score);
+        if (r < 0)
+        {
+            break;
+        }
+
+        if (autobaud_accepted(&score, opts))
+        {
+            best = candidate;
+            found = true;
+            break;
+        }
+
+        /* fallback: most bytes over errors (no pattern expected) */
+        value = (int64_t)score.sz -
+                ((int64_t)score.errors * AUTOBAUD_ERR_WEIGHT);
+        if ((opts->expect == NULL) && (score.sz >= opts->min_bytes) &&
+            (value > best_score))
+        {
+            best = candidate;
+            best_score = value;
+        }
+    }
+
+    if ((r == 0) && !found && (best_score == 0))
+    {
+        sererr_set("Baudrate not detected");
+        r = SER_EFAIL;
+    }
+
+    /* leave detected (or initial) baudrate, without parity marking */
+    line.baudrate = (r == 0) ? best : initial;
+    line.bytesz = ser->line.bytesz;
+    line.parity = ser->line.parity;
+    line.stopbits = ser->line.stopbits;
+
+    if (r == 0)
+    {
+        r = port_switch(ser, &line, iflag);
+    }
+    else
+    {
+        (void)port_switch(ser, &line, iflag);
+    }
+
+    if (r == 0)
+    {
+        (void)ser_flush(ser, SER_QUEUE_IN);
+        *baudrate = best;
+    }
+
+    return r;
+}
+
+int32_t ser_flush(ser_t *ser, ser_queue_t queue)
+{
+    int32_t r = 0;
+
+    int queue_;
+
+    /* map to the corresponding termios queue */
+    switch (queue)
+    {
+        case SER_QUEUE_IN:
+            queue_ = TCIFLUSH;
+            break;
+        case SER_QUEUE_OUT:
+            queue_ = TCOFLUSH;
+            break;
+        case SER_QUEUE_ALL:
+            queue_ = TCIOFLUSH;
+            break;
+        default:
+            sererr_set("Invalid queue specified");
+            r = SER_EINVAL;
+            break;
+    }
+
+    /* flush */
+    if (r == 0)
+    {
+        if (tcflush(ser->fd, queue_) < 0)
+        {
+            r = perr_setc(errno);
+        }
+        else if ((ser->rx != NULL) && (queue != SER_QUEUE_OUT))
+        {
+            rx_flush(ser);
+        }
+    }
+
+    return r;
+}
+
+int32_t ser_get_baudrate(ser_t *ser, uint32_t *baudrate)
+{
+    *baudrate = ser->baudrate;
+
+    return 0;
+}
+
+int32_t ser_rx_stats(ser_t *ser, ser_rx_stats_t *stats)
+{
+    if (ser->rx == NULL)
+    {
+        sererr_set("Background reception is not enabled");
+        return SER_EINVAL;
+    }
+
+    rx_stats(ser, stats);
+
+    return 0;
+}
+
+int32_t ser_pace_stats(ser_t *ser, ser_pace_stats_t *stats)
+{
+    if (ser->pace == NULL)
+    {
+        sererr_set("Transmit pacing is not enabled");
+        return SER_EINVAL;
+    }
+
+    pace_stats(ser, stats);
+
+    return 0;
+}
+
+int32_t ser_low_latency(ser_t *ser, uint32_t *applied)
+{
+    if (ser->lowlat == NULL)
+    {
+        sererr_set("Low-latency profile is not enabled");
+        return SER_EINVAL;
+    }
+
+    *applied = lowlat_applied(ser);
+
+    return 0;
+}
+
+int32_t ser_wait_stats(ser_t *ser, ser_wait_stats_t *stats)
+{
+    if (ser->spin == NULL)
+    {
+        sererr_set("Spinning wait strategy is not enabled");
+        return SER_EINVAL;
+    }
+
+    spin_stats(ser, stats);
+
+    return 0;
+}
+
+int32_t ser_available(ser_t *ser, size_t *available)
+{
+    int32_t r;
+
+    int cinq = 0;
+
+    if (ser->rx != NULL)
+    {
+        *available = rx_available(ser);
+        return 0;
+    }
+
+    if (ioctl(ser->fd, TIOCINQ, &cinq) < 0)
+    {
+        r = perr_setc(errno);
+    }
+    else
+    {
+        *available = (size_t)cinq;
+        r = 0;
+    }
+
+    return r;
+}
+
+int32_t ser_outq(ser_t *ser, size_t *queued)
+{
+    int coutq = 0;
+
+    if (ioctl(ser->fd, TIOCOUTQ, &coutq) < 0)
+    {
+        return perr_setc(errno);
+    }
+
+    *queued = (size_t)coutq;
+
+    if (ser->tx != NULL)
+    {
+        *queued += tx_queued(ser);
+    }
+
+    return 0;
+}
+
+int32_t ser_drain(ser_t *ser, const ser_deadline_t *deadline)
+{
+    int32_t r;
+
+    int64_t end = clock__deadline_ns(deadline);
+
+    /* asynchronous transmission: queued frames reach the driver first */
+    if (ser->tx != NULL)
+    {
+        r = tx_drain(ser, deadline);
+        if (r < 0)
+        {
+            return r;
+        }
+    }
+
+    /* driver queue: sleep for the estimated transmission time of its bytes
+     * (re-checked, flow control or a slower line may hold them back) */
+    for (;;)
+    {
+        int coutq = 0;
+        int64_t now;
+        int64_t wake;
+
+        if (ioctl(ser->fd, TIOCOUTQ, &coutq) < 0)
+        {
+            return perr_setc(errno);
+        }
+
+        if (coutq == 0)
+        {
+            break;
+        }
+
+        now = clock__now_ns();
+        if (now >= end)
+        {
+            sererr_set("Operation timed out");
+            return SER_ETIMEDOUT;
+        }
+
+        wake = now + ((ser->char_ns > 0) ? (int64_t)coutq * ser->char_ns :
+                      DRAIN_POLL_NS);
+        clock__sleep_until((wake < end) ? wake : end);
+    }
+
+    /* transmitter: last characters */
+    return port_drain_tx(ser, end);
+}
+
+int32_t ser_read_wait(ser_t *ser)
+{
+    ser_deadline_t deadline;
+
+    deadline = ser_deadline_in(ser->timeouts.rd);
+
+    return ser_read_wait_until(ser, &deadline);
+}
+
+int32_t ser_read_wait_until(ser_t *ser, const ser_deadline_t *deadline)
+{
+    if (ser->rx != NULL)
+    {
+        return rx_wait(ser, deadline);
+    }
+
+    /* wait until read is ready */
+    return port_wait_ready(ser, SER_OP_RD, deadline);
+}
+
+int32_t ser_read_available(ser_t *ser, void *buf, size_t sz, size_t *recvd)
+{
+    int32_t r;
+    ser_deadline_t deadline;
+
+    /* optimistic: bytes are usually pending already, unless a request was
+     * just written (the read would only find nothing) */
+    if (!ser->wrote)
+    {
+        r = ser_try_read(ser, buf, sz, recvd);
+        if (r != SER_EEMPTY)
+        {
+            return r;
+        }
+    }
+
+    ser->wrote = false;
+
+    /* nothing pending (yet): wait (clock is only read now), then drain */
+    deadline = ser_deadline_in(ser->timeouts.rd);
+
+    r = ser_read_wait_until(ser, &deadline);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    return ser_try_read(ser, buf, sz, recvd);
+}
+
+int32_t ser_read(ser_t *ser, void *buf, size_t sz, size_t *recvd)
+{
+    int32_t r = 0;
+
+    ssize_t recvd_;
+
+    if (ser->rx != NULL)
+    {
+        size_t recvd_rx;
+
+        r = rx_read(ser, buf, sz, &recvd_rx);
+        if ((r == 0) && (recvd != NULL))
+        {
+            *recvd = recvd_rx;
+        }
+
+        return r;
+    }
+
+    recvd_ = read(ser->rd_fd, buf, sz);
+
+    if (recvd_ > 0)
+    {
+        /* optionally store read bytes */
+        if (recvd != NULL)
+        {
+            *recvd = (size_t)recvd_;
+        }
+    }
+    else
+    {
+        r = perr_setc(read_errno(ser, recvd_));
+    }
+
+    return r;
+}
+
+int32_t ser_write(ser_t *ser, const void *buf, size_t sz, size_t *sent)
+{
+    ser_iov_t iov;
+
+    iov.buf = (void *)buf;
+    iov.sz = sz;
+
+    return ser_writev(ser, &iov, 1U, sent);
+}
+
+int32_t ser_write_until(ser_t *ser, const void *buf, size_t sz, size_t *sent,
+                        const ser_deadline_t *deadline)
+{
+    ser_iov_t iov;
+
+    iov.buf = (void *)buf;
+    iov.sz = sz;
+
+    return ser_writev_until(ser, &iov, 1U, sent, deadline);
 }
 
-int32_t ser_flush(ser_t *ser, ser_queue_t queue)
+int32_t ser_write_at(ser_t *ser, const void *buf, size_t sz, size_t *sent,
+                     const ser_deadline_t *at, ser_deadline_t *sent_at)
+{
+    int32_t r;
+
+    ser_iov_t iov;
+    deadline_lazy_t deadline;
+    int64_t first = -1;
+
+    if (ser->tx != NULL)
+    {
+        sererr_set("Not available with asynchronous transmission");
+        return SER_ENOTSUP;
+    }
+
+    if (at->sec == INT64_MAX)
+    {
+        sererr_set("Invalid time");
+        return SER_EINVAL;
+    }
+
+    (void)spin_until(ser, clock__deadline_ns(at));
+
+    iov.buf = (void *)buf;
+    iov.sz = sz;
+
+    /* the write timeout applies from the release time */
+    deadline.timeout = ser->timeouts.wr;
+    deadline.valid = false;
+
+    r = port_writev(ser, &iov, 1U, sent, &deadline, &first);
+
+    /* timestamp of the first successful write (bytes handed to the driver) */
+    if ((sent_at != NULL) && (first >= 0))
+    {
+        sent_at->sec = first / 1000000000;
+        sent_at->nsec = (int32_t)(first % 1000000000);
+    }
+
+    return r;
+}
+
+int32_t ser_read_exact(ser_t *ser, void *buf, size_t sz, size_t *recvd,
+                       const ser_deadline_t *deadline)
 {
     int32_t r = 0;
 
-    int queue_;
+    size_t recvd_ = 0U;
+    uint8_t *bufc = buf;
 
-    /* map to the corresponding termios queue */
-    switch (queue)
+    while ((recvd_ < sz) && (ser->rx != NULL))
     {
-        case SER_QUEUE_IN:
-            queue_ = TCIFLUSH;
+        size_t recvd_now;
+
+        r = rx_read(ser, bufc + recvd_, sz - recvd_, &recvd_now);
+        if (r == 0)
+        {
+            recvd_ += recvd_now;
+        }
+        else if (r == SER_EEMPTY)
+        {
+            r = rx_wait(ser, deadline);
+            if (r < 0)
+            {
+                break;
+            }
+        }
+        else
+        {
             break;
-        case SER_QUEUE_OUT:
-            queue_ = TCOFLUSH;
+        }
+    }
+
+    while ((recvd_ < sz) && (ser->rx == NULL))
+    {
+        ssize_t recvd_now;
+        size_t want = sz - recvd_;
+        bool expired = false;
+
+        /* blocking mode: reads would wait on their own (ignoring the
+         * deadline), so wait first and only request the queued bytes */
+        if (ser->blocking)
+        {
+            r = port_wait_queued(ser, want, deadline);
+            if (r == SER_ETIMEDOUT)
+            {
+                /* still take the bytes queued so far */
+                expired = true;
+            }
+            else if (r < 0)
+            {
+                break;
+            }
+
+            r = port_read_queued(ser, &want);
+            if (r < 0)
+            {
+                break;
+            }
+
+            if (want == 0U)
+            {
+                if (expired)
+                {
+                    sererr_set("Operation timed out");
+                    r = SER_ETIMEDOUT;
+                    break;
+                }
+
+                /* ready but nothing queued (hang-up): let read report it */
+                want = 1U;
+            }
+        }
+
+        /* request all remaining (queued) bytes, so that a single read drains
+         * all the bytes already queued */
+        recvd_now = read(ser->rd_fd, bufc + recvd_, want);
+
+        if (recvd_now > 0)
+        {
+            recvd_ += (size_t)recvd_now;
+
+            if (expired && (recvd_ < sz))
+            {
+                sererr_set("Operation timed out");
+                r = SER_ETIMEDOUT;
+                break;
+            }
+        }
+        else if (read_errno(ser, recvd_now) == EAGAIN)
+        {
+            /* nothing queued: wait (bounded by the overall deadline) */
+            r = port_wait_ready(ser, SER_OP_RD, deadline);
+            if (r < 0)
+            {
+                break;
+            }
+        }
+        else
+        {
+            r = perr_setc(read_errno(ser, recvd_now));
             break;
-        case SER_QUEUE_ALL:
-            queue_ = TCIOFLUSH;
+        }
+    }
+
+    /* optionally store read bytes (also partial ones) */
+    if (recvd != NULL)
+    {
+        *recvd = recvd_;
+    }
+
+    return r;
+}
+
+int32_t ser_readv(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                  size_t *recvd)
+{
+    int32_t r = 0;
+
+    struct iovec siov[IOV_BATCH];
+    size_t recvd_ = 0U;
+    size_t idx = 0U;
+    size_t off = 0U;
+
+    iov_advance(iov, iovcnt, &idx, &off, 0U);
+
+    /* background reception: copy out of the ring, vector by vector */
+    while ((idx < iovcnt) && (ser->rx != NULL))
+    {
+        size_t want = iov[idx].sz - off;
+        size_t recvd_now;
+
+        r = rx_read(ser, (uint8_t *)iov[idx].buf + off, want, &recvd_now);
+        if (r < 0)
+        {
+            /* some bytes were already read: not an error */
+            if ((recvd_ > 0U) && (r == SER_EEMPTY))
+            {
+                r = 0;
+            }
+
             break;
-        default:
-            sererr_set("Invalid queue specified");
-            r = SER_EINVAL;
+        }
+
+        recvd_ += recvd_now;
+        iov_advance(iov, iovcnt, &idx, &off, recvd_now);
+
+        if (recvd_now < want)
+        {
             break;
+        }
     }
 
-    /* flush */
-    if (r == 0)
+    /* read until vectors are full or no more bytes are available */
+    while ((idx < iovcnt) && (ser->rx == NULL))
     {
-        if (tcflush(ser->fd, queue_) < 0)
+        ssize_t recvd_now;
+        int n;
+        int i;
+        size_t batch_sz = 0U;
+
+        n = iov_fill(siov, iov, iovcnt, idx, off);
+        for (i = 0; i < n; i++)
+        {
+            batch_sz += siov[i].iov_len;
+        }
+
+        /* blocking mode: only the first read may wait (as ser_read() does),
+         * further batches only take the bytes already queued */
+        if (ser->blocking && (recvd_ > 0U))
+        {
+            size_t want = batch_sz;
+
+            /* some bytes were already read: not an error */
+            if ((port_read_queued(ser, &want) < 0) || (want == 0U))
+            {
+                break;
+            }
+
+            if (want < batch_sz)
+            {
+                /* trim the batch to the queued bytes */
+                batch_sz = 0U;
+                for (i = 0; i < n; i++)
+                {
+                    if ((batch_sz + siov[i].iov_len) >= want)
+                    {
+                        siov[i].iov_len = want - batch_sz;
+                        n = i + 1;
+                        break;
+                    }
+
+                    batch_sz += siov[i].iov_len;
+                }
+
+                batch_sz = want;
+            }
+        }
+
+        recvd_now = readv(ser->rd_fd, siov, n);
+
+        if (recvd_now > 0)
+        {
+            recvd_ += (size_t)recvd_now;
+            iov_advance(iov, iovcnt, &idx, &off, (size_t)recvd_now);
+
+            if ((size_t)recvd_now < batch_sz)
+            {
+                break;
+            }
+        }
+        else
         {
-            r = error_set(errno);
+            /* some bytes were already read: not an error */
+            if ((recvd_ == 0U) || ((recvd_now < 0) && (errno != EAGAIN)))
+            {
+                r = perr_setc(read_errno(ser, recvd_now));
+            }
+
+            break;
         }
     }
 
+    /* optionally store read bytes */
+    if (recvd != NULL)
+    {
+        *recvd = recvd_;
+    }
+
     return r;
 }
 
-int32_t ser_available(ser_t *ser, size_t *available)
+int32_t ser_writev(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                   size_t *sent)
 {
-    int32_t r;
+    deadline_lazy_t deadline;
 
-    int cinq = 0;
+    /* single deadline for all retries (only computed if required) */
+    deadline.timeout = ser->timeouts.wr;
+    deadline.valid = false;
 
-    if (ioctl(ser->fd, TIOCINQ, &cinq) < 0)
+    return port_writev(ser, iov, iovcnt, sent, &deadline, NULL);
+}
+
+int32_t ser_writev_until(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                         size_t *sent, const ser_deadline_t *deadline)
+{
+    deadline_lazy_t deadline_;
+
+    deadline_.deadline = *deadline;
+    deadline_.valid = true;
+
+    return port_writev(ser, iov, iovcnt, sent, &deadline_, NULL);
+}
+
+int32_t ser_write_async(ser_t *ser, const void *buf, size_t sz,
+                        ser_tx_on_done_t on_done, void *ctx, uint64_t *seq)
+{
+    ser_iov_t iov;
+
+    if (ser->tx == NULL)
     {
-        r = error_set(errno);
+        sererr_set("Asynchronous transmission is not enabled");
+        return SER_EINVAL;
     }
-    else
+
+    iov.buf = (void *)buf;
+    iov.sz = sz;
+
+    return tx_enqueue(ser, &iov, 1U, 0U, NULL, on_done, ctx, NULL, seq);
+}
+
+int32_t ser_write_async_prio(ser_t *ser, const void *buf, size_t sz,
+                             uint8_t prio, const ser_deadline_t *expires,
+                             ser_tx_on_done_t on_done, void *ctx, uint64_t *seq)
+{
+    ser_iov_t iov;
+
+    if (ser->tx == NULL)
     {
-        *available = (size_t)cinq;
-        r = 0;
+        sererr_set("Asynchronous transmission is not enabled");
+        return SER_EINVAL;
     }
 
-    return r;
+    iov.buf = (void *)buf;
+    iov.sz = sz;
+
+    return tx_enqueue(ser, &iov, 1U, prio, expires, on_done, ctx, NULL, seq);
 }
 
-int32_t ser_read_wait(ser_t *ser)
+int32_t ser_tx_stats(ser_t *ser, ser_tx_stats_t *stats)
 {
-    int timeout = ser->timeouts.rd;
+    if (ser->tx == NULL)
+    {
+        sererr_set("Asynchronous transmission is not enabled");
+        return SER_EINVAL;
+    }
 
-    /* wait until read is ready */
-    return port_wait_ready(ser, SER_OP_RD, &timeout);
+    tx_stats(ser, stats);
+
+    return 0;
 }
 
-int32_t ser_read(ser_t *ser, void *buf, size_t sz, size_t *recvd)
+int32_t ser_tx_wait(ser_t *ser, uint64_t seq, const ser_deadline_t *deadline)
+{
+    if (ser->tx == NULL)
+    {
+        sererr_set("Asynchronous transmission is not enabled");
+        return SER_EINVAL;
+    }
+
+    return tx_wait(ser, seq, deadline);
+}
+
+int32_t ser_get_fd(ser_t *ser, ser_fd_t *fd)
+{
+    if (ser->rx != NULL)
+    {
+        sererr_set("Not available with background reception");
+        return SER_ENOTSUP;
+    }
+
+    *fd = ser->fd;
+
+    return 0;
+}
+
+int32_t ser_try_read(ser_t *ser, void *buf, size_t sz, size_t *recvd)
+{
+    /* blocking mode: only request the bytes already queued, so that the
+     * read completes immediately */
+    if (ser->blocking)
+    {
+        int32_t r;
+
+        r = port_read_queued(ser, &sz);
+        if (r < 0)
+        {
+            return r;
+        }
+
+        if (sz == 0U)
+        {
+            return perr_setc(EAGAIN);
+        }
+    }
+
+    /* reads never wait (port is non-blocking, ring reads do not block) */
+    return ser_read(ser, buf, sz, recvd);
+}
+
+int32_t ser_try_write(ser_t *ser, const void *buf, size_t sz, size_t *sent)
 {
     int32_t r = 0;
 
-    ssize_t recvd_;
+    ssize_t sent_;
 
-    recvd_ = read(ser->fd, buf, sz);
+    if (sent != NULL)
+    {
+        *sent = 0U;
+    }
 
-    if (recvd_ > 0)
+    if (sz == 0U)
     {
-        /* optionally store read bytes */
-        if (recvd != NULL)
+        return 0;
+    }
+
+    /* asynchronous transmission: queue the whole buffer (never waits) */
+    if (ser->tx != NULL)
+    {
+        ser_iov_t iov;
+
+        iov.buf = (void *)buf;
+        iov.sz = sz;
+
+        r = tx_enqueue(ser, &iov, 1U, 0U, NULL, NULL, NULL, NULL, NULL);
+        if (r == 0)
         {
-            *recvd = (size_t)recvd_;
+            ser->wrote = true;
+
+            if (sent != NULL)
+            {
+                *sent = sz;
+            }
+        }
+
+        return r;
+    }
+
+    /* only the bytes the pacing allows right now */
+    if (ser->pace != NULL)
+    {
+        int64_t wait;
+        size_t allowed;
+
+        allowed = pace_allow(ser, sz, &wait);
+        if (allowed == 0U)
+        {
+            sererr_set("Transmit pacing does not allow bytes now");
+            return SER_EBUSY;
+        }
+
+        sz = allowed;
+    }
+
+    sent_ = write(ser->fd, buf, sz);
+
+    if (sent_ > 0)
+    {
+        ser->wrote = true;
+
+        if (ser->pace != NULL)
+        {
+            pace_consume(ser, (size_t)sent_);
+        }
+
+        if (sent != NULL)
+        {
+            *sent = (size_t)sent_;
         }
     }
-    else if (recvd_ == 0)
+    else if ((sent_ < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
     {
-        r = error_set(EIO);
+        sererr_set("Port cannot accept bytes now");
+        r = SER_EBUSY;
     }
     else
     {
-        r = error_set(errno);
+        r = perr_setc((sent_ == 0) ? EIO : errno);
     }
 
     return r;
 }
 
-int32_t ser_write(ser_t *ser, const void *buf, size_t sz, size_t *sent)
+int32_t ser_write_some(ser_t *ser, const void *buf, size_t sz, size_t *sent,
+                       const ser_deadline_t *deadline)
 {
     int32_t r;
 
-    size_t sent_ = 0;
-    const uint8_t *bufc = buf;
-    int timeout = ser->timeouts.wr;
-    bool stop;
+    deadline_lazy_t dl;
+
+    *sent = 0U;
 
-    stop = false;
-    while (stop == false)
+    if (ser->tx != NULL)
     {
-        /* wait until write is available */
-        r = port_wait_ready(ser, SER_OP_WR, &timeout);
-        if (r < 0)
-        {
-            stop = true;
-        }
-        else
-        {
-            ssize_t sent_now;
+        sererr_set("Not available with asynchronous transmission");
+        return SER_ENOTSUP;
+    }
+
+    if (deadline != NULL)
+    {
+        dl.deadline = *deadline;
+        dl.timeout = SER_NO_TIMEOUT;
+        dl.valid = true;
+    }
 
-            /* write remaining bytes */
-            sent_now = write(ser->fd, bufc + sent_, sz - sent_);
+    for (;;)
+    {
+        /* wait for the pacing to allow bytes (if allowed to wait) */
+        if ((ser->pace != NULL) && (deadline != NULL))
+        {
+            struct iovec siov;
+            int cnt = 1;
 
-            sent_ += (size_t)sent_now;
+            siov.iov_base = (void *)buf;
+            siov.iov_len = sz;
 
-            /* write available but no data written: device disconnected */
-            if ((sent_now < 1) && (errno != EAGAIN))
+            r = port_pace(ser, &siov, &cnt, &dl);
+            if (r < 0)
             {
-                error_set(EIO);
-                stop = true;
+                break;
             }
-            else
+
+            if (cnt == 0)
             {
-                /* finished */
-                if (sent_ == sz)
-                {
-                    r = 0;
-                    stop = true;
-                }
+                continue;
             }
         }
+
+        r = ser_try_write(ser, buf, sz, sent);
+        if ((r != SER_EBUSY) || (deadline == NULL))
+        {
+            break;
+        }
+
+        /* port is full: wait until write is available */
+        r = port_wait_ready(ser, SER_OP_WR, deadline);
+        if (r < 0)
+        {
+            break;
+        }
     }
 
-    /* optionally store sent bytes */
-    if (sent != NULL)
+    /* nothing accepted is not an error if not allowed to wait */
+    if ((r == SER_EBUSY) && (deadline == NULL))
     {
-        *sent = sent_;
+        r = 0;
     }
 
     return r;
@@ -0,0 +1,559 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "public/sercomm/cyclic.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef __linux__
+# include <sys/prctl.h>
+# include <sys/timerfd.h>
+#endif
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+#include "sercomm/posix/notify.h"
+#include "sercomm/posix/rt.h"
+#include "sercomm/posix/time.h"
+#include "sercomm/posix/wait.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Cache line size (bytes). */
+#define CACHE_LINE      64U
+
+/** Delay of the first release after start (ns). */
+#define START_DELAY     1000000
+
+/** Cyclic exchange. */
+typedef struct
+{
+    /** Library instance */
+    ser_t *ser;
+    /** Options */
+    ser_cyclic_opts_t opts;
+    /** Request buffer */
+    uint8_t *req;
+    /** Response buffer */
+    uint8_t *rsp;
+    /** Next release (ns) */
+    int64_t next;
+    /** Cycle number of the next release */
+    uint64_t cycle;
+    /** Statistics */
+    ser_cyclic_stats_t stats;
+} exchange_t;
+
+/** Cyclic executor. */
+struct ser_cyclic
+{
+    /** Real-time configuration */
+    ser_rt_t rt;
+    /** Exchanges */
+    exchange_t *xs;
+    /** Number of exchanges */
+    size_t cnt;
+    /** Executor thread */
+    pthread_t td;
+    /** Executor thread is running */
+    bool running;
+    /** Stop requested */
+    bool stop;
+    /** Stop notifier (interrupts the wait for the next release) */
+    notifier_t wake;
+#ifdef __linux__
+    /** Release timer (absolute) */
+    int tfd;
+#endif
+    /** Statistics lock */
+    pthread_mutex_t lock;
+};
+
+/**
+ * Obtain the jitter histogram bucket of a release.
+ *
+ * @param [in] jitter
+ *      Release jitter (ns).
+ *
+ * @return
+ *      Histogram bucket.
+ */
+static size_t cyclic_bucket(int64_t jitter)
+{
+    int64_t us = jitter / 1000;
+    size_t bucket = 0U;
+
+    while ((us > 0) && (bucket < (SER_CYCLIC_HIST_SZ - 1U)))
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/**
+ * Run the exchange of a release, and schedule the next one.
+ *
+ * @param [in] cy
+ *      Executor.
+ * @param [in, out] x
+ *      Exchange.
+ */
+static void cyclic_run(ser_cyclic_t *cy, exchange_t *x)
+{
+    int32_t r;
+
+    const ser_cyclic_opts_t *opts = &x->opts;
+    int64_t period = (int64_t)opts->period_us * 1000;
+    int64_t timeout;
+    int64_t start;
+    int64_t end;
+    int64_t jitter;
+    uint64_t missed = 0U;
+    size_t req_sz = 0U;
+    size_t rsp_sz = 0U;
+
+    start = clock__now_ns();
+    jitter = (start > x->next) ? (start - x->next) : 0;
+
+    r = opts->fill(opts->ctx, x->cycle, x->req, opts->req_max, &req_sz);
+    if ((r == 0) && (req_sz > opts->req_max))
+    {
+        sererr_set("Request does not fit in the buffer");
+        r = SER_EINVAL;
+    }
+
+    if ((r == 0) && (req_sz > 0U))
+    {
+        ser_deadline_t deadline;
+
+        /* the response is due by the timeout, counted from the release */
+        timeout = (opts->timeout_us > 0U) ?
+                  ((int64_t)opts->timeout_us * 1000) : period;
+        deadline.sec = (x->next + timeout) / 1000000000;
+        deadline.nsec = (int32_t)((x->next + timeout) % 1000000000);
+
+        if ((opts->transact.framer != NULL) || (opts->transact.rsp_sz > 0U))
+        {
+            r = ser_transact(x->ser, x->req, req_sz, x->rsp, opts->rsp_max,
+                             &opts->transact, &rsp_sz, &deadline);
+        }
+        else
+        {
+            r = ser_write_until(x->ser, x->req, req_sz, NULL, &deadline);
+        }
+    }
+
+    if ((opts->consume != NULL) && ((req_sz > 0U) || (r < 0)))
+    {
+        opts->consume(opts->ctx, x->cycle, r, x->rsp, (r == 0) ? rsp_sz : 0U);
+    }
+
+    end = clock__now_ns();
+
+    /* next release; releases already past are skipped (phase is kept) */
+    x->next += period;
+    x->cycle++;
+
+    if (end > x->next)
+    {
+        missed = (uint64_t)((end - x->next) / period) + 1U;
+        x->next += (int64_t)missed * period;
+        x->cycle += missed;
+    }
+
+    (void)pthread_mutex_lock(&cy->lock);
+
+    x->stats.cycles++;
+    if (r < 0)
+    {
+        x->stats.failures++;
+    }
+
+    if (missed > 0U)
+    {
+        x->stats.overruns++;
+        x->stats.skipped += missed;
+    }
+
+    if (jitter > x->stats.jitter_max_ns)
+    {
+        x->stats.jitter_max_ns = jitter;
+    }
+
+    x->stats.jitter_sum_ns += jitter;
+    x->stats.hist[cyclic_bucket(jitter)]++;
+
+    (void)pthread_mutex_unlock(&cy->lock);
+}
+
+/**
+ * Wait until a release time, or until a stop is requested.
+ *
+ * @note
+ *      On Linux, the release time is armed as an absolute timer (timerfd),
+ *      waited for together with the stop notifier. Elsewhere, the wait
+ *      timeout is computed from the release time.
+ *
+ * @param [in] cy
+ *      Executor.
+ * @param [in] t
+ *      Release time (ns).
+ *
+ * @return
+ *      true if a stop was requested.
+ */
+static bool cyclic_wait(ser_cyclic_t *cy, int64_t t)
+{
+    struct pollfd pfds[2];
+    ser_deadline_t deadline;
+    nfds_t nfds = 1U;
+
+    deadline.sec = t / 1000000000;
+    deadline.nsec = (int32_t)(t % 1000000000);
+
+    pfds[0].fd = cy->wake.rd;
+    pfds[0].events = POLLIN;
+    pfds[0].revents = 0;
+
+#ifdef __linux__
+    {
+        struct itimerspec its;
+
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_sec = (time_t)(t / 1000000000);
+        its.it_value.tv_nsec = (long)(t % 1000000000);
+
+        /* re-arming also clears a previous expiration */
+        if (timerfd_settime(cy->tfd, TFD_TIMER_ABSTIME, &its, NULL) == 0)
+        {
+            const ser_deadline_t never = SER_DEADLINE_NEVER;
+
+            pfds[1].fd = cy->tfd;
+            pfds[1].events = POLLIN;
+            pfds[1].revents = 0;
+            nfds = 2U;
+            deadline = never;
+        }
+    }
+#endif
+
+    if (__atomic_load_n(&cy->stop, __ATOMIC_ACQUIRE))
+    {
+        return true;
+    }
+
+    /* the release time is kept even if the notifier can not be waited on */
+    if (pwait_poll(pfds, nfds, &deadline) < 0)
+    {
+        clock__sleep_until(t);
+    }
+
+    return __atomic_load_n(&cy->stop, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Executor thread.
+ *
+ * @param [in] args
+ *      Executor (ser_cyclic_t).
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *cyclic_thread(void *args)
+{
+    ser_cyclic_t *cy = args;
+
+#ifdef __linux__
+    /* wake-ups are otherwise deferred by up to 50 us (default timer slack of
+     * non real-time threads) */
+    (void)prctl(PR_SET_TIMERSLACK, 1UL);
+#endif
+
+    while (!__atomic_load_n(&cy->stop, __ATOMIC_ACQUIRE))
+    {
+        exchange_t *x = &cy->xs[0];
+        size_t i;
+
+        /* earliest release */
+        for (i = 1U; i < cy->cnt; i++)
+        {
+            if (cy->xs[i].next < x->next)
+            {
+                x = &cy->xs[i];
+            }
+        }
+
+        /* wait for the release, or until a stop is requested */
+        if (cyclic_wait(cy, x->next))
+        {
+            break;
+        }
+
+        cyclic_run(cy, x);
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+ser_cyclic_t *ser_cyclic_create(const ser_rt_t *rt)
+{
+    ser_cyclic_t *cy;
+    ser_rt_t rt_default = SER_RT_INIT;
+
+    cy = calloc(1U, sizeof(*cy));
+    if (cy == NULL)
+    {
+        sererr_set("Could not allocate cyclic executor");
+        return NULL;
+    }
+
+    cy->rt = (rt != NULL) ? *rt : rt_default;
+
+    /* priority inheritance if a real-time thread is used */
+    if (rt_mutex_init(&cy->lock, &cy->rt) != 0)
+    {
+        sererr_set("Could not initialize cyclic executor lock");
+        free(cy);
+        return NULL;
+    }
+
+    return cy;
+}
+
+void ser_cyclic_destroy(ser_cyclic_t *cy)
+{
+    size_t i;
+
+    ser_cyclic_stop(cy);
+
+    for (i = 0U; i < cy->cnt; i++)
+    {
+        rt_mem_free(cy->xs[i].req, cy->xs[i].opts.req_max, &cy->rt);
+        rt_mem_free(cy->xs[i].rsp, cy->xs[i].opts.rsp_max, &cy->rt);
+    }
+
+    rt_mem_free(cy->xs, cy->cnt * sizeof(*cy->xs), &cy->rt);
+
+    (void)pthread_mutex_destroy(&cy->lock);
+
+    free(cy);
+}
+
+int32_t ser_cyclic_add(ser_cyclic_t *cy, ser_t *ser,
+                       const ser_cyclic_opts_t *opts)
+{
+    int32_t r;
+
+    void *mem;
+    exchange_t *xs;
+    exchange_t *x;
+
+    if (cy->running)
+    {
+        sererr_set("Cyclic executor is running");
+        return SER_EBUSY;
+    }
+
+    if ((opts->period_us == 0U) || (opts->phase_us >= opts->period_us) ||
+        (opts->req_max == 0U) || (opts->rsp_max == 0U) ||
+        (opts->fill == NULL))
+    {
+        sererr_set("Invalid cyclic exchange options");
+        return SER_EINVAL;
+    }
+
+    /* exchanges are few: grow by one (keeps them locked if required) */
+    r = rt_mem_alloc(&mem, (cy->cnt + 1U) * sizeof(*xs), CACHE_LINE, &cy->rt);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    xs = mem;
+    if (cy->cnt > 0U)
+    {
+        memcpy(xs, cy->xs, cy->cnt * sizeof(*xs));
+    }
+
+    x = &xs[cy->cnt];
+    x->ser = ser;
+    x->opts = *opts;
+
+    r = rt_mem_alloc(&mem, opts->req_max, CACHE_LINE, &cy->rt);
+    if (r < 0)
+    {
+        goto cleanup_xs;
+    }
+
+    x->req = mem;
+
+    r = rt_mem_alloc(&mem, opts->rsp_max, CACHE_LINE, &cy->rt);
+    if (r < 0)
+    {
+        goto cleanup_req;
+    }
+
+    x->rsp = mem;
+
+    rt_mem_free(cy->xs, cy->cnt * sizeof(*xs), &cy->rt);
+    cy->xs = xs;
+    cy->cnt++;
+
+    return 0;
+
+cleanup_req:
+    rt_mem_free(x->req, opts->req_max, &cy->rt);
+
+cleanup_xs:
+    rt_mem_free(xs, (cy->cnt + 1U) * sizeof(*xs), &cy->rt);
+
+    return r;
+}
+
+int32_t ser_cyclic_start(ser_cyclic_t *cy)
+{
+    int32_t r;
+
+    int pr;
+    int64_t t0;
+    size_t i;
+
+    if (cy->running)
+    {
+        sererr_set("Cyclic executor is running");
+        return SER_EBUSY;
+    }
+
+    if (cy->cnt == 0U)
+    {
+        sererr_set("No cyclic exchanges");
+        return SER_EINVAL;
+    }
+
+    /* common time base, so that phase offsets are relative to each other */
+    t0 = clock__now_ns() + START_DELAY;
+
+    for (i = 0U; i < cy->cnt; i++)
+    {
+        exchange_t *x = &cy->xs[i];
+
+        x->next = t0 + ((int64_t)x->opts.phase_us * 1000);
+        x->cycle = 0U;
+        memset(&x->stats, 0, sizeof(x->stats));
+    }
+
+    cy->stop = false;
+
+    if (notifier_open(&cy->wake) < 0)
+    {
+        return perr_setc(errno);
+    }
+
+#ifdef __linux__
+    cy->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (cy->tfd < 0)
+    {
+        r = perr_setc(errno);
+        goto cleanup_wake;
+    }
+#endif
+
+    pr = rt_thread_create(&cy->td, &cy->rt, cyclic_thread, cy);
+    if (pr != 0)
+    {
+        sererr_set("Could not start cyclic executor thread: %s", strerror(pr));
+        r = SER_EFAIL;
+        goto cleanup_tfd;
+    }
+
+    cy->running = true;
+
+    return 0;
+
+cleanup_tfd:
+#ifdef __linux__
+    (void)close(cy->tfd);
+
+cleanup_wake:
+#endif
+    notifier_close(&cy->wake);
+
+    return r;
+}
+
+void ser_cyclic_stop(ser_cyclic_t *cy)
+{
+    if (!cy->running)
+    {
+        return;
+    }
+
+    /* interrupt the wait for the next release (exchanges in progress are
+     * completed) */
+    __atomic_store_n(&cy->stop, true, __ATOMIC_RELEASE);
+    notifier_signal(&cy->wake);
+    (void)pthread_join(cy->td, NULL);
+
+    notifier_close(&cy->wake);
+#ifdef __linux__
+    (void)close(cy->tfd);
+#endif
+
+    cy->running = false;
+}
+
+int32_t ser_cyclic_stats(ser_cyclic_t *cy, ser_t *ser,
+                         ser_cyclic_stats_t *stats)
+{
+    size_t i;
+
+    for (i = 0U; i < cy->cnt; i++)
+    {
+        if (cy->xs[i].ser == ser)
+        {
+            (void)pthread_mutex_lock(&cy->lock);
+            *stats = cy->xs[i].stats;
+            (void)pthread_mutex_unlock(&cy->lock);
+
+            return 0;
+        }
+    }
+
+    sererr_set("No cyclic exchange on the port");
+    return SER_EINVAL;
+}
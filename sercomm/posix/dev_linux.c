@@ -34,7 +34,9 @@
 #include <libudev.h>
 
 #include "sercomm/err.h"
+#include "sercomm/posix/rt.h"
 #include "sercomm/posix/time.h"
+#include "sercomm/posix/wait.h"
 
 /*
  * References:
@@ -166,7 +168,6 @@ static void *ser_dev_monitor(void *args)
     struct udev *uinst;
     struct udev_monitor *umon;
     int ufd;
-    int maxfd;
     bool stop;
 
     /* create udev instance */
@@ -190,16 +191,6 @@ static void *ser_dev_monitor(void *args)
 
     ufd = udev_monitor_get_fd(umon);
 
-    /* obtain maximum file descriptor of udev, term. pipe (for select) */
-    if (ufd > mon->pfd[0])
-    {
-        maxfd = ufd;
-    }
-    else
-    {
-        maxfd = mon->pfd[0];
-    }
-
     /* signal successful initialization */
     pthread_mutex_lock(&mon->init_m);
     pthread_cond_signal(&mon->init_cond);
@@ -209,14 +200,16 @@ static void *ser_dev_monitor(void *args)
     stop = false;
     while (stop == false)
     {
-        fd_set fds;
+        struct pollfd pfds[2];
+        const ser_deadline_t never = SER_DEADLINE_NEVER;
         int s;
 
-        FD_ZERO(&fds);
-        FD_SET(ufd, &fds);
-        FD_SET(mon->pfd[0], &fds);
+        pfds[0].fd = ufd;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = mon->pfd[0];
+        pfds[1].events = POLLIN;
 
-        s = select(maxfd + 1, &fds, NULL, NULL, NULL);
+        s = pwait_poll(pfds, 2U, &never);
 
         if (s <= 0)
         {
@@ -226,7 +219,7 @@ static void *ser_dev_monitor(void *args)
         else
         {
             /* we must terminate */
-            if (FD_ISSET(mon->pfd[0], &fds) != 0)
+            if (pfds[1].revents != 0)
             {
                 stop = true;
             }
@@ -376,6 +369,12 @@ void ser_dev_list_destroy(ser_dev_list_t *lst)
 }
 
 ser_dev_mon_t *ser_dev_monitor_init(ser_dev_on_event_t on_event, void *ctx)
+{
+    return ser_dev_monitor_init_ex(on_event, ctx, NULL);
+}
+
+ser_dev_mon_t *ser_dev_monitor_init_ex(ser_dev_on_event_t on_event,
+                                       void *ctx, const ser_rt_t *rt)
 {
     ser_dev_mon_t *mon = NULL;
     bool initialized = false;
@@ -418,7 +417,7 @@ ser_dev_mon_t *ser_dev_monitor_init(ser_dev_on_event_t on_event, void *ctx)
     mon->on_event = on_event;
     mon->ctx = ctx;
 
-    pr = pthread_create(&mon->td, NULL, ser_dev_monitor, mon);
+    pr = rt_thread_create(&mon->td, rt, ser_dev_monitor, mon);
     if (pr != 0)
     {
         sererr_set("%s", strerror(pr));
@@ -32,6 +32,7 @@
 #include <IOKit/serial/IOSerialKeys.h>
 
 #include "sercomm/err.h"
+#include "sercomm/posix/rt.h"
 #include "sercomm/posix/time.h"
 
 /*
@@ -395,6 +396,12 @@ void ser_dev_list_destroy(ser_dev_list_t *lst)
 }
 
 ser_dev_mon_t *ser_dev_monitor_init(ser_dev_on_event_t on_event, void *ctx)
+{
+    return ser_dev_monitor_init_ex(on_event, ctx, NULL);
+}
+
+ser_dev_mon_t *ser_dev_monitor_init_ex(ser_dev_on_event_t on_event,
+                                       void *ctx, const ser_rt_t *rt)
 {
     ser_dev_mon_t *mon = NULL;
     bool initialized = false;
@@ -430,7 +437,7 @@ ser_dev_mon_t *ser_dev_monitor_init(ser_dev_on_event_t on_event, void *ctx)
     mon->on_event = on_event;
     mon->ctx = ctx;
 
-    pr = pthread_create(&mon->td, NULL, ser_dev_monitor, mon);
+    pr = rt_thread_create(&mon->td, rt, ser_dev_monitor, mon);
     if (pr != 0)
     {
         sererr_set("%s", strerror(pr));
@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "public/sercomm/err.h"
+
+#include <string.h>
+#include <errno.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t perr_setc(int code)
+{
+    int32_t r;
+
+    switch (code)
+    {
+        case 0:
+            r = 0;
+            break;
+        case ENOENT:
+            sererr_set("No such device");
+            r = SER_ENODEV;
+            break;
+        case EBUSY:
+            sererr_set("Device is busy");
+            r = SER_EBUSY;
+            break;
+        case EIO:
+        case ENXIO:
+            sererr_set("Device was disconnected");
+            r = SER_EDISCONN;
+            break;
+        case EAGAIN:
+            sererr_set("No bytes available");
+            r = SER_EEMPTY;
+            break;
+        default:
+            sererr_set("%s", strerror(code));
+            r = SER_EFAIL;
+            break;
+    }
+
+    return r;
+}
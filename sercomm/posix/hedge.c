@@ -0,0 +1,746 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/transact.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+#include "sercomm/posix/rx.h"
+#include "sercomm/posix/types.h"
+#include "sercomm/posix/time.h"
+#include "sercomm/posix/wait.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Number of latency samples kept per link. */
+#define HEDGE_WINDOW    256U
+
+/** Number of latency samples needed before the percentile is used. */
+#define HEDGE_WARMUP    32U
+
+/** Percentile refresh period (samples). */
+#define HEDGE_REFRESH   16U
+
+/** Probing period (transactions): a backup link is used right away, so that
+ * its latency keeps being known even if the primary never needs a hedge. */
+#define HEDGE_PROBE     64U
+
+/** Link of a hedged transaction group. */
+typedef struct
+{
+    /** Library instance */
+    ser_t *ser;
+    /** Latency samples (us, ring) */
+    uint32_t samples[HEDGE_WINDOW];
+    /** Number of latency samples taken */
+    uint64_t nsamples;
+    /** A request was abandoned: its response is being drained */
+    bool late;
+    /** Until when the response to the abandoned request is drained */
+    ser_deadline_t late_until;
+    /** Input must be flushed before sending */
+    bool flush;
+    /** Statistics */
+    ser_hedge_link_stats_t stats;
+    /** Transaction: request sent */
+    bool sent;
+    /** Transaction: link failed */
+    bool failed;
+    /** Transaction: bytes pending in the receive ring */
+    bool ready;
+    /** Transaction: request send time (ns) */
+    int64_t sent_at;
+    /** Transaction: response buffer */
+    uint8_t *buf;
+    /** Transaction: bytes received */
+    size_t recvd;
+} link_t;
+
+/** Hedged transaction group. */
+struct ser_hedge
+{
+    /** Links */
+    link_t *links;
+    /** Number of links */
+    size_t cnt;
+    /** Primary link */
+    size_t primary;
+    /** Hedging mode */
+    ser_hedge_mode_t mode;
+    /** Hedging threshold percentile */
+    uint32_t percentile;
+    /** Hedging threshold until enough latencies are known (us) */
+    uint32_t threshold_us;
+    /** Maximum response size */
+    size_t rsp_max;
+    /** Number of transactions */
+    uint64_t transactions;
+    /** Response buffers (one per link) */
+    uint8_t *bufs;
+    /** Poll descriptors (one per link) */
+    struct pollfd *pfds;
+};
+
+/**
+ * Compute the median latency of a link, and its latency at the hedging
+ * percentile.
+ *
+ * @param [in] hg
+ *      Group.
+ * @param [in, out] link
+ *      Link.
+ */
+static void link_percentile(const ser_hedge_t *hg, link_t *link)
+{
+    uint32_t sorted[HEDGE_WINDOW];
+    size_t n;
+    size_t i;
+
+    n = (link->nsamples < HEDGE_WINDOW) ? (size_t)link->nsamples :
+                                          HEDGE_WINDOW;
+
+    /* insertion sort: the window is small */
+    for (i = 0U; i < n; i++)
+    {
+        uint32_t v = link->samples[i];
+        size_t j = i;
+
+        while ((j > 0U) && (sorted[j - 1U] > v))
+        {
+            sorted[j] = sorted[j - 1U];
+            j--;
+        }
+
+        sorted[j] = v;
+    }
+
+    i = (n * hg->percentile) / 100U;
+    if (i >= n)
+    {
+        i = n - 1U;
+    }
+
+    /* never 0: it means "not known" */
+    link->stats.latency_us = (sorted[i] > 0U) ? sorted[i] : 1U;
+    link->stats.median_us = (sorted[n / 2U] > 0U) ? sorted[n / 2U] : 1U;
+}
+
+/**
+ * Record a latency sample.
+ *
+ * @param [in] hg
+ *      Group.
+ * @param [in, out] link
+ *      Link.
+ * @param [in] latency
+ *      Latency (ns).
+ */
+static void link_sample(const ser_hedge_t *hg, link_t *link, int64_t latency)
+{
+    int64_t us = latency / 1000;
+
+    link->samples[link->nsamples % HEDGE_WINDOW] =
+        (us > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)us;
+    link->nsamples++;
+
+    if ((link->nsamples >= HEDGE_WARMUP) &&
+        ((link->nsamples % HEDGE_REFRESH) == 0U))
+    {
+        link_percentile(hg, link);
+    }
+}
+
+/**
+ * Obtain the latency used to order and hedge links.
+ *
+ * @param [in] hg
+ *      Group.
+ * @param [in] link
+ *      Link.
+ *
+ * @return
+ *      Latency (us).
+ */
+static uint32_t link_latency(const ser_hedge_t *hg, const link_t *link)
+{
+    return (link->stats.latency_us > 0U) ? link->stats.latency_us :
+                                           hg->threshold_us;
+}
+
+/**
+ * Choose the next link to send the request on.
+ *
+ * @param [in] hg
+ *      Group.
+ *
+ * @return
+ *      Link index, number of links if no link is left (used, or still
+ *      draining a late response).
+ */
+static size_t hedge_next(const ser_hedge_t *hg)
+{
+    size_t next = hg->cnt;
+    size_t i;
+
+    if (!hg->links[hg->primary].sent && !hg->links[hg->primary].late)
+    {
+        return hg->primary;
+    }
+
+    for (i = 0U; i < hg->cnt; i++)
+    {
+        if (!hg->links[i].sent && !hg->links[i].late &&
+            ((next == hg->cnt) || (link_latency(hg, &hg->links[i]) <
+                                   link_latency(hg, &hg->links[next]))))
+        {
+            next = i;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * Send the request on a link.
+ *
+ * @param [in, out] link
+ *      Link.
+ * @param [in] req
+ *      Request.
+ * @param [in] req_sz
+ *      Request size.
+ * @param [in] opts
+ *      Transaction options.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t link_send(link_t *link, const void *req, size_t req_sz,
+                         const ser_transact_opts_t *opts,
+                         const ser_deadline_t *deadline)
+{
+    int32_t r = 0;
+
+    link->sent = true;
+    link->stats.requests++;
+
+    /* drop stale input (e.g. an abandoned response never completed) */
+    if (link->flush || (opts->flush != 0U))
+    {
+        r = ser_flush(link->ser, SER_QUEUE_IN);
+        link->flush = false;
+    }
+
+    link->sent_at = clock__now_ns();
+
+    if (r == 0)
+    {
+        r = ser_write_until(link->ser, req, req_sz, NULL, deadline);
+    }
+
+    if (r < 0)
+    {
+        link->failed = true;
+        link->stats.failures++;
+    }
+
+    return r;
+}
+
+/**
+ * Read the bytes pending on a link.
+ *
+ * @param [in, out] link
+ *      Link.
+ * @param [in] opts
+ *      Transaction options.
+ * @param [in] want
+ *      Number of bytes requested.
+ *
+ * @return
+ *      1 if the response is complete, 0 if more bytes are needed, error code
+ *      otherwise.
+ */
+static int32_t link_read(link_t *link, const ser_transact_opts_t *opts,
+                         size_t want)
+{
+    int32_t r;
+    size_t recvd_now = 0U;
+
+    r = ser_try_read(link->ser, link->buf + link->recvd, want - link->recvd,
+                     &recvd_now);
+    if (r == SER_EEMPTY)
+    {
+        return 0;
+    }
+    else if (r < 0)
+    {
+        return r;
+    }
+
+    link->recvd += recvd_now;
+
+    return transact_check(opts, link->buf, &link->recvd, want);
+}
+
+/**
+ * Account the end of a transaction and choose the primary link.
+ *
+ * @param [in, out] hg
+ *      Group.
+ * @param [in] winner
+ *      Link that answered (number of links if none).
+ * @param [in] deadline
+ *      Transaction deadline.
+ */
+static void hedge_finish(ser_hedge_t *hg, size_t winner,
+                         const ser_deadline_t *deadline)
+{
+    link_t *primary;
+    size_t best = hg->cnt;
+    int64_t now;
+    size_t i;
+
+    now = clock__now_ns();
+
+    for (i = 0U; i < hg->cnt; i++)
+    {
+        link_t *link = &hg->links[i];
+        if (!link->sent || link->failed)
+        {
+            continue;
+        }
+
+        if (i == winner)
+        {
+            link->stats.wins++;
+            link_sample(hg, link, now - link->sent_at);
+            continue;
+        }
+
+        /* abandoned: its latency is sampled once drained */
+        link->late = true;
+        link->late_until = *deadline;
+        link->stats.late++;
+    }
+
+    /* primary: lowest median latency (hedging takes care of the tail),
+     * switching only on a clear improvement (or if the primary failed) */
+    for (i = 0U; i < hg->cnt; i++)
+    {
+        link_t *link = &hg->links[i];
+
+        if (link->failed || (link->stats.median_us == 0U))
+        {
+            continue;
+        }
+
+        if ((best == hg->cnt) ||
+            (link->stats.median_us < hg->links[best].stats.median_us))
+        {
+            best = i;
+        }
+    }
+
+    primary = &hg->links[hg->primary];
+
+    if (primary->failed)
+    {
+        if (best == hg->cnt)
+        {
+            best = (hg->primary + 1U) % hg->cnt;
+        }
+    }
+    else if ((best == hg->cnt) || (primary->stats.median_us == 0U) ||
+             (((uint64_t)hg->links[best].stats.median_us * 4U) >=
+              ((uint64_t)primary->stats.median_us * 3U)))
+    {
+        best = hg->primary;
+    }
+
+    hg->links[hg->primary].stats.primary = 0U;
+    hg->primary = best;
+    hg->links[hg->primary].stats.primary = 1U;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+ser_hedge_t *ser_hedge_create(ser_t *const *links, size_t cnt,
+                              const ser_hedge_opts_t *opts)
+{
+    ser_hedge_t *hg;
+    size_t i;
+
+    if ((cnt < 2U) || (opts->rsp_max == 0U) || (opts->percentile == 0U) ||
+        (opts->percentile > 99U))
+    {
+        sererr_set("Invalid hedged transaction group options");
+        return NULL;
+    }
+
+    hg = calloc(1U, sizeof(*hg));
+    if (hg == NULL)
+    {
+        sererr_set("Could not allocate hedged transaction group");
+        return NULL;
+    }
+
+    hg->links = calloc(cnt, sizeof(*hg->links));
+    hg->bufs = malloc(cnt * opts->rsp_max);
+    hg->pfds = malloc(cnt * sizeof(*hg->pfds));
+    if ((hg->links == NULL) || (hg->bufs == NULL) || (hg->pfds == NULL))
+    {
+        sererr_set("Could not allocate hedged transaction group");
+        ser_hedge_destroy(hg);
+        return NULL;
+    }
+
+    hg->cnt = cnt;
+    hg->mode = opts->mode;
+    hg->percentile = opts->percentile;
+    hg->threshold_us = opts->threshold_us;
+    hg->rsp_max = opts->rsp_max;
+
+    for (i = 0U; i < cnt; i++)
+    {
+        hg->links[i].ser = links[i];
+        hg->links[i].buf = &hg->bufs[i * opts->rsp_max];
+    }
+
+    hg->links[0].stats.primary = 1U;
+
+    return hg;
+}
+
+void ser_hedge_destroy(ser_hedge_t *hg)
+{
+    free(hg->pfds);
+    free(hg->bufs);
+    free(hg->links);
+    free(hg);
+}
+
+int32_t ser_hedge_transact(ser_hedge_t *hg, const void *req, size_t req_sz,
+                           void *rsp, size_t rsp_cap,
+                           const ser_transact_opts_t *opts, size_t *rsp_sz,
+                           size_t *link, const ser_deadline_t *deadline)
+{
+    int32_t r;
+
+    ser_deadline_t hedge_at = SER_DEADLINE_NEVER;
+    ser_deadline_t now;
+    size_t winner = hg->cnt;
+    size_t probe = hg->cnt;
+    size_t want;
+    size_t i;
+
+    r = transact_want(opts, (rsp_cap < hg->rsp_max) ? rsp_cap : hg->rsp_max,
+                      &want);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    /* backup link to probe (links taken in turn) */
+    hg->transactions++;
+    if ((hg->mode == SER_HEDGE_DELAYED) &&
+        ((hg->transactions % HEDGE_PROBE) == 0U))
+    {
+        probe = (hg->primary + 1U +
+                 (size_t)((hg->transactions / HEDGE_PROBE) % (hg->cnt - 1U))) %
+                hg->cnt;
+    }
+
+    now = ser_deadline_in_ns(0);
+
+    for (i = 0U; i < hg->cnt; i++)
+    {
+        link_t *l = &hg->links[i];
+
+        l->sent = false;
+        l->failed = false;
+
+        /* late responses are drained until the deadline of their request,
+         * then flushed */
+        if (l->late && (deadline_cmp(&l->late_until, &now) <= 0))
+        {
+            l->late = false;
+            l->flush = true;
+        }
+
+        if (!l->late)
+        {
+            l->recvd = 0U;
+        }
+    }
+
+    while (winner == hg->cnt)
+    {
+        const ser_deadline_t *wait = deadline;
+        size_t active = 0U;
+        size_t draining = 0U;
+        size_t next;
+        bool ready = false;
+        int s = 0;
+
+        for (i = 0U; i < hg->cnt; i++)
+        {
+            if (hg->links[i].sent && !hg->links[i].failed)
+            {
+                active++;
+            }
+            else if (hg->links[i].late)
+            {
+                draining++;
+            }
+        }
+
+        /* send on the next links: all at once, or until one is active */
+        next = hedge_next(hg);
+        while ((next < hg->cnt) &&
+               ((hg->mode == SER_HEDGE_ALWAYS) || (active == 0U)))
+        {
+            link_t *l = &hg->links[next];
+
+            if (next != hg->primary)
+            {
+                l->stats.hedges++;
+            }
+
+            r = link_send(l, req, req_sz, opts, deadline);
+            if (r == 0)
+            {
+                active++;
+                hedge_at = ser_deadline_in_ns(
+                    (int64_t)link_latency(hg, l) * 1000);
+            }
+
+            next = hedge_next(hg);
+        }
+
+        /* probing: backup link right away (if not busy) */
+        if ((probe < hg->cnt) && !hg->links[probe].sent &&
+            !hg->links[probe].late)
+        {
+            link_t *l = &hg->links[probe];
+
+            l->stats.hedges++;
+            if (link_send(l, req, req_sz, opts, deadline) == 0)
+            {
+                active++;
+            }
+
+            next = hedge_next(hg);
+        }
+
+        probe = hg->cnt;
+
+        /* all links failed (or waiting for late responses to drain) */
+        if ((active == 0U) && (draining == 0U))
+        {
+            if (r == 0)
+            {
+                sererr_set("No link available");
+                r = SER_EFAIL;
+            }
+
+            break;
+        }
+
+        /* wake up to hedge if links are left */
+        if ((next < hg->cnt) && (deadline_cmp(&hedge_at, deadline) < 0))
+        {
+            wait = &hedge_at;
+        }
+
+        for (i = 0U; i < hg->cnt; i++)
+        {
+            link_t *l = &hg->links[i];
+
+            hg->pfds[i].fd = -1;
+            hg->pfds[i].events = 0;
+            hg->pfds[i].revents = 0;
+            l->ready = false;
+
+            if ((!l->sent || l->failed) && !l->late)
+            {
+                continue;
+            }
+
+            if (l->ser->rx != NULL)
+            {
+                l->ready = rx_wait_arm(l->ser, &hg->pfds[i]);
+                ready = ready || l->ready;
+            }
+            else
+            {
+                hg->pfds[i].fd = l->ser->fd;
+                hg->pfds[i].events = POLLIN;
+            }
+        }
+
+        if (!ready)
+        {
+            s = pwait_poll(hg->pfds, (nfds_t)hg->cnt, wait);
+        }
+
+        for (i = 0U; i < hg->cnt; i++)
+        {
+            link_t *l = &hg->links[i];
+
+            if (((l->sent && !l->failed) || l->late) &&
+                (l->ser->rx != NULL))
+            {
+                rx_wait_disarm(l->ser, &hg->pfds[i]);
+            }
+        }
+
+        if (s < 0)
+        {
+            r = perr_setc(errno);
+            break;
+        }
+
+        if ((s == 0) && !ready)
+        {
+            now = ser_deadline_in_ns(0);
+            if (deadline_cmp(deadline, &now) <= 0)
+            {
+                sererr_set("Operation timed out");
+                r = SER_ETIMEDOUT;
+                break;
+            }
+
+            /* hedging threshold elapsed: send on the next link */
+            if ((next < hg->cnt) && (deadline_cmp(&hedge_at, &now) <= 0))
+            {
+                link_t *l = &hg->links[next];
+
+                l->stats.hedges++;
+                r = link_send(l, req, req_sz, opts, deadline);
+                if (r == 0)
+                {
+                    hedge_at = ser_deadline_in_ns(
+                        (int64_t)link_latency(hg, l) * 1000);
+                }
+            }
+
+            continue;
+        }
+
+        for (i = 0U; (i < hg->cnt) && (winner == hg->cnt); i++)
+        {
+            link_t *l = &hg->links[i];
+            int32_t rl;
+
+            if ((hg->pfds[i].fd < 0) && !l->ready)
+            {
+                continue;
+            }
+
+            if (!l->ready && (hg->pfds[i].revents == 0))
+            {
+                continue;
+            }
+
+            rl = link_read(l, opts, want);
+
+            /* late response: sample and drop it, the link can be used
+             * again */
+            if (l->late)
+            {
+                if (rl > 0)
+                {
+                    link_sample(hg, l, clock__now_ns() - l->sent_at);
+                }
+
+                if (rl != 0)
+                {
+                    l->late = false;
+                    l->flush = (rl < 0);
+                    l->recvd = 0U;
+                }
+
+                continue;
+            }
+
+            r = rl;
+            if (r > 0)
+            {
+                winner = i;
+            }
+            else if (r < 0)
+            {
+                l->failed = true;
+                l->stats.failures++;
+            }
+        }
+    }
+
+    hedge_finish(hg, winner, deadline);
+
+    if (winner == hg->cnt)
+    {
+        return r;
+    }
+
+    memcpy(rsp, hg->links[winner].buf, hg->links[winner].recvd);
+
+    if (rsp_sz != NULL)
+    {
+        *rsp_sz = hg->links[winner].recvd;
+    }
+
+    if (link != NULL)
+    {
+        *link = winner;
+    }
+
+    return 0;
+}
+
+int32_t ser_hedge_stats(ser_hedge_t *hg, size_t link,
+                        ser_hedge_link_stats_t *stats)
+{
+    if (link >= hg->cnt)
+    {
+        sererr_set("Invalid link");
+        return SER_EINVAL;
+    }
+
+    *stats = hg->links[link].stats;
+
+    return 0;
+}
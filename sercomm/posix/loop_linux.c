@@ -0,0 +1,725 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "public/sercomm/loop.h"
+#include "public/sercomm/comms.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/types.h"
+#include "sercomm/posix/time.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Maximum number of events retrieved on each wait. */
+#define LOOP_EVTS_MAX   64
+
+/** Invalid heap index (entry has no timeout). */
+#define HEAP_NONE       ((size_t)-1)
+
+/** Event loop entry (registered port). */
+struct ser_loop_ent
+{
+    /** Port (NULL if removed) */
+    ser_t *ser;
+    /** Callback */
+    ser_loop_on_event_t on_event;
+    /** Callback context */
+    void *ctx;
+    /** Events of interest */
+    uint32_t events;
+    /** Inactivity timeout (ms) */
+    int32_t timeout;
+    /** Absolute timeout deadline (ns, monotonic) */
+    int64_t deadline;
+    /** Position in the timeouts heap */
+    size_t heap_idx;
+    /** Previous entry */
+    struct ser_loop_ent *prev;
+    /** Next entry */
+    struct ser_loop_ent *next;
+};
+
+/** Event loop (Linux). */
+struct ser_loop
+{
+    /** epoll file descriptor */
+    int efd;
+    /** Stop request event file descriptor */
+    int sfd;
+    /** Stop requested */
+    int stop;
+    /** Dispatching events (removed entries can not be freed) */
+    bool dispatching;
+    /** Registered entries */
+    struct ser_loop_ent *ents;
+    /** Removed entries pending to be freed */
+    struct ser_loop_ent *zombies;
+    /** Timeouts heap (earliest deadline first) */
+    struct ser_loop_ent **heap;
+    /** Timeouts heap size */
+    size_t heap_sz;
+    /** Timeouts heap capacity */
+    size_t heap_cap;
+};
+
+/**
+ * Swap two heap positions.
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] a
+ *      Heap position.
+ * @param [in] b
+ *      Heap position.
+ */
+static void heap_swap(ser_loop_t *loop, size_t a, size_t b)
+{
+    struct ser_loop_ent *tmp;
+
+    tmp = loop->heap[a];
+    loop->heap[a] = loop->heap[b];
+    loop->heap[b] = tmp;
+
+    loop->heap[a]->heap_idx = a;
+    loop->heap[b]->heap_idx = b;
+}
+
+/**
+ * Restore heap ordering for the given position.
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] idx
+ *      Heap position.
+ */
+static void heap_fix(ser_loop_t *loop, size_t idx)
+{
+    /* sift up */
+    while ((idx > 0U) &&
+           (loop->heap[idx]->deadline < loop->heap[(idx - 1U) / 2U]->deadline))
+    {
+        heap_swap(loop, idx, (idx - 1U) / 2U);
+        idx = (idx - 1U) / 2U;
+    }
+
+    /* sift down */
+    while (1)
+    {
+        size_t l = (2U * idx) + 1U;
+        size_t r = l + 1U;
+        size_t min = idx;
+
+        if ((l < loop->heap_sz) &&
+            (loop->heap[l]->deadline < loop->heap[min]->deadline))
+        {
+            min = l;
+        }
+
+        if ((r < loop->heap_sz) &&
+            (loop->heap[r]->deadline < loop->heap[min]->deadline))
+        {
+            min = r;
+        }
+
+        if (min == idx)
+        {
+            break;
+        }
+
+        heap_swap(loop, idx, min);
+        idx = min;
+    }
+}
+
+/**
+ * Remove an entry from the timeouts heap (if present).
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] ent
+ *      Entry.
+ */
+static void heap_remove(ser_loop_t *loop, struct ser_loop_ent *ent)
+{
+    size_t idx = ent->heap_idx;
+
+    if (idx == HEAP_NONE)
+    {
+        return;
+    }
+
+    loop->heap_sz--;
+    if (idx != loop->heap_sz)
+    {
+        loop->heap[idx] = loop->heap[loop->heap_sz];
+        loop->heap[idx]->heap_idx = idx;
+        heap_fix(loop, idx);
+    }
+
+    ent->heap_idx = HEAP_NONE;
+}
+
+/**
+ * (Re)arm entry timeout.
+ *
+ * @param [in] loop
+ *      Event loop.
+ * @param [in] ent
+ *      Entry.
+ * @param [in] now
+ *      Current time (ns).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t ent_arm(ser_loop_t *loop, struct ser_loop_ent *ent, int64_t now)
+{
+    if (ent->timeout == SER_NO_TIMEOUT)
+    {
+        heap_remove(loop, ent);
+        return 0;
+    }
+
+    ent->deadline = now + ((int64_t)ent->timeout * 1000000LL);
+
+    if (ent->heap_idx == HEAP_NONE)
+    {
+        /* grow heap if necessary */
+        if (loop->heap_sz == loop->heap_cap)
+        {
+            struct ser_loop_ent **heap;
+            size_t cap;
+
+            cap = (loop->heap_cap == 0U) ? 16U : (2U * loop->heap_cap);
+            heap = realloc(loop->heap, cap * sizeof(*heap));
+            if (heap == NULL)
+            {
+                sererr_set("%s", strerror(errno));
+                return SER_EFAIL;
+            }
+
+            loop->heap = heap;
+            loop->heap_cap = cap;
+        }
+
+        ent->heap_idx = loop->heap_sz;
+        loop->heap[loop->heap_sz++] = ent;
+    }
+
+    heap_fix(loop, ent->heap_idx);
+
+    return 0;
+}
+
+/**
+ * Map event loop flags to epoll events.
+ *
+ * @param [in] events
+ *      Event loop flags.
+ *
+ * @return
+ *      epoll events.
+ */
+static uint32_t events_to_epoll(uint32_t events)
+{
+    uint32_t eevents = 0U;
+
+    if ((events & SER_LOOP_EVT_RD) != 0U)
+    {
+        eevents |= EPOLLIN;
+    }
+
+    if ((events & SER_LOOP_EVT_WR) != 0U)
+    {
+        eevents |= EPOLLOUT;
+    }
+
+    return eevents;
+}
+
+/**
+ * Map epoll events to event loop flags.
+ *
+ * @param [in] eevents
+ *      epoll events.
+ *
+ * @return
+ *      Event loop flags.
+ */
+static uint32_t events_from_epoll(uint32_t eevents)
+{
+    uint32_t events = 0U;
+
+    if ((eevents & EPOLLIN) != 0U)
+    {
+        events |= SER_LOOP_EVT_RD;
+    }
+
+    if ((eevents & EPOLLOUT) != 0U)
+    {
+        events |= SER_LOOP_EVT_WR;
+    }
+
+    if ((eevents & (EPOLLERR | EPOLLHUP)) != 0U)
+    {
+        events |= SER_LOOP_EVT_ERR;
+    }
+
+    return events;
+}
+
+/**
+ * Validate timeout and events of interest.
+ *
+ * @param [in] events
+ *      Events of interest.
+ * @param [in] timeout
+ *      Timeout (ms).
+ *
+ * @return
+ *      0 if valid, error code otherwise.
+ */
+static int32_t check_args(uint32_t events, int32_t timeout)
+{
+    if ((events & ~(SER_LOOP_EVT_RD | SER_LOOP_EVT_WR)) != 0U)
+    {
+        sererr_set("Invalid events of interest");
+        return SER_EINVAL;
+    }
+
+    if (timeout < 0)
+    {
+        sererr_set("Invalid timeout");
+        return SER_EINVAL;
+    }
+
+    return 0;
+}
+
+/**
+ * Free removed entries.
+ *
+ * @param [in] loop
+ *      Event loop.
+ */
+static void zombies_free(ser_loop_t *loop)
+{
+    while (loop->zombies != NULL)
+    {
+        struct ser_loop_ent *tmp;
+
+        tmp = loop->zombies->next;
+        free(loop->zombies);
+        loop->zombies = tmp;
+    }
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+ser_loop_t *ser_loop_create(void)
+{
+    ser_loop_t *loop;
+    struct epoll_event ev;
+
+    loop = calloc(1U, sizeof(*loop));
+    if (loop == NULL)
+    {
+        sererr_set("%s", strerror(errno));
+        goto out;
+    }
+
+    loop->efd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->efd < 0)
+    {
+        sererr_set("%s", strerror(errno));
+        goto cleanup_loop;
+    }
+
+    loop->sfd = eventfd(0U, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (loop->sfd < 0)
+    {
+        sererr_set("%s", strerror(errno));
+        goto cleanup_efd;
+    }
+
+    /* stop event is identified by a NULL entry */
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+
+    if (epoll_ctl(loop->efd, EPOLL_CTL_ADD, loop->sfd, &ev) < 0)
+    {
+        sererr_set("%s", strerror(errno));
+        goto cleanup_sfd;
+    }
+
+    goto out;
+
+cleanup_sfd:
+    close(loop->sfd);
+
+cleanup_efd:
+    close(loop->efd);
+
+cleanup_loop:
+    free(loop);
+    loop = NULL;
+
+out:
+    return loop;
+}
+
+void ser_loop_destroy(ser_loop_t *loop)
+{
+    while (loop->ents != NULL)
+    {
+        (void)ser_loop_del(loop, loop->ents->ser);
+    }
+
+    zombies_free(loop);
+
+    close(loop->sfd);
+    close(loop->efd);
+
+    free(loop->heap);
+    free(loop);
+}
+
+int32_t ser_loop_add(ser_loop_t *loop, ser_t *ser, uint32_t events,
+                     int32_t timeout, ser_loop_on_event_t on_event, void *ctx)
+{
+    int32_t r;
+
+    struct ser_loop_ent *ent;
+    struct epoll_event ev;
+
+    r = check_args(events, timeout);
+    if (r < 0)
+    {
+        goto out;
+    }
+
+    /* the port is drained by the reception thread */
+    if (ser->rx != NULL)
+    {
+        sererr_set("Not available with background reception");
+        r = SER_ENOTSUP;
+        goto out;
+    }
+
+    if (ser->loop_ent != NULL)
+    {
+        sererr_set("Port is already registered");
+        r = SER_EBUSY;
+        goto out;
+    }
+
+    ent = calloc(1U, sizeof(*ent));
+    if (ent == NULL)
+    {
+        sererr_set("%s", strerror(errno));
+        r = SER_EFAIL;
+        goto out;
+    }
+
+    ent->ser = ser;
+    ent->on_event = on_event;
+    ent->ctx = ctx;
+    ent->events = events;
+    ent->timeout = timeout;
+    ent->heap_idx = HEAP_NONE;
+
+    r = ent_arm(loop, ent, clock__now_ns());
+    if (r < 0)
+    {
+        goto cleanup_ent;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events_to_epoll(events);
+    ev.data.ptr = ent;
+
+    if (epoll_ctl(loop->efd, EPOLL_CTL_ADD, ser->fd, &ev) < 0)
+    {
+        sererr_set("%s", strerror(errno));
+        r = SER_EFAIL;
+        goto cleanup_heap;
+    }
+
+    /* link entry */
+    ent->next = loop->ents;
+    if (loop->ents != NULL)
+    {
+        loop->ents->prev = ent;
+    }
+    loop->ents = ent;
+
+    ser->loop_ent = ent;
+
+    goto out;
+
+cleanup_heap:
+    heap_remove(loop, ent);
+
+cleanup_ent:
+    free(ent);
+
+out:
+    return r;
+}
+
+int32_t ser_loop_mod(ser_loop_t *loop, ser_t *ser, uint32_t events,
+                     int32_t timeout)
+{
+    int32_t r;
+
+    struct ser_loop_ent *ent = ser->loop_ent;
+    struct epoll_event ev;
+
+    r = check_args(events, timeout);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    if (ent == NULL)
+    {
+        sererr_set("Port is not registered");
+        return SER_EINVAL;
+    }
+
+    if (events != ent->events)
+    {
+        memset(&ev, 0, sizeof(ev));
+        ev.events = events_to_epoll(events);
+        ev.data.ptr = ent;
+
+        if (epoll_ctl(loop->efd, EPOLL_CTL_MOD, ser->fd, &ev) < 0)
+        {
+            sererr_set("%s", strerror(errno));
+            return SER_EFAIL;
+        }
+
+        ent->events = events;
+    }
+
+    ent->timeout = timeout;
+
+    return ent_arm(loop, ent, clock__now_ns());
+}
+
+int32_t ser_loop_del(ser_loop_t *loop, ser_t *ser)
+{
+    struct ser_loop_ent *ent = ser->loop_ent;
+
+    if (ent == NULL)
+    {
+        sererr_set("Port is not registered");
+        return SER_EINVAL;
+    }
+
+    /* fd may have already been closed, so ignore errors */
+    (void)epoll_ctl(loop->efd, EPOLL_CTL_DEL, ser->fd, NULL);
+
+    heap_remove(loop, ent);
+
+    /* unlink entry */
+    if (ent->prev != NULL)
+    {
+        ent->prev->next = ent->next;
+    }
+    else
+    {
+        loop->ents = ent->next;
+    }
+
+    if (ent->next != NULL)
+    {
+        ent->next->prev = ent->prev;
+    }
+
+    ser->loop_ent = NULL;
+
+    /* entry may still be referenced by pending events if dispatching */
+    ent->ser = NULL;
+    ent->prev = NULL;
+    ent->next = loop->zombies;
+    loop->zombies = ent;
+
+    if (loop->dispatching == false)
+    {
+        zombies_free(loop);
+    }
+
+    return 0;
+}
+
+int32_t ser_loop_run_once(ser_loop_t *loop, int32_t timeout)
+{
+    int32_t r = 0;
+
+    struct epoll_event evs[LOOP_EVTS_MAX];
+    int wait_ms;
+    int n;
+    int i;
+    int64_t now;
+
+    if (timeout < 0)
+    {
+        sererr_set("Invalid timeout");
+        return SER_EINVAL;
+    }
+
+    /* wait until the earliest port deadline (or user timeout) */
+    wait_ms = (timeout == SER_NO_TIMEOUT) ? -1 : (int)timeout;
+
+    if (loop->heap_sz > 0U)
+    {
+        int64_t remaining;
+
+        remaining = loop->heap[0]->deadline - clock__now_ns();
+        if (remaining <= 0)
+        {
+            wait_ms = 0;
+        }
+        else
+        {
+            /* round up, so that timeouts are not reported early */
+            remaining = (remaining + 999999LL) / 1000000LL;
+            if ((wait_ms < 0) || (remaining < (int64_t)wait_ms))
+            {
+                wait_ms = (int)remaining;
+            }
+        }
+    }
+
+    n = epoll_wait(loop->efd, evs, LOOP_EVTS_MAX, wait_ms);
+    if (n < 0)
+    {
+        if (errno != EINTR)
+        {
+            sererr_set("%s", strerror(errno));
+            return SER_EFAIL;
+        }
+
+        n = 0;
+    }
+
+    now = clock__now_ns();
+
+    loop->dispatching = true;
+
+    /* dispatch I/O events */
+    for (i = 0; i < n; i++)
+    {
+        struct ser_loop_ent *ent = evs[i].data.ptr;
+        uint32_t events;
+
+        /* stop request */
+        if (ent == NULL)
+        {
+            uint64_t cnt;
+
+            (void)read(loop->sfd, &cnt, sizeof(cnt));
+            continue;
+        }
+
+        /* removed by a previous callback */
+        if (ent->ser == NULL)
+        {
+            continue;
+        }
+
+        events = events_from_epoll(evs[i].events) &
+                 (ent->events | SER_LOOP_EVT_ERR);
+        if (events == 0U)
+        {
+            continue;
+        }
+
+        if (ent->heap_idx != HEAP_NONE)
+        {
+            (void)ent_arm(loop, ent, now);
+        }
+
+        ent->on_event(ent->ctx, ent->ser, events);
+        r++;
+    }
+
+    /* dispatch expired timeouts */
+    while ((loop->heap_sz > 0U) && (loop->heap[0]->deadline <= now))
+    {
+        struct ser_loop_ent *ent = loop->heap[0];
+
+        (void)ent_arm(loop, ent, now);
+
+        ent->on_event(ent->ctx, ent->ser, SER_LOOP_EVT_TIMEOUT);
+        r++;
+    }
+
+    loop->dispatching = false;
+
+    zombies_free(loop);
+
+    return r;
+}
+
+int32_t ser_loop_run(ser_loop_t *loop)
+{
+    int32_t r = 0;
+
+    while (__atomic_load_n(&loop->stop, __ATOMIC_ACQUIRE) == 0)
+    {
+        r = ser_loop_run_once(loop, SER_NO_TIMEOUT);
+        if (r < 0)
+        {
+            break;
+        }
+
+        r = 0;
+    }
+
+    __atomic_store_n(&loop->stop, 0, __ATOMIC_RELEASE);
+
+    return r;
+}
+
+void ser_loop_stop(ser_loop_t *loop)
+{
+    uint64_t cnt = 1U;
+
+    __atomic_store_n(&loop->stop, 1, __ATOMIC_RELEASE);
+    (void)write(loop->sfd, &cnt, sizeof(cnt));
+}
@@ -0,0 +1,350 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/posix/lowlat.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#ifdef __linux__
+# include <linux/serial.h>
+#endif
+
+#include "sercomm/err.h"
+#include "sercomm/posix/types.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** USB-serial adapter latency timer applied by the profile (ms). */
+#define LATENCY_TIMER   1
+
+/** Low-latency profile context. */
+struct ser_lowlat
+{
+    /** Applied knobs (SER_LOWLAT_*) */
+    uint32_t applied;
+    /** Previous serial driver flags */
+    int flags;
+    /** Previous latency timer value */
+    char latency_timer[16];
+    /** Latency timer attribute path */
+    char latency_timer_path[PATH_MAX];
+    /** Previous USB power control value */
+    char power_control[16];
+    /** USB power control attribute path */
+    char power_control_path[PATH_MAX];
+};
+
+#ifdef __linux__
+/**
+ * Read a sysfs attribute.
+ *
+ * @param [in] path
+ *      Attribute path.
+ * @param [out] value
+ *      Value (trailing new line removed).
+ * @param [in] value_sz
+ *      Value buffer size.
+ *
+ * @return
+ *      true on success, false otherwise.
+ */
+static bool attr_read(const char *path, char *value, size_t value_sz)
+{
+    FILE *f;
+    bool ok;
+
+    f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    ok = (fgets(value, (int)value_sz, f) != NULL);
+    fclose(f);
+
+    if (ok)
+    {
+        value[strcspn(value, "\n")] = '\0';
+    }
+
+    return ok;
+}
+
+/**
+ * Write a sysfs attribute.
+ *
+ * @param [in] path
+ *      Attribute path.
+ * @param [in] value
+ *      Value.
+ *
+ * @return
+ *      true on success, false otherwise.
+ */
+static bool attr_write(const char *path, const char *value)
+{
+    FILE *f;
+    bool ok;
+
+    f = fopen(path, "w");
+    if (f == NULL)
+    {
+        return false;
+    }
+
+    ok = (fputs(value, f) >= 0);
+
+    /* sysfs reports errors when the value is flushed */
+    if (fclose(f) != 0)
+    {
+        ok = false;
+    }
+
+    return ok;
+}
+
+/**
+ * Obtain the kernel name of the port (e.g. ttyUSB0).
+ *
+ * @param [in] port
+ *      Port path (may be a symbolic link, e.g. /dev/serial/by-id/...).
+ * @param [out] name
+ *      Kernel name.
+ * @param [in] name_sz
+ *      Name buffer size.
+ *
+ * @return
+ *      true on success, false otherwise.
+ */
+static bool port_name(const char *port, char *name, size_t name_sz)
+{
+    char path[PATH_MAX];
+    const char *base;
+
+    if (realpath(port, path) == NULL)
+    {
+        return false;
+    }
+
+    base = strrchr(path, '/');
+    base = (base != NULL) ? base + 1 : path;
+
+    return (snprintf(name, name_sz, "%s", base) < (int)name_sz);
+}
+
+/**
+ * Set the low-latency flag of the serial driver (ASYNC_LOW_LATENCY).
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ */
+static void async_apply(ser_t *ser)
+{
+    struct serial_struct lser;
+
+    if (ioctl(ser->fd, TIOCGSERIAL, &lser) < 0)
+    {
+        return;
+    }
+
+    ser->lowlat->flags = lser.flags;
+    lser.flags |= ASYNC_LOW_LATENCY;
+
+    if (ioctl(ser->fd, TIOCSSERIAL, &lser) == 0)
+    {
+        ser->lowlat->applied |= SER_LOWLAT_ASYNC;
+    }
+}
+
+/**
+ * Set the latency timer of the USB-serial adapter (e.g. FTDI).
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] name
+ *      Port kernel name.
+ */
+static void latency_timer_apply(ser_t *ser, const char *name)
+{
+    struct ser_lowlat *ll = ser->lowlat;
+    char value[16];
+
+    (void)snprintf(ll->latency_timer_path, sizeof(ll->latency_timer_path),
+                   "/sys/bus/usb-serial/devices/%s/latency_timer", name);
+
+    if (!attr_read(ll->latency_timer_path, ll->latency_timer,
+                   sizeof(ll->latency_timer)))
+    {
+        return;
+    }
+
+    (void)snprintf(value, sizeof(value), "%d", LATENCY_TIMER);
+
+    if (attr_write(ll->latency_timer_path, value))
+    {
+        ll->applied |= SER_LOWLAT_LATENCY_TIMER;
+    }
+}
+
+/**
+ * Disable autosuspend of the USB device the port belongs to.
+ *
+ * @param [in] ser
+ *      Opened library instance.
+ * @param [in] name
+ *      Port kernel name.
+ */
+static void autosuspend_apply(ser_t *ser, const char *name)
+{
+    struct ser_lowlat *ll = ser->lowlat;
+    char link[PATH_MAX];
+    char dev[PATH_MAX];
+    char attr[PATH_MAX];
+
+    (void)snprintf(link, sizeof(link), "/sys/class/tty/%s/device", name);
+    if (realpath(link, dev) == NULL)
+    {
+        return;
+    }
+
+    /* walk up from the port device (interface) to the USB device */
+    for (;;)
+    {
+        char *sep;
+
+        if ((snprintf(attr, sizeof(attr), "%s/idVendor", dev) <
+             (int)sizeof(attr)) && (access(attr, F_OK) == 0))
+        {
+            break;
+        }
+
+        sep = strrchr(dev, '/');
+        if ((sep == NULL) || (sep == dev))
+        {
+            return;
+        }
+
+        *sep = '\0';
+    }
+
+    if (snprintf(ll->power_control_path, sizeof(ll->power_control_path),
+                 "%s/power/control", dev) >= (int)sizeof(ll->power_control_path))
+    {
+        return;
+    }
+
+    if (!attr_read(ll->power_control_path, ll->power_control,
+                   sizeof(ll->power_control)))
+    {
+        return;
+    }
+
+    if (attr_write(ll->power_control_path, "on"))
+    {
+        ll->applied |= SER_LOWLAT_NO_AUTOSUSPEND;
+    }
+}
+#endif
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t lowlat_apply(ser_t *ser, const ser_opts_t *opts)
+{
+#ifdef __linux__
+    char name[NAME_MAX + 1];
+#endif
+
+    ser->lowlat = NULL;
+
+    if (opts->low_latency == 0U)
+    {
+        return 0;
+    }
+
+    ser->lowlat = calloc(1U, sizeof(*ser->lowlat));
+    if (ser->lowlat == NULL)
+    {
+        sererr_set("Could not allocate low-latency context");
+        return SER_EFAIL;
+    }
+
+#ifdef __linux__
+    async_apply(ser);
+
+    if (port_name(opts->port, name, sizeof(name)))
+    {
+        latency_timer_apply(ser, name);
+        autosuspend_apply(ser, name);
+    }
+#endif
+
+    return 0;
+}
+
+uint32_t lowlat_applied(ser_t *ser)
+{
+    return ser->lowlat->applied;
+}
+
+void lowlat_restore(ser_t *ser)
+{
+    struct ser_lowlat *ll = ser->lowlat;
+
+#ifdef __linux__
+    if (ll->applied & SER_LOWLAT_ASYNC)
+    {
+        struct serial_struct lser;
+
+        /* only revert our flag (other flags may have changed meanwhile) */
+        if ((ioctl(ser->fd, TIOCGSERIAL, &lser) == 0) &&
+            ((ll->flags & ASYNC_LOW_LATENCY) == 0))
+        {
+            lser.flags &= ~ASYNC_LOW_LATENCY;
+            (void)ioctl(ser->fd, TIOCSSERIAL, &lser);
+        }
+    }
+
+    if (ll->applied & SER_LOWLAT_LATENCY_TIMER)
+    {
+        (void)attr_write(ll->latency_timer_path, ll->latency_timer);
+    }
+
+    if (ll->applied & SER_LOWLAT_NO_AUTOSUSPEND)
+    {
+        (void)attr_write(ll->power_control_path, ll->power_control);
+    }
+#endif
+
+    free(ll);
+    ser->lowlat = NULL;
+}
@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/posix/notify.h"
+
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef __linux__
+# include <sys/eventfd.h>
+#endif
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int notifier_open(notifier_t *n)
+{
+#ifdef __linux__
+    n->rd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (n->rd < 0)
+    {
+        return -1;
+    }
+
+    n->wr = n->rd;
+#else
+    int fds[2];
+    int i;
+
+    if (pipe(fds) < 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        (void)fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        (void)fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    n->rd = fds[0];
+    n->wr = fds[1];
+#endif
+
+    return 0;
+}
+
+void notifier_close(notifier_t *n)
+{
+    (void)close(n->rd);
+    if (n->wr != n->rd)
+    {
+        (void)close(n->wr);
+    }
+}
+
+void notifier_signal(notifier_t *n)
+{
+    uint64_t v = 1U;
+
+    /* a full pipe (or eventfd) is already signalled, so errors are ignored */
+    (void)!write(n->wr, &v, sizeof(v));
+}
+
+void notifier_clear(notifier_t *n)
+{
+    uint8_t buf[64];
+
+    while (read(n->rd, buf, sizeof(buf)) > 0)
+    {
+    }
+}
@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/posix/pace.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/time.h"
+#include "sercomm/posix/types.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Transmit pacing context (token bucket). */
+struct ser_pace
+{
+    /** Rate (bytes/s) */
+    int64_t rate;
+    /** Burst size (bytes) */
+    int64_t burst;
+    /** Time to fill the bucket (ns) */
+    int64_t fill_ns;
+    /** Time to fill the bucket, plus the credit kept for late writers (ns) */
+    int64_t cap_ns;
+    /** Time at which the bucket was (virtually) empty (ns) */
+    int64_t empty_ns;
+    /** Sub-nanosecond remainder of the consumed time (ns * rate) */
+    int64_t rem;
+    /** A write is waiting for the pacing (already accounted as a delay) */
+    bool delayed;
+    /** Statistics */
+    ser_pace_stats_t stats;
+};
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t pace_start(ser_t *ser, const ser_opts_t *opts)
+{
+    struct ser_pace *pace;
+
+    ser->pace = NULL;
+
+    if (opts->pacing.rate == 0U)
+    {
+        return 0;
+    }
+
+    pace = calloc(1U, sizeof(*pace));
+    if (pace == NULL)
+    {
+        sererr_set("Could not allocate pacing context");
+        return SER_EFAIL;
+    }
+
+    pace->rate = (int64_t)opts->pacing.rate;
+    pace->burst = (opts->pacing.burst > 0U) ? (int64_t)opts->pacing.burst : 1;
+    /* rounded up, so that a full bucket holds a whole burst */
+    pace->fill_ns = ((pace->burst * 1000000000) + pace->rate - 1) /
+                    pace->rate;
+
+    /* a fraction of a byte of credit survives a full bucket: late wake-ups
+     * (timer slack, scheduling) are caught up on without exceeding a burst */
+    pace->cap_ns = pace->fill_ns;
+    if (pace->rate < 1000000000)
+    {
+        pace->cap_ns += (1000000000 / pace->rate) - 1;
+    }
+
+    /* start with a full bucket */
+    pace->empty_ns = clock__now_ns() - pace->fill_ns;
+
+    ser->pace = pace;
+
+    return 0;
+}
+
+void pace_stop(ser_t *ser)
+{
+    free(ser->pace);
+    ser->pace = NULL;
+}
+
+size_t pace_allow(ser_t *ser, size_t sz, int64_t *wait)
+{
+    struct ser_pace *pace = ser->pace;
+    int64_t now;
+    int64_t want;
+    int64_t avail;
+
+    now = clock__now_ns();
+
+    /* the bucket holds a burst at most */
+    if (pace->empty_ns < (now - pace->cap_ns))
+    {
+        pace->empty_ns = now - pace->cap_ns;
+        pace->rem = 0;
+    }
+
+    avail = ((now - pace->empty_ns) * pace->rate) / 1000000000;
+    want = ((int64_t)sz < pace->burst) ? (int64_t)sz : pace->burst;
+
+    if (avail < want)
+    {
+        *wait = pace->empty_ns +
+                ((want * 1000000000) + pace->rate - 1) / pace->rate - now;
+
+        return 0U;
+    }
+
+    if (avail > pace->burst)
+    {
+        avail = pace->burst;
+    }
+
+    return ((int64_t)sz < avail) ? sz : (size_t)avail;
+}
+
+void pace_consume(ser_t *ser, size_t sz)
+{
+    struct ser_pace *pace = ser->pace;
+    int64_t t;
+
+    t = ((int64_t)sz * 1000000000) + pace->rem;
+    pace->empty_ns += t / pace->rate;
+    pace->rem = t % pace->rate;
+    pace->delayed = false;
+
+    __atomic_fetch_add(&pace->stats.bytes, (uint64_t)sz, __ATOMIC_RELAXED);
+}
+
+void pace_delayed(ser_t *ser, int64_t ns)
+{
+    struct ser_pace *pace = ser->pace;
+
+    /* repeated waits of the same write are a single delay */
+    if (!pace->delayed)
+    {
+        __atomic_fetch_add(&pace->stats.delays, 1U, __ATOMIC_RELAXED);
+        pace->delayed = true;
+    }
+
+    __atomic_fetch_add(&pace->stats.delay_ns, (uint64_t)((ns > 0) ? ns : 0),
+                       __ATOMIC_RELAXED);
+}
+
+void pace_stats(ser_t *ser, ser_pace_stats_t *stats)
+{
+    struct ser_pace *pace = ser->pace;
+
+    stats->bytes = __atomic_load_n(&pace->stats.bytes, __ATOMIC_RELAXED);
+    stats->delays = __atomic_load_n(&pace->stats.delays, __ATOMIC_RELAXED);
+    stats->delay_ns = __atomic_load_n(&pace->stats.delay_ns,
+                                      __ATOMIC_RELAXED);
+}
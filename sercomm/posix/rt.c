@@ -0,0 +1,226 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef __linux__
+# define _GNU_SOURCE
+#endif
+
+#include "sercomm/posix/rt.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sercomm/err.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/**
+ * Check if buffers have to be locked in memory.
+ *
+ * @param [in] rt
+ *      Real-time configuration (optional).
+ *
+ * @return
+ *      true if buffers have to be locked, false otherwise.
+ */
+static bool mem_locked(const ser_rt_t *rt)
+{
+    return (rt != NULL) && (rt->lock_memory != 0U);
+}
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int rt_thread_create(pthread_t *td, const ser_rt_t *rt,
+                     void *(*start)(void *), void *arg)
+{
+    int r;
+    pthread_attr_t attr;
+
+    if ((rt == NULL) || ((rt->priority == 0) && (rt->cpus == 0U)))
+    {
+        return pthread_create(td, NULL, start, arg);
+    }
+
+    if ((rt->priority < 0) ||
+        (rt->priority > sched_get_priority_max(SCHED_FIFO)))
+    {
+        return EINVAL;
+    }
+
+    r = pthread_attr_init(&attr);
+    if (r != 0)
+    {
+        return r;
+    }
+
+    if (rt->priority > 0)
+    {
+        struct sched_param param;
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = (int)rt->priority;
+
+        r = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        if (r == 0)
+        {
+            r = pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        }
+
+        if (r == 0)
+        {
+            r = pthread_attr_setschedparam(&attr, &param);
+        }
+    }
+
+    if ((r == 0) && (rt->cpus != 0U))
+    {
+#ifdef __linux__
+        cpu_set_t cpus;
+        unsigned i;
+
+        CPU_ZERO(&cpus);
+        for (i = 0U; i < 64U; i++)
+        {
+            if (rt->cpus & (UINT64_C(1) << i))
+            {
+                CPU_SET(i, &cpus);
+            }
+        }
+
+        r = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+#else
+        r = ENOTSUP;
+#endif
+    }
+
+    if (r == 0)
+    {
+        r = pthread_create(td, &attr, start, arg);
+    }
+
+    (void)pthread_attr_destroy(&attr);
+
+    return r;
+}
+
+int rt_mutex_init(pthread_mutex_t *mtx, const ser_rt_t *rt)
+{
+    int r;
+    pthread_mutexattr_t attr;
+
+    if ((rt == NULL) || (rt->priority == 0))
+    {
+        return pthread_mutex_init(mtx, NULL);
+    }
+
+    /* avoid priority inversion with lower priority threads */
+    r = pthread_mutexattr_init(&attr);
+    if (r != 0)
+    {
+        return r;
+    }
+
+    r = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    if (r == 0)
+    {
+        r = pthread_mutex_init(mtx, &attr);
+    }
+
+    (void)pthread_mutexattr_destroy(&attr);
+
+    return r;
+}
+
+int32_t rt_mem_alloc(void **mem, size_t sz, size_t align, const ser_rt_t *rt)
+{
+    size_t page;
+
+    if (!mem_locked(rt))
+    {
+        if (posix_memalign(mem, align, sz) != 0)
+        {
+            sererr_set("Could not allocate memory");
+            return SER_EFAIL;
+        }
+
+        memset(*mem, 0, sz);
+
+        return 0;
+    }
+
+    /* whole pages: unlocking must not affect other allocations */
+    page = (size_t)sysconf(_SC_PAGESIZE);
+    if (align < page)
+    {
+        align = page;
+    }
+
+    sz = (sz + page - 1U) & ~(page - 1U);
+
+    if (posix_memalign(mem, align, sz) != 0)
+    {
+        sererr_set("Could not allocate memory");
+        return SER_EFAIL;
+    }
+
+    /* prefault (touch every page), then lock */
+    memset(*mem, 0, sz);
+
+    if (mlock(*mem, sz) < 0)
+    {
+        sererr_set("Could not lock memory: %s", strerror(errno));
+        free(*mem);
+        *mem = NULL;
+        return SER_EFAIL;
+    }
+
+    return 0;
+}
+
+void rt_mem_free(void *mem, size_t sz, const ser_rt_t *rt)
+{
+    if (mem == NULL)
+    {
+        return;
+    }
+
+    if (mem_locked(rt))
+    {
+        size_t page;
+
+        page = (size_t)sysconf(_SC_PAGESIZE);
+        (void)munlock(mem, (sz + page - 1U) & ~(page - 1U));
+    }
+
+    free(mem);
+}
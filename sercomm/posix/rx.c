@@ -0,0 +1,672 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/posix/rx.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+#include "sercomm/posix/notify.h"
+#include "sercomm/posix/rt.h"
+#include "sercomm/posix/types.h"
+#include "sercomm/posix/time.h"
+#include "sercomm/posix/wait.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Cache line size (bytes). */
+#define CACHE_LINE      64U
+
+/** Maximum receive ring size (bytes). */
+#define RING_SZ_MAX     ((size_t)1U << 30U)
+
+/** Scratch buffer size, used when bytes are dropped (bytes). */
+#define SCRATCH_SZ      4096U
+
+/** Background reception context. */
+struct ser_rx
+{
+    /** Consumer index (total bytes consumed or dropped) */
+    uint64_t head;
+    /** Padding (keeps producer/consumer indexes on separate lines) */
+    uint8_t pad_head[CACHE_LINE - sizeof(uint64_t)];
+    /** Producer index (total bytes produced) */
+    uint64_t tail;
+    /** Padding */
+    uint8_t pad_tail[CACHE_LINE - sizeof(uint64_t)];
+    /** Consumer is waiting for data */
+    int rd_waiting;
+    /** Producer is waiting for room */
+    int wr_waiting;
+    /** Stop requested */
+    int stop;
+    /** Reception error (errno value, 0 if none) */
+    int err;
+    /** Statistics */
+    ser_rx_stats_t stats;
+    /** Ring buffer */
+    uint8_t *buf;
+    /** Ring buffer size (power of 2) */
+    size_t sz;
+    /** Overflow policy */
+    ser_rx_ovf_t overflow;
+    /** Serial port file descriptor */
+    int fd;
+    /** Data available notifier (producer to consumer) */
+    notifier_t data;
+    /** Wake-up notifier, room available or stop (consumer to producer) */
+    notifier_t wake;
+    /** Reception thread */
+    pthread_t td;
+    /** Real-time configuration */
+    ser_rt_t rt;
+};
+
+/**
+ * Update the high water mark statistic.
+ *
+ * @param [in] rx
+ *      Background reception context.
+ * @param [in] used
+ *      Bytes currently stored in the ring.
+ */
+static void stats_high_water(struct ser_rx *rx, uint64_t used)
+{
+    if (used > __atomic_load_n(&rx->stats.high_water, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(&rx->stats.high_water, used, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Publish produced bytes to the consumer.
+ *
+ * @param [in] rx
+ *      Background reception context.
+ * @param [in] tail
+ *      New producer index.
+ * @param [in] n
+ *      Number of produced bytes.
+ */
+static void ring_publish(struct ser_rx *rx, uint64_t tail, size_t n)
+{
+    __atomic_store_n(&rx->tail, tail, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&rx->stats.bytes, (uint64_t)n, __ATOMIC_RELAXED);
+
+    /* consumer sets rd_waiting before re-checking tail, so either it sees
+     * the new tail or we see its flag */
+    if (__atomic_load_n(&rx->rd_waiting, __ATOMIC_SEQ_CST))
+    {
+        notifier_signal(&rx->data);
+    }
+}
+
+/**
+ * Read from the port directly into the ring free space.
+ *
+ * @param [in] rx
+ *      Background reception context.
+ * @param [in] head
+ *      Consumer index.
+ * @param [in] tail
+ *      Producer index.
+ *
+ * @return
+ *      Number of bytes read, 0 on EOF, -1 on error (errno is set).
+ */
+static ssize_t ring_read_direct(struct ser_rx *rx, uint64_t head,
+                                uint64_t tail)
+{
+    struct iovec iov[2];
+    size_t room;
+    size_t off;
+    ssize_t n;
+
+    room = rx->sz - (size_t)(tail - head);
+    off = (size_t)tail & (rx->sz - 1U);
+
+    iov[0].iov_base = &rx->buf[off];
+    iov[0].iov_len = room < (rx->sz - off) ? room : (rx->sz - off);
+    iov[1].iov_base = rx->buf;
+    iov[1].iov_len = room - iov[0].iov_len;
+
+    n = readv(rx->fd, iov, (iov[1].iov_len > 0U) ? 2 : 1);
+    if (n > 0)
+    {
+        stats_high_water(rx, (tail - head) + (uint64_t)n);
+        ring_publish(rx, tail + (uint64_t)n, (size_t)n);
+    }
+
+    return n;
+}
+
+/**
+ * Read from the port evicting the oldest bytes if required.
+ *
+ * @param [in] rx
+ *      Background reception context.
+ * @param [in] tail
+ *      Producer index.
+ * @param [in] scratch
+ *      Scratch buffer (SCRATCH_SZ bytes).
+ *
+ * @return
+ *      Number of bytes read, 0 on EOF, -1 on error (errno is set).
+ */
+static ssize_t ring_read_evict(struct ser_rx *rx, uint64_t tail,
+                               uint8_t *scratch)
+{
+    uint64_t head;
+    uint64_t need;
+    size_t off;
+    size_t first;
+    ssize_t n;
+
+    n = read(rx->fd, scratch, SCRATCH_SZ < rx->sz ? SCRATCH_SZ : rx->sz);
+    if (n <= 0)
+    {
+        return n;
+    }
+
+    /* make room by advancing the consumer index (consumer may race us) */
+    head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+    do
+    {
+        uint64_t room = (uint64_t)rx->sz - (tail - head);
+
+        need = ((uint64_t)n > room) ? ((uint64_t)n - room) : 0U;
+        if (need == 0U)
+        {
+            break;
+        }
+    } while (!__atomic_compare_exchange_n(&rx->head, &head, head + need,
+                                          false, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_ACQUIRE));
+
+    if (need > 0U)
+    {
+        __atomic_add_fetch(&rx->stats.dropped, need, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&rx->stats.overflows, 1U, __ATOMIC_RELAXED);
+        head += need;
+    }
+
+    off = (size_t)tail & (rx->sz - 1U);
+    first = (size_t)n < (rx->sz - off) ? (size_t)n : (rx->sz - off);
+    memcpy(&rx->buf[off], scratch, first);
+    memcpy(rx->buf, &scratch[first], (size_t)n - first);
+
+    stats_high_water(rx, (tail - head) + (uint64_t)n);
+    ring_publish(rx, tail + (uint64_t)n, (size_t)n);
+
+    return n;
+}
+
+/**
+ * Read from the port discarding all bytes (ring is full).
+ *
+ * @param [in] rx
+ *      Background reception context.
+ * @param [in] scratch
+ *      Scratch buffer (SCRATCH_SZ bytes).
+ *
+ * @return
+ *      Number of bytes read, 0 on EOF, -1 on error (errno is set).
+ */
+static ssize_t ring_read_drop(struct ser_rx *rx, uint8_t *scratch)
+{
+    ssize_t n;
+
+    n = read(rx->fd, scratch, SCRATCH_SZ);
+    if (n > 0)
+    {
+        __atomic_add_fetch(&rx->stats.dropped, (uint64_t)n,
+                           __ATOMIC_RELAXED);
+        __atomic_add_fetch(&rx->stats.overflows, 1U, __ATOMIC_RELAXED);
+    }
+
+    return n;
+}
+
+/**
+ * Reception thread.
+ *
+ * @param [in] args
+ *      Background reception context.
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *rx_thread(void *args)
+{
+    struct ser_rx *rx = args;
+    const ser_deadline_t never = SER_DEADLINE_NEVER;
+    uint8_t scratch[SCRATCH_SZ];
+
+    for (;;)
+    {
+        struct pollfd pfds[2];
+        uint64_t head;
+        uint64_t tail;
+        bool full;
+        ssize_t n;
+
+        tail = rx->tail;
+        head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+        full = (tail - head) == (uint64_t)rx->sz;
+
+        /* on a full ring (blocking policy), wait for room */
+        if (full && (rx->overflow == SER_RX_OVF_BLOCK))
+        {
+            __atomic_store_n(&rx->wr_waiting, 1, __ATOMIC_SEQ_CST);
+            head = __atomic_load_n(&rx->head, __ATOMIC_SEQ_CST);
+            full = (tail - head) == (uint64_t)rx->sz;
+        }
+
+        pfds[0].fd = (full && (rx->overflow == SER_RX_OVF_BLOCK)) ? -1 :
+                                                                    rx->fd;
+        pfds[0].events = POLLIN;
+        pfds[0].revents = 0;
+        pfds[1].fd = rx->wake.rd;
+        pfds[1].events = POLLIN;
+        pfds[1].revents = 0;
+
+        if (pwait_poll(pfds, 2U, &never) < 0)
+        {
+            __atomic_store_n(&rx->err, errno, __ATOMIC_RELAXED);
+            break;
+        }
+
+        if (pfds[1].revents != 0)
+        {
+            notifier_clear(&rx->wake);
+            __atomic_store_n(&rx->wr_waiting, 0, __ATOMIC_RELAXED);
+        }
+
+        if (__atomic_load_n(&rx->stop, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+
+        if (pfds[0].revents == 0)
+        {
+            continue;
+        }
+
+        /* read (policy dependent) */
+        head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+        if (rx->overflow == SER_RX_OVF_DROP_OLDEST)
+        {
+            n = ring_read_evict(rx, tail, scratch);
+        }
+        else if ((tail - head) == (uint64_t)rx->sz)
+        {
+            n = ring_read_drop(rx, scratch);
+        }
+        else
+        {
+            n = ring_read_direct(rx, head, tail);
+        }
+
+        if (n == 0)
+        {
+            __atomic_store_n(&rx->err, EIO, __ATOMIC_RELAXED);
+            break;
+        }
+        else if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+                 (errno != EINTR))
+        {
+            __atomic_store_n(&rx->err, errno, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    /* wake up any waiting consumer, so that it observes the error */
+    __atomic_store_n(&rx->stop, 1, __ATOMIC_SEQ_CST);
+    notifier_signal(&rx->data);
+
+    return NULL;
+}
+
+/**
+ * Obtain the error of a terminated reception thread.
+ *
+ * @param [in] rx
+ *      Background reception context.
+ *
+ * @return
+ *      Error code, 0 if the reception thread is still running.
+ */
+static int32_t rx_error(struct ser_rx *rx)
+{
+    int err;
+
+    if (!__atomic_load_n(&rx->stop, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+
+    err = __atomic_load_n(&rx->err, __ATOMIC_RELAXED);
+    if (err == 0)
+    {
+        sererr_set("Reception stopped");
+        return SER_EFAIL;
+    }
+
+    return perr_setc(err);
+}
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t rx_start(ser_t *ser, const ser_opts_t *opts)
+{
+    int32_t r;
+    struct ser_rx *rx;
+    void *mem;
+    size_t sz;
+    int pr;
+
+    ser->rx = NULL;
+
+    if (opts->rx.ring_sz == 0U)
+    {
+        return 0;
+    }
+
+    if (opts->rx.ring_sz > RING_SZ_MAX)
+    {
+        sererr_set("Receive ring too large");
+        return SER_EINVAL;
+    }
+
+    if ((opts->rx.overflow != SER_RX_OVF_BLOCK) &&
+        (opts->rx.overflow != SER_RX_OVF_DROP_OLDEST) &&
+        (opts->rx.overflow != SER_RX_OVF_DROP_NEWEST))
+    {
+        sererr_set("Invalid overflow policy");
+        return SER_EINVAL;
+    }
+
+    /* round ring size up to a power of 2 (indexes are masked) */
+    for (sz = 1U; sz < opts->rx.ring_sz; sz <<= 1U)
+    {
+    }
+
+    r = rt_mem_alloc(&mem, sizeof(*rx), CACHE_LINE, &opts->rt);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    rx = mem;
+    rx->rt = opts->rt;
+
+    r = rt_mem_alloc(&mem, sz, CACHE_LINE, &rx->rt);
+    if (r < 0)
+    {
+        goto cleanup_rx;
+    }
+
+    rx->buf = mem;
+    rx->sz = sz;
+    rx->overflow = opts->rx.overflow;
+    rx->fd = ser->fd;
+
+    if (notifier_open(&rx->data) < 0)
+    {
+        r = perr_setc(errno);
+        goto cleanup_buf;
+    }
+
+    if (notifier_open(&rx->wake) < 0)
+    {
+        r = perr_setc(errno);
+        goto cleanup_data;
+    }
+
+    pr = rt_thread_create(&rx->td, &rx->rt, rx_thread, rx);
+    if (pr != 0)
+    {
+        sererr_set("Could not start reception thread: %s", strerror(pr));
+        r = SER_EFAIL;
+        goto cleanup_wake;
+    }
+
+    ser->rx = rx;
+
+    return 0;
+
+cleanup_wake:
+    notifier_close(&rx->wake);
+
+cleanup_data:
+    notifier_close(&rx->data);
+
+cleanup_buf:
+    rt_mem_free(rx->buf, rx->sz, &rx->rt);
+
+cleanup_rx:
+    rt_mem_free(rx, sizeof(*rx), &opts->rt);
+
+    return r;
+}
+
+void rx_stop(ser_t *ser)
+{
+    struct ser_rx *rx = ser->rx;
+    ser_rt_t rt = rx->rt;
+
+    __atomic_store_n(&rx->stop, 1, __ATOMIC_RELEASE);
+    notifier_signal(&rx->wake);
+    (void)pthread_join(rx->td, NULL);
+
+    notifier_close(&rx->wake);
+    notifier_close(&rx->data);
+    rt_mem_free(rx->buf, rx->sz, &rx->rt);
+    rt_mem_free(rx, sizeof(*rx), &rt);
+
+    ser->rx = NULL;
+}
+
+int32_t rx_read(ser_t *ser, void *buf, size_t sz, size_t *recvd)
+{
+    struct ser_rx *rx = ser->rx;
+    uint64_t head;
+    uint64_t tail;
+    size_t n;
+    size_t off;
+    size_t first;
+
+    *recvd = 0U;
+
+    head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+    for (;;)
+    {
+        tail = __atomic_load_n(&rx->tail, __ATOMIC_ACQUIRE);
+
+        n = (size_t)(tail - head);
+        if (n > sz)
+        {
+            n = sz;
+        }
+
+        if (n == 0U)
+        {
+            int32_t r;
+
+            r = rx_error(rx);
+            if (r < 0)
+            {
+                return r;
+            }
+
+            return perr_setc(EAGAIN);
+        }
+
+        off = (size_t)head & (rx->sz - 1U);
+        first = n < (rx->sz - off) ? n : (rx->sz - off);
+        memcpy(buf, &rx->buf[off], first);
+        memcpy((uint8_t *)buf + first, rx->buf, n - first);
+
+        /* the producer only moves head when evicting, in which case the
+         * copied bytes may have been overwritten and must be re-read */
+        if (rx->overflow != SER_RX_OVF_DROP_OLDEST)
+        {
+            __atomic_store_n(&rx->head, head + n, __ATOMIC_SEQ_CST);
+            break;
+        }
+
+        if (__atomic_compare_exchange_n(&rx->head, &head, head + n, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE))
+        {
+            break;
+        }
+    }
+
+    /* producer sets wr_waiting before re-checking head */
+    if (__atomic_load_n(&rx->wr_waiting, __ATOMIC_SEQ_CST))
+    {
+        notifier_signal(&rx->wake);
+    }
+
+    *recvd = n;
+
+    return 0;
+}
+
+size_t rx_available(ser_t *ser)
+{
+    struct ser_rx *rx = ser->rx;
+    uint64_t head;
+    uint64_t tail;
+
+    head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+    tail = __atomic_load_n(&rx->tail, __ATOMIC_ACQUIRE);
+
+    return (size_t)(tail - head);
+}
+
+int32_t rx_wait(ser_t *ser, const ser_deadline_t *deadline)
+{
+    for (;;)
+    {
+        struct pollfd pfd;
+        int s;
+
+        if (rx_wait_arm(ser, &pfd))
+        {
+            rx_wait_disarm(ser, &pfd);
+            return 0;
+        }
+
+        s = pwait_poll(&pfd, 1U, deadline);
+
+        rx_wait_disarm(ser, &pfd);
+
+        if (s == 0)
+        {
+            sererr_set("Operation timed out");
+            return SER_ETIMEDOUT;
+        }
+        else if (s < 0)
+        {
+            return perr_setc(errno);
+        }
+    }
+}
+
+bool rx_wait_arm(ser_t *ser, struct pollfd *pfd)
+{
+    struct ser_rx *rx = ser->rx;
+
+    __atomic_store_n(&rx->rd_waiting, 1, __ATOMIC_SEQ_CST);
+
+    pfd->fd = rx->data.rd;
+    pfd->events = POLLIN;
+    pfd->revents = 0;
+
+    if ((rx_available(ser) > 0U) ||
+        __atomic_load_n(&rx->stop, __ATOMIC_SEQ_CST))
+    {
+        pfd->fd = -1;
+        return true;
+    }
+
+    return false;
+}
+
+void rx_wait_disarm(ser_t *ser, const struct pollfd *pfd)
+{
+    struct ser_rx *rx = ser->rx;
+
+    __atomic_store_n(&rx->rd_waiting, 0, __ATOMIC_RELAXED);
+
+    /* only consume the wake-up if it was delivered */
+    if ((pfd->fd >= 0) && (pfd->revents != 0))
+    {
+        notifier_clear(&rx->data);
+    }
+}
+
+void rx_flush(ser_t *ser)
+{
+    struct ser_rx *rx = ser->rx;
+    uint64_t head;
+    uint64_t tail;
+
+    head = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE);
+    do
+    {
+        tail = __atomic_load_n(&rx->tail, __ATOMIC_ACQUIRE);
+    } while (!__atomic_compare_exchange_n(&rx->head, &head, tail, false,
+                                          __ATOMIC_SEQ_CST,
+                                          __ATOMIC_ACQUIRE));
+
+    if (__atomic_load_n(&rx->wr_waiting, __ATOMIC_SEQ_CST))
+    {
+        notifier_signal(&rx->wake);
+    }
+}
+
+void rx_stats(ser_t *ser, ser_rx_stats_t *stats)
+{
+    struct ser_rx *rx = ser->rx;
+
+    stats->bytes = __atomic_load_n(&rx->stats.bytes, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&rx->stats.dropped, __ATOMIC_RELAXED);
+    stats->overflows = __atomic_load_n(&rx->stats.overflows,
+                                       __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&rx->stats.high_water,
+                                        __ATOMIC_RELAXED);
+}
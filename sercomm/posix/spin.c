@@ -0,0 +1,308 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/posix/spin.h"
+
+#include <stdlib.h>
+#include <sys/ioctl.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/time.h"
+#include "sercomm/posix/types.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/* ioctl for input queue size (macOS) */
+#if defined(__MACH__) && defined(__APPLE__)
+# ifndef TIOCINQ
+#  define TIOCINQ FIONREAD
+# endif
+#endif
+
+/** Maximum spin time (us). */
+#define SPIN_US_MAX     1000000U
+
+/** Adaptive mode: reply time average weight (1/2^n of each new sample). */
+#define EWMA_SHIFT      3
+
+/** Adaptive mode: slack added on top of the spin budget (ns). */
+#define SPIN_SLACK_NS   2000
+
+/** Timed waits: initial sleep margin (ns). */
+#define WAKE_MARGIN_INIT    100000
+
+/** Timed waits: minimum sleep margin (ns). */
+#define WAKE_MARGIN_MIN     5000
+
+/** Timed waits: maximum sleep margin (ns). */
+#define WAKE_MARGIN_MAX     2000000
+
+/** Timed waits: margin decay (1/2^n of the margin per wait). */
+#define WAKE_MARGIN_DECAY   4
+
+/** Spinning wait strategy context. */
+struct ser_spin
+{
+    /** Mode */
+    ser_wait_mode_t mode;
+    /** Maximum spin time (ns) */
+    int64_t max_ns;
+    /** Adaptive mode: average reply time (ns) */
+    int64_t ewma_ns;
+    /** Current wait start time (ns) */
+    int64_t wait_start;
+    /** Current wait blocking start time (ns) */
+    int64_t block_start;
+    /** Statistics */
+    ser_wait_stats_t stats;
+};
+
+/**
+ * Obtain the spin budget of the next wait.
+ *
+ * @param [in] spin
+ *      Spinning wait strategy context.
+ *
+ * @return
+ *      Spin budget (ns).
+ */
+static int64_t spin_budget(const struct ser_spin *spin)
+{
+    int64_t budget;
+
+    if (spin->mode == SER_WAIT_SPIN)
+    {
+        return spin->max_ns;
+    }
+
+    /* replies usually slower than allowed: spinning would be wasted */
+    if (spin->ewma_ns > spin->max_ns)
+    {
+        return 0;
+    }
+
+    budget = (2 * spin->ewma_ns) + SPIN_SLACK_NS;
+
+    return (budget < spin->max_ns) ? budget : spin->max_ns;
+}
+
+/**
+ * Learn a reply time (adaptive mode).
+ *
+ * @param [in] spin
+ *      Spinning wait strategy context.
+ * @param [in] sample
+ *      Observed reply time (ns).
+ */
+static void spin_learn(struct ser_spin *spin, int64_t sample)
+{
+    spin->ewma_ns += (sample - spin->ewma_ns) / (1 << EWMA_SHIFT);
+    spin->stats.budget_us = (uint32_t)(spin_budget(spin) / 1000);
+}
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t spin_start(ser_t *ser, const ser_opts_t *opts)
+{
+    struct ser_spin *spin;
+
+    ser->spin = NULL;
+
+    /* waits happen elsewhere (receive thread, kernel) */
+    if ((opts->wait.mode == SER_WAIT_BLOCK) || (opts->rx.ring_sz != 0U) ||
+        (opts->blocking.enabled != 0U))
+    {
+        return 0;
+    }
+
+    if ((opts->wait.mode != SER_WAIT_SPIN) &&
+        (opts->wait.mode != SER_WAIT_ADAPTIVE))
+    {
+        sererr_set("Invalid wait mode");
+        return SER_EINVAL;
+    }
+
+    if ((opts->wait.spin_us == 0U) || (opts->wait.spin_us > SPIN_US_MAX))
+    {
+        sererr_set("Invalid spin time");
+        return SER_EINVAL;
+    }
+
+    spin = calloc(1U, sizeof(*spin));
+    if (spin == NULL)
+    {
+        sererr_set("Could not allocate wait context");
+        return SER_EFAIL;
+    }
+
+    spin->mode = opts->wait.mode;
+    spin->max_ns = (int64_t)opts->wait.spin_us * 1000;
+    spin->ewma_ns = spin->max_ns / 2;
+    spin->stats.budget_us = (uint32_t)(spin_budget(spin) / 1000);
+
+    ser->spin = spin;
+
+    return 0;
+}
+
+void spin_stop(ser_t *ser)
+{
+    free(ser->spin);
+    ser->spin = NULL;
+}
+
+bool spin_poll(ser_t *ser, const ser_deadline_t *deadline)
+{
+    struct ser_spin *spin = ser->spin;
+    int64_t now;
+    int64_t end;
+    int64_t deadline_ns;
+
+    now = clock__now_ns();
+    spin->wait_start = now;
+    spin->block_start = now;
+
+    spin->stats.waits++;
+
+    end = spin_budget(spin);
+    if (end == 0)
+    {
+        return false;
+    }
+
+    end += now;
+
+    /* never spin past the deadline */
+    deadline_ns = clock__deadline_ns(deadline);
+    if (deadline_ns < end)
+    {
+        end = deadline_ns;
+    }
+
+    while (now < end)
+    {
+        int cinq;
+
+        /* port failures are reported by the blocking wait */
+        if (ioctl(ser->fd, TIOCINQ, &cinq) < 0)
+        {
+            break;
+        }
+
+        if (cinq > 0)
+        {
+            now = clock__now_ns();
+
+            spin->stats.spin_hits++;
+            spin->stats.spin_ns += (uint64_t)(now - spin->wait_start);
+
+            if (spin->mode == SER_WAIT_ADAPTIVE)
+            {
+                spin_learn(spin, now - spin->wait_start);
+            }
+
+            return true;
+        }
+
+        cpu_relax();
+        now = clock__now_ns();
+    }
+
+    spin->stats.spin_misses++;
+    spin->stats.spin_ns += (uint64_t)(now - spin->wait_start);
+    spin->block_start = now;
+
+    return false;
+}
+
+void spin_blocked(ser_t *ser, bool ready)
+{
+    struct ser_spin *spin = ser->spin;
+    int64_t now;
+
+    now = clock__now_ns();
+
+    spin->stats.block_ns += (uint64_t)(now - spin->block_start);
+
+    if (ready && (spin->mode == SER_WAIT_ADAPTIVE))
+    {
+        spin_learn(spin, now - spin->wait_start);
+    }
+}
+
+void spin_stats(ser_t *ser, ser_wait_stats_t *stats)
+{
+    *stats = ser->spin->stats;
+}
+
+int64_t spin_until(ser_t *ser, int64_t t)
+{
+    int64_t margin;
+    int64_t wake;
+    int64_t now;
+
+    margin = (ser->wake_margin_ns > 0) ? ser->wake_margin_ns :
+                                         WAKE_MARGIN_INIT;
+
+    /* coarse: sleep until shortly before */
+    wake = t - margin;
+    now = clock__now_ns();
+    if (now < wake)
+    {
+        clock__sleep_until(wake);
+        now = clock__now_ns();
+
+        /* margin follows the worst recent wake-up latency (slowly decaying),
+         * with a quarter on top */
+        margin -= margin >> WAKE_MARGIN_DECAY;
+        if (((now - wake) + ((now - wake) >> 2)) > margin)
+        {
+            margin = (now - wake) + ((now - wake) >> 2);
+        }
+
+        if (margin < WAKE_MARGIN_MIN)
+        {
+            margin = WAKE_MARGIN_MIN;
+        }
+        else if (margin > WAKE_MARGIN_MAX)
+        {
+            margin = WAKE_MARGIN_MAX;
+        }
+
+        ser->wake_margin_ns = margin;
+    }
+
+    /* fine: busy-wait the rest */
+    while (now < t)
+    {
+        cpu_relax();
+        now = clock__now_ns();
+    }
+
+    return now;
+}
@@ -24,13 +24,14 @@
 
 #include "sercomm/posix/time.h"
 
+#include <errno.h>
+
 /*******************************************************************************
  * Internal
  ******************************************************************************/
 
 #ifdef MAC_OS_X_VERSION_MAX_ALLOWED
 #if MAC_OS_X_VERSION_MAX_ALLOWED < 101200
-#include <errno.h>
 #include <mach/clock.h>
 #include <mach/mach.h>
 
@@ -98,3 +99,82 @@ struct timespec clock__diff(const struct timespec *a, const struct timespec *b)
 
     return diff;
 }
+
+int64_t clock__now_ns(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((int64_t)now.tv_sec * 1000000000) + (int64_t)now.tv_nsec;
+}
+
+int64_t clock__deadline_ns(const ser_deadline_t *deadline)
+{
+    if (deadline->sec == INT64_MAX)
+    {
+        return INT64_MAX;
+    }
+
+    return (deadline->sec * 1000000000) + deadline->nsec;
+}
+
+bool clock__remaining(const ser_deadline_t *deadline,
+                      struct timespec *remaining)
+{
+    struct timespec now;
+    struct timespec end;
+
+    if (deadline->sec == INT64_MAX)
+    {
+        return false;
+    }
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    end.tv_sec = (time_t)deadline->sec;
+    end.tv_nsec = (long)deadline->nsec;
+
+    *remaining = clock__diff(&end, &now);
+    if (remaining->tv_sec < 0)
+    {
+        remaining->tv_sec = 0;
+        remaining->tv_nsec = 0;
+    }
+
+    return true;
+}
+
+void clock__sleep_until(int64_t t)
+{
+    struct timespec ts;
+
+#if defined(__MACH__) && defined(__APPLE__)
+    /* no clock_nanosleep(): relative sleep, recomputed after interruptions */
+    int64_t remaining;
+
+    for (;;)
+    {
+        remaining = t - clock__now_ns();
+        if (remaining <= 0)
+        {
+            break;
+        }
+
+        ts.tv_sec = (time_t)(remaining / 1000000000);
+        ts.tv_nsec = (long)(remaining % 1000000000);
+
+        if ((nanosleep(&ts, NULL) == 0) || (errno != EINTR))
+        {
+            break;
+        }
+    }
+#else
+    ts.tv_sec = (time_t)(t / 1000000000);
+    ts.tv_nsec = (long)(t % 1000000000);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+#endif
+}
@@ -0,0 +1,280 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/transact.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+#include "sercomm/posix/rx.h"
+#include "sercomm/posix/types.h"
+#include "sercomm/posix/time.h"
+#include "sercomm/posix/wait.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Number of transactions handled without allocating. */
+#define MANY_STACK      64U
+
+/** Transaction state. */
+typedef struct
+{
+    /** Number of bytes requested */
+    size_t want;
+    /** Waiting for the response */
+    bool pending;
+    /** Bytes pending in the receive ring (background reception) */
+    bool ready;
+} many_state_t;
+
+/**
+ * Complete a transaction.
+ *
+ * @param [in, out] item
+ *      Transaction.
+ * @param [in, out] state
+ *      Transaction state.
+ * @param [in] r
+ *      Result.
+ * @param [in] start
+ *      Start time (ns).
+ */
+static void many_complete(ser_transact_item_t *item, many_state_t *state,
+                          int32_t r, int64_t start)
+{
+    item->r = r;
+    item->elapsed_ns = clock__now_ns() - start;
+    state->pending = false;
+}
+
+/**
+ * Read the bytes pending on a port, completing its transaction if the
+ * response is complete (or on failure).
+ *
+ * @param [in, out] item
+ *      Transaction.
+ * @param [in, out] state
+ *      Transaction state.
+ * @param [in] start
+ *      Start time (ns).
+ */
+static void many_read(ser_transact_item_t *item, many_state_t *state,
+                      int64_t start)
+{
+    int32_t r;
+    uint8_t *rsp = item->rsp;
+    size_t recvd_now = 0U;
+
+    r = ser_try_read(item->ser, rsp + item->rsp_sz,
+                     state->want - item->rsp_sz, &recvd_now);
+    if (r == SER_EEMPTY)
+    {
+        return;
+    }
+
+    if (r == 0)
+    {
+        item->rsp_sz += recvd_now;
+
+        r = transact_check(item->opts, rsp, &item->rsp_sz, state->want);
+        if (r == 0)
+        {
+            return;
+        }
+
+        if (r > 0)
+        {
+            r = 0;
+        }
+    }
+
+    many_complete(item, state, r, start);
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+int32_t ser_transact_many(ser_transact_item_t *items, size_t cnt,
+                          const ser_deadline_t *deadline)
+{
+    int32_t r = 0;
+
+    struct pollfd pfds_stack[MANY_STACK];
+    many_state_t states_stack[MANY_STACK];
+    struct pollfd *pfds = pfds_stack;
+    many_state_t *states = states_stack;
+    int64_t start;
+    size_t i;
+
+    if (cnt > MANY_STACK)
+    {
+        pfds = malloc(cnt * sizeof(*pfds));
+        states = malloc(cnt * sizeof(*states));
+        if ((pfds == NULL) || (states == NULL))
+        {
+            sererr_set("Could not allocate transactions");
+            r = SER_EFAIL;
+            goto cleanup;
+        }
+    }
+
+    start = clock__now_ns();
+
+    /* write all requests first, so that devices work in parallel */
+    for (i = 0U; i < cnt; i++)
+    {
+        ser_transact_item_t *item = &items[i];
+
+        item->r = 0;
+        item->rsp_sz = 0U;
+        item->elapsed_ns = 0;
+        states[i].pending = true;
+
+        r = transact_want(item->opts, item->rsp_cap, &states[i].want);
+        if ((r == 0) && (item->opts->flush != 0U))
+        {
+            r = ser_flush(item->ser, SER_QUEUE_IN);
+        }
+
+        if (r == 0)
+        {
+            r = ser_write_until(item->ser, item->req, item->req_sz, NULL,
+                                deadline);
+        }
+
+        if (r < 0)
+        {
+            many_complete(item, &states[i], r, start);
+        }
+    }
+
+    /* collect responses as they arrive, waiting on all ports at once */
+    for (;;)
+    {
+        size_t pending = 0U;
+        bool ready = false;
+        int s = 0;
+
+        for (i = 0U; i < cnt; i++)
+        {
+            ser_t *ser = items[i].ser;
+
+            pfds[i].fd = -1;
+            pfds[i].events = 0;
+            pfds[i].revents = 0;
+            states[i].ready = false;
+
+            if (!states[i].pending)
+            {
+                continue;
+            }
+
+            pending++;
+
+            if (ser->rx != NULL)
+            {
+                states[i].ready = rx_wait_arm(ser, &pfds[i]);
+                ready = ready || states[i].ready;
+            }
+            else
+            {
+                pfds[i].fd = ser->fd;
+                pfds[i].events = POLLIN;
+            }
+        }
+
+        if (pending == 0U)
+        {
+            break;
+        }
+
+        /* bytes already in a receive ring: serve them without waiting */
+        if (!ready)
+        {
+            s = pwait_poll(pfds, (nfds_t)cnt, deadline);
+        }
+
+        for (i = 0U; i < cnt; i++)
+        {
+            if (states[i].pending && (items[i].ser->rx != NULL))
+            {
+                rx_wait_disarm(items[i].ser, &pfds[i]);
+            }
+        }
+
+        if ((s < 0) || ((s == 0) && !ready))
+        {
+            if (s == 0)
+            {
+                sererr_set("Operation timed out");
+                r = SER_ETIMEDOUT;
+            }
+            else
+            {
+                r = perr_setc(errno);
+            }
+
+            for (i = 0U; i < cnt; i++)
+            {
+                if (states[i].pending)
+                {
+                    many_complete(&items[i], &states[i], r, start);
+                }
+            }
+
+            break;
+        }
+
+        for (i = 0U; i < cnt; i++)
+        {
+            if (states[i].pending &&
+                (states[i].ready || (pfds[i].revents != 0)))
+            {
+                many_read(&items[i], &states[i], start);
+            }
+        }
+    }
+
+    /* report the first failure */
+    r = 0;
+    for (i = 0U; (i < cnt) && (r == 0); i++)
+    {
+        r = items[i].r;
+    }
+
+cleanup:
+    if (pfds != pfds_stack)
+    {
+        free(pfds);
+        free(states);
+    }
+
+    return r;
+}
@@ -0,0 +1,1119 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "sercomm/posix/tx.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+#include "sercomm/posix/notify.h"
+#include "sercomm/posix/pace.h"
+#include "sercomm/posix/rt.h"
+#include "sercomm/posix/types.h"
+#include "sercomm/posix/time.h"
+#include "sercomm/posix/wait.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Cache line size (bytes). */
+#define CACHE_LINE      64U
+
+/** Maximum transmit ring size (bytes). */
+#define RING_SZ_MAX     ((size_t)1U << 30U)
+
+/** Average frame size assumed to size the frames queue (bytes). */
+#define FRAME_SZ_AVG    32U
+
+/** Minimum frames queue size. */
+#define FRAMES_SZ_MIN   16U
+
+/** Weighted classes: bytes granted per round and weight unit. */
+#define QUANTUM         256
+
+/** Frame outcome: not completed yet. */
+#define RESULT_PENDING  1
+
+/** Queued frame. */
+typedef struct
+{
+    /** Ring index of the frame first byte */
+    uint64_t start;
+    /** Ring index right after the frame last byte */
+    uint64_t end;
+    /** Sequence number */
+    uint64_t seq;
+    /** Expiry time (ns, INT64_MAX if never) */
+    int64_t expires;
+    /** Completion callback */
+    ser_tx_on_done_t on_done;
+    /** Completion callback context */
+    void *ctx;
+} tx_frame_t;
+
+/** Priority class. */
+typedef struct
+{
+    /** Ring buffer */
+    uint8_t *buf;
+    /** Ring consumer index (total bytes written or dropped) */
+    uint64_t head;
+    /** Ring producer index (total bytes queued) */
+    uint64_t tail;
+    /** Frames queue */
+    tx_frame_t *frames;
+    /** Completed frames */
+    uint64_t frames_head;
+    /** Queued frames */
+    uint64_t frames_tail;
+    /** Weight (0 for strict priority) */
+    int64_t weight;
+    /** Weighted classes: bytes left in the current round */
+    int64_t deficit;
+    /** Frames written */
+    uint64_t sent;
+    /** Bytes written */
+    uint64_t bytes;
+    /** Frames dropped */
+    uint64_t dropped;
+} tx_class_t;
+
+/** Asynchronous transmission context. */
+struct ser_tx
+{
+    /** Lock (protects all fields below, except ring contents) */
+    pthread_mutex_t lock;
+    /** Signalled when bytes are queued (or stop is requested) */
+    pthread_cond_t data_cond;
+    /** Signalled when frames complete (room is available) */
+    pthread_cond_t room_cond;
+    /** Priority classes */
+    tx_class_t classes[SER_TX_CLASSES_MAX];
+    /** Number of priority classes */
+    size_t nclasses;
+    /** Ring buffers size (power of 2) */
+    size_t sz;
+    /** Frames queues size (power of 2) */
+    size_t frames_sz;
+    /** Weighted classes: class served in the current round */
+    size_t rr;
+    /** Queued frames (also sequence number of the last queued one) */
+    uint64_t seq;
+    /** Outcome of the recent frames (indexed by sequence number) */
+    int32_t *results;
+    /** Outcomes size (power of 2) */
+    size_t results_sz;
+    /** Transmission error (errno value, 0 if none) */
+    int err;
+    /** Stop requested (or transmission failed) */
+    bool stop;
+    /** Serial port file descriptor */
+    int fd;
+    /** Library instance (transmit pacing) */
+    ser_t *ser;
+    /** Wake-up notifier (stop while waiting for the port) */
+    notifier_t wake;
+    /** Transmission thread */
+    pthread_t td;
+    /** Real-time configuration */
+    ser_rt_t rt;
+};
+
+/**
+ * Round a size up to a power of 2.
+ *
+ * @param [in] sz
+ *      Size.
+ *
+ * @return
+ *      Rounded size.
+ */
+static size_t round_pow2(size_t sz)
+{
+    size_t r;
+
+    for (r = 1U; r < sz; r <<= 1U)
+    {
+    }
+
+    return r;
+}
+
+/**
+ * Wait on a condition variable until a deadline.
+ *
+ * @param [in] cond
+ *      Condition variable (using the monotonic clock).
+ * @param [in] lock
+ *      Locked mutex.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      0 if signalled (or spurious wake-up), SER_ETIMEDOUT if deadline
+ *      expired.
+ */
+static int32_t cond_wait_until(pthread_cond_t *cond, pthread_mutex_t *lock,
+                               const ser_deadline_t *deadline)
+{
+    int s;
+    struct timespec ts;
+
+#if defined(__MACH__) && defined(__APPLE__)
+    if (clock__remaining(deadline, &ts) == false)
+    {
+        s = pthread_cond_wait(cond, lock);
+    }
+    else
+    {
+        s = pthread_cond_timedwait_relative_np(cond, lock, &ts);
+    }
+#else
+    if (deadline->sec == INT64_MAX)
+    {
+        s = pthread_cond_wait(cond, lock);
+    }
+    else
+    {
+        ts.tv_sec = (time_t)deadline->sec;
+        ts.tv_nsec = (long)deadline->nsec;
+
+        s = pthread_cond_timedwait(cond, lock, &ts);
+    }
+#endif
+
+    if (s == ETIMEDOUT)
+    {
+        sererr_set("Operation timed out");
+        return SER_ETIMEDOUT;
+    }
+
+    return 0;
+}
+
+/**
+ * Obtain the error of a stopped transmission.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ *
+ * @return
+ *      Error code.
+ */
+static int32_t tx_error(struct ser_tx *tx)
+{
+    if (tx->err != 0)
+    {
+        return perr_setc(tx->err);
+    }
+
+    sererr_set("Transmission stopped");
+    return SER_EFAIL;
+}
+
+/**
+ * Obtain the first pending frame of a class.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ * @param [in] cls
+ *      Priority class.
+ *
+ * @return
+ *      First pending frame, NULL if the class is empty.
+ */
+static tx_frame_t *tx_first(struct ser_tx *tx, tx_class_t *cls)
+{
+    if (cls->frames_head == cls->frames_tail)
+    {
+        return NULL;
+    }
+
+    return &cls->frames[cls->frames_head & (tx->frames_sz - 1U)];
+}
+
+/**
+ * Check whether any frame is pending.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ *
+ * @return
+ *      true if a frame is pending, false otherwise.
+ */
+static bool tx_pending(struct ser_tx *tx)
+{
+    size_t i;
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        if (tx->classes[i].frames_head < tx->classes[i].frames_tail)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Obtain the sequence number of the oldest pending frame.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ *
+ * @return
+ *      Sequence number (the next one if no frame is pending).
+ */
+static uint64_t tx_oldest(struct ser_tx *tx)
+{
+    uint64_t oldest = tx->seq + 1U;
+    size_t i;
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        tx_frame_t *frame = tx_first(tx, &tx->classes[i]);
+
+        if ((frame != NULL) && (frame->seq < oldest))
+        {
+            oldest = frame->seq;
+        }
+    }
+
+    return oldest;
+}
+
+/**
+ * Complete the first pending frame of a class.
+ *
+ * @note
+ *      Must be called with the lock held, which is released while the
+ *      callback is run.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ * @param [in] cls
+ *      Priority class.
+ * @param [in] r
+ *      Frame outcome.
+ */
+static void tx_done(struct ser_tx *tx, tx_class_t *cls, int32_t r)
+{
+    tx_frame_t frame;
+
+    frame = *tx_first(tx, cls);
+    cls->frames_head++;
+
+    tx->results[frame.seq & (tx->results_sz - 1U)] = r;
+
+    if (frame.on_done != NULL)
+    {
+        (void)pthread_mutex_unlock(&tx->lock);
+        frame.on_done(frame.ctx, frame.seq, r);
+        (void)pthread_mutex_lock(&tx->lock);
+    }
+}
+
+/**
+ * Complete frames.
+ *
+ * @note
+ *      Must be called with the lock held, which is released while callbacks
+ *      are run.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ * @param [in] failed
+ *      Complete all frames with an error (otherwise, only the written ones
+ *      are completed).
+ */
+static void tx_complete(struct ser_tx *tx, bool failed)
+{
+    size_t i;
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        tx_class_t *cls = &tx->classes[i];
+        tx_frame_t *frame;
+
+        while (((frame = tx_first(tx, cls)) != NULL) &&
+               (failed || (frame->end <= cls->head)))
+        {
+            if (!failed)
+            {
+                cls->sent++;
+                cls->bytes += frame->end - frame->start;
+            }
+
+            tx_done(tx, cls, failed ? tx_error(tx) : 0);
+        }
+
+        if (failed)
+        {
+            cls->head = cls->tail;
+        }
+    }
+
+    (void)pthread_cond_broadcast(&tx->room_cond);
+}
+
+/**
+ * Drop the expired frames waiting at the front of the classes.
+ *
+ * @note
+ *      Must be called with the lock held, which is released while callbacks
+ *      are run. A frame being written is never dropped.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ * @param [in] now
+ *      Current time (ns).
+ *
+ * @return
+ *      true if frames were dropped, false otherwise.
+ */
+static bool tx_expire(struct ser_tx *tx, int64_t now)
+{
+    bool dropped = false;
+    size_t i;
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        tx_class_t *cls = &tx->classes[i];
+        tx_frame_t *frame;
+
+        while (((frame = tx_first(tx, cls)) != NULL) &&
+               (frame->start == cls->head) && (frame->expires <= now))
+        {
+            cls->head = frame->end;
+            cls->dropped++;
+            dropped = true;
+
+            sererr_set("Frame expired before being written");
+            tx_done(tx, cls, SER_ETIMEDOUT);
+        }
+    }
+
+    if (dropped)
+    {
+        (void)pthread_cond_broadcast(&tx->room_cond);
+    }
+
+    return dropped;
+}
+
+/**
+ * Pick the class to be served next.
+ *
+ * @note
+ *      A frame partially written is always finished first. Otherwise, strict
+ *      classes are served by priority, then weighted classes take turns
+ *      (deficit round-robin).
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context (with pending frames).
+ *
+ * @return
+ *      Class to be served.
+ */
+static tx_class_t *tx_pick(struct ser_tx *tx)
+{
+    tx_class_t *cls;
+    size_t i;
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        tx_frame_t *frame = tx_first(tx, &tx->classes[i]);
+
+        if ((frame != NULL) && (frame->start != tx->classes[i].head))
+        {
+            return &tx->classes[i];
+        }
+    }
+
+    for (i = tx->nclasses; i > 0U; i--)
+    {
+        cls = &tx->classes[i - 1U];
+        if ((cls->weight == 0) && (cls->frames_head < cls->frames_tail))
+        {
+            return cls;
+        }
+    }
+
+    cls = &tx->classes[tx->rr];
+    if ((cls->frames_head < cls->frames_tail) && (cls->deficit > 0))
+    {
+        return cls;
+    }
+
+    for (;;)
+    {
+        tx->rr = (tx->rr + 1U) % tx->nclasses;
+        cls = &tx->classes[tx->rr];
+
+        if (cls->weight == 0)
+        {
+            continue;
+        }
+
+        if (cls->frames_head == cls->frames_tail)
+        {
+            /* idle classes do not save up credit */
+            cls->deficit = 0;
+            continue;
+        }
+
+        cls->deficit += cls->weight * QUANTUM;
+        if (cls->deficit > 0)
+        {
+            return cls;
+        }
+    }
+}
+
+/**
+ * Obtain the number of bytes of a class to be written at once.
+ *
+ * @note
+ *      Queued frames are coalesced up to the first expired one (dropped once
+ *      it reaches the front) and, for weighted classes, up to the bytes left
+ *      in the round. A frame partially written is finished on its own, so
+ *      that the class is picked again right after it.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ * @param [in] cls
+ *      Class to be served.
+ * @param [in] now
+ *      Current time (ns).
+ *
+ * @return
+ *      Number of bytes.
+ */
+static size_t tx_span(struct ser_tx *tx, tx_class_t *cls, int64_t now)
+{
+    tx_frame_t *first = tx_first(tx, cls);
+    uint64_t end;
+    uint64_t i;
+
+    end = first->end;
+
+    /* partial frame: only finish it (tx_pick() then serves it first) */
+    if (first->start != cls->head)
+    {
+        return (size_t)(end - cls->head);
+    }
+
+    for (i = cls->frames_head + 1U; i < cls->frames_tail; i++)
+    {
+        tx_frame_t *frame = &cls->frames[i & (tx->frames_sz - 1U)];
+
+        if ((frame->expires <= now) ||
+            ((cls->weight > 0) && ((int64_t)(end - cls->head) >= cls->deficit)))
+        {
+            break;
+        }
+
+        end = frame->end;
+    }
+
+    return (size_t)(end - cls->head);
+}
+
+/**
+ * Transmission thread.
+ *
+ * @param [in] args
+ *      Asynchronous transmission context.
+ *
+ * @return
+ *      Always NULL.
+ */
+static void *tx_thread(void *args)
+{
+    struct ser_tx *tx = args;
+
+    (void)pthread_mutex_lock(&tx->lock);
+
+    for (;;)
+    {
+        struct iovec iov[2];
+        tx_class_t *cls;
+        int64_t now;
+        size_t used;
+        size_t off;
+        ssize_t n;
+        int err;
+
+        while (!tx_pending(tx) && !tx->stop)
+        {
+            (void)pthread_cond_wait(&tx->data_cond, &tx->lock);
+        }
+
+        if (tx->stop)
+        {
+            break;
+        }
+
+        now = clock__now_ns();
+        if (tx_expire(tx, now))
+        {
+            continue;
+        }
+
+        /* coalesce queued frames of the served class into a single write
+         * (producers only touch the free part of the ring, so no lock is
+         * needed) */
+        cls = tx_pick(tx);
+        used = tx_span(tx, cls, now);
+
+        if (tx->ser->pace != NULL)
+        {
+            size_t allowed;
+            int64_t wait;
+
+            allowed = pace_allow(tx->ser, used, &wait);
+            if (allowed == 0U)
+            {
+                ser_deadline_t until;
+                struct pollfd pfd;
+                int64_t start;
+
+                /* wait for the pacing (or until stop is requested), then
+                 * pick again: urgent frames may have been queued */
+                (void)pthread_mutex_unlock(&tx->lock);
+
+                start = clock__now_ns();
+                until = ser_deadline_in_ns(wait);
+                pfd.fd = tx->wake.rd;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+
+                if (pwait_poll(&pfd, 1U, &until) > 0)
+                {
+                    notifier_clear(&tx->wake);
+                }
+
+                pace_delayed(tx->ser, clock__now_ns() - start);
+
+                (void)pthread_mutex_lock(&tx->lock);
+                continue;
+            }
+
+            used = allowed;
+        }
+
+        off = (size_t)cls->head & (tx->sz - 1U);
+
+        iov[0].iov_base = &cls->buf[off];
+        iov[0].iov_len = used < (tx->sz - off) ? used : (tx->sz - off);
+        iov[1].iov_base = cls->buf;
+        iov[1].iov_len = used - iov[0].iov_len;
+
+        (void)pthread_mutex_unlock(&tx->lock);
+
+        n = writev(tx->fd, iov, (iov[1].iov_len > 0U) ? 2 : 1);
+        err = errno;
+
+        if ((n < 0) && ((err == EAGAIN) || (err == EWOULDBLOCK)))
+        {
+            const ser_deadline_t never = SER_DEADLINE_NEVER;
+            struct pollfd pfds[2];
+
+            /* wait until port is writable (or stop is requested) */
+            pfds[0].fd = tx->fd;
+            pfds[0].events = POLLOUT;
+            pfds[0].revents = 0;
+            pfds[1].fd = tx->wake.rd;
+            pfds[1].events = POLLIN;
+            pfds[1].revents = 0;
+
+            if ((pwait_poll(pfds, 2U, &never) > 0) &&
+                (pfds[1].revents != 0))
+            {
+                notifier_clear(&tx->wake);
+            }
+        }
+
+        (void)pthread_mutex_lock(&tx->lock);
+
+        if (n > 0)
+        {
+            if (tx->ser->pace != NULL)
+            {
+                pace_consume(tx->ser, (size_t)n);
+            }
+
+            cls->head += (uint64_t)n;
+            if (cls->weight > 0)
+            {
+                cls->deficit -= (int64_t)n;
+            }
+
+            tx_complete(tx, false);
+        }
+        else if ((n == 0) ||
+                 ((err != EAGAIN) && (err != EWOULDBLOCK) && (err != EINTR)))
+        {
+            tx->err = (n == 0) ? EIO : err;
+            break;
+        }
+    }
+
+    /* fail any pending frames, refuse new ones */
+    tx->stop = true;
+    tx_complete(tx, true);
+
+    (void)pthread_mutex_unlock(&tx->lock);
+
+    return NULL;
+}
+
+/**
+ * Free the rings and queues of an asynchronous transmission context.
+ *
+ * @param [in] tx
+ *      Asynchronous transmission context.
+ */
+static void tx_free_bufs(struct ser_tx *tx)
+{
+    size_t i;
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        rt_mem_free(tx->classes[i].frames,
+                    tx->frames_sz * sizeof(tx->classes[i].frames[0]), &tx->rt);
+        rt_mem_free(tx->classes[i].buf, tx->sz, &tx->rt);
+    }
+
+    rt_mem_free(tx->results, tx->results_sz * sizeof(tx->results[0]),
+                &tx->rt);
+}
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t tx_start(ser_t *ser, const ser_opts_t *opts)
+{
+    int32_t r;
+    struct ser_tx *tx;
+    pthread_condattr_t attr;
+    void *mem;
+    size_t i;
+    int pr;
+
+    ser->tx = NULL;
+
+    if (opts->tx.ring_sz == 0U)
+    {
+        return 0;
+    }
+
+    if (opts->tx.ring_sz > RING_SZ_MAX)
+    {
+        sererr_set("Transmit ring too large");
+        return SER_EINVAL;
+    }
+
+    if (opts->tx.classes > SER_TX_CLASSES_MAX)
+    {
+        sererr_set("Too many transmit priority classes (max %u)",
+                   SER_TX_CLASSES_MAX);
+        return SER_EINVAL;
+    }
+
+    r = rt_mem_alloc(&mem, sizeof(*tx), CACHE_LINE, &opts->rt);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    tx = mem;
+    tx->rt = opts->rt;
+
+    tx->nclasses = (opts->tx.classes > 0U) ? opts->tx.classes : 1U;
+    tx->sz = round_pow2(opts->tx.ring_sz);
+    tx->frames_sz = round_pow2(tx->sz / FRAME_SZ_AVG);
+    if (tx->frames_sz < FRAMES_SZ_MIN)
+    {
+        tx->frames_sz = FRAMES_SZ_MIN;
+    }
+
+    /* outcomes are kept until twice the frames capacity has been queued */
+    tx->results_sz = 2U * round_pow2(tx->nclasses * tx->frames_sz);
+
+    tx->fd = ser->fd;
+    tx->ser = ser;
+
+    r = rt_mem_alloc(&mem, tx->results_sz * sizeof(tx->results[0]),
+                     CACHE_LINE, &tx->rt);
+    if (r < 0)
+    {
+        goto cleanup_bufs;
+    }
+
+    tx->results = mem;
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        tx->classes[i].weight = (tx->nclasses > 1U) ? opts->tx.weights[i] : 0;
+
+        r = rt_mem_alloc(&mem, tx->sz, CACHE_LINE, &tx->rt);
+        if (r < 0)
+        {
+            goto cleanup_bufs;
+        }
+
+        tx->classes[i].buf = mem;
+
+        r = rt_mem_alloc(&mem, tx->frames_sz * sizeof(tx->classes[i].frames[0]),
+                         CACHE_LINE, &tx->rt);
+        if (r < 0)
+        {
+            goto cleanup_bufs;
+        }
+
+        tx->classes[i].frames = mem;
+    }
+
+    if (notifier_open(&tx->wake) < 0)
+    {
+        r = perr_setc(errno);
+        goto cleanup_bufs;
+    }
+
+    /* priority inheritance if real-time threads are used */
+    if (rt_mutex_init(&tx->lock, &tx->rt) != 0)
+    {
+        sererr_set("Could not initialize transmit lock");
+        r = SER_EFAIL;
+        goto cleanup_wake;
+    }
+
+    /* deadlines use the monotonic clock */
+    (void)pthread_condattr_init(&attr);
+#if !defined(__MACH__) || !defined(__APPLE__)
+    (void)pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+
+    (void)pthread_cond_init(&tx->data_cond, NULL);
+    (void)pthread_cond_init(&tx->room_cond, &attr);
+    (void)pthread_condattr_destroy(&attr);
+
+    pr = rt_thread_create(&tx->td, &tx->rt, tx_thread, tx);
+    if (pr != 0)
+    {
+        sererr_set("Could not start transmission thread: %s", strerror(pr));
+        r = SER_EFAIL;
+        goto cleanup_sync;
+    }
+
+    ser->tx = tx;
+
+    return 0;
+
+cleanup_sync:
+    (void)pthread_cond_destroy(&tx->room_cond);
+    (void)pthread_cond_destroy(&tx->data_cond);
+    (void)pthread_mutex_destroy(&tx->lock);
+
+cleanup_wake:
+    notifier_close(&tx->wake);
+
+cleanup_bufs:
+    tx_free_bufs(tx);
+    rt_mem_free(tx, sizeof(*tx), &opts->rt);
+
+    return r;
+}
+
+void tx_stop(ser_t *ser, const ser_deadline_t *deadline)
+{
+    struct ser_tx *tx = ser->tx;
+    ser_rt_t rt = tx->rt;
+
+    /* give queued frames a chance to be written */
+    (void)pthread_mutex_lock(&tx->lock);
+
+    while (tx_pending(tx) && !tx->stop)
+    {
+        if (cond_wait_until(&tx->room_cond, &tx->lock, deadline) < 0)
+        {
+            break;
+        }
+    }
+
+    tx->stop = true;
+    (void)pthread_cond_signal(&tx->data_cond);
+    (void)pthread_mutex_unlock(&tx->lock);
+
+    notifier_signal(&tx->wake);
+    (void)pthread_join(tx->td, NULL);
+
+    (void)pthread_cond_destroy(&tx->room_cond);
+    (void)pthread_cond_destroy(&tx->data_cond);
+    (void)pthread_mutex_destroy(&tx->lock);
+    notifier_close(&tx->wake);
+
+    tx_free_bufs(tx);
+    rt_mem_free(tx, sizeof(*tx), &rt);
+
+    ser->tx = NULL;
+}
+
+int32_t tx_enqueue(ser_t *ser, const ser_iov_t *iov, size_t iovcnt,
+                   uint8_t prio, const ser_deadline_t *expires,
+                   ser_tx_on_done_t on_done, void *ctx,
+                   const ser_deadline_t *deadline, uint64_t *seq)
+{
+    int32_t r = 0;
+    struct ser_tx *tx = ser->tx;
+    tx_class_t *cls;
+    tx_frame_t *frame;
+    size_t total = 0U;
+    size_t i;
+
+    for (i = 0U; i < iovcnt; i++)
+    {
+        total += iov[i].sz;
+    }
+
+    if ((total == 0U) || (total > tx->sz))
+    {
+        sererr_set("Frame size must be between 1 and %zu bytes", tx->sz);
+        return SER_EINVAL;
+    }
+
+    if (prio >= tx->nclasses)
+    {
+        sererr_set("Invalid priority class (max %zu)", tx->nclasses - 1U);
+        return SER_EINVAL;
+    }
+
+    cls = &tx->classes[prio];
+
+    (void)pthread_mutex_lock(&tx->lock);
+
+    /* wait for room (in the ring, in the frames queue, and for the outcome
+     * of the oldest pending frame not to be overwritten) */
+    for (;;)
+    {
+        if (tx->stop)
+        {
+            r = tx_error(tx);
+            goto out;
+        }
+
+        if (((tx->sz - (size_t)(cls->tail - cls->head)) >= total) &&
+            ((cls->frames_tail - cls->frames_head) < tx->frames_sz) &&
+            ((tx->seq + 1U - tx_oldest(tx)) < tx->results_sz))
+        {
+            break;
+        }
+
+        if (deadline == NULL)
+        {
+            sererr_set("Transmit queue is full");
+            r = SER_EBUSY;
+            goto out;
+        }
+
+        r = cond_wait_until(&tx->room_cond, &tx->lock, deadline);
+        if (r < 0)
+        {
+            goto out;
+        }
+    }
+
+    frame = &cls->frames[cls->frames_tail & (tx->frames_sz - 1U)];
+    frame->start = cls->tail;
+
+    /* copy frame into the ring */
+    for (i = 0U; i < iovcnt; i++)
+    {
+        size_t off = (size_t)cls->tail & (tx->sz - 1U);
+        size_t first;
+
+        first = iov[i].sz < (tx->sz - off) ? iov[i].sz : (tx->sz - off);
+        memcpy(&cls->buf[off], iov[i].buf, first);
+        memcpy(cls->buf, (const uint8_t *)iov[i].buf + first,
+               iov[i].sz - first);
+
+        cls->tail += (uint64_t)iov[i].sz;
+    }
+
+    frame->end = cls->tail;
+    frame->seq = ++tx->seq;
+    frame->expires = (expires == NULL) ? INT64_MAX :
+                     clock__deadline_ns(expires);
+    frame->on_done = on_done;
+    frame->ctx = ctx;
+    cls->frames_tail++;
+
+    tx->results[frame->seq & (tx->results_sz - 1U)] = RESULT_PENDING;
+
+    if (seq != NULL)
+    {
+        *seq = frame->seq;
+    }
+
+    (void)pthread_cond_signal(&tx->data_cond);
+
+out:
+    (void)pthread_mutex_unlock(&tx->lock);
+
+    return r;
+}
+
+int32_t tx_wait(ser_t *ser, uint64_t seq, const ser_deadline_t *deadline)
+{
+    int32_t r = 0;
+    struct ser_tx *tx = ser->tx;
+
+    (void)pthread_mutex_lock(&tx->lock);
+
+    if ((seq == 0U) || (seq > tx->seq))
+    {
+        sererr_set("Invalid frame sequence number");
+        r = SER_EINVAL;
+        goto out;
+    }
+
+    for (;;)
+    {
+        if ((tx->seq - seq) >= tx->results_sz)
+        {
+            sererr_set("Frame outcome is no longer available");
+            r = SER_EINVAL;
+            goto out;
+        }
+
+        r = tx->results[seq & (tx->results_sz - 1U)];
+        if (r != RESULT_PENDING)
+        {
+            break;
+        }
+
+        if (tx->stop)
+        {
+            r = tx_error(tx);
+            goto out;
+        }
+
+        r = cond_wait_until(&tx->room_cond, &tx->lock, deadline);
+        if (r < 0)
+        {
+            goto out;
+        }
+    }
+
+    /* completed, but not written */
+    if (r == SER_ETIMEDOUT)
+    {
+        sererr_set("Frame expired before being written");
+    }
+    else if (r < 0)
+    {
+        r = tx_error(tx);
+    }
+
+out:
+    (void)pthread_mutex_unlock(&tx->lock);
+
+    return r;
+}
+
+int32_t tx_drain(ser_t *ser, const ser_deadline_t *deadline)
+{
+    int32_t r = 0;
+    struct ser_tx *tx = ser->tx;
+
+    (void)pthread_mutex_lock(&tx->lock);
+
+    while (tx_pending(tx))
+    {
+        if (tx->stop)
+        {
+            r = tx_error(tx);
+            break;
+        }
+
+        r = cond_wait_until(&tx->room_cond, &tx->lock, deadline);
+        if (r < 0)
+        {
+            break;
+        }
+    }
+
+    (void)pthread_mutex_unlock(&tx->lock);
+
+    return r;
+}
+
+size_t tx_queued(ser_t *ser)
+{
+    struct ser_tx *tx = ser->tx;
+    size_t queued = 0U;
+    size_t i;
+
+    (void)pthread_mutex_lock(&tx->lock);
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        queued += (size_t)(tx->classes[i].tail - tx->classes[i].head);
+    }
+
+    (void)pthread_mutex_unlock(&tx->lock);
+
+    return queued;
+}
+
+void tx_stats(ser_t *ser, ser_tx_stats_t *stats)
+{
+    struct ser_tx *tx = ser->tx;
+    size_t i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    (void)pthread_mutex_lock(&tx->lock);
+
+    for (i = 0U; i < tx->nclasses; i++)
+    {
+        stats->classes[i].frames = tx->classes[i].sent;
+        stats->classes[i].bytes = tx->classes[i].bytes;
+        stats->classes[i].dropped = tx->classes[i].dropped;
+        stats->classes[i].queued = tx->classes[i].frames_tail -
+                                   tx->classes[i].frames_head;
+    }
+
+    (void)pthread_mutex_unlock(&tx->lock);
+}
@@ -0,0 +1,1779 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "public/sercomm/uring.h"
+#include "public/sercomm/comms.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "sercomm/err.h"
+#include "sercomm/posix/err.h"
+#include "sercomm/posix/types.h"
+#include "sercomm/posix/time.h"
+
+/*
+ * References:
+ *      - "Efficient IO with io_uring", Jens Axboe,
+ *        https://kernel.dk/io_uring.pdf
+ */
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Multishot read opcode (Linux >= 6.7, may be missing in system headers). */
+#define URING_OP_READ_MULTISHOT 49U
+
+/** Maximum number of SQEs needed by a single operation chain. */
+#define CHAIN_SQES_MAX          5U
+
+/** Reception buffers per operation. */
+#define RECV_BUFS_PER_OP        4U
+
+/** Maximum number of entries of a provided buffers ring. */
+#define RECV_BUFS_MAX           32768U
+
+/** Reception buffers group ID. */
+#define RECV_BGID               0U
+
+/** Number of bits used to encode the operation type in the user data. */
+#define UD_OP_BITS              3U
+
+/** Encode user data. */
+#define UD(slot, op)            (((uint64_t)(slot) << UD_OP_BITS) | (op))
+
+/** No deadline. */
+#define DEADLINE_NONE           -1
+
+/** Maximum number of operation slots. */
+#define DEPTH_MAX               4096U
+
+/** Maximum time to wait for cancellations when destroying (ms). */
+#define CANCEL_TIMEOUT          1000
+
+/** Operation type (encoded in the user data). */
+typedef enum
+{
+    /** Write request */
+    OP_WR,
+    /** Wait until writable/readable */
+    OP_POLL,
+    /** Read response */
+    OP_RD,
+    /** Linked timeout */
+    OP_LT,
+    /** Reception */
+    OP_RECV,
+    /** Reception cancellation */
+    OP_CANCEL
+} uring_op_t;
+
+/** Slot type. */
+typedef enum
+{
+    /** Free */
+    SLOT_FREE,
+    /** Transaction */
+    SLOT_XFER,
+    /** Reception */
+    SLOT_RECV
+} slot_type_t;
+
+/** Operation slot. */
+struct uring_slot
+{
+    /** Type */
+    slot_type_t type;
+    /** Port (NULL if the slot is pending to be released) */
+    ser_t *ser;
+    /** Registered buffer */
+    uint8_t *buf;
+    /** Operations pending completion */
+    unsigned inflight;
+    /** Queued, not yet submitted (regular I/O path only) */
+    bool queued;
+    /** Request size */
+    size_t req_sz;
+    /** Request bytes written */
+    size_t req_done;
+    /** Wait until writable before writing (previous write incomplete) */
+    bool wr_wait;
+    /** Expected response size */
+    size_t rsp_sz;
+    /** Response bytes read */
+    size_t rsp_done;
+    /** Deadline (ns, monotonic) */
+    int64_t deadline;
+    /** Deadline (for linked timeouts) */
+    struct __kernel_timespec ts;
+    /** Result */
+    int32_t result;
+    /** Transaction completion callback */
+    ser_uring_on_done_t on_done;
+    /** Reception callback */
+    ser_uring_on_data_t on_data;
+    /** Callback context */
+    void *ctx;
+};
+
+/** io_uring backend instance (Linux). */
+struct ser_uring
+{
+    /** Using io_uring */
+    bool native;
+    /** Ring file descriptor */
+    int fd;
+    /** Submission queue ring */
+    void *sq_ring;
+    /** Submission queue ring size */
+    size_t sq_ring_sz;
+    /** Completion queue ring (may be the same as the submission ring) */
+    void *cq_ring;
+    /** Completion queue ring size */
+    size_t cq_ring_sz;
+    /** Submission queue entries */
+    struct io_uring_sqe *sqes;
+    /** Submission queue entries size */
+    size_t sqes_sz;
+    /** Submission queue head */
+    unsigned *sq_head;
+    /** Submission queue tail */
+    unsigned *sq_tail;
+    /** Submission queue index array */
+    unsigned *sq_array;
+    /** Submission queue mask */
+    unsigned sq_mask;
+    /** Submission queue number of entries */
+    unsigned sq_entries;
+    /** Submission queue local tail (not yet published) */
+    unsigned sq_local_tail;
+    /** Completion queue head */
+    unsigned *cq_head;
+    /** Completion queue tail */
+    unsigned *cq_tail;
+    /** Completion queue mask */
+    unsigned cq_mask;
+    /** Completion queue entries */
+    struct io_uring_cqe *cqes;
+    /** Waiting with a timeout is supported */
+    bool ext_arg;
+    /** Buffers are registered */
+    bool fixed;
+    /** Readiness must be polled before reading (fd is non-blocking) */
+    bool poll_first;
+    /** Provided buffers ring for receptions */
+    struct io_uring_buf_ring *br;
+    /** Provided buffers ring size */
+    size_t br_sz;
+    /** Provided buffers ring number of entries */
+    unsigned br_entries;
+    /** Provided buffers (reception) */
+    uint8_t *rbufs;
+    /** Multishot reads are supported */
+    bool multishot;
+    /** Operation buffers */
+    uint8_t *bufs;
+    /** Operation buffer size */
+    size_t buf_sz;
+    /** Operation slots */
+    struct uring_slot *slots;
+    /** Number of operation slots */
+    uint32_t depth;
+    /** Number of dispatched callbacks (current run) */
+    int32_t dispatched;
+    /** Being destroyed (completions are only accounted) */
+    bool closing;
+};
+
+/**
+ * Compute remaining time until a deadline.
+ *
+ * @param [in] deadline
+ *      Deadline (ns), or DEADLINE_NONE.
+ *
+ * @return
+ *      Remaining time (ms, rounded up), -1 if there is no deadline.
+ */
+static int deadline_remaining_ms(int64_t deadline)
+{
+    int64_t remaining;
+
+    if (deadline == DEADLINE_NONE)
+    {
+        return -1;
+    }
+
+    remaining = deadline - clock__now_ns();
+    if (remaining <= 0)
+    {
+        return 0;
+    }
+
+    return (int)((remaining + 999999LL) / 1000000LL);
+}
+
+/**
+ * Round up to the next power of two.
+ *
+ * @param [in] v
+ *      Value.
+ *
+ * @return
+ *      Next power of two.
+ */
+static unsigned pow2_roundup(unsigned v)
+{
+    unsigned p = 1U;
+
+    while (p < v)
+    {
+        p <<= 1U;
+    }
+
+    return p;
+}
+
+/**
+ * Setup io_uring instance, map its rings.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] entries
+ *      Submission queue entries.
+ *
+ * @return
+ *      0 on success, negative errno otherwise.
+ */
+static int uring_setup(ser_uring_t *ring, unsigned entries)
+{
+    struct io_uring_params p;
+    uint8_t *sq;
+    uint8_t *cq;
+    int r;
+
+    memset(&p, 0, sizeof(p));
+#ifdef IORING_SETUP_COOP_TASKRUN
+    /* completions are only reaped when entering the kernel anyway */
+    p.flags = IORING_SETUP_COOP_TASKRUN;
+#endif
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if ((ring->fd < 0) && (errno == EINVAL) && (p.flags != 0U))
+    {
+        memset(&p, 0, sizeof(p));
+        ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    }
+
+    if (ring->fd < 0)
+    {
+        return -errno;
+    }
+
+    ring->sq_ring_sz = p.sq_off.array + (p.sq_entries * sizeof(unsigned));
+    ring->cq_ring_sz = p.cq_off.cqes +
+                       (p.cq_entries * sizeof(struct io_uring_cqe));
+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0U)
+    {
+        if (ring->cq_ring_sz > ring->sq_ring_sz)
+        {
+            ring->sq_ring_sz = ring->cq_ring_sz;
+        }
+        ring->cq_ring_sz = ring->sq_ring_sz;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_sz, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd,
+                         IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        goto cleanup_fd;
+    }
+
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0U)
+    {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_sz, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ring->fd,
+                             IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+        {
+            goto cleanup_sq;
+        }
+    }
+
+    ring->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_sz, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        goto cleanup_cq;
+    }
+
+    sq = ring->sq_ring;
+    ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+
+    cq = ring->cq_ring;
+    ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    ring->ext_arg = ((p.features & IORING_FEAT_EXT_ARG) != 0U);
+
+    return 0;
+
+cleanup_cq:
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        (void)munmap(ring->cq_ring, ring->cq_ring_sz);
+    }
+
+cleanup_sq:
+    (void)munmap(ring->sq_ring, ring->sq_ring_sz);
+
+cleanup_fd:
+    r = -errno;
+    close(ring->fd);
+
+    return r;
+}
+
+/**
+ * Release io_uring instance resources.
+ *
+ * @param [in] ring
+ *      Instance.
+ */
+static void uring_release(ser_uring_t *ring)
+{
+    if (ring->br != NULL)
+    {
+        (void)munmap(ring->br, ring->br_sz);
+    }
+
+    (void)munmap(ring->sqes, ring->sqes_sz);
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        (void)munmap(ring->cq_ring, ring->cq_ring_sz);
+    }
+    (void)munmap(ring->sq_ring, ring->sq_ring_sz);
+
+    close(ring->fd);
+}
+
+/**
+ * Register operation buffers and the reception provided buffers ring.
+ *
+ * @note
+ *      Failures are not fatal, unregistered buffers are used instead.
+ *
+ * @param [in] ring
+ *      Instance.
+ */
+static void uring_register(ser_uring_t *ring)
+{
+    struct iovec *iovs;
+    struct io_uring_buf_reg reg;
+    uint32_t i;
+
+    /* operation buffers (one per slot) */
+    iovs = calloc(ring->depth, sizeof(*iovs));
+    if (iovs != NULL)
+    {
+        for (i = 0U; i < ring->depth; i++)
+        {
+            iovs[i].iov_base = ring->slots[i].buf;
+            iovs[i].iov_len = ring->buf_sz;
+        }
+
+        ring->fixed = (syscall(__NR_io_uring_register, ring->fd,
+                               IORING_REGISTER_BUFFERS, iovs,
+                               ring->depth) == 0);
+
+        free(iovs);
+    }
+
+    /* provided buffers ring (receptions) */
+    ring->br_sz = ring->br_entries * sizeof(struct io_uring_buf);
+    ring->br = mmap(NULL, ring->br_sz, PROT_READ | PROT_WRITE,
+                    MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring->br == MAP_FAILED)
+    {
+        ring->br = NULL;
+        return;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->br;
+    reg.ring_entries = ring->br_entries;
+    reg.bgid = RECV_BGID;
+
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING,
+                &reg, 1) < 0)
+    {
+        (void)munmap(ring->br, ring->br_sz);
+        ring->br = NULL;
+        return;
+    }
+
+    /* provide all buffers */
+    for (i = 0U; i < ring->br_entries; i++)
+    {
+        ring->br->bufs[i].addr = (uint64_t)(uintptr_t)(ring->rbufs +
+                                                        (i * ring->buf_sz));
+        ring->br->bufs[i].len = (uint32_t)ring->buf_sz;
+        ring->br->bufs[i].bid = (uint16_t)i;
+    }
+
+    __atomic_store_n(&ring->br->tail, (uint16_t)ring->br_entries,
+                     __ATOMIC_RELEASE);
+
+    ring->multishot = true;
+}
+
+/**
+ * Give a reception buffer back to the kernel.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] bid
+ *      Buffer ID.
+ */
+static void uring_recycle(ser_uring_t *ring, uint16_t bid)
+{
+    uint16_t tail;
+    struct io_uring_buf *b;
+
+    tail = ring->br->tail;
+    b = &ring->br->bufs[tail & (ring->br_entries - 1U)];
+
+    b->addr = (uint64_t)(uintptr_t)(ring->rbufs + (bid * ring->buf_sz));
+    b->len = (uint32_t)ring->buf_sz;
+    b->bid = bid;
+
+    __atomic_store_n(&ring->br->tail, (uint16_t)(tail + 1U), __ATOMIC_RELEASE);
+}
+
+/**
+ * Enter the kernel: submit pending entries and optionally wait.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] wait
+ *      Wait for at least one completion.
+ * @param [in] timeout
+ *      Wait timeout (ms), -1 for infinite.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t uring_enter(ser_uring_t *ring, bool wait, int timeout)
+{
+    unsigned to_submit;
+    unsigned flags = 0U;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    void *argp = NULL;
+    size_t argsz = 0U;
+    int r;
+
+    /* publish new entries */
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    to_submit = ring->sq_local_tail -
+                __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    /* no support for wait timeouts: submit, then poll the ring */
+    if (wait && (timeout >= 0) && !ring->ext_arg)
+    {
+        struct pollfd pfd;
+
+        r = uring_enter(ring, false, 0);
+        if (r < 0)
+        {
+            return r;
+        }
+
+        pfd.fd = ring->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if ((poll(&pfd, 1U, timeout) < 0) && (errno != EINTR))
+        {
+            return perr_setc(errno);
+        }
+
+        return 0;
+    }
+
+    if (wait)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+
+        if (timeout >= 0)
+        {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (long long)(timeout % 1000) * 1000000LL;
+
+            memset(&arg, 0, sizeof(arg));
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+    }
+
+    do
+    {
+        r = (int)syscall(__NR_io_uring_enter, ring->fd, to_submit,
+                         wait ? 1U : 0U, flags, argp, argsz);
+    } while ((r < 0) && (errno == EINTR));
+
+    if ((r < 0) && (errno != ETIME) && (errno != EBUSY))
+    {
+        return perr_setc(errno);
+    }
+
+    return 0;
+}
+
+/**
+ * Obtain a number of consecutive submission queue entries.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] n
+ *      Number of entries.
+ *
+ * @return
+ *      First entry (NULL if not available).
+ */
+static struct io_uring_sqe *uring_sqes_get(ser_uring_t *ring, unsigned n)
+{
+    unsigned i;
+    unsigned used;
+
+    /* make room, so that chains are never split between submissions */
+    used = ring->sq_local_tail -
+           __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if ((ring->sq_entries - used) < n)
+    {
+        if (uring_enter(ring, false, 0) < 0)
+        {
+            return NULL;
+        }
+
+        used = ring->sq_local_tail -
+               __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if ((ring->sq_entries - used) < n)
+        {
+            sererr_set("Submission queue is full");
+            return NULL;
+        }
+    }
+
+    for (i = 0U; i < n; i++)
+    {
+        unsigned idx = (ring->sq_local_tail + i) & ring->sq_mask;
+
+        memset(&ring->sqes[idx], 0, sizeof(ring->sqes[idx]));
+        ring->sq_array[idx] = idx;
+    }
+
+    return &ring->sqes[ring->sq_local_tail & ring->sq_mask];
+}
+
+/**
+ * Take the next submission queue entry (previously obtained).
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] slot
+ *      Slot index.
+ * @param [in] op
+ *      Operation.
+ * @param [in] fd
+ *      File descriptor.
+ *
+ * @return
+ *      Submission queue entry.
+ */
+static struct io_uring_sqe *uring_sqe_next(ser_uring_t *ring, uint32_t slot,
+                                           uring_op_t op, int fd)
+{
+    struct io_uring_sqe *sqe;
+
+    sqe = &ring->sqes[ring->sq_local_tail & ring->sq_mask];
+    ring->sq_local_tail++;
+
+    sqe->fd = fd;
+    sqe->user_data = UD(slot, op);
+
+    ring->slots[slot].inflight++;
+
+    return sqe;
+}
+
+/**
+ * Prepare a read/write submission queue entry.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] sqe
+ *      Submission queue entry.
+ * @param [in] write
+ *      Write (true) or read (false).
+ * @param [in] slot
+ *      Slot index.
+ * @param [in] offset
+ *      Offset within the slot buffer.
+ * @param [in] len
+ *      Length.
+ */
+static void uring_prep_rw(ser_uring_t *ring, struct io_uring_sqe *sqe,
+                          bool write, uint32_t slot, size_t offset, size_t len)
+{
+    if (ring->fixed)
+    {
+        sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+        sqe->buf_index = (uint16_t)slot;
+    }
+    else
+    {
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+
+    sqe->addr = (uint64_t)(uintptr_t)(ring->slots[slot].buf + offset);
+    sqe->len = (uint32_t)len;
+    sqe->off = (uint64_t)-1;
+}
+
+/**
+ * Prepare a poll submission queue entry.
+ *
+ * @param [in] sqe
+ *      Submission queue entry.
+ * @param [in] events
+ *      Poll events.
+ */
+static void uring_prep_poll(struct io_uring_sqe *sqe, unsigned events)
+{
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->poll32_events = events;
+}
+
+/**
+ * Queue a linked timeout (if the slot has a deadline).
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] slot
+ *      Slot index.
+ * @param [in] prev
+ *      Entry the timeout applies to.
+ */
+static void uring_queue_lt(ser_uring_t *ring, uint32_t slot,
+                           struct io_uring_sqe *prev)
+{
+    struct uring_slot *s = &ring->slots[slot];
+    struct io_uring_sqe *sqe;
+
+    if (s->deadline == DEADLINE_NONE)
+    {
+        return;
+    }
+
+    prev->flags |= IOSQE_IO_LINK;
+
+    sqe = uring_sqe_next(ring, slot, OP_LT, -1);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->addr = (uint64_t)(uintptr_t)&s->ts;
+    sqe->len = 1U;
+    sqe->timeout_flags = IORING_TIMEOUT_ABS;
+}
+
+/**
+ * Link the last queued entry with the next one.
+ *
+ * @param [in] ring
+ *      Instance.
+ */
+static void uring_link_last(ser_uring_t *ring)
+{
+    ring->sqes[(ring->sq_local_tail - 1U) & ring->sq_mask].flags |=
+        IOSQE_IO_LINK;
+}
+
+/**
+ * Queue transaction operations (write remaining request, read remaining
+ * response).
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] slot
+ *      Slot index.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t xfer_queue(ser_uring_t *ring, uint32_t slot)
+{
+    struct uring_slot *s = &ring->slots[slot];
+    struct io_uring_sqe *sqe;
+    int fd = s->ser->fd;
+
+    if (uring_sqes_get(ring, CHAIN_SQES_MAX) == NULL)
+    {
+        return SER_EFAIL;
+    }
+
+    /* write: [poll -> timeout ->] write */
+    if (s->req_done < s->req_sz)
+    {
+        if (s->wr_wait)
+        {
+            sqe = uring_sqe_next(ring, slot, OP_POLL, fd);
+            uring_prep_poll(sqe, POLLOUT);
+            uring_queue_lt(ring, slot, sqe);
+            uring_link_last(ring);
+        }
+
+        sqe = uring_sqe_next(ring, slot, OP_WR, fd);
+        uring_prep_rw(ring, sqe, true, slot, s->req_done,
+                      s->req_sz - s->req_done);
+
+        if (s->rsp_done < s->rsp_sz)
+        {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+    }
+
+    /* read: [poll -> timeout ->] read [-> timeout] */
+    if (s->rsp_done < s->rsp_sz)
+    {
+        if (ring->poll_first)
+        {
+            sqe = uring_sqe_next(ring, slot, OP_POLL, fd);
+            uring_prep_poll(sqe, POLLIN);
+            uring_queue_lt(ring, slot, sqe);
+            uring_link_last(ring);
+        }
+
+        sqe = uring_sqe_next(ring, slot, OP_RD, fd);
+        uring_prep_rw(ring, sqe, false, slot, s->rsp_done,
+                      s->rsp_sz - s->rsp_done);
+
+        if (!ring->poll_first)
+        {
+            uring_queue_lt(ring, slot, sqe);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Queue reception operation.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] slot
+ *      Slot index.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t recv_queue(ser_uring_t *ring, uint32_t slot)
+{
+    struct uring_slot *s = &ring->slots[slot];
+    struct io_uring_sqe *sqe;
+    int fd = s->ser->fd;
+
+    if (uring_sqes_get(ring, 2U) == NULL)
+    {
+        return SER_EFAIL;
+    }
+
+    if (ring->poll_first)
+    {
+        sqe = uring_sqe_next(ring, slot, OP_POLL, fd);
+        uring_prep_poll(sqe, POLLIN);
+        sqe->flags |= IOSQE_IO_LINK;
+    }
+
+    sqe = uring_sqe_next(ring, slot, OP_RECV, fd);
+
+    if (ring->br != NULL)
+    {
+        /* kernel picks a provided buffer */
+        sqe->opcode = (ring->multishot && !ring->poll_first) ?
+                      URING_OP_READ_MULTISHOT : IORING_OP_READ;
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = RECV_BGID;
+        sqe->off = (uint64_t)-1;
+        if (sqe->opcode == IORING_OP_READ)
+        {
+            sqe->len = (uint32_t)ring->buf_sz;
+        }
+    }
+    else
+    {
+        uring_prep_rw(ring, sqe, false, slot, 0U, ring->buf_sz);
+    }
+
+    return 0;
+}
+
+/**
+ * Release a slot.
+ *
+ * @param [in] s
+ *      Slot.
+ */
+static void slot_release(struct uring_slot *s)
+{
+    s->type = SLOT_FREE;
+    s->ser = NULL;
+    s->queued = false;
+}
+
+/**
+ * Complete a transaction.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] s
+ *      Slot.
+ */
+static void xfer_complete(ser_uring_t *ring, struct uring_slot *s)
+{
+    ser_t *ser = s->ser;
+
+    /* keep slot reserved during the callback, so that its buffer is valid
+     * while new transactions can be queued for the same port */
+    s->ser = NULL;
+
+    s->on_done(s->ctx, ser, s->result, s->buf, s->rsp_done);
+    ring->dispatched++;
+
+    slot_release(s);
+}
+
+/**
+ * Continue a transaction after all its in-flight operations completed.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] slot
+ *      Slot index.
+ */
+static void xfer_step(ser_uring_t *ring, uint32_t slot)
+{
+    struct uring_slot *s = &ring->slots[slot];
+
+    if ((s->result == 0) &&
+        ((s->req_done < s->req_sz) || (s->rsp_done < s->rsp_sz)))
+    {
+        if ((s->deadline != DEADLINE_NONE) && (clock__now_ns() >= s->deadline))
+        {
+            sererr_set("Operation timed out");
+            s->result = SER_ETIMEDOUT;
+        }
+        else
+        {
+            s->result = xfer_queue(ring, slot);
+            if (s->result == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    xfer_complete(ring, s);
+}
+
+/**
+ * Process a transaction completion.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] slot
+ *      Slot index.
+ * @param [in] op
+ *      Operation.
+ * @param [in] res
+ *      Completion result.
+ */
+static void xfer_process(ser_uring_t *ring, uint32_t slot, uring_op_t op,
+                         int res)
+{
+    struct uring_slot *s = &ring->slots[slot];
+
+    switch (op)
+    {
+        case OP_WR:
+            if (res > 0)
+            {
+                s->req_done += (size_t)res;
+            }
+            else if ((res < 0) && (res != -EAGAIN) && (res != -ECANCELED) &&
+                     (s->result == 0))
+            {
+                s->result = perr_setc(-res);
+            }
+
+            /* incomplete write: wait until writable on retry */
+            s->wr_wait = (s->req_done < s->req_sz);
+            break;
+        case OP_RD:
+            if (res > 0)
+            {
+                s->rsp_done += (size_t)res;
+            }
+            else if (res == -EAGAIN)
+            {
+                /* fd is non-blocking for io_uring: poll before reading */
+                ring->poll_first = true;
+            }
+            else if ((res == 0) && (s->result == 0))
+            {
+                s->result = perr_setc(EIO);
+            }
+            else if ((res < 0) && (res != -ECANCELED) && (s->result == 0))
+            {
+                s->result = perr_setc(-res);
+            }
+            break;
+        case OP_POLL:
+            if ((res < 0) && (res != -ECANCELED) && (s->result == 0))
+            {
+                s->result = perr_setc(-res);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (s->inflight == 0U)
+    {
+        xfer_step(ring, slot);
+    }
+}
+
+/**
+ * Process a reception completion.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] slot
+ *      Slot index.
+ * @param [in] op
+ *      Operation.
+ * @param [in] cqe
+ *      Completion queue entry.
+ */
+static void recv_process(ser_uring_t *ring, uint32_t slot, uring_op_t op,
+                         const struct io_uring_cqe *cqe)
+{
+    struct uring_slot *s = &ring->slots[slot];
+    int32_t result = 0;
+
+    if ((op == OP_RECV) && (s->ser != NULL))
+    {
+        if (cqe->res > 0)
+        {
+            const uint8_t *data = s->buf;
+
+            if ((cqe->flags & IORING_CQE_F_BUFFER) != 0U)
+            {
+                data = ring->rbufs +
+                       ((cqe->flags >> IORING_CQE_BUFFER_SHIFT) * ring->buf_sz);
+            }
+
+            s->on_data(s->ctx, s->ser, 0, data, (size_t)cqe->res);
+            ring->dispatched++;
+        }
+        else if ((cqe->res == -EINVAL) && ring->multishot)
+        {
+            /* multishot reads not supported by the running kernel */
+            ring->multishot = false;
+        }
+        else if (cqe->res == -EAGAIN)
+        {
+            ring->poll_first = true;
+        }
+        else if (cqe->res == 0)
+        {
+            result = perr_setc(EIO);
+        }
+        else if ((cqe->res != -ENOBUFS) && (cqe->res != -ECANCELED))
+        {
+            result = perr_setc(-cqe->res);
+        }
+    }
+    else if ((op == OP_POLL) && (cqe->res < 0) && (cqe->res != -ECANCELED) &&
+             (s->ser != NULL))
+    {
+        result = perr_setc(-cqe->res);
+    }
+
+    if ((cqe->flags & IORING_CQE_F_BUFFER) != 0U)
+    {
+        uring_recycle(ring, (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+    }
+
+    /* reception failed: notify and stop */
+    if (result < 0)
+    {
+        ser_t *ser = s->ser;
+
+        s->ser = NULL;
+        s->on_data(s->ctx, ser, result, NULL, 0U);
+        ring->dispatched++;
+    }
+
+    if (s->inflight == 0U)
+    {
+        /* stopped (or failed) */
+        if (s->ser == NULL)
+        {
+            slot_release(s);
+        }
+        /* re-arm */
+        else if (recv_queue(ring, slot) < 0)
+        {
+            ser_t *ser = s->ser;
+
+            s->ser = NULL;
+            s->on_data(s->ctx, ser, SER_EFAIL, NULL, 0U);
+            ring->dispatched++;
+            slot_release(s);
+        }
+    }
+}
+
+/**
+ * Reap and process all available completions.
+ *
+ * @param [in] ring
+ *      Instance.
+ */
+static void uring_reap(ser_uring_t *ring)
+{
+    unsigned head;
+
+    head = *ring->cq_head;
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+        struct io_uring_cqe cqe;
+        uint32_t slot;
+        uring_op_t op;
+
+        cqe = ring->cqes[head & ring->cq_mask];
+        head++;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        slot = (uint32_t)(cqe.user_data >> UD_OP_BITS);
+        op = (uring_op_t)(cqe.user_data & ((1U << UD_OP_BITS) - 1U));
+
+        /* multishot operations stay in-flight while more are expected */
+        if ((op != OP_RECV) || ((cqe.flags & IORING_CQE_F_MORE) == 0U))
+        {
+            ring->slots[slot].inflight--;
+        }
+
+        if (ring->closing)
+        {
+            continue;
+        }
+
+        if (ring->slots[slot].type == SLOT_XFER)
+        {
+            xfer_process(ring, slot, op, cqe.res);
+        }
+        else if (ring->slots[slot].type == SLOT_RECV)
+        {
+            recv_process(ring, slot, op, &cqe);
+        }
+    }
+}
+
+/**
+ * Cancel all in-flight operations and wait until they complete.
+ *
+ * @note
+ *      Buffers can not be released while the kernel may still use them.
+ *
+ * @param [in] ring
+ *      Instance.
+ */
+static void uring_cancel_all(ser_uring_t *ring)
+{
+    static const uring_op_t ops[] = { OP_WR, OP_POLL, OP_RD, OP_RECV };
+    uint32_t i;
+    size_t j;
+    int64_t deadline;
+    bool busy = true;
+
+    ring->closing = true;
+
+    for (i = 0U; i < ring->depth; i++)
+    {
+        if (ring->slots[i].inflight == 0U)
+        {
+            continue;
+        }
+
+        for (j = 0U; j < (sizeof(ops) / sizeof(ops[0])); j++)
+        {
+            struct io_uring_sqe *sqe;
+
+            if (uring_sqes_get(ring, 1U) == NULL)
+            {
+                break;
+            }
+
+            sqe = uring_sqe_next(ring, i, OP_CANCEL, -1);
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = UD(i, ops[j]);
+        }
+    }
+
+    deadline = clock__now_ns() + ((int64_t)CANCEL_TIMEOUT * 1000000LL);
+
+    while (busy && (clock__now_ns() < deadline))
+    {
+        if (uring_enter(ring, true, deadline_remaining_ms(deadline)) < 0)
+        {
+            break;
+        }
+
+        uring_reap(ring);
+
+        busy = false;
+        for (i = 0U; (i < ring->depth) && !busy; i++)
+        {
+            busy = (ring->slots[i].inflight > 0U);
+        }
+    }
+}
+
+/**
+ * Wait until a port is ready or the deadline expires (regular I/O path).
+ *
+ * @param [in] fd
+ *      File descriptor.
+ * @param [in] events
+ *      Poll events.
+ * @param [in] deadline
+ *      Deadline (ns), or DEADLINE_NONE.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t fallback_wait(int fd, short events, int64_t deadline)
+{
+    struct pollfd pfd;
+    int s;
+
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    do
+    {
+        s = poll(&pfd, 1U, deadline_remaining_ms(deadline));
+    } while ((s < 0) && (errno == EINTR));
+
+    if (s == 0)
+    {
+        sererr_set("Operation timed out");
+        return SER_ETIMEDOUT;
+    }
+    else if (s < 0)
+    {
+        return perr_setc(errno);
+    }
+
+    return 0;
+}
+
+/**
+ * Perform a transaction using the regular I/O path.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] s
+ *      Slot.
+ */
+static void fallback_xfer(ser_uring_t *ring, struct uring_slot *s)
+{
+    int fd = s->ser->fd;
+
+    while ((s->result == 0) && (s->req_done < s->req_sz))
+    {
+        ssize_t n;
+
+        n = write(fd, s->buf + s->req_done, s->req_sz - s->req_done);
+        if (n > 0)
+        {
+            s->req_done += (size_t)n;
+        }
+        else if ((n < 0) && (errno == EAGAIN))
+        {
+            s->result = fallback_wait(fd, POLLOUT, s->deadline);
+        }
+        else
+        {
+            s->result = perr_setc((n == 0) ? EIO : errno);
+        }
+    }
+
+    while ((s->result == 0) && (s->rsp_done < s->rsp_sz))
+    {
+        ssize_t n;
+
+        n = read(fd, s->buf + s->rsp_done, s->rsp_sz - s->rsp_done);
+        if (n > 0)
+        {
+            s->rsp_done += (size_t)n;
+        }
+        else if ((n < 0) && (errno == EAGAIN))
+        {
+            s->result = fallback_wait(fd, POLLIN, s->deadline);
+        }
+        else
+        {
+            s->result = perr_setc((n == 0) ? EIO : errno);
+        }
+    }
+
+    xfer_complete(ring, s);
+}
+
+/**
+ * Submit, wait and dispatch using the regular I/O path.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] timeout
+ *      Maximum wait time (ms), -1 for infinite.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t fallback_run(ser_uring_t *ring, int timeout)
+{
+    struct pollfd *pfds;
+    uint32_t *idxs;
+    nfds_t n = 0U;
+    uint32_t i;
+    int s;
+
+    /* transactions are performed synchronously */
+    for (i = 0U; i < ring->depth; i++)
+    {
+        if ((ring->slots[i].type == SLOT_XFER) && ring->slots[i].queued)
+        {
+            ring->slots[i].queued = false;
+            fallback_xfer(ring, &ring->slots[i]);
+        }
+    }
+
+    /* receptions: wait for any of them */
+    pfds = calloc(ring->depth, sizeof(*pfds));
+    idxs = calloc(ring->depth, sizeof(*idxs));
+    if ((pfds == NULL) || (idxs == NULL))
+    {
+        free(pfds);
+        free(idxs);
+        sererr_set("%s", strerror(errno));
+        return SER_EFAIL;
+    }
+
+    for (i = 0U; i < ring->depth; i++)
+    {
+        if ((ring->slots[i].type == SLOT_RECV) && (ring->slots[i].ser != NULL))
+        {
+            pfds[n].fd = ring->slots[i].ser->fd;
+            pfds[n].events = POLLIN;
+            idxs[n] = i;
+            n++;
+        }
+    }
+
+    if (n > 0U)
+    {
+        if (ring->dispatched > 0)
+        {
+            timeout = 0;
+        }
+
+        do
+        {
+            s = poll(pfds, n, timeout);
+        } while ((s < 0) && (errno == EINTR));
+
+        for (i = 0U; (s > 0) && (i < (uint32_t)n); i++)
+        {
+            struct uring_slot *sl = &ring->slots[idxs[i]];
+            ssize_t rd;
+            ser_t *ser;
+
+            if ((pfds[i].revents == 0) || (sl->ser == NULL))
+            {
+                continue;
+            }
+
+            rd = read(sl->ser->fd, sl->buf, ring->buf_sz);
+            if (rd > 0)
+            {
+                sl->on_data(sl->ctx, sl->ser, 0, sl->buf, (size_t)rd);
+            }
+            else if ((rd < 0) && (errno == EAGAIN))
+            {
+                continue;
+            }
+            else
+            {
+                ser = sl->ser;
+                slot_release(sl);
+                sl->on_data(sl->ctx, ser, perr_setc((rd == 0) ? EIO : errno),
+                            NULL, 0U);
+            }
+
+            ring->dispatched++;
+        }
+    }
+
+    free(pfds);
+    free(idxs);
+
+    return 0;
+}
+
+/**
+ * Find the slot of a port.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] ser
+ *      Port.
+ *
+ * @return
+ *      Slot (NULL if not found).
+ */
+static struct uring_slot *slot_find(ser_uring_t *ring, const ser_t *ser)
+{
+    uint32_t i;
+
+    for (i = 0U; i < ring->depth; i++)
+    {
+        if ((ring->slots[i].type != SLOT_FREE) && (ring->slots[i].ser == ser))
+        {
+            return &ring->slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Check a port can be used by the ring.
+ *
+ * @param [in] ser
+ *      Port.
+ * @param [in] wr
+ *      Port is written (transactions).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_check(const ser_t *ser, bool wr)
+{
+    /* the port is drained by the reception thread */
+    if (ser->rx != NULL)
+    {
+        sererr_set("Not available with background reception");
+        return SER_ENOTSUP;
+    }
+
+    /* writes would bypass the transmission queue */
+    if (wr && (ser->tx != NULL))
+    {
+        sererr_set("Not available with asynchronous transmission");
+        return SER_ENOTSUP;
+    }
+
+    return 0;
+}
+
+/**
+ * Allocate a slot for a port.
+ *
+ * @param [in] ring
+ *      Instance.
+ * @param [in] ser
+ *      Port.
+ * @param [in] type
+ *      Slot type.
+ *
+ * @return
+ *      Slot index on success, error code otherwise.
+ */
+static int32_t slot_alloc(ser_uring_t *ring, ser_t *ser, slot_type_t type)
+{
+    uint32_t i;
+
+    if (slot_find(ring, ser) != NULL)
+    {
+        sererr_set("Port has an operation in-flight");
+        return SER_EBUSY;
+    }
+
+    for (i = 0U; i < ring->depth; i++)
+    {
+        struct uring_slot *s = &ring->slots[i];
+
+        if (s->type == SLOT_FREE)
+        {
+            uint8_t *buf = s->buf;
+
+            memset(s, 0, sizeof(*s));
+            s->type = type;
+            s->ser = ser;
+            s->buf = buf;
+            s->deadline = DEADLINE_NONE;
+
+            return (int32_t)i;
+        }
+    }
+
+    sererr_set("Too many operations in-flight");
+    return SER_EBUSY;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+ser_uring_t *ser_uring_create(uint32_t depth, size_t buf_sz)
+{
+    ser_uring_t *ring;
+    uint32_t i;
+    int r;
+
+    if ((depth == 0U) || (depth > DEPTH_MAX) || (buf_sz == 0U))
+    {
+        sererr_set("Invalid depth or buffer size");
+        return NULL;
+    }
+
+    ring = calloc(1U, sizeof(*ring));
+    if (ring == NULL)
+    {
+        sererr_set("%s", strerror(errno));
+        goto out;
+    }
+
+    ring->depth = depth;
+    ring->buf_sz = buf_sz;
+    ring->br_entries = pow2_roundup(depth * RECV_BUFS_PER_OP);
+    if (ring->br_entries > RECV_BUFS_MAX)
+    {
+        ring->br_entries = RECV_BUFS_MAX;
+    }
+
+    ring->slots = calloc(depth, sizeof(*ring->slots));
+    if (ring->slots == NULL)
+    {
+        sererr_set("%s", strerror(errno));
+        goto cleanup_ring;
+    }
+
+    /* operation buffers (page aligned, so that they can be registered) */
+    r = posix_memalign((void **)&ring->bufs, (size_t)sysconf(_SC_PAGESIZE),
+                       depth * buf_sz);
+    if (r != 0)
+    {
+        sererr_set("%s", strerror(r));
+        goto cleanup_slots;
+    }
+
+    for (i = 0U; i < depth; i++)
+    {
+        ring->slots[i].buf = ring->bufs + (i * buf_sz);
+    }
+
+    /* setup io_uring, use the regular I/O path if not available */
+    r = uring_setup(ring, pow2_roundup(depth * CHAIN_SQES_MAX));
+    if (r == 0)
+    {
+        ring->rbufs = malloc(ring->br_entries * buf_sz);
+        if (ring->rbufs == NULL)
+        {
+            sererr_set("%s", strerror(errno));
+            uring_release(ring);
+            goto cleanup_bufs;
+        }
+
+        ring->native = true;
+        uring_register(ring);
+    }
+    else if ((r != -ENOSYS) && (r != -EPERM))
+    {
+        sererr_set("%s", strerror(-r));
+        goto cleanup_bufs;
+    }
+
+    goto out;
+
+cleanup_bufs:
+    free(ring->bufs);
+
+cleanup_slots:
+    free(ring->slots);
+
+cleanup_ring:
+    free(ring);
+    ring = NULL;
+
+out:
+    return ring;
+}
+
+void ser_uring_destroy(ser_uring_t *ring)
+{
+    if (ring->native)
+    {
+        uring_cancel_all(ring);
+        uring_release(ring);
+        free(ring->rbufs);
+    }
+
+    free(ring->bufs);
+    free(ring->slots);
+    free(ring);
+}
+
+int ser_uring_is_native(ser_uring_t *ring)
+{
+    return ring->native ? 1 : 0;
+}
+
+int32_t ser_uring_transact(ser_uring_t *ring, ser_t *ser, const void *req,
+                           size_t req_sz, size_t rsp_sz, int32_t timeout,
+                           ser_uring_on_done_t on_done, void *ctx)
+{
+    int32_t r;
+    struct uring_slot *s;
+
+    if ((req_sz > ring->buf_sz) || (rsp_sz > ring->buf_sz) || (timeout < 0))
+    {
+        sererr_set("Invalid request/response size or timeout");
+        return SER_EINVAL;
+    }
+
+    r = port_check(ser, true);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    r = slot_alloc(ring, ser, SLOT_XFER);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    s = &ring->slots[r];
+
+    memcpy(s->buf, req, req_sz);
+    s->req_sz = req_sz;
+    s->rsp_sz = rsp_sz;
+    s->on_done = on_done;
+    s->ctx = ctx;
+
+    if (timeout != SER_NO_TIMEOUT)
+    {
+        s->deadline = clock__now_ns() + ((int64_t)timeout * 1000000LL);
+        s->ts.tv_sec = s->deadline / 1000000000LL;
+        s->ts.tv_nsec = s->deadline % 1000000000LL;
+    }
+
+    if (ring->native)
+    {
+        r = xfer_queue(ring, (uint32_t)r);
+        if (r < 0)
+        {
+            slot_release(s);
+            return r;
+        }
+    }
+    else
+    {
+        s->queued = true;
+    }
+
+    return 0;
+}
+
+int32_t ser_uring_recv_start(ser_uring_t *ring, ser_t *ser,
+                             ser_uring_on_data_t on_data, void *ctx)
+{
+    int32_t r;
+    struct uring_slot *s;
+
+    r = port_check(ser, false);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    r = slot_alloc(ring, ser, SLOT_RECV);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    s = &ring->slots[r];
+
+    s->on_data = on_data;
+    s->ctx = ctx;
+
+    if (ring->native)
+    {
+        r = recv_queue(ring, (uint32_t)r);
+        if (r < 0)
+        {
+            slot_release(s);
+            return r;
+        }
+    }
+
+    return 0;
+}
+
+int32_t ser_uring_recv_stop(ser_uring_t *ring, ser_t *ser)
+{
+    struct uring_slot *s;
+    struct io_uring_sqe *sqe;
+    uint32_t slot;
+
+    s = slot_find(ring, ser);
+    if ((s == NULL) || (s->type != SLOT_RECV))
+    {
+        sererr_set("Port has no reception in-flight");
+        return SER_EINVAL;
+    }
+
+    slot = (uint32_t)(s - ring->slots);
+
+    /* slot is released once cancellation completes */
+    s->ser = NULL;
+
+    if (!ring->native)
+    {
+        slot_release(s);
+        return 0;
+    }
+
+    if (uring_sqes_get(ring, 1U) == NULL)
+    {
+        return SER_EFAIL;
+    }
+
+    sqe = uring_sqe_next(ring, slot, OP_CANCEL, -1);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = UD(slot, OP_RECV);
+
+    return 0;
+}
+
+int32_t ser_uring_run_once(ser_uring_t *ring, int32_t timeout)
+{
+    int32_t r;
+    uint32_t i;
+    bool busy = false;
+
+    if (timeout < 0)
+    {
+        sererr_set("Invalid timeout");
+        return SER_EINVAL;
+    }
+
+    ring->dispatched = 0;
+
+    if (!ring->native)
+    {
+        r = fallback_run(ring,
+                         (timeout == SER_NO_TIMEOUT) ? -1 : (int)timeout);
+        return (r < 0) ? r : ring->dispatched;
+    }
+
+    /* nothing to wait for */
+    for (i = 0U; (i < ring->depth) && !busy; i++)
+    {
+        busy = (ring->slots[i].type != SLOT_FREE);
+    }
+
+    /* submit + wait: a single system call */
+    r = uring_enter(ring, busy,
+                    (timeout == SER_NO_TIMEOUT) ? -1 : (int)timeout);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    uring_reap(ring);
+
+    /* flush operations queued by callbacks */
+    if (ring->sq_local_tail != *ring->sq_tail)
+    {
+        r = uring_enter(ring, false, 0);
+        if (r < 0)
+        {
+            return r;
+        }
+    }
+
+    return ring->dispatched;
+}
@@ -0,0 +1,182 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef __linux__
+# define _GNU_SOURCE
+#endif
+
+#include "sercomm/posix/wait.h"
+
+#include <stdbool.h>
+#include <errno.h>
+
+#ifndef __linux__
+# include <sys/select.h>
+#endif
+
+#include "sercomm/posix/time.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+#ifndef __linux__
+/**
+ * Wait until any descriptor is ready (select() based poll() emulation).
+ *
+ * @param [in, out] pfds
+ *      Descriptors and events of interest.
+ * @param [in] nfds
+ *      Number of descriptors.
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      Same as poll().
+ */
+static int select_poll(struct pollfd *pfds, nfds_t nfds,
+                       const ser_deadline_t *deadline)
+{
+    fd_set rfds;
+    fd_set wfds;
+    int fd_max = -1;
+    struct timespec remaining;
+    struct timeval tv;
+    struct timeval *tvp = NULL;
+    nfds_t i;
+    int s;
+
+    FD_ZERO(&rfds);
+    FD_ZERO(&wfds);
+
+    for (i = 0U; i < nfds; i++)
+    {
+        pfds[i].revents = 0;
+
+        if (pfds[i].fd < 0)
+        {
+            continue;
+        }
+
+        /* fd_set is a fixed size bitmap: never write beyond it */
+        if (pfds[i].fd >= FD_SETSIZE)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+
+        if ((pfds[i].events & POLLIN) != 0)
+        {
+            FD_SET(pfds[i].fd, &rfds);
+        }
+
+        if ((pfds[i].events & POLLOUT) != 0)
+        {
+            FD_SET(pfds[i].fd, &wfds);
+        }
+
+        if (pfds[i].fd > fd_max)
+        {
+            fd_max = pfds[i].fd;
+        }
+    }
+
+    if (clock__remaining(deadline, &remaining) == true)
+    {
+        /* round up, so that the deadline is never reported early */
+        tv.tv_sec = remaining.tv_sec;
+        tv.tv_usec = (remaining.tv_nsec + 999) / 1000;
+        if (tv.tv_usec >= 1000000)
+        {
+            tv.tv_sec++;
+            tv.tv_usec -= 1000000;
+        }
+
+        tvp = &tv;
+    }
+
+    s = select(fd_max + 1, &rfds, &wfds, NULL, tvp);
+    if (s <= 0)
+    {
+        return s;
+    }
+
+    s = 0;
+    for (i = 0U; i < nfds; i++)
+    {
+        if (pfds[i].fd < 0)
+        {
+            continue;
+        }
+
+        if (FD_ISSET(pfds[i].fd, &rfds))
+        {
+            pfds[i].revents |= POLLIN;
+        }
+
+        if (FD_ISSET(pfds[i].fd, &wfds))
+        {
+            pfds[i].revents |= POLLOUT;
+        }
+
+        if (pfds[i].revents != 0)
+        {
+            s++;
+        }
+    }
+
+    return s;
+}
+#endif
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int pwait_poll(struct pollfd *pfds, nfds_t nfds,
+               const ser_deadline_t *deadline)
+{
+    int s;
+
+    do
+    {
+#ifdef __linux__
+        struct timespec remaining;
+        struct timespec *timeout = NULL;
+
+        /* remaining time is recomputed on each try, so retries after an
+         * interruption never extend the deadline */
+        if (clock__remaining(deadline, &remaining) == true)
+        {
+            timeout = &remaining;
+        }
+
+        s = ppoll(pfds, nfds, timeout, NULL);
+#else
+        s = select_poll(pfds, nfds, deadline);
+#endif
+    } while ((s < 0) && (errno == EINTR));
+
+    return s;
+}
@@ -0,0 +1,173 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 Ingenia-CAT S.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sercomm/transact.h"
+
+#include "sercomm/err.h"
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+int32_t transact_want(const ser_transact_opts_t *opts, size_t rsp_cap,
+                      size_t *want)
+{
+    /* framed responses may take the whole buffer */
+    *want = (opts->framer != NULL) ? rsp_cap : opts->rsp_sz;
+    if ((*want == 0U) || (*want > rsp_cap))
+    {
+        sererr_set("Invalid response size");
+        return SER_EINVAL;
+    }
+
+    return 0;
+}
+
+int32_t transact_check(const ser_transact_opts_t *opts, const uint8_t *rsp,
+                       size_t *recvd, size_t want)
+{
+    int32_t frame_sz;
+
+    if (opts->framer == NULL)
+    {
+        return (*recvd == want) ? 1 : 0;
+    }
+
+    frame_sz = opts->framer(opts->framer_ctx, rsp, *recvd);
+    if ((frame_sz < 0) || ((size_t)frame_sz > *recvd))
+    {
+        sererr_set("Invalid response");
+        return (frame_sz < 0) ? frame_sz : SER_EINVAL;
+    }
+    else if (frame_sz > 0)
+    {
+        *recvd = (size_t)frame_sz;
+        return 1;
+    }
+    else if (*recvd == want)
+    {
+        sererr_set("Response does not fit in the buffer");
+        return SER_EINVAL;
+    }
+
+    return 0;
+}
+
+int deadline_cmp(const ser_deadline_t *a, const ser_deadline_t *b)
+{
+    if (a->sec != b->sec)
+    {
+        return (a->sec < b->sec) ? -1 : 1;
+    }
+
+    if (a->nsec != b->nsec)
+    {
+        return (a->nsec < b->nsec) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+int32_t ser_transact(ser_t *ser, const void *req, size_t req_sz, void *rsp,
+                     size_t rsp_cap, const ser_transact_opts_t *opts,
+                     size_t *rsp_sz, const ser_deadline_t *deadline)
+{
+    int32_t r;
+
+    uint8_t *rspc = rsp;
+    size_t recvd = 0U;
+    size_t want;
+
+    r = transact_want(opts, rsp_cap, &want);
+    if (r < 0)
+    {
+        goto out;
+    }
+
+    /* discard stale input (e.g. late replies to timed out requests) */
+    if (opts->flush != 0U)
+    {
+        r = ser_flush(ser, SER_QUEUE_IN);
+        if (r < 0)
+        {
+            goto out;
+        }
+    }
+
+    r = ser_write_until(ser, req, req_sz, NULL, deadline);
+    if (r < 0)
+    {
+        goto out;
+    }
+
+    for (;;)
+    {
+        size_t recvd_now = 0U;
+
+        /* the response is never there right after the request: wait first
+         * (saves a read that would find nothing) */
+        r = ser_read_wait_until(ser, deadline);
+        if (r < 0)
+        {
+            break;
+        }
+
+        r = ser_try_read(ser, rspc + recvd, want - recvd, &recvd_now);
+        if (r == SER_EEMPTY)
+        {
+            continue;
+        }
+        else if (r < 0)
+        {
+            break;
+        }
+
+        recvd += recvd_now;
+
+        r = transact_check(opts, rspc, &recvd, want);
+        if (r != 0)
+        {
+            break;
+        }
+    }
+
+    /* complete */
+    if (r > 0)
+    {
+        r = 0;
+    }
+
+out:
+    /* optionally store response size (received bytes on failure) */
+    if (rsp_sz != NULL)
+    {
+        *rsp_sz = recvd;
+    }
+
+    return r;
+}
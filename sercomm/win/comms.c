@@ -27,6 +27,9 @@
 #include <string.h>
 #include <errno.h>
 
+#include "public/sercomm/cyclic.h"
+#include "public/sercomm/transact.h"
+
 #include "sercomm/err.h"
 #include "sercomm/win/err.h"
 #include "sercomm/win/types.h"
@@ -92,121 +95,90 @@ int32_t werr(const DWORD *wr)
 }
 
 /**
- * Configure port.
+ * Set the line settings (baudrate, byte size, parity and stop bits).
  *
- * @param [in] ser
- *      Closed library instance.
  * @param [in] opts
  *      Port configuration.
+ * @param [in, out] dcb
+ *      Port settings.
  *
  * @return
  *      0 on success, error code otherwise.
  */
-static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
+static int32_t port_line(const ser_opts_t *opts, DCB *dcb)
 {
-    int32_t r = 0;
-
-    DCB dcb;
-    COMMTIMEOUTS timeouts;
-
-    /* store current state, timeouts */
-    if (GetCommState(ser->hnd, &ser->dcb_old) == FALSE)
-    {
-        r = werr(NULL);
-        goto out;
-    }
-
-    if (GetCommTimeouts(ser->hnd, &ser->timeouts_old) == FALSE)
-    {
-        r = werr(NULL);
-        goto out;
-    }
-
-    /* configure port settings */
-    memset(&dcb, 0, sizeof(dcb));
-
-    dcb.DCBlength = sizeof(dcb);
-
-    dcb.BaudRate = (DWORD)opts->baudrate;
+    dcb->BaudRate = (DWORD)opts->baudrate;
 
     switch (opts->bytesz)
     {
         case SER_BYTESZ_8:
-            dcb.ByteSize = 8;
+            dcb->ByteSize = 8;
             break;
         case SER_BYTESZ_7:
-            dcb.ByteSize = 7;
+            dcb->ByteSize = 7;
             break;
         case SER_BYTESZ_6:
-            dcb.ByteSize = 6;
+            dcb->ByteSize = 6;
             break;
         case SER_BYTESZ_5:
-            dcb.ByteSize = 5;
+            dcb->ByteSize = 5;
             break;
         default:
             sererr_set("Invalid byte size");
-            r = SER_EINVAL;
-            goto out;
+            return SER_EINVAL;
     }
 
     switch (opts->parity)
     {
         case SER_PAR_NONE:
-            dcb.Parity = NOPARITY;
+            dcb->Parity = NOPARITY;
             break;
         case SER_PAR_ODD:
-            dcb.Parity = ODDPARITY;
+            dcb->Parity = ODDPARITY;
             break;
         case SER_PAR_EVEN:
-            dcb.Parity = EVENPARITY;
+            dcb->Parity = EVENPARITY;
             break;
         case SER_PAR_MARK:
-            dcb.Parity = MARKPARITY;
+            dcb->Parity = MARKPARITY;
             break;
         case SER_PAR_SPACE:
-            dcb.Parity = SPACEPARITY;
+            dcb->Parity = SPACEPARITY;
             break;
         default:
             sererr_set("Invalid parity type");
-            r = SER_EINVAL;
-            goto out;
+            return SER_EINVAL;
     }
 
     switch (opts->stopbits)
     {
         case SER_STOPB_ONE:
-            dcb.StopBits = ONESTOPBIT;
+            dcb->StopBits = ONESTOPBIT;
             break;
         case SER_STOPB_ONE5:
-            dcb.StopBits = ONE5STOPBITS;
+            dcb->StopBits = ONE5STOPBITS;
             break;
         case SER_STOPB_TWO:
-            dcb.StopBits = TWOSTOPBITS;
+            dcb->StopBits = TWOSTOPBITS;
             break;
         default:
             sererr_set("Invalid number of stop bits");
-            r = SER_EINVAL;
-            goto out;
-    }
-
-    if (SetCommState(ser->hnd, &dcb) == FALSE)
-    {
-        r = werr(NULL);
-        goto out;
+            return SER_EINVAL;
     }
 
-    /* configure port timeouts - only using WaitFor..., so 'disable' the Comms
-     * timeouts */
-    memset(&timeouts, 0, sizeof(timeouts));
-
-    timeouts.ReadIntervalTimeout = MAXDWORD;
-
-    if (SetCommTimeouts(ser->hnd, &timeouts) == FALSE)
-    {
-        r = werr(NULL);
-        goto restore;
-    }
+    return 0;
+}
 
+/**
+ * Store the timeouts (used by waits).
+ *
+ * @param [in] ser
+ *      Library instance.
+ * @param [in] opts
+ *      Port configuration.
+ */
+static void port_timeouts(ser_t *ser, const ser_opts_t *opts)
+{
     if (opts->timeouts.rd == SER_NO_TIMEOUT)
     {
         ser->timeouts.rd = INFINITE;
@@ -222,146 +194,127 @@ static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
     }
     else
     {
-        ser->timeouts.wr = (DWORD)opts->timeouts.rd;
+        ser->timeouts.wr = (DWORD)opts->timeouts.wr;
     }
-
-    /* purge input buffer */
-    (void)PurgeComm(ser->hnd, PURGE_RXCLEAR);
-
-    goto out;
-
-restore:
-    SetCommState(ser->hnd, &ser->dcb_old);
-
-out:
-    return r;
 }
 
-/*******************************************************************************
-* Public
-******************************************************************************/
-
-int32_t ser_open(ser_t *inst, const ser_opts_t *opts)
+/**
+ * Configure port.
+ *
+ * @param [in] ser
+ *      Closed library instance.
+ * @param [in] opts
+ *      Port configuration.
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_configure(ser_t *ser, const ser_opts_t *opts)
 {
     int32_t r = 0;
-    char *port;
 
-    /* prepend '\\.\' to port name (required for > COM9) */
-    port = malloc(sizeof(PORT_PREFIX) + strlen(opts->port));
-    if (port == NULL)
+    DCB dcb;
+    COMMTIMEOUTS timeouts;
+
+    /* store current state, timeouts */
+    if (GetCommState(ser->hnd, &ser->dcb_old) == FALSE)
     {
-        sererr_set("%s", strerror(errno));
+        r = werr(NULL);
         goto out;
     }
 
-    strcpy(port, PORT_PREFIX);
-    strcat(port, opts->port);
-
-    /* open port */
-    inst->hnd = CreateFile(
-        port,
-        GENERIC_READ | GENERIC_WRITE,
-        0,
-        NULL,
-        OPEN_EXISTING,
-        FILE_FLAG_OVERLAPPED,
-        NULL);
-
-    free(port);
-
-    if (inst->hnd == INVALID_HANDLE_VALUE)
+    if (GetCommTimeouts(ser->hnd, &ser->timeouts_old) == FALSE)
     {
         r = werr(NULL);
         goto out;
     }
 
-    /* configure port */
-    r = port_configure(inst, opts);
+    /* configure port settings */
+    memset(&dcb, 0, sizeof(dcb));
+
+    dcb.DCBlength = sizeof(dcb);
+
+    r = port_line(opts, &dcb);
     if (r < 0)
     {
-        goto cleanup;
+        goto out;
     }
 
-    /* subscribe to reception events */
-    if (SetCommMask(inst->hnd, EV_RXCHAR) == FALSE)
+    if (SetCommState(ser->hnd, &dcb) == FALSE)
     {
         r = werr(NULL);
-        goto cleanup;
+        goto out;
     }
 
-    goto out;
-
-cleanup:
-    CloseHandle(inst->hnd);
-
-out:
-    return r;
-}
+    /* configure port timeouts - only using WaitFor..., so 'disable' the Comms
+     * timeouts */
+    memset(&timeouts, 0, sizeof(timeouts));
 
-void ser_close(ser_t *inst)
-{
-    /* restore old settings, close port */
-    SetCommState(inst->hnd, &inst->dcb_old);
-    SetCommTimeouts(inst->hnd, &inst->timeouts_old);
+    timeouts.ReadIntervalTimeout = MAXDWORD;
 
-    /* QUIRK: CloseHandle may raise an exception which may lead to crashes
-     * when running, for example, from a Python wrapper. This situation has
-     * only been observed on some virtual COM ports.
-     */
-    __try
+    if (SetCommTimeouts(ser->hnd, &timeouts) == FALSE)
     {
-        CloseHandle(inst->hnd);
+        r = werr(NULL);
+        goto restore;
     }
-    __except (EXCEPTION_CONTINUE_EXECUTION) {}
-}
 
-int32_t ser_flush(ser_t *inst, ser_queue_t flush)
-{
-    DWORD flags;
+    port_timeouts(ser, opts);
 
-    /* map to the corresponding PurgeComm flags */
-    switch (flush)
-    {
-        case SER_QUEUE_IN:
-            flags = PURGE_RXCLEAR;
-            break;
-        case SER_QUEUE_OUT:
-            flags = PURGE_TXCLEAR;
-            break;
-        case SER_QUEUE_ALL:
-            flags = PURGE_RXCLEAR | PURGE_TXCLEAR;
-            break;
-        default:
-            sererr_set("Invalid queue specified");
-            return SER_EINVAL;
-    }
+    /* purge input buffer */
+    (void)PurgeComm(ser->hnd, PURGE_RXCLEAR);
 
-    if (PurgeComm(inst->hnd, flags) == FALSE)
-    {
-        return werr(NULL);
-    }
+    goto out;
 
-    return 0;
+restore:
+    SetCommState(ser->hnd, &ser->dcb_old);
+
+out:
+    return r;
 }
 
-int32_t ser_available(ser_t *inst, size_t *available)
+/**
+ * Obtain remaining time until a deadline.
+ *
+ * @param [in] deadline
+ *      Deadline.
+ *
+ * @return
+ *      Remaining time (ms), INFINITE if deadline never expires.
+ */
+static DWORD deadline_remaining(const ser_deadline_t *deadline)
 {
-    int32_t r = 0;
-    COMSTAT cs;
+    ULONGLONG now;
+    ULONGLONG end;
 
-    if (ClearCommError(inst->hnd, NULL, &cs) == FALSE)
+    if (deadline->sec == INT64_MAX)
     {
-        r = werr(NULL);
+        return INFINITE;
     }
-    else
+
+    now = GetTickCount64();
+    end = ((ULONGLONG)deadline->sec * 1000) +
+          (((ULONGLONG)deadline->nsec + 999999) / 1000000);
+
+    if (end <= now)
     {
-        *available = (size_t)cs.cbInQue;
+        return 0;
     }
 
-    return r;
+    return (DWORD)(end - now);
 }
 
-int32_t ser_read_wait(ser_t *inst)
+/**
+ * Wait until serial port has received bytes.
+ *
+ * @param [in] inst
+ *      Opened library instance.
+ * @param [in] timeout
+ *      Timeout (ms).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_wait_rx(ser_t *inst, DWORD timeout)
 {
     int32_t r = 0;
 
@@ -386,7 +339,7 @@ int32_t ser_read_wait(ser_t *inst)
         /* no event was set, wait until some are received */
         if (wr == ERROR_IO_PENDING)
         {
-            wr = WaitForSingleObject(ovs.hEvent, inst->timeouts.rd);
+            wr = WaitForSingleObject(ovs.hEvent, timeout);
             switch (wr)
             {
                 case WAIT_OBJECT_0:
@@ -424,33 +377,58 @@ out:
     return r;
 }
 
-int32_t ser_read(ser_t *inst, void *buf, size_t sz, size_t *recvd)
+/**
+ * Write to serial port.
+ *
+ * @param [in] inst
+ *      Opened library instance.
+ * @param [in] buf
+ *      Buffer with the data to be written.
+ * @param [in] sz
+ *      Number of bytes to write.
+ * @param [in] sent
+ *      Number of actual written bytes (optional).
+ * @param [in] timeout
+ *      Timeout (ms).
+ * @param [out] issued
+ *      Time right after the write was accepted by the driver (optional).
+ *
+ * @return
+ *      0 on success, error code otherwise.
+ */
+static int32_t port_write(ser_t *inst, const void *buf, size_t sz,
+                          size_t *sent, DWORD timeout, ser_deadline_t *issued)
 {
     int32_t r = 0;
 
-    OVERLAPPED ovr = { 0 };
-    DWORD recvd_ = 0;
+    OVERLAPPED ovw = { 0 };
+    DWORD sent_ = 0;
+    BOOL done;
 
-    /* create event for the read completion */
-    ovr.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (ovr.hEvent == NULL)
+    /* create event for the write completion */
+    ovw.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (ovw.hEvent == NULL)
     {
-        werr_set();
-        r = SER_EFAIL;
+        r = werr(NULL);
         goto out;
     }
 
-    /* try read */
-    if (ReadFile(inst->hnd, buf, (DWORD)sz, NULL, &ovr) == FALSE)
+    /* try write */
+    done = WriteFile(inst->hnd, buf, (DWORD)sz, &sent_, &ovw);
+    if (done == FALSE)
     {
         DWORD wr;
 
         wr = GetLastError();
-
-        /* read pending, wait until completion */
         if (wr == ERROR_IO_PENDING)
         {
-            wr = WaitForSingleObject(ovr.hEvent, inst->timeouts.rd);
+            if (issued != NULL)
+            {
+                *issued = ser_deadline_in_ns(0);
+            }
+
+            /* write is pending, wait until completion */
+            wr = WaitForSingleObject(ovw.hEvent, timeout);
             switch (wr)
             {
                 case WAIT_OBJECT_0:
@@ -466,59 +444,428 @@ int32_t ser_read(ser_t *inst, void *buf, size_t sz, size_t *recvd)
             goto cleanup;
         }
     }
+    else if (issued != NULL)
+    {
+        *issued = ser_deadline_in_ns(0);
+    }
 
-    /* obtain results */
-    if (GetOverlappedResult(inst->hnd, &ovr, &recvd_, FALSE) == FALSE)
+    if (GetOverlappedResult(inst->hnd, &ovw, &sent_, FALSE) == FALSE)
     {
         r = werr(NULL);
         goto cleanup;
     }
 
-    /* no more bytes available */
-    if (recvd_ == 0)
+    /* optionally store written bytes */
+    if (sent != NULL)
     {
-        sererr_set("No bytes available");
-        r = SER_EEMPTY;
+        *sent = (size_t)sent_;
     }
 
-    /* optionally store received bytes */
-    if (recvd != NULL)
-    {
-        *recvd = (size_t)recvd_;
-    }
+cleanup:
+    CloseHandle(ovw.hEvent);
+
+out:
+    return r;
+}
+
+/*******************************************************************************
+* Public
+******************************************************************************/
+
+ser_deadline_t ser_deadline_in(int32_t timeout)
+{
+    /* negative timeouts never expire (as #SER_NO_TIMEOUT) */
+    if (timeout <= SER_NO_TIMEOUT)
+    {
+        return ser_deadline_in_ns(-1);
+    }
+
+    return ser_deadline_in_ns((int64_t)timeout * 1000000);
+}
+
+ser_deadline_t ser_deadline_in_ns(int64_t timeout_ns)
+{
+    ser_deadline_t deadline = SER_DEADLINE_NEVER;
+    ULONGLONG now;
+
+    if (timeout_ns >= 0)
+    {
+        /* tick count has millisecond resolution */
+        now = GetTickCount64();
+
+        deadline.sec = (int64_t)(now / 1000) + (timeout_ns / 1000000000);
+        deadline.nsec = (int32_t)(((now % 1000) * 1000000) +
+                                  (timeout_ns % 1000000000));
+
+        if (deadline.nsec >= 1000000000)
+        {
+            deadline.sec++;
+            deadline.nsec -= 1000000000;
+        }
+    }
+
+    return deadline;
+}
+
+int32_t ser_open(ser_t *inst, const ser_opts_t *opts)
+{
+    int32_t r = 0;
+    char *port;
+
+    /* prepend '\\.\' to port name (required for > COM9) */
+    port = malloc(sizeof(PORT_PREFIX) + strlen(opts->port));
+    if (port == NULL)
+    {
+        sererr_set("%s", strerror(errno));
+        goto out;
+    }
+
+    strcpy(port, PORT_PREFIX);
+    strcat(port, opts->port);
+
+    /* open port */
+    inst->hnd = CreateFile(
+        port,
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_OVERLAPPED,
+        NULL);
+
+    free(port);
+
+    if (inst->hnd == INVALID_HANDLE_VALUE)
+    {
+        r = werr(NULL);
+        goto out;
+    }
+
+    /* configure port */
+    r = port_configure(inst, opts);
+    if (r < 0)
+    {
+        goto cleanup;
+    }
+
+    /* subscribe to reception events */
+    if (SetCommMask(inst->hnd, EV_RXCHAR) == FALSE)
+    {
+        r = werr(NULL);
+        goto cleanup;
+    }
+
+    /* the driver already receives in the background: use the requested ring
+     * size as a hint for its input queue size */
+    if (opts->rx.ring_sz > 0U)
+    {
+        DWORD in_sz;
+
+        in_sz = (opts->rx.ring_sz > MAXDWORD) ? MAXDWORD :
+                                                (DWORD)opts->rx.ring_sz;
+
+        if (SetupComm(inst->hnd, in_sz, 0U) == FALSE)
+        {
+            r = werr(NULL);
+            goto cleanup;
+        }
+    }
+
+    goto out;
 
 cleanup:
-    CloseHandle(ovr.hEvent);
+    CloseHandle(inst->hnd);
 
 out:
     return r;
 }
 
-int32_t ser_write(ser_t *inst, const void *buf, size_t sz, size_t *sent)
+void ser_close(ser_t *inst)
+{
+    /* restore old settings, close port */
+    SetCommState(inst->hnd, &inst->dcb_old);
+    SetCommTimeouts(inst->hnd, &inst->timeouts_old);
+
+    /* QUIRK: CloseHandle may raise an exception which may lead to crashes
+     * when running, for example, from a Python wrapper. This situation has
+     * only been observed on some virtual COM ports.
+     */
+    __try
+    {
+        CloseHandle(inst->hnd);
+    }
+    __except (EXCEPTION_CONTINUE_EXECUTION) {}
+}
+
+int32_t ser_reconfigure(ser_t *inst, const ser_opts_t *opts,
+                        ser_reconf_t when)
+{
+    int32_t r;
+    DCB dcb;
+    DCB dcb_new;
+
+    if ((when != SER_RECONF_NOW) && (when != SER_RECONF_DRAIN))
+    {
+        sererr_set("Invalid reconfiguration timing");
+        return SER_EINVAL;
+    }
+
+    /* new line settings over the current ones (validated first) */
+    memset(&dcb, 0, sizeof(dcb));
+    dcb.DCBlength = sizeof(dcb);
+
+    if (GetCommState(inst->hnd, &dcb) == FALSE)
+    {
+        return werr(NULL);
+    }
+
+    dcb_new = dcb;
+
+    r = port_line(opts, &dcb_new);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    if (when == SER_RECONF_DRAIN)
+    {
+        ser_deadline_t deadline;
+
+        deadline = ser_deadline_in((inst->timeouts.wr == INFINITE) ?
+                                   SER_NO_TIMEOUT :
+                                   (int32_t)inst->timeouts.wr);
+
+        r = ser_drain(inst, &deadline);
+        if (r < 0)
+        {
+            return r;
+        }
+    }
+
+    /* apply changed settings only (queues are not purged) */
+    if ((dcb_new.BaudRate != dcb.BaudRate) ||
+        (dcb_new.ByteSize != dcb.ByteSize) || (dcb_new.Parity != dcb.Parity) ||
+        (dcb_new.StopBits != dcb.StopBits))
+    {
+        if (SetCommState(inst->hnd, &dcb_new) == FALSE)
+        {
+            return werr(NULL);
+        }
+    }
+
+    port_timeouts(inst, opts);
+
+    return 0;
+}
+
+int32_t ser_autobaud(ser_t *inst, const ser_autobaud_opts_t *opts,
+                     uint32_t *baudrate)
+{
+    (void)inst;
+    (void)opts;
+    (void)baudrate;
+
+    sererr_set("Automatic baudrate detection is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_flush(ser_t *inst, ser_queue_t flush)
+{
+    DWORD flags;
+
+    /* map to the corresponding PurgeComm flags */
+    switch (flush)
+    {
+        case SER_QUEUE_IN:
+            flags = PURGE_RXCLEAR;
+            break;
+        case SER_QUEUE_OUT:
+            flags = PURGE_TXCLEAR;
+            break;
+        case SER_QUEUE_ALL:
+            flags = PURGE_RXCLEAR | PURGE_TXCLEAR;
+            break;
+        default:
+            sererr_set("Invalid queue specified");
+            return SER_EINVAL;
+    }
+
+    if (PurgeComm(inst->hnd, flags) == FALSE)
+    {
+        return werr(NULL);
+    }
+
+    return 0;
+}
+
+int32_t ser_rx_stats(ser_t *inst, ser_rx_stats_t *stats)
+{
+    (void)inst;
+    (void)stats;
+
+    sererr_set("Background reception statistics are not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_low_latency(ser_t *inst, uint32_t *applied)
+{
+    (void)inst;
+    (void)applied;
+
+    sererr_set("Low-latency profile is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_wait_stats(ser_t *inst, ser_wait_stats_t *stats)
+{
+    (void)inst;
+    (void)stats;
+
+    sererr_set("Wait strategies are not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_available(ser_t *inst, size_t *available)
 {
     int32_t r = 0;
+    COMSTAT cs;
 
-    OVERLAPPED ovw = { 0 };
-    DWORD sent_ = 0;
+    if (ClearCommError(inst->hnd, NULL, &cs) == FALSE)
+    {
+        r = werr(NULL);
+    }
+    else
+    {
+        *available = (size_t)cs.cbInQue;
+    }
 
-    /* create event for the write completion */
-    ovw.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-    if (ovw.hEvent == NULL)
+    return r;
+}
+
+int32_t ser_outq(ser_t *inst, size_t *queued)
+{
+    int32_t r = 0;
+    COMSTAT cs;
+
+    if (ClearCommError(inst->hnd, NULL, &cs) == FALSE)
     {
         r = werr(NULL);
+    }
+    else
+    {
+        *queued = (size_t)cs.cbOutQue;
+    }
+
+    return r;
+}
+
+int32_t ser_drain(ser_t *inst, const ser_deadline_t *deadline)
+{
+    /* transmitter status is not reported: poll the driver queue */
+    for (;;)
+    {
+        COMSTAT cs;
+
+        if (ClearCommError(inst->hnd, NULL, &cs) == FALSE)
+        {
+            return werr(NULL);
+        }
+
+        if (cs.cbOutQue == 0)
+        {
+            break;
+        }
+
+        if (deadline_remaining(deadline) == 0)
+        {
+            sererr_set("Operation timed out");
+            return SER_ETIMEDOUT;
+        }
+
+        Sleep(1);
+    }
+
+    return 0;
+}
+
+int32_t ser_get_baudrate(ser_t *inst, uint32_t *baudrate)
+{
+    DCB dcb;
+
+    memset(&dcb, 0, sizeof(dcb));
+    dcb.DCBlength = sizeof(dcb);
+
+    if (GetCommState(inst->hnd, &dcb) == FALSE)
+    {
+        return werr(NULL);
+    }
+
+    *baudrate = (uint32_t)dcb.BaudRate;
+
+    return 0;
+}
+
+int32_t ser_read_wait(ser_t *inst)
+{
+    return port_wait_rx(inst, inst->timeouts.rd);
+}
+
+int32_t ser_read_wait_until(ser_t *inst, const ser_deadline_t *deadline)
+{
+    return port_wait_rx(inst, deadline_remaining(deadline));
+}
+
+int32_t ser_read_available(ser_t *inst, void *buf, size_t sz, size_t *recvd)
+{
+    int32_t r;
+    size_t available;
+
+    r = ser_available(inst, &available);
+    if (r < 0)
+    {
+        return r;
+    }
+
+    /* nothing pending: wait first */
+    if (available == 0U)
+    {
+        r = port_wait_rx(inst, inst->timeouts.rd);
+        if (r < 0)
+        {
+            return r;
+        }
+    }
+
+    return ser_read(inst, buf, sz, recvd);
+}
+
+int32_t ser_read(ser_t *inst, void *buf, size_t sz, size_t *recvd)
+{
+    int32_t r = 0;
+
+    OVERLAPPED ovr = { 0 };
+    DWORD recvd_ = 0;
+
+    /* create event for the read completion */
+    ovr.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (ovr.hEvent == NULL)
+    {
+        werr_set();
+        r = SER_EFAIL;
         goto out;
     }
 
-    /* try write */
-    if (WriteFile(inst->hnd, buf, (DWORD)sz, &sent_, &ovw) == FALSE)
+    /* try read */
+    if (ReadFile(inst->hnd, buf, (DWORD)sz, NULL, &ovr) == FALSE)
     {
         DWORD wr;
 
         wr = GetLastError();
+
+        /* read pending, wait until completion */
         if (wr == ERROR_IO_PENDING)
         {
-            /* write is pending, wait until completion */
-            wr = WaitForSingleObject(ovw.hEvent, inst->timeouts.wr);
+            wr = WaitForSingleObject(ovr.hEvent, inst->timeouts.rd);
             switch (wr)
             {
                 case WAIT_OBJECT_0:
@@ -535,21 +882,398 @@ int32_t ser_write(ser_t *inst, const void *buf, size_t sz, size_t *sent)
         }
     }
 
-    if (GetOverlappedResult(inst->hnd, &ovw, &sent_, FALSE) == FALSE)
+    /* obtain results */
+    if (GetOverlappedResult(inst->hnd, &ovr, &recvd_, FALSE) == FALSE)
     {
         r = werr(NULL);
         goto cleanup;
     }
 
-    /* optionally store written bytes */
-    if (sent != NULL)
+    /* no more bytes available */
+    if (recvd_ == 0)
     {
-        *sent = (size_t)sent_;
+        sererr_set("No bytes available");
+        r = SER_EEMPTY;
+    }
+
+    /* optionally store received bytes */
+    if (recvd != NULL)
+    {
+        *recvd = (size_t)recvd_;
     }
 
 cleanup:
-    CloseHandle(ovw.hEvent);
+    CloseHandle(ovr.hEvent);
 
 out:
     return r;
 }
+
+int32_t ser_write(ser_t *inst, const void *buf, size_t sz, size_t *sent)
+{
+    return port_write(inst, buf, sz, sent, inst->timeouts.wr, NULL);
+}
+
+int32_t ser_write_until(ser_t *inst, const void *buf, size_t sz, size_t *sent,
+                        const ser_deadline_t *deadline)
+{
+    return port_write(inst, buf, sz, sent, deadline_remaining(deadline),
+                      NULL);
+}
+
+int32_t ser_write_at(ser_t *inst, const void *buf, size_t sz, size_t *sent,
+                     const ser_deadline_t *at, ser_deadline_t *sent_at)
+{
+    DWORD remaining;
+
+    if (at->sec == INT64_MAX)
+    {
+        sererr_set("Invalid time");
+        return SER_EINVAL;
+    }
+
+    /* tick count has millisecond resolution: sleep all but the last tick */
+    remaining = deadline_remaining(at);
+    if (remaining > 1)
+    {
+        Sleep(remaining - 1);
+    }
+
+    while (deadline_remaining(at) > 0)
+    {
+        YieldProcessor();
+    }
+
+    /* timestamp of the write accepted by the driver */
+    return port_write(inst, buf, sz, sent, inst->timeouts.wr, sent_at);
+}
+
+int32_t ser_read_exact(ser_t *inst, void *buf, size_t sz, size_t *recvd,
+                       const ser_deadline_t *deadline)
+{
+    int32_t r = 0;
+
+    size_t recvd_ = 0;
+    uint8_t *bufc = buf;
+
+    while (recvd_ < sz)
+    {
+        size_t recvd_now = 0;
+
+        /* read all remaining bytes (returns those available) */
+        r = ser_read(inst, bufc + recvd_, sz - recvd_, &recvd_now);
+        recvd_ += recvd_now;
+
+        if (r == SER_EEMPTY)
+        {
+            /* nothing queued: wait (bounded by the overall deadline) */
+            r = port_wait_rx(inst, deadline_remaining(deadline));
+        }
+
+        if (r < 0)
+        {
+            break;
+        }
+    }
+
+    /* optionally store received bytes (also partial ones) */
+    if (recvd != NULL)
+    {
+        *recvd = recvd_;
+    }
+
+    return r;
+}
+
+int32_t ser_readv(ser_t *inst, const ser_iov_t *iov, size_t iovcnt,
+                  size_t *recvd)
+{
+    int32_t r = 0;
+
+    size_t recvd_ = 0;
+    size_t i;
+
+    /* read into each buffer until no more bytes are available */
+    for (i = 0; i < iovcnt; i++)
+    {
+        size_t recvd_now = 0;
+
+        if (iov[i].sz == 0)
+        {
+            continue;
+        }
+
+        r = ser_read(inst, iov[i].buf, iov[i].sz, &recvd_now);
+        recvd_ += recvd_now;
+
+        if (r < 0)
+        {
+            /* some bytes were already read: not an error */
+            if ((r == SER_EEMPTY) && (recvd_ > 0))
+            {
+                r = 0;
+            }
+
+            break;
+        }
+
+        if (recvd_now < iov[i].sz)
+        {
+            break;
+        }
+    }
+
+    /* optionally store received bytes */
+    if (recvd != NULL)
+    {
+        *recvd = recvd_;
+    }
+
+    return r;
+}
+
+int32_t ser_writev(ser_t *inst, const ser_iov_t *iov, size_t iovcnt,
+                   size_t *sent)
+{
+    ser_deadline_t deadline;
+
+    /* single deadline for all buffers */
+    deadline = ser_deadline_in((inst->timeouts.wr == INFINITE) ?
+                               SER_NO_TIMEOUT : (int32_t)inst->timeouts.wr);
+
+    return ser_writev_until(inst, iov, iovcnt, sent, &deadline);
+}
+
+int32_t ser_writev_until(ser_t *inst, const ser_iov_t *iov, size_t iovcnt,
+                         size_t *sent, const ser_deadline_t *deadline)
+{
+    int32_t r = 0;
+
+    size_t sent_ = 0;
+    size_t i;
+
+    for (i = 0; (i < iovcnt) && (r == 0); i++)
+    {
+        size_t sent_now = 0;
+
+        if (iov[i].sz == 0)
+        {
+            continue;
+        }
+
+        r = port_write(inst, iov[i].buf, iov[i].sz, &sent_now,
+                       deadline_remaining(deadline), NULL);
+        sent_ += sent_now;
+    }
+
+    /* optionally store written bytes */
+    if (sent != NULL)
+    {
+        *sent = sent_;
+    }
+
+    return r;
+}
+
+int32_t ser_write_async(ser_t *inst, const void *buf, size_t sz,
+                        ser_tx_on_done_t on_done, void *ctx, uint64_t *seq)
+{
+    (void)inst;
+    (void)buf;
+    (void)sz;
+    (void)on_done;
+    (void)ctx;
+    (void)seq;
+
+    sererr_set("Asynchronous transmission is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_write_async_prio(ser_t *inst, const void *buf, size_t sz,
+                             uint8_t prio, const ser_deadline_t *expires,
+                             ser_tx_on_done_t on_done, void *ctx, uint64_t *seq)
+{
+    (void)inst;
+    (void)buf;
+    (void)sz;
+    (void)prio;
+    (void)expires;
+    (void)on_done;
+    (void)ctx;
+    (void)seq;
+
+    sererr_set("Asynchronous transmission is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_tx_stats(ser_t *inst, ser_tx_stats_t *stats)
+{
+    (void)inst;
+    (void)stats;
+
+    sererr_set("Asynchronous transmission is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_pace_stats(ser_t *inst, ser_pace_stats_t *stats)
+{
+    (void)inst;
+    (void)stats;
+
+    sererr_set("Transmit pacing is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_tx_wait(ser_t *inst, uint64_t seq, const ser_deadline_t *deadline)
+{
+    (void)inst;
+    (void)seq;
+    (void)deadline;
+
+    sererr_set("Asynchronous transmission is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_get_fd(ser_t *inst, ser_fd_t *fd)
+{
+    *fd = inst->hnd;
+
+    return 0;
+}
+
+int32_t ser_try_read(ser_t *inst, void *buf, size_t sz, size_t *recvd)
+{
+    /* reads complete immediately with the available bytes (see the read
+     * interval timeout set in port_configure) */
+    return ser_read(inst, buf, sz, recvd);
+}
+
+int32_t ser_try_write(ser_t *inst, const void *buf, size_t sz, size_t *sent)
+{
+    (void)inst;
+    (void)buf;
+    (void)sz;
+    (void)sent;
+
+    sererr_set("Non-blocking writes are not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_write_some(ser_t *inst, const void *buf, size_t sz,
+                       size_t *sent, const ser_deadline_t *deadline)
+{
+    (void)inst;
+    (void)buf;
+    (void)sz;
+    (void)deadline;
+
+    *sent = 0;
+
+    sererr_set("Partial writes are not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_transact_many(ser_transact_item_t *items, size_t cnt,
+                          const ser_deadline_t *deadline)
+{
+    (void)items;
+    (void)cnt;
+    (void)deadline;
+
+    sererr_set("Concurrent transactions are not supported");
+    return SER_ENOTSUP;
+}
+
+ser_hedge_t *ser_hedge_create(ser_t *const *links, size_t cnt,
+                              const ser_hedge_opts_t *opts)
+{
+    (void)links;
+    (void)cnt;
+    (void)opts;
+
+    sererr_set("Hedged transactions are not supported");
+    return NULL;
+}
+
+void ser_hedge_destroy(ser_hedge_t *hg)
+{
+    (void)hg;
+}
+
+int32_t ser_hedge_transact(ser_hedge_t *hg, const void *req, size_t req_sz,
+                           void *rsp, size_t rsp_cap,
+                           const ser_transact_opts_t *opts, size_t *rsp_sz,
+                           size_t *link, const ser_deadline_t *deadline)
+{
+    (void)hg;
+    (void)req;
+    (void)req_sz;
+    (void)rsp;
+    (void)rsp_cap;
+    (void)opts;
+    (void)rsp_sz;
+    (void)link;
+    (void)deadline;
+
+    sererr_set("Hedged transactions are not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_hedge_stats(ser_hedge_t *hg, size_t link,
+                        ser_hedge_link_stats_t *stats)
+{
+    (void)hg;
+    (void)link;
+    (void)stats;
+
+    sererr_set("Hedged transactions are not supported");
+    return SER_ENOTSUP;
+}
+
+ser_cyclic_t *ser_cyclic_create(const ser_rt_t *rt)
+{
+    (void)rt;
+
+    sererr_set("Cyclic executor is not supported");
+    return NULL;
+}
+
+void ser_cyclic_destroy(ser_cyclic_t *cy)
+{
+    (void)cy;
+}
+
+int32_t ser_cyclic_add(ser_cyclic_t *cy, ser_t *ser,
+                       const ser_cyclic_opts_t *opts)
+{
+    (void)cy;
+    (void)ser;
+    (void)opts;
+
+    sererr_set("Cyclic executor is not supported");
+    return SER_ENOTSUP;
+}
+
+int32_t ser_cyclic_start(ser_cyclic_t *cy)
+{
+    (void)cy;
+
+    sererr_set("Cyclic executor is not supported");
+    return SER_ENOTSUP;
+}
+
+void ser_cyclic_stop(ser_cyclic_t *cy)
+{
+    (void)cy;
+}
+
+int32_t ser_cyclic_stats(ser_cyclic_t *cy, ser_t *ser,
+                         ser_cyclic_stats_t *stats)
+{
+    (void)cy;
+    (void)ser;
+    (void)stats;
+
+    sererr_set("Cyclic executor is not supported");
+    return SER_ENOTSUP;
+}
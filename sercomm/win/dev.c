@@ -437,6 +437,12 @@ void ser_dev_list_destroy(ser_dev_list_t *lst)
 }
 
 ser_dev_mon_t *ser_dev_monitor_init(ser_dev_on_event_t on_event, void *ctx)
+{
+    return ser_dev_monitor_init_ex(on_event, ctx, NULL);
+}
+
+ser_dev_mon_t *ser_dev_monitor_init_ex(ser_dev_on_event_t on_event,
+                                       void *ctx, const ser_rt_t *rt)
 {
     ser_dev_mon_t *mon = NULL;
     WNDCLASS wndc;
@@ -495,14 +501,29 @@ ser_dev_mon_t *ser_dev_monitor_init(ser_dev_on_event_t on_event, void *ctx)
         goto cleanup_wndc;
     }
 
-    /* create device monitoring thread, wait for initialization */
-    mon->td = CreateThread(NULL, 0, ser_dev_monitor, mon, 0, &mon->td_id);
+    /* create device monitoring thread (suspended to apply real-time
+     * configuration), wait for initialization */
+    mon->td = CreateThread(NULL, 0, ser_dev_monitor, mon, CREATE_SUSPENDED,
+                           &mon->td_id);
     if (mon->td == NULL)
     {
         werr_set();
         goto cleanup_init;
     }
 
+    if ((rt != NULL) &&
+        (((rt->priority > 0) &&
+          (SetThreadPriority(mon->td, THREAD_PRIORITY_TIME_CRITICAL) == 0)) ||
+         ((rt->cpus != 0U) &&
+          (SetThreadAffinityMask(mon->td, (DWORD_PTR)rt->cpus) == 0))))
+    {
+        werr_set();
+        TerminateThread(mon->td, 0);
+        goto cleanup_td;
+    }
+
+    (void)ResumeThread(mon->td);
+
     /* wait until initialized */
     wr = WaitForSingleObject(mon->init, DEV_MON_INIT_TIMEOUT);
     if (wr != WAIT_OBJECT_0)